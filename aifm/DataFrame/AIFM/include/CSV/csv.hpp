@@ -34,7 +34,9 @@
 
 #include "dataframe_vector.hpp"
 #include "deref_scope.hpp"
+#include "helpers.hpp"
 #include "manager.hpp"
+#include "parallel.hpp"
 #include "simple_time.hpp"
 
 #include <algorithm>
@@ -51,8 +53,15 @@
 #endif
 #include <cassert>
 #include <cerrno>
+#include <exception>
 #include <istream>
 #include <memory>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace io
 {
@@ -1364,33 +1373,213 @@ class CSVReader
     }
 };
 
+namespace detail
+{
+// Returns the end of the line that contains pos, or end if it has none.
+inline const char* find_line_end(const char* pos, const char* end)
+{
+    // memchr() scans with SIMD instructions.
+    auto line_end = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    return line_end ? line_end : end;
+}
+
+// Parses the rows in [begin, end), which starts at a line and ends after one,
+// into cols, where col_order maps the columns of a line to cols. The lines are
+// parsed from a local copy, as parse_line() terminates the fields in place and
+// [begin, end) is read-only (and the last line of a file may have no '\n' to
+// overwrite).
+template <class trim_policy, class quote_policy, class... ColTypes>
+void parse_rows(const char* begin, const char* end, const std::vector<int>& col_order,
+                std::tuple<std::vector<ColTypes>...>& cols)
+{
+    constexpr auto column_count = sizeof...(ColTypes);
+    char* row[column_count];
+    std::string line;
+    auto seq = std::index_sequence_for<ColTypes...>{};
+    while (begin < end) {
+        auto line_end = find_line_end(begin, end);
+        line.assign(begin, line_end);
+        begin = line_end + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        parse_line<trim_policy, quote_policy>(line.data(), row, col_order);
+        [&]<typename T, T... ints>(std::integer_sequence<T, ints...>)
+        {
+            ((parse<throw_on_overflow>(row[ints], std::get<ints>(cols).emplace_back())), ...);
+        }
+        (seq);
+    }
+}
+
+// Estimates the number of rows in total_bytes bytes of a file, given that its
+// first parsed_bytes bytes hold num_rows rows.
+inline uint64_t estimate_num_rows(uint64_t num_rows, uint64_t parsed_bytes,
+                                  uint64_t total_bytes)
+{
+    return static_cast<unsigned __int128>(num_rows) * total_bytes / parsed_bytes;
+}
+
+// Appends column I of every buffer, in order, to vecs.
+template <std::size_t I, class Vecs, class Buffers>
+void append_column(Vecs& vecs, std::vector<Buffers>& buffers)
+{
+    for (auto& buffer : buffers) {
+        auto& vals = std::get<I>(buffer);
+        std::get<I>(vecs).append(vals.data(), vals.size());
+    }
+}
+}  // namespace detail
+
+// Tunes parse_csv_to_vectors(). The defaults suit files of any size; smaller
+// blocks mainly serve to exercise the block loop on small files.
+struct CSVLoadOptions
+{
+    uint64_t block_size           = 64 << 20;
+    uint64_t min_bytes_per_thread = 1 << 20;
+};
+
+// Loads the named columns of the CSV file into far memory. The file is mapped
+// read-only and streamed in blocks of options.block_size bytes, whose pages are dropped
+// once parsed, so that the loader's footprint stays bounded by a block and its
+// column buffers regardless of the file size. Each block is split at line
+// boundaries across the runtime cores, which parse their lines into local
+// column buffers, and the buffers are then appended to the columns (one
+// uthread per column) with DataFrameVector::append(). The server's copies of
+// the columns are reserved up front for the number of rows that the first
+// block implies.
 template <typename... ColTypes, typename... Strs>
 std::tuple<far_memory::DataFrameVector<ColTypes>...> parse_csv_to_vectors(
-    far_memory::FarMemManager* manager, std::string csv_file_path, Strs... col_names)
+    far_memory::FarMemManager* manager, const CSVLoadOptions& options,
+    std::string csv_file_path, Strs... col_names)
 {
-    io::CSVReader<sizeof...(col_names), io::trim_chars<' '>, io::double_quote_escape<',', '\"'>> in(
-        csv_file_path);
-    in.read_header(io::ignore_extra_column, col_names...);
-    std::tuple<ColTypes...> col_fields;
-    auto col_vecs     = std::make_tuple(manager->allocate_dataframe_vector<ColTypes>()...);
-    far_memory::DerefScope scope;
-    uint64_t num_rows = 0;
-    constexpr uint64_t kNumRowsPerScope = 1024;
-    while (std::apply([&](auto&... fields) { return in.read_row(fields...); }, col_fields)) {
-        if (unlikely(((num_rows++) % kNumRowsPerScope) == 0)) {
-            scope.renew();
+    using trim_policy           = io::trim_chars<' '>;
+    using quote_policy          = io::double_quote_escape<',', '\"'>;
+    using Buffers               = std::tuple<std::vector<ColTypes>...>;
+    constexpr auto column_count = sizeof...(ColTypes);
+    static_assert(sizeof...(Strs) == column_count);
+    assert(options.block_size && options.min_bytes_per_thread);
+
+    auto col_vecs = std::make_tuple(manager->allocate_dataframe_vector<ColTypes>()...);
+    auto seq      = std::index_sequence_for<ColTypes...>{};
+
+    int fd = open(csv_file_path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        error::can_not_open_file err;
+        err.set_errno(errno);
+        err.set_file_name(csv_file_path.c_str());
+        if (fd != -1) close(fd);
+        throw err;
+    }
+    uint64_t file_size = st.st_size;
+    if (!file_size) {
+        close(fd);
+        error::header_missing err;
+        err.set_file_name(csv_file_path.c_str());
+        throw err;
+    }
+    auto file = static_cast<const char*>(
+        mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0));
+    auto mmap_errno = errno;
+    close(fd);
+    if (file == MAP_FAILED) {
+        error::can_not_open_file err;
+        err.set_errno(mmap_errno);
+        err.set_file_name(csv_file_path.c_str());
+        throw err;
+    }
+    auto file_addr  = const_cast<char*>(file);
+    madvise(file_addr, file_size, MADV_SEQUENTIAL);
+    auto file_guard = helpers::finally([&]() { munmap(file_addr, file_size); });
+    auto page_size  = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    auto file_end   = file + file_size;
+
+    std::vector<int> col_order;
+    const char* body;
+    {
+        std::string names[column_count] = {std::string(col_names)...};
+        auto header_end                 = detail::find_line_end(file, file_end);
+        std::string header(file, header_end);
+        if (!header.empty() && header.back() == '\r') header.pop_back();
+        detail::parse_header_line<column_count, trim_policy, quote_policy>(
+            header.data(), col_order, names, io::ignore_extra_column);
+        body = std::min(header_end + 1, file_end);
+    }
+
+    bool reserved = false;
+    for (auto block = body; block < file_end;) {
+        auto block_end = block + std::min<uint64_t>(options.block_size, file_end - block);
+        if (block_end != file_end) {
+            block_end = std::min(detail::find_line_end(block_end - 1, file_end) + 1, file_end);
         }
-        auto seq = std::index_sequence_for<ColTypes...>{};
-        [&]<typename T, T... ints>(std::integer_sequence<T, ints...> int_seq)
-        {
-            ((std::get<ints>(col_vecs).push_back(scope, std::get<ints>(col_fields))), ...);
+        uint64_t block_size = block_end - block;
+        auto num_threads =
+            far_memory::get_num_parallel_threads(block_size, options.min_bytes_per_thread);
+        std::vector<const char*> splits(num_threads + 1, block_end);
+        splits[0] = block;
+        for (uint32_t tid = 1; tid < num_threads; tid++) {
+            auto split = block + far_memory::get_parallel_range_begin(block_size, tid, num_threads);
+            splits[tid] = std::max(splits[tid - 1],
+                                   std::min(detail::find_line_end(split - 1, block_end) + 1, block_end));
         }
-        (seq);
+        std::vector<Buffers> buffers(num_threads);
+        std::vector<std::exception_ptr> errors(num_threads);
+        far_memory::parallel_run(num_threads, [&](uint32_t tid) {
+            try {
+                detail::parse_rows<trim_policy, quote_policy>(splits[tid], splits[tid + 1],
+                                                              col_order, buffers[tid]);
+            } catch (...) {
+                errors[tid] = std::current_exception();
+            }
+        });
+        for (auto& err_ptr : errors) {
+            if (!err_ptr) continue;
+            try {
+                std::rethrow_exception(err_ptr);
+            } catch (error::with_file_name& err) {
+                err.set_file_name(csv_file_path.c_str());
+                throw;
+            }
+        }
+
+        if (!reserved) {
+            uint64_t num_rows = 0;
+            for (auto& buffer : buffers) num_rows += std::get<0>(buffer).size();
+            auto num_file_rows = detail::estimate_num_rows(num_rows, block_size, file_end - body);
+            if (num_file_rows) {
+                std::apply([&](auto&... vecs) { (vecs.reserve_remote(num_file_rows), ...); },
+                           col_vecs);
+            }
+            reserved = true;
+        }
+        far_memory::parallel_run(column_count, [&](uint32_t col) {
+            [&]<typename T, T... ints>(std::integer_sequence<T, ints...>)
+            {
+                ((col == ints ? detail::append_column<ints>(col_vecs, buffers) : void()), ...);
+            }
+            (seq);
+        });
+        // Drops the parsed pages, except the one shared with the next block.
+        auto drop_begin = (block - file) / page_size * page_size;
+        auto drop_end   = (block_end - file) / page_size * page_size;
+        if (block_end == file_end) drop_end = file_size;
+        if (drop_end > drop_begin) {
+            madvise(file_addr + drop_begin, drop_end - drop_begin, MADV_DONTNEED);
+        }
+        block = block_end;
     }
     std::apply([&](auto&... vecs) { (vecs.flush(), ...); }, col_vecs);
     return col_vecs;
 }
 
+template <typename... ColTypes, typename... Strs>
+std::tuple<far_memory::DataFrameVector<ColTypes>...> parse_csv_to_vectors(
+    far_memory::FarMemManager* manager, std::string csv_file_path, Strs... col_names)
+{
+    return parse_csv_to_vectors<ColTypes...>(manager, CSVLoadOptions(), std::move(csv_file_path),
+                                             col_names...);
+}
+
 }  // namespace io
 
 #endif
@@ -1280,6 +1280,23 @@ public: // Read/access and slicing interfaces
                                             const char* name,
                                             F& sel_functor) const;
 
+    // This is identical with above get_data_by_sel(), but the selection is
+    // a far_memory::DataFramePredicate over one or more columns of this
+    // DataFrame, instead of a functor over a single column. The predicate is
+    // evaluated by the memory server (see DataFrameVector::filter()), so the
+    // unselected rows never move into local memory.
+    //
+    // Ts:
+    //   List all the types of all data columns. A type should be specified in
+    //   the list only once.
+    // pred:
+    //   The selection predicate
+    //
+    template <typename... Ts>
+    [[nodiscard]] DataFrame
+    get_data_by_sel(far_memory::FarMemManager* manager,
+                    const far_memory::DataFramePredicate& pred) const;
+
     // This is identical with above get_data_by_sel(), but:
     //   1) The result is a view
     //   2) Since the result is a view, you cannot call make_consistent() on
@@ -1101,6 +1101,35 @@ DataFrame<I, H> DataFrame<I, H>::get_data_by_sel(far_memory::FarMemManager* mana
 
 // ----------------------------------------------------------------------------
 
+template <typename I, typename H>
+template <typename... Ts>
+DataFrame<I, H> DataFrame<I, H>::get_data_by_sel(far_memory::FarMemManager* manager,
+                                                 const far_memory::DataFramePredicate& pred) const
+{
+    auto col_indices = const_cast<IndexVecType*>(&indices_)->filter(manager, pred);
+
+    DataFrame df(manager);
+    auto new_index = const_cast<IndexVecType*>(&indices_)->
+        copy_data_by_idx(manager, col_indices);
+    df.load_index(std::move(new_index));
+
+    const size_type idx_s = indices_.size();
+    for (auto col_citer : column_tb_)  {
+        sel_load_functor_<unsigned long long, Ts ...>    functor (
+            manager,
+            col_citer.first.c_str(),
+            col_indices,
+            idx_s,
+            df);
+
+        data_[col_citer.second].change(functor);
+    }
+
+    return df;
+}
+
+// ----------------------------------------------------------------------------
+
 template<typename I, typename  H>
 template<typename T, typename F, typename ... Ts>
 DataFramePtrView<I> DataFrame<I, H>::
@@ -0,0 +1,159 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "array.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+#define ACCESS_ONCE(x) (*(volatile typeof(x) *)&(x))
+
+namespace far_memory {
+class FarMemTest {
+private:
+  constexpr static uint64_t kCacheSize = (2ULL << 30);
+  constexpr static uint64_t kFarMemSize = (16ULL << 30);
+  constexpr static uint32_t kNumGCThreads = 16;
+  constexpr static uint32_t kNumConnections = 400;
+  constexpr static uint32_t kNumEntries = (64ULL << 20);
+  constexpr static uint32_t kNumMutatorThreadsPerCore = 16;
+  constexpr static uint32_t kNumItersPerScope = 64;
+  constexpr static uint64_t kWarmupUs = 5 * 1000 * 1000;
+  constexpr static uint64_t kRunningUs = 20 * 1000 * 1000;
+
+  struct Data {
+    uint8_t data[64];
+  };
+
+  struct alignas(64) Cnt {
+    uint64_t c;
+  };
+
+  using Array_t = Array<Data, kNumEntries>;
+
+  void prepare(Array_t *array) {
+    auto num_threads = helpers::get_num_runtime_cores();
+    std::vector<rt::Thread> threads;
+    for (uint32_t tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back(rt::Thread([&, tid]() {
+        auto num_entries_per_thread = (kNumEntries - 1) / num_threads + 1;
+        auto left = num_entries_per_thread * tid;
+        auto right = std::min(left + num_entries_per_thread, kNumEntries);
+        for (uint64_t i = left; i < right; i++) {
+          DerefScope scope;
+          array->at_mut(scope, i).data[0] = static_cast<uint8_t>(i);
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+  }
+
+  void bench(Array_t *array) {
+    auto num_cores = helpers::get_num_runtime_cores();
+    auto num_threads = num_cores * kNumMutatorThreadsPerCore;
+    std::unique_ptr<Cnt[]> cnts(new Cnt[num_threads]());
+    bool stop = false;
+    std::vector<rt::Thread> threads;
+    for (uint32_t tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back(rt::Thread([&, tid]() {
+        std::mt19937 generator(tid);
+        std::uniform_int_distribution<uint32_t> uniform(0, kNumEntries - 1);
+        DerefScope scope;
+        uint64_t cnt = 0;
+        while (!ACCESS_ONCE(stop)) {
+          if (unlikely(cnt % kNumItersPerScope == 0)) {
+            scope.renew();
+          }
+          auto idx = uniform(generator);
+          auto &data = array->at(scope, idx);
+          DONT_OPTIMIZE(data);
+          ACCESS_ONCE(cnts[tid].c) = ++cnt;
+        }
+      }));
+    }
+
+    auto sum_cnts = [&]() {
+      uint64_t sum = 0;
+      for (uint32_t i = 0; i < num_threads; i++) {
+        sum += ACCESS_ONCE(cnts[i].c);
+      }
+      return sum;
+    };
+    timer_sleep(kWarmupUs);
+    auto start_us = microtime();
+    auto start_cnts = sum_cnts();
+    timer_sleep(kRunningUs);
+    auto mops = static_cast<double>(sum_cnts() - start_cnts) /
+                (microtime() - start_us);
+    ACCESS_ONCE(stop) = true;
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+    std::cout << "cores = " << num_cores
+              << ", numa nodes = " << helpers::get_num_numa_nodes()
+              << ", mops = " << mops << std::endl;
+  }
+
+public:
+  void run(netaddr raddr) {
+    std::unique_ptr<FarMemManager> manager =
+        std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+            kCacheSize, kNumGCThreads,
+            new TCPDevice(raddr, kNumConnections, kFarMemSize)));
+    auto array = std::unique_ptr<Array_t>(
+        manager->allocate_array_heap<Data, kNumEntries>());
+    std::cout << "Prepare..." << std::endl;
+    prepare(array.get());
+    std::cout << "Bench..." << std::endl;
+    bench(array.get());
+    array.reset();
+    manager.reset();
+  }
+};
+} // namespace far_memory
+
+int argc;
+FarMemTest test;
+void my_main(void *arg) {
+  char **argv = (char **)arg;
+  std::string ip_addr_port(argv[1]);
+  test.run(helpers::str_to_netaddr(ip_addr_port));
+}
+
+int main(int _argc, char *argv[]) {
+  int ret;
+
+  if (_argc < 3) {
+    std::cerr << "usage: [cfg_file] [ip_addr:port]" << std::endl;
+    return -EINVAL;
+  }
+
+  char conf_path[strlen(argv[1]) + 1];
+  strcpy(conf_path, argv[1]);
+  for (int i = 2; i < _argc; i++) {
+    argv[i - 1] = argv[i];
+  }
+  argc = _argc - 1;
+
+  ret = runtime_init(conf_path, my_main, argv);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
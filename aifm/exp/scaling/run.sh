@@ -0,0 +1,22 @@
+#!/bin/bash
+
+source ../../shared.sh
+
+max_num_cores=${1:-`nproc`}
+config=`mktemp`
+
+sudo pkill -9 main
+make clean
+make -j
+for num_cores in `seq 1 $max_num_cores`
+do
+    sed "s/runtime_kthreads.*/runtime_kthreads $num_cores/g" \
+        $AIFM_PATH/configs/client.config > $config
+    rerun_local_iokerneld
+    rerun_mem_server
+    sudo stdbuf -o0 sh -c "./main $config $MEM_SERVER_DPDK_IP:$MEM_SERVER_PORT" \
+         1>log.$num_cores 2>&1
+done
+kill_local_iokerneld
+kill_mem_server
+rm -f $config
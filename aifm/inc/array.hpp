@@ -3,16 +3,22 @@
 #include "deref_scope.hpp"
 #include "pointer.hpp"
 #include "prefetcher.hpp"
+#include "server_kernel.hpp"
 
 #include <cstdint>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <optional>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace far_memory {
 
 class FarMemManager;
+class FarMemDevice;
 
 class GenericArray {
 protected:
@@ -26,6 +32,10 @@ protected:
   uint64_t kNumItems_;
   uint32_t kItemSize_;
   bool dynamic_prefetch_enabled_ = true;
+  FarMemDevice *device_;
+  // The number of items per kernel invocation, bounded by the compute input
+  // size.
+  constexpr static uint32_t kMaxKernelBatchSize = 4096;
   constexpr static auto kInduceFn = [](Index_t idx_0,
                                        Index_t idx_1) -> Pattern_t {
     return GenericArray::induce_fn(idx_0, idx_1);
@@ -45,6 +55,20 @@ protected:
   ~GenericArray();
   NOT_COPYABLE(GenericArray);
   NOT_MOVEABLE(GenericArray);
+  // Scans the items in [start, end) with the server kernel. Locally present
+  // items are passed to local_fn(idx, data); remote ones are batched, and
+  // remote_fn(idxs, num_idxs, output, output_len) gets the kernel output of
+  // each batch, so they are never swapped in. Without kernel support on the
+  // device, all items go to local_fn. The scan proceeds in windows of
+  // kMaxKernelBatchSize items and stops after the window in which a callback
+  // returns false.
+  void scan(const std::string &kernel, const std::vector<uint8_t> &args,
+            Index_t start, Index_t end,
+            const std::function<bool(Index_t, const uint8_t *)> &local_fn,
+            const std::function<bool(const Index_t *, uint32_t,
+                                     const uint8_t *, uint16_t)> &remote_fn);
+  // The number of items in the prefetch window of the device.
+  uint64_t get_prefetch_win_num_items() const;
 
 public:
   void disable_prefetch();
@@ -57,6 +81,8 @@ template <typename T, uint64_t... Dims> class Array : public GenericArray {
 private:
   using num_dim_t = uint8_t;
   static_assert(std::numeric_limits<num_dim_t>::max() >= sizeof...(Dims));
+  constexpr static uint64_t kNumItemsPerScope = 1024;
+  constexpr static uint64_t kMinNumItemsPerThread = 4096;
 
   friend class FarMemManager;
   friend class FarMemTest;
@@ -74,6 +100,9 @@ private:
     return N * _size(rest_dims...);
   }
 
+  template <bool Mut, typename F>
+  void parallel_walk(Index_t start, Index_t end, uint32_t num_threads, F &&f);
+
 public:
   static constexpr uint64_t kSize = _size(Dims...);
 
@@ -100,6 +129,35 @@ public:
   template <typename... ArgsStart, typename... ArgsStep>
   void static_prefetch(std::tuple<ArgsStart...> start,
                        std::tuple<ArgsStep...> step, uint32_t num);
+  // Scans over the flat index range [start, end), offloaded to the server
+  // kernels for the items that are not cached locally. They are not atomic
+  // w.r.t. concurrent writers.
+  KernelSum_t<T> sum(Index_t start = 0, Index_t end = kSize);
+  std::optional<Index_t> find_first(KernelCmpOp op, const T &val,
+                                    Index_t start = 0, Index_t end = kSize);
+  std::vector<Index_t> filter(KernelCmpOp op, const T &val, Index_t start = 0,
+                              Index_t end = kSize);
+  std::vector<Index_t> search(const void *pattern, uint16_t pattern_len,
+                              Index_t start = 0, Index_t end = kSize);
+  // Calls f(scope, idx, item) on every item in the flat index range [start,
+  // end), where item is a mutable reference and scope is the DerefScope that f
+  // runs in. The range is split across the runtime cores, and each worker
+  // renews its own DerefScope and prefetches the items of its own share. f runs
+  // on the workers concurrently.
+  template <typename F>
+  void parallel_for(F &&f, Index_t start = 0, Index_t end = kSize);
+  // Like parallel_for(), but item is a const reference, so the items are only
+  // dereferenced immutably and stay clean. Call it through a const array,
+  // e.g., std::as_const(array).
+  template <typename F>
+  void parallel_for(F &&f, Index_t start = 0, Index_t end = kSize) const;
+  // Folds the items in [start, end) like parallel_for(): each worker calls
+  // f(acc, scope, idx, item) on the items of its share with a copy of init as
+  // acc, and the accumulators of the workers are then folded into the first
+  // one by combine(acc, other) in index order.
+  template <typename Acc, typename F, typename C>
+  Acc parallel_reduce(Acc init, F &&f, C &&combine, Index_t start = 0,
+                      Index_t end = kSize);
 };
 
 } // namespace far_memory
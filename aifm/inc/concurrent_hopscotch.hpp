@@ -88,7 +88,8 @@ public:
 template <typename K, typename V>
 class ConcurrentHopscotch : public GenericConcurrentHopscotch {
 private:
-  CachelineAligned(int64_t) per_core_size_[helpers::kNumCPUs];
+  CachelineAligned(int64_t);
+  std::unique_ptr<CachelineAligned_int64_t[]> per_core_size_;
   friend class FarMemTest;
   friend class FarMemManager;
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "internal/dataframe_types.hpp"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace far_memory {
+
+enum class DataFrameChunkEncoding : uint8_t {
+  // The runs of equal elements.
+  RunLength = 0,
+  // Up to 256 distinct elements and a 1, 2, 4 or 8-bit code per element.
+  Dictionary,
+  // The smallest element and a 1, 2 or 4-byte offset from it per element.
+  FrameOfReference
+};
+
+// The lightweight encodings of a DataFrameVector chunk on the wire, which
+// shrink the chunks of low-cardinality, run-heavy or narrow-range columns
+// (e.g., a sorted time series) several times. The encodings work on the bits
+// of the elements and are lossless for every element, NaNs included.
+template <typename T> class DataFrameChunkCodec {
+public:
+  constexpr static uint32_t kMaxNumEntries = 4096;
+
+  // Writes the shortest encoding of the n elements at data to buf, which must
+  // hold n * sizeof(T) bytes, and returns its length. Returns 0 instead if no
+  // encoding is shorter than n * sizeof(T) bytes.
+  static uint32_t encode(const T *data, uint32_t n, uint8_t *buf);
+  // Decodes the len bytes at buf that encode() wrote for n elements into data.
+  static void decode(const uint8_t *buf, uint32_t len, T *data, uint32_t n);
+
+private:
+  static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 ||
+                sizeof(T) == 8);
+  using Bits_t = std::conditional_t<
+      sizeof(T) == 1, uint8_t,
+      std::conditional_t<
+          sizeof(T) == 2, uint16_t,
+          std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+  constexpr static uint32_t kMaxDictSize = 256;
+  constexpr static uint32_t kDictTableSize = 2 * kMaxDictSize;
+
+  static Bits_t to_bits(const T &val);
+  static T from_bits(Bits_t bits);
+  static uint32_t get_run_length_size(const T *data, uint32_t n);
+  static uint32_t get_dictionary_size(const T *data, uint32_t n,
+                                      Bits_t *dict, uint32_t *dict_size,
+                                      uint8_t *codes);
+  static uint32_t get_frame_of_reference_size(const T *data, uint32_t n,
+                                              Bits_t *ref, uint8_t *width);
+  static void encode_run_length(const T *data, uint32_t n, uint8_t *buf);
+  static void encode_dictionary(const Bits_t *dict, uint32_t dict_size,
+                                const uint8_t *codes, uint32_t n,
+                                uint8_t *buf);
+  static void encode_frame_of_reference(const T *data, uint32_t n, Bits_t ref,
+                                        uint8_t width, uint8_t *buf);
+};
+
+} // namespace far_memory
+
+#include "internal/dataframe_chunk_codec.ipp"
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "internal/dataframe_types.hpp"
+#include "server_kernel.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+namespace far_memory {
+
+class GenericDataFrameVector;
+template <typename T> class DataFrameVector;
+
+enum class GroupByAggFn : uint8_t { Count = 0, Sum, Mean, Min, Max, Std };
+
+// The element type of the column that aggregates a column of T by fn: Count
+// yields unsigned long long, Sum yields KernelSum_t<T>, Mean and Std (the
+// sample standard deviation) yield double, and Min and Max yield T.
+template <typename T, GroupByAggFn Fn>
+using GroupByResult_t = std::conditional_t<
+    Fn == GroupByAggFn::Count, unsigned long long,
+    std::conditional_t<
+        Fn == GroupByAggFn::Sum, KernelSum_t<T>,
+        std::conditional_t<Fn == GroupByAggFn::Mean || Fn == GroupByAggFn::Std,
+                           double, T>>>;
+
+// Groups the rows of one or more key columns by their key tuple and
+// aggregates any number of value columns per group, all on the memory server
+// (see ServerGroupBy), so that neither the rows nor the groups have to leave
+// far memory. The keys need not be sorted. Every output column must be empty;
+// row i of each of them describes the i-th group, in an unspecified order.
+//
+//   DataFrameGroupBy group_by;
+//   group_by.key(city_vec, &city_out);
+//   group_by.agg<GroupByAggFn::Mean>(price_vec, &mean_price_out);
+//   auto num_groups = group_by.run();
+class DataFrameGroupBy {
+private:
+  struct Column {
+    GenericDataFrameVector *vec;
+    uint8_t dt_id;
+    GenericDataFrameVector *out;
+    // Sets the size and capacity of out once the server has filled it.
+    std::function<void(uint64_t size, uint64_t capacity)> set_result;
+  };
+  struct Agg {
+    Column col;
+    GroupByAggFn fn;
+  };
+
+  std::vector<Column> keys_;
+  std::vector<Agg> aggs_;
+
+  template <typename T, typename U>
+  static Column make_column(DataFrameVector<T> &vec, DataFrameVector<U> *out);
+
+public:
+  template <typename T>
+  void key(DataFrameVector<T> &vec, DataFrameVector<T> *out);
+  // Only Count, Min and Max apply to SimpleTime columns.
+  template <GroupByAggFn Fn, typename T>
+  void agg(DataFrameVector<T> &vec,
+           DataFrameVector<GroupByResult_t<T, Fn>> *out);
+  // Returns the number of groups. Every key and value column must have at
+  // least as many rows as the first key column, which decides the row count.
+  uint64_t run();
+};
+
+} // namespace far_memory
+
+#include "internal/dataframe_group_by.ipp"
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "internal/dataframe_types.hpp"
+#include "server_kernel.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace far_memory {
+
+class GenericDataFrameVector;
+template <typename T> class DataFrameVector;
+
+// A selection predicate over one or more DataFrameVector columns: comparisons,
+// ranges and IN-lists combined by AND, OR and NOT. It is serialized as it is
+// built, so that DataFrameVector::filter() can ship it to the memory server and
+// evaluate it next to the columns (see DataFramePredicateEvaluator). It refers
+// to the columns by pointer, so they must outlive it.
+//
+// Serialized format, in prefix order:
+// Cmp:   |Cmp|ds_id|dt_id|cmp_op|val|
+// Range: |Range|ds_id|dt_id|lo|hi|           (lo <= x <= hi)
+// In:    |In|ds_id|dt_id|num_vals(2B)|vals|
+// And:   |And|lhs|rhs|
+// Or:    |Or|lhs|rhs|
+// Not:   |Not|child|
+class DataFramePredicate {
+private:
+  enum class Kind : uint8_t { Cmp = 0, Range, In, And, Or, Not };
+  constexpr static uint64_t kNumElementsPerScope = 1024;
+
+  struct Column {
+    GenericDataFrameVector *vec;
+    uint32_t elem_size;
+    // Copies len elements of the column, starting from begin, to buf.
+    std::function<void(uint64_t begin, uint32_t len, uint8_t *buf)> read;
+  };
+
+  std::vector<uint8_t> buf_;
+  std::unordered_map<uint8_t, Column> columns_;
+  friend class DataFramePredicateEvaluator;
+  template <typename T> friend class DataFrameVector;
+
+  DataFramePredicate() = default;
+  template <typename T>
+  static DataFramePredicate leaf(Kind kind, DataFrameVector<T> &col);
+  template <typename T> void append(const T &val);
+  DataFramePredicate combine(Kind kind, const DataFramePredicate *rhs) const;
+  void flush_columns() const;
+  uint64_t get_min_column_size() const;
+  uint32_t get_max_elem_size() const;
+
+public:
+  template <typename T>
+  static DataFramePredicate cmp(DataFrameVector<T> &col, KernelCmpOp op,
+                                std::type_identity_t<T> val);
+  template <typename T>
+  static DataFramePredicate range(DataFrameVector<T> &col,
+                                  std::type_identity_t<T> lo,
+                                  std::type_identity_t<T> hi);
+  template <typename T>
+  static DataFramePredicate
+  in(DataFrameVector<T> &col,
+     const std::vector<std::type_identity_t<T>> &vals);
+  DataFramePredicate operator&&(const DataFramePredicate &other) const;
+  DataFramePredicate operator||(const DataFramePredicate &other) const;
+  DataFramePredicate operator!() const;
+};
+
+// Evaluates a serialized DataFramePredicate over a block of rows at a time,
+// which keeps the per-row cost to a tight loop over each referenced column.
+// Used by the server for offloaded filters and by the client otherwise.
+class DataFramePredicateEvaluator {
+public:
+  constexpr static uint32_t kBlockSize = 4096;
+  // Returns the address of the elements [begin, begin + len) of column ds_id,
+  // whose type is dt_id. It is only dereferenced until the next call.
+  using ColumnLoader = std::function<const uint8_t *(
+      uint8_t ds_id, uint8_t dt_id, uint64_t begin, uint32_t len)>;
+
+  DataFramePredicateEvaluator(const uint8_t *buf, uint32_t len);
+  // Sets mask[i] to whether row begin + i satisfies the predicate, for every i
+  // in [0, len). len must not exceed kBlockSize.
+  void eval(const ColumnLoader &loader, uint64_t begin, uint32_t len,
+            uint8_t *mask);
+
+private:
+  using LeafFn =
+      std::function<void(const uint8_t *data, uint32_t len, uint8_t *mask)>;
+
+  struct Node {
+    DataFramePredicate::Kind kind;
+    uint8_t ds_id;
+    uint8_t dt_id;
+    uint32_t children[2];
+    LeafFn leaf_fn;
+    // Holds the mask of the second child of And and Or.
+    std::vector<uint8_t> scratch;
+  };
+
+  std::vector<Node> nodes_;
+
+  uint32_t parse(const uint8_t *&buf, const uint8_t *end);
+  template <typename T>
+  static LeafFn parse_leaf(DataFramePredicate::Kind kind, const uint8_t *&buf,
+                           const uint8_t *end);
+  void eval(uint32_t node_idx, const ColumnLoader &loader, uint64_t begin,
+            uint32_t len, uint8_t *mask);
+};
+
+} // namespace far_memory
+
+#include "internal/dataframe_predicate.ipp"
@@ -1,6 +1,8 @@
 #pragma once
 
-#include "dataframe_vector.hpp"
+#include "dataframe_chunk_codec.hpp"
+#include "dataframe_group_by.hpp"
+#include "dataframe_predicate.hpp"
 #include "deref_scope.hpp"
 #include "device.hpp"
 #include "helpers.hpp"
@@ -10,9 +12,11 @@
 #include "reader_writer_lock.hpp"
 
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #ifdef DISABLE_OFFLOAD_UNIQUE
@@ -45,15 +49,36 @@
 #define DISABLE_OFFLOAD_AGGREGATE 0
 #endif
 
+#ifdef DISABLE_OFFLOAD_FILTER
+#define DISABLE_OFFLOAD_FILTER 1
+#else
+#define DISABLE_OFFLOAD_FILTER 0
+#endif
+
+#ifdef DISABLE_OFFLOAD_ARG_SORT
+#define DISABLE_OFFLOAD_ARG_SORT 1
+#else
+#define DISABLE_OFFLOAD_ARG_SORT 0
+#endif
+
 #define DISABLE_OFFLOAD                                                        \
   (DISABLE_OFFLOAD_UNIQUE & DISABLE_OFFLOAD_COPY_DATA_BY_IDX &                 \
    DISABLE_OFFLOAD_SHUFFLE_DATA_BY_IDX & DISABLE_OFFLOAD_ASSIGN &              \
-   DISABLE_OFFLOAD_AGGREGATE)
+   DISABLE_OFFLOAD_AGGREGATE & DISABLE_OFFLOAD_FILTER &                       \
+   DISABLE_OFFLOAD_ARG_SORT)
 
 namespace far_memory {
 
 class FarMemManager;
 
+// Which unmatched rows a join keeps. The values match hmdf::join_policy.
+enum class DataFrameJoinPolicy : uint8_t {
+  Inner = 1,
+  Left,
+  Right,
+  LeftRight
+};
+
 class GenericDataFrameVector {
 private:
   enum OpCode {
@@ -64,7 +89,16 @@ private:
     Assign,
     AggregateMax,
     AggregateMin,
-    AggregateMedian
+    AggregateMedian,
+    Filter,
+    ArgSort,
+    GroupBy,
+    Join,
+    SetEncoding,
+    SetSize,
+    GetSize,
+    // Served by compute_stream() only.
+    UniqueStream
   };
 
   uint32_t chunk_size_;
@@ -73,6 +107,8 @@ private:
   uint8_t ds_id_;
   uint64_t size_ = 0;
   uint64_t remote_vec_capacity_ = 0;
+  // The size that the server last learned from flush().
+  uint64_t flushed_size_ = 0;
   ReaderWriterLock lock_;
   std::vector<GenericUniquePtr> chunk_ptrs_;
   bool moved_ = false;
@@ -80,11 +116,22 @@ private:
   uint64_t last_idx_ = std::numeric_limits<uint64_t>::max();
   template <typename T> friend class DataFrameVector;
   template <typename T> friend class ServerDataFrameVector;
+  friend class FarMemTest;
+  friend class DataFramePredicate;
+  friend class DataFrameGroupBy;
 
   void expand(uint64_t num);
   void expand_no_alloc(uint64_t num);
-  void reserve_remote(uint64_t num);
   void cleanup();
+  // Reads chunk chunk_idx from the device into buf, which holds a chunk, if
+  // the chunk is not in local memory. Returns whether it did.
+  bool read_remote_chunk(uint64_t chunk_idx, uint8_t *buf);
+  // Writes the chunk at buf to the device as chunk chunk_idx if the chunk is
+  // not in local memory. Returns whether it did.
+  bool write_remote_chunk(uint64_t chunk_idx, const uint8_t *buf);
+  // Takes over the size and the chunks of the server's vector, which outlived
+  // its previous client in a snapshot.
+  void adopt_remote();
 
 public:
   GenericDataFrameVector(const uint32_t chunk_size, uint32_t chunk_num_entries,
@@ -97,7 +144,14 @@ public:
   bool empty() const;
   uint64_t size() const;
   void clear();
+  // Writes the dirty chunks back and records size() on the server, so that
+  // the server's snapshot holds everything needed to adopt the vector.
   void flush();
+  // Grows the server's copy of the vector to hold num elements at once,
+  // instead of step by step as the vector grows, without allocating anything
+  // locally (unlike reserve()). Meant for loaders that can estimate the final
+  // size.
+  void reserve_remote(uint64_t num);
 };
 
 template <typename T> class DataFrameVector : public GenericDataFrameVector {
@@ -115,6 +169,7 @@ private:
   constexpr static uint32_t kNumEntriesPerExpansion =
       (kSizePerExpansion - 1) / sizeof(T) + 1;
   constexpr static uint64_t kNumElementsPerScope = 1024;
+  constexpr static uint64_t kMinNumChunksPerThread = 8;
 
   static Pattern_t induce_fn(Index_t idx_0, Index_t idx_1);
   static Index_t infer_fn(Index_t idx, Pattern_t stride);
@@ -136,7 +191,25 @@ private:
       prefetcher_;
   bool dynamic_prefetch_enabled_ = true;  
 
+  // The summary of the first count elements of a chunk, kept in local memory
+  // so that scan() can skip the chunk without fetching it: num_nans of them
+  // are NaNs and the rest lie in [min, max]. push_back() extends it, while
+  // every mutable dereference of the chunk (at_mut(), each chunk and renew() of
+  // a mutable FastIterator, parallel_for(), write_range()) resets it. A chunk
+  // whose count falls short of its number of elements is summarized again by
+  // the next scan() of it.
+  struct ZoneMap {
+    T min;
+    T max;
+    uint32_t count = 0;
+    uint32_t num_nans = 0;
+  };
+  std::vector<ZoneMap> zone_maps_;
+
   friend class FarMemTest;
+  friend class FarMemManager;
+  friend class DataFrameGroupBy;
+  template <typename U> friend class DataFrameVector;
   template <typename U> friend class ServerDataFrameVector;
 
   // STL compatible, but slower (since it takes GC sync overhead per
@@ -194,6 +267,7 @@ private:
     friend class DataFrameVector;
 
     uint64_t get_idx() const;
+    template <bool Nt> bool deref_chunk();
     template <bool Nt> void update_on_new_chunk();
 
   public:
@@ -223,10 +297,22 @@ private:
   void expand(uint64_t num);
   void expand_no_alloc(uint64_t num);
   void prefetch_record(bool nt, Index_t idx);
+  static bool is_nan(const T &val);
+  ZoneMap &get_zone_map(uint64_t chunk_idx);
+  void update_zone_map(uint64_t chunk_idx, uint64_t chunk_offset,
+                       const T &val);
+  void invalidate_zone_map(uint64_t chunk_idx);
+  uint32_t get_num_walk_threads(uint64_t begin, uint64_t end);
+  template <bool Mut, typename F>
+  void parallel_walk(uint64_t begin, uint64_t end, uint32_t num_threads,
+                     F &&f);
   DataFrameVector &lock();
   template <bool Ascending = true>
   void _get_sorted_indices_counting_sort(
       DataFrameVector<unsigned long long> *indices);
+  template <bool Ascending = true>
+  DataFrameVector<unsigned long long>
+  get_sorted_indices_remotely(FarMemManager *manager);
   template <typename U>
   DataFrameVector<T> aggregate_locally(FarMemManager *manager, const U &key_vec,
                                        OpCode opcode);
@@ -247,9 +333,16 @@ private:
   DataFrameVector<T>
   shuffle_data_by_idx_remotely(FarMemManager *manager,
                                DataFrameVector<unsigned long long> &idx_vec);
+  DataFrameVector<unsigned long long>
+  filter_locally(FarMemManager *manager, const DataFramePredicate &pred);
+  DataFrameVector<unsigned long long>
+  filter_remotely(FarMemManager *manager, const DataFramePredicate &pred);
   void assign_locally(const Iterator &begin, const Iterator &end);
   void assign_remotely(const Iterator &begin, const Iterator &end);
   T _nth_element(uint64_t begin, uint64_t len, uint64_t n);
+  // Adopts the server's vector of ds_id; see
+  // FarMemManager::adopt_dataframe_vector().
+  DataFrameVector(FarMemManager *manager, uint8_t ds_id);
 
 public:
   using value_type = T;
@@ -266,6 +359,17 @@ public:
   uint64_t capacity() const;
   template <typename U, bool Nt = false>
   void push_back(const DerefScope &scope, U &&u);
+  // The bulk counterparts of push_back(), at() and at_mut(), which copy a
+  // chunk at a time and record no prefetch traces. They take no DerefScope and
+  // must not be called in one. With Bypass, the whole chunks that are not in
+  // local memory go to and come from the device directly rather than through
+  // the local cache (for append(), the whole chunks past the end of the
+  // vector).
+  template <bool Bypass = false> void append(const T *data, uint64_t n);
+  template <bool Bypass = false>
+  void read_range(uint64_t begin, uint64_t n, T *out);
+  template <bool Bypass = false>
+  void write_range(uint64_t begin, uint64_t n, const T *data);
   void pop_back(const DerefScope &scope);
   void reserve(uint64_t count);
   void resize(uint64_t count);
@@ -288,6 +392,12 @@ public:
   FastIterator</* Mut = */ false> cfend(DerefScope &scope) const;
 
   DataFrameVector<T> get_col_unique_values(FarMemManager *manager);
+  // Like get_col_unique_values(), but the unique values are streamed back
+  // from the server (see FarMemDevice::compute_stream()) and appended to the
+  // returned vector as they arrive.
+  DataFrameVector<T> get_col_unique_values_streamed(FarMemManager *manager);
+  // Returns the elements that idx_vec refers to, where kDataFrameNullIdx refers
+  // to get_dataframe_null_value<T>().
   DataFrameVector<T>
   copy_data_by_idx(FarMemManager *manager,
                    DataFrameVector<unsigned long long> &idx_vec);
@@ -295,15 +405,72 @@ public:
   shuffle_data_by_idx(FarMemManager *manager,
                       DataFrameVector<unsigned long long> &idx_vec);
   void assign(const Iterator &begin, const Iterator &end);
+  // Calls f(scope, index, element) on every non-NaN element in [lo, hi], in
+  // index order, where scope is the DerefScope that f runs in. The chunks that
+  // their zone maps show to hold no such element are never fetched, which
+  // turns a range scan of a sorted column (e.g., a time series) into a few
+  // chunk fetches. It must not be called within a DerefScope, so that no
+  // mutable reference handed out before can be written through afterwards.
+  template <typename F> void scan(const T &lo, const T &hi, F &&f);
+  // Returns the indices of the non-NaN elements in [lo, hi], in ascending
+  // order. Unlike filter(), it runs locally, so that it can skip chunks by
+  // their zone maps (see scan()).
+  DataFrameVector<unsigned long long>
+  filter_range(FarMemManager *manager, const T &lo, const T &hi);
+  // Calls f(scope, index, element) on every element in [begin, min(end,
+  // size())), where element is a mutable reference and scope is the DerefScope
+  // that f runs in. The range is split at chunk boundaries across the runtime
+  // cores, and each worker renews its own DerefScope and prefetches the chunks
+  // of its own share, so a column scan scales with the cores. f runs on the
+  // workers concurrently and must not resize the vector.
+  template <typename F>
+  void parallel_for(F &&f, uint64_t begin = 0,
+                    uint64_t end = std::numeric_limits<uint64_t>::max());
+  // Like parallel_for(), but element is a const reference, so the chunks are
+  // only dereferenced immutably: they stay clean, and their zone maps stay
+  // valid. Call it through a const vector, e.g., std::as_const(vec).
+  template <typename F>
+  void parallel_for(F &&f, uint64_t begin = 0,
+                    uint64_t end = std::numeric_limits<uint64_t>::max()) const;
+  // Folds the elements in [begin, min(end, size())) like parallel_for(): each
+  // worker calls f(acc, scope, index, element) on the elements of its share
+  // with a copy of init as acc, and the accumulators of the workers are then
+  // folded into the first one by combine(acc, other) in index order.
+  template <typename Acc, typename F, typename C>
+  Acc parallel_reduce(Acc init, F &&f, C &&combine, uint64_t begin = 0,
+                      uint64_t end = std::numeric_limits<uint64_t>::max());
+  // Returns the indices of the rows in [0, size()) that satisfy pred, in
+  // ascending order. Every column pred refers to must have at least size()
+  // elements. Unless DISABLE_OFFLOAD_FILTER, pred is evaluated by the server,
+  // so that the rows never leave far memory.
+  DataFrameVector<unsigned long long> filter(FarMemManager *manager,
+                                             const DataFramePredicate &pred);
+  // Equi-joins the vector (the left side) with rhs on the server, which hash
+  // joins them with the smaller side as the build side. Returns the left and
+  // the right row of every joined pair, in an unspecified order, as two index
+  // vectors for copy_data_by_idx(). The side that an unmatched row kept by
+  // policy lacks is kDataFrameNullIdx.
+  std::pair<DataFrameVector<unsigned long long>,
+            DataFrameVector<unsigned long long>>
+  join(FarMemManager *manager, DataFrameVector<T> &rhs,
+       DataFrameJoinPolicy policy);
   template <typename U>
   DataFrameVector<T> aggregate_min(FarMemManager *manager, const U &key_vec);
   template <typename U>
   DataFrameVector<T> aggregate_max(FarMemManager *manager, const U &key_vec);
   template <typename U>
   DataFrameVector<T> aggregate_median(FarMemManager *manager, const U &key_vec);
+  // Makes the chunks go to and come from the server in their shortest
+  // DataFrameChunkCodec encoding, which cuts the swap traffic of the columns
+  // that encode well. The server keeps the chunks decoded, so its operations
+  // are unaffected. Must be called before the first element is added.
+  void enable_encoding();
   void disable_prefetch();
   void enable_prefetch();
   void static_prefetch(Index_t start, Index_t step, uint32_t num);
+  // Returns the rank of every element in the stable sort of the vector, which
+  // shuffle_data_by_idx() turns into the sorted vector. Unless
+  // DISABLE_OFFLOAD_ARG_SORT, the ranks are computed by the server.
   template <bool Ascending = true>
   DataFrameVector<unsigned long long>
   get_sorted_indices(FarMemManager *manager, bool already_sorted_asc);
@@ -4,9 +4,22 @@ extern "C" {
 #include <runtime/tcp.h>
 }
 
+#include "device_scheduler.hpp"
 #include "helpers.hpp"
+#include "io_uring.hpp"
 #include "server.hpp"
 #include "shared_pool.hpp"
+#include "shm_ring.hpp"
+#include "thread.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace far_memory {
 
@@ -14,6 +27,7 @@ class FarMemDevice {
 public:
   uint64_t far_mem_size_;
   uint32_t prefetch_win_size_;
+  std::unique_ptr<DeviceScheduler> scheduler_;
 
   FarMemDevice(uint64_t far_mem_size, uint32_t prefetch_win_size);
   virtual ~FarMemDevice() {}
@@ -33,6 +47,23 @@ public:
   virtual void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                        const uint8_t *input_buf, uint16_t *output_len,
                        uint8_t *output_buf) = 0;
+  // Like compute(), but the input may exceed kMaxComputeDataLen and the
+  // output is unbounded: it is handed to consumer chunk by chunk as the
+  // server produces it (see ServerDS::compute_stream()). The default
+  // implementation falls back to compute(), and thus has its limits.
+  virtual void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
+  // Whether compute() on kVanillaPtrDSID runs the server kernels (see
+  // server_kernel.hpp) over the vanilla objects.
+  virtual bool is_kernel_supported() const { return false; }
+  // Bounds the requests in flight to max_inflight and admits the rest by
+  // their traffic class (see DeviceScheduler). Disabled by default, in which
+  // case admit() never blocks. Must be called before the device is shared.
+  void enable_scheduler(uint32_t max_inflight);
+  DeviceScheduler *get_scheduler() const { return scheduler_.get(); }
+  DeviceScheduler::Ticket admit(TrafficClass cls);
 };
 
 class FakeDevice : public FarMemDevice {
@@ -54,34 +85,131 @@ public:
   void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                const uint8_t *input_buf, uint16_t *output_len,
                uint8_t *output_buf);
+  void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
+  bool is_kernel_supported() const { return true; }
 };
 
 class TCPDevice : public FarMemDevice {
 private:
   constexpr static uint32_t kPrefetchWinSize = 1 << 20;
+  constexpr static uint32_t kNumLatencySamples = 1024;
+  constexpr static uint64_t kNoHedgeDelay =
+      std::numeric_limits<uint64_t>::max();
+  constexpr static uint32_t kDrainBufSize = 4096;
+
+  struct Hedge;
+
+  // Chunks of a streamed response, queued by the receiver thread until the
+  // requester consumes them. The receiver never runs the consumer itself, so
+  // the consumer is free to issue requests on the same connection. The queue
+  // is bounded by the server, which never has more than kStreamWindowSize
+  // bytes of the response unacknowledged (see kOpStreamCredit).
+  struct Stream {
+    rt::Spin spin;
+    rt::CondVar cv;
+    std::deque<std::vector<uint8_t>> chunks;
+    bool done = false;
+  };
+
+  // An outstanding request. Its address is the request tag; the receiver
+  // thread scatters the first header_len bytes of the response payload into
+  // header and the rest into data, or queues it into stream if set.
+  struct Pending {
+    uint8_t *header;
+    uint32_t header_len;
+    uint8_t *data;
+    Stream *stream = nullptr;
+    Hedge *hedge = nullptr;
+    rt::WaitGroup wg{1};
+  };
+
+  // The duplicates of a hedged read. Only the first response (the winner) is
+  // scattered into the caller's buffers; the others are drained. The
+  // requester does not wait for the losers, so it is freed by whoever drops
+  // the last reference.
+  struct Hedge {
+    rt::Spin spin;
+    rt::CondVar cv;
+    Pending *winner = nullptr;
+    bool done = false;
+    uint32_t refcnt = 1;
+    std::unique_ptr<Pending> pendings[2];
+  };
+
+  // Slave connections are shared by all threads: requests are sent under
+  // tx_mutex, and responses (which the server may send out of order) are
+  // dispatched by rx_thread.
+  struct Connection {
+    tcpconn_t *conn;
+    rt::Mutex tx_mutex;
+    rt::Thread rx_thread;
+  };
 
   tcpconn_t *remote_master_;
-  SharedPool<tcpconn_t *> shared_pool_;
+  uint32_t num_connections_;
+  std::unique_ptr<Connection[]> connections_;
+  // Hedged reads; disabled if hedge_percentile_ is 0.
+  double hedge_percentile_ = 0;
+  std::unique_ptr<std::atomic<uint32_t>[]> latency_samples_;
+  std::atomic<uint64_t> num_latency_samples_{0};
+  std::atomic<uint64_t> hedge_delay_us_{kNoHedgeDelay};
 
-  void _read_object(tcpconn_t *remote_slave, uint8_t ds_id, uint8_t obj_id_len,
+  Connection *get_connection();
+  void receive(Connection *connection);
+  void scatter(Connection *connection, Pending *pending, uint32_t len);
+  void receive_hedged(Connection *connection, Pending *pending, uint32_t len);
+  void record_read_latency(uint64_t latency_us);
+  bool is_hedgeable(uint8_t ds_id) const;
+  void send(Connection *connection, Pending *pending, uint8_t *req,
+            uint32_t req_len, const uint8_t *payload = nullptr,
+            uint64_t payload_len = 0);
+  void send_and_wait(Connection *connection, Pending *pending, uint8_t *req,
+                     uint32_t req_len, const uint8_t *payload = nullptr,
+                     uint32_t payload_len = 0);
+  void _read_object(Connection *connection, uint8_t ds_id, uint8_t obj_id_len,
                     const uint8_t *obj_id, uint16_t *data_len,
                     uint8_t *data_buf);
-  void _write_object(tcpconn_t *remote_slave, uint8_t ds_id, uint8_t obj_id_len,
+  static uint32_t fill_read_object_req(uint8_t *req, uint8_t ds_id,
+                                       uint8_t obj_id_len,
+                                       const uint8_t *obj_id);
+  void _hedged_read_object(uint8_t ds_id, uint8_t obj_id_len,
+                           const uint8_t *obj_id, uint16_t *data_len,
+                           uint8_t *data_buf);
+  void _write_object(Connection *connection, uint8_t ds_id, uint8_t obj_id_len,
                      const uint8_t *obj_id, uint16_t data_len,
                      const uint8_t *data_buf);
-  bool _remove_object(tcpconn_t *remote_slave, uint64_t ds_id,
+  bool _remove_object(Connection *connection, uint64_t ds_id,
                       uint8_t obj_id_len, const uint8_t *obj_id);
-  void _construct(tcpconn_t *remote_slave, uint8_t ds_type, uint8_t ds_id,
+  void _construct(Connection *connection, uint8_t ds_type, uint8_t ds_id,
                   uint8_t param_len, uint8_t *params);
-  void _destruct(tcpconn_t *remote_slave, uint8_t ds_id);
-  void _compute(tcpconn_t *remote_slave, uint8_t ds_id, uint8_t opcode,
+  void _destruct(Connection *connection, uint8_t ds_id);
+  void _compute(Connection *connection, uint8_t ds_id, uint8_t opcode,
                 uint16_t input_len, const uint8_t *input_buf,
                 uint16_t *output_len, uint8_t *output_buf);
+  void _compute_stream(
+      Connection *connection, uint8_t ds_id, uint8_t opcode,
+      uint64_t input_len, const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
+  bool _snapshot(Connection *connection);
+  void send_stream_credit(Connection *connection, Pending *pending,
+                          uint32_t credit);
 
 public:
   // TCPDevice talks to remote agent via TCP.
   // Request format:
-  //     |OpCode (1B)|Data (optional)|
+  //     |OpCode (1B)|Tag (8B)|Data (optional)|
+  // Response format:
+  //     |Tag (8B)|Len (4B)|Data (Len B)|
+  // A compute_stream response is a sequence of such frames with the same tag,
+  // terminated by an empty one. The server sends a frame only while less than
+  // kStreamWindowSize bytes of the response are unacknowledged; the client
+  // acknowledges the bytes it has consumed with stream_credit requests, which
+  // carry the tag of the stream and get no response. Requests on the master
+  // connection (init and shutdown) are not tagged, and their responses carry
+  // no header.
   // All possible OpCode:
   //     0. init
   //     1. shutdown
@@ -91,10 +219,18 @@ public:
   //     5. construct
   //     6. destruct
   //     7. compute
+  //     8. snapshot
+  //     9. compute_stream
+  //     10. stream_credit
   constexpr static uint32_t kOpcodeSize = 1;
+  constexpr static uint32_t kTagSize = 8;
+  constexpr static uint32_t kRespLenSize = 4;
+  constexpr static uint32_t kRespHeaderSize = kTagSize + kRespLenSize;
   constexpr static uint32_t kPortSize = 2;
   constexpr static uint32_t kLargeDataSize = 512;
   constexpr static uint32_t kMaxComputeDataLen = 65535;
+  constexpr static uint32_t kStreamWindowSize = 1 << 20;
+  constexpr static uint32_t kStreamCreditBatchSize = kStreamWindowSize / 4;
 
   constexpr static uint8_t kOpInit = 0;
   constexpr static uint8_t kOpShutdown = 1;
@@ -104,9 +240,284 @@ public:
   constexpr static uint8_t kOpConstruct = 5;
   constexpr static uint8_t kOpDeconstruct = 6;
   constexpr static uint8_t kOpCompute = 7;
+  constexpr static uint8_t kOpSnapshot = 8;
+  constexpr static uint8_t kOpComputeStream = 9;
+  constexpr static uint8_t kOpStreamCredit = 10;
 
-  TCPDevice(netaddr raddr, uint32_t num_connections, uint64_t far_mem_size);
+  // With reattach, the client adopts the ds that the server restored from
+  // its snapshot (see tcp_device_server) whenever it constructs a ds with the
+  // same ds_id, type and params; otherwise the restored ds are dropped.
+  TCPDevice(netaddr raddr, uint32_t num_connections, uint64_t far_mem_size,
+            bool reattach = false);
   ~TCPDevice();
+  // Makes the server persist all ds into its snapshot directory. Returns false
+  // if the server has none or the snapshot failed.
+  bool snapshot();
+  // Enables hedged reads: a read that is still outstanding after the given
+  // percentile (e.g., 0.99) of the recent read latencies is re-issued on
+  // another connection, and whichever response arrives first is taken. Only
+  // reads are hedged, since they are idempotent. Needs two connections or
+  // more.
+  void enable_hedged_reads(double percentile);
+  void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                   uint16_t *data_len, uint8_t *data_buf);
+  void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                    uint16_t data_len, const uint8_t *data_buf);
+  bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
+  void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
+                 uint8_t *params);
+  void destruct(uint8_t ds_id);
+  void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+               const uint8_t *input_buf, uint16_t *output_len,
+               uint8_t *output_buf);
+  void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
+  bool is_kernel_supported() const { return true; }
+};
+
+// ShmDevice talks to a memory server running on the same host (see
+// src/shm_device_server.cpp) through a shared memory segment under /dev/shm.
+// Segment layout:
+//     |Header|Channel 0 (req ring, resp ring)|...|Channel N-1|Arena|
+// The arena backs the vanilla ptr ds; the client accesses it directly, so
+// vanilla objects never go through the server. All other requests use the
+// untagged TCPDevice wire format over the per-channel SPSC rings; each
+// channel is owned by one thread at a time, so responses arrive in order.
+class ShmDevice : public FarMemDevice {
+public:
+  struct Header {
+    uint64_t magic;
+    uint64_t shm_size;
+    uint64_t arena_offset;
+    uint64_t far_mem_size;
+    uint32_t num_channels;
+    uint32_t ring_capacity;
+    uint8_t shutdown;        // Set by the client.
+    uint8_t server_attached; // Set by the server.
+    uint8_t server_exit;     // Set by the server.
+  };
+
+  struct Channel {
+    ShmRing *req;
+    ShmRing *resp;
+  };
+
+  constexpr static uint64_t kMagic = 0x41494641534d4853ULL;
+  constexpr static uint32_t kRingCapacity = 1 << 18;
+  static_assert(kRingCapacity >= TCPDevice::kMaxComputeDataLen);
+
+  static uint64_t get_ring_offset(uint32_t ring_idx);
+  static uint64_t get_arena_offset(uint32_t num_channels);
+  static Channel get_channel(uint8_t *shm, uint32_t channel_idx);
+
+private:
+  constexpr static uint32_t kPrefetchWinSize = 1 << 20;
+  constexpr static uint32_t kWaitServerExitUs = 1000;
+
+  std::string shm_name_;
+  uint8_t *shm_;
+  Header *header_;
+  uint8_t *arena_;
+  SharedPool<Channel *> shared_pool_;
+  std::unique_ptr<Channel[]> channels_;
+  bool constructed_[kMaxNumDSIDs];
+
+  void _read_object(Channel *channel, uint8_t ds_id, uint8_t obj_id_len,
+                    const uint8_t *obj_id, uint16_t *data_len,
+                    uint8_t *data_buf);
+  void _write_object(Channel *channel, uint8_t ds_id, uint8_t obj_id_len,
+                     const uint8_t *obj_id, uint16_t data_len,
+                     const uint8_t *data_buf);
+  bool _remove_object(Channel *channel, uint64_t ds_id, uint8_t obj_id_len,
+                      const uint8_t *obj_id);
+  void _construct(Channel *channel, uint8_t ds_type, uint8_t ds_id,
+                  uint8_t param_len, uint8_t *params);
+  void _destruct(Channel *channel, uint8_t ds_id);
+  void _compute(Channel *channel, uint8_t ds_id, uint8_t opcode,
+                uint16_t input_len, const uint8_t *input_buf,
+                uint16_t *output_len, uint8_t *output_buf);
+  void _compute_stream(Channel *channel, uint8_t ds_id, uint8_t opcode,
+                       uint64_t input_len, const uint8_t *input_buf,
+                       std::vector<std::vector<uint8_t>> *chunks);
+
+public:
+  ShmDevice(const std::string &shm_name, uint32_t num_channels,
+            uint64_t far_mem_size);
+  ~ShmDevice();
+  void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                   uint16_t *data_len, uint8_t *data_buf);
+  void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                    uint16_t data_len, const uint8_t *data_buf);
+  bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
+  void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
+                 uint8_t *params);
+  void destruct(uint8_t ds_id);
+  void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+               const uint8_t *input_buf, uint16_t *output_len,
+               uint8_t *output_buf);
+  void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
+};
+
+// StorageDevice keeps far memory on a block device: either a plain file
+// accessed through io_uring (handy for local testing), or the NVMe device
+// exposed by Shenango's storage path (SPDK). Vanilla objects are stored as
+// |data_len(2B)|data| at their remote address, so every block (LBA) holds a
+// slab of consecutively evacuated objects. Small writes are packed into full
+// blocks by a direct-mapped write-combining buffer; a block is flushed once
+// its tail is written (remote objects are bump-allocated) or when its slot is
+// reused. Data structures that need server-side compute (hashtables,
+// DataFrames) are served by an in-process Server as in FakeDevice.
+class StorageDevice : public FarMemDevice {
+private:
+  constexpr static uint32_t kPrefetchWinSize = 1 << 20;
+  constexpr static uint32_t kFileBlockSize = 4096;
+  constexpr static uint32_t kNumWCSlots = 1024;
+  constexpr static uint32_t kIOUringNumEntries = 256;
+  constexpr static uint32_t kNumBounceBufs = 256;
+  constexpr static uint64_t kInvalidLBA = std::numeric_limits<uint64_t>::max();
+
+  struct WCSlot {
+    rt::Mutex mutex;
+    uint64_t lba;
+    bool dirty;
+    uint8_t *image;
+  };
+
+  int fd_;
+  std::unique_ptr<IOUring> io_uring_;
+  uint32_t block_size_;
+  uint64_t num_blocks_;
+  std::unique_ptr<uint64_t[]> written_bitmap_;
+  std::unique_ptr<WCSlot[]> wc_slots_;
+  SharedPool<uint8_t *> bounce_bufs_;
+  Server server_;
+  bool constructed_[kMaxNumDSIDs];
+
+  uint64_t get_bounce_buf_size() const;
+  void io_blocks(bool is_write, uint8_t *buf, uint64_t lba, uint32_t count);
+  bool is_written(uint64_t lba) const;
+  void set_written(uint64_t lba);
+  WCSlot *get_wc_slot(uint64_t lba);
+  WCSlot *lock_wc_slot(uint64_t lba);
+  void flush_wc_slot(WCSlot *slot);
+  uint8_t *read_bytes(uint8_t *bounce_buf, uint64_t offset, uint32_t len);
+  void write_bytes(uint64_t offset, uint32_t len, const uint8_t *src);
+
+public:
+  // Uses the file at file_path if given; otherwise uses Shenango storage.
+  StorageDevice(std::optional<std::string> file_path, uint64_t far_mem_size);
+  ~StorageDevice();
+  void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                   uint16_t *data_len, uint8_t *data_buf);
+  void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                    uint16_t data_len, const uint8_t *data_buf);
+  bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
+  void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
+                 uint8_t *params);
+  void destruct(uint8_t ds_id);
+  void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+               const uint8_t *input_buf, uint16_t *output_len,
+               uint8_t *output_buf);
+  void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
+};
+
+// TieredDevice composes a fast tier (e.g., remote DRAM) and a slow tier (e.g.,
+// an SSD-backed StorageDevice). The slow tier spans the whole far memory, so a
+// vanilla object keeps its remote address (and thus its object ID) wherever
+// it lives, while the fast tier caches up to fast_tier_size bytes of objects
+// by their object IDs (see ServerTierCache). Writes land in the fast tier,
+// waiting for the demoter if it is full; reads go to the fast tier first and
+// fall back to the slow tier. The fast tier tracks when each object was last
+// read, and a background demoter moves the least recently read ones to the
+// slow tier and evicts them from the fast tier whenever it gets nearly full.
+// A demoted object is promoted back when it is written again. Data
+// structures with server-side compute always stay in the fast tier.
+class TieredDevice : public FarMemDevice {
+private:
+  constexpr static uint32_t kDemoteIntervalUs = 1000;
+  constexpr static uint32_t kEvictRecordSize =
+      sizeof(uint64_t) + sizeof(uint32_t);
+  constexpr static uint32_t kMaxNumEvictRecordsPerCompute =
+      std::numeric_limits<uint16_t>::max() / kEvictRecordSize;
+
+  enum Tier : uint8_t { kFast = 0, kSlow = 1, kNumTiers };
+
+  std::unique_ptr<FarMemDevice> tiers_[kNumTiers];
+  std::atomic<uint64_t> num_hits_[kNumTiers];
+  std::atomic<uint64_t> num_demotions_;
+  bool demoter_exit_;
+  std::unique_ptr<rt::Thread> demoter_thread_;
+  bool constructed_[kMaxNumDSIDs];
+
+  void demote();
+
+public:
+  // Takes the ownership of both tiers, and replaces the vanilla ptr ds of the
+  // fast tier with its cache.
+  TieredDevice(FarMemDevice *fast_tier, FarMemDevice *slow_tier,
+               uint64_t fast_tier_size);
+  ~TieredDevice();
+  uint64_t get_num_fast_tier_hits() const { return num_hits_[kFast]; }
+  uint64_t get_num_slow_tier_hits() const { return num_hits_[kSlow]; }
+  uint64_t get_num_demotions() const { return num_demotions_; }
+  uint64_t get_fast_tier_used_size();
+  void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                   uint16_t *data_len, uint8_t *data_buf);
+  void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+                    uint16_t data_len, const uint8_t *data_buf);
+  bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
+  void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
+                 uint8_t *params);
+  void destruct(uint8_t ds_id);
+  void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+               const uint8_t *input_buf, uint16_t *output_len,
+               uint8_t *output_buf);
+  void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
+};
+
+// ShardedDevice spreads far memory over several underlying devices (e.g.
+// multiple TCPDevices, each talking to its own memory server). Vanilla
+// objects are range-partitioned in kStripeSize stripes, i.e., stripe i lives
+// in shard (i % N), so that an object (which never crosses a remote region)
+// always maps to exactly one shard. Other data structures are placed per
+// ds_id in a round-robin fashion when constructed, except DataFrameVectors:
+// their server-side ops (filter, join, copy_data_by_idx, ...) refer to other
+// vectors, including freshly allocated result vectors, by ds_id, so they all
+// live on kDataFrameVectorShard. Every shard is accessed independently, so
+// concurrent requests from different threads are served by all shards in
+// parallel.
+class ShardedDevice : public FarMemDevice {
+private:
+  constexpr static uint8_t kUnplaced = std::numeric_limits<uint8_t>::max();
+  constexpr static uint32_t kDataFrameVectorShard = 0;
+
+  std::vector<std::unique_ptr<FarMemDevice>> shards_;
+  uint8_t ds_shards_[kMaxNumDSIDs];
+  uint32_t next_shard_;
+
+  FarMemDevice *route(uint8_t ds_id, uint8_t obj_id_len,
+                      const uint8_t **obj_id, uint64_t *shard_obj_id);
+
+public:
+  constexpr static uint64_t kStripeShift = 20;
+  constexpr static uint64_t kStripeSize = (1ULL << kStripeShift);
+
+  // Takes the ownership of all shards.
+  ShardedDevice(const std::vector<FarMemDevice *> &shards);
+  uint32_t get_num_shards() const { return shards_.size(); }
+  uint32_t get_shard_idx(uint8_t ds_id, uint8_t obj_id_len,
+                         const uint8_t *obj_id) const;
   void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
                    uint16_t *data_len, uint8_t *data_buf);
   void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
@@ -118,6 +529,10 @@ public:
   void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                const uint8_t *input_buf, uint16_t *output_len,
                uint8_t *output_buf);
+  void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &consumer);
 };
 
 } // namespace far_memory
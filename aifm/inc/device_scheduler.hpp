@@ -0,0 +1,85 @@
+#pragma once
+
+#include "sync.h"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+namespace far_memory {
+
+// Kinds of far memory traffic, from the most to the least latency-critical.
+enum class TrafficClass : uint8_t {
+  kDemandRead = 0, // Mutator misses.
+  kGCWrite,        // Write-backs of evacuated or flushed objects.
+  kPrefetch,       // Swap-ins issued by prefetchers.
+  kCompute,        // Offloaded compute.
+  kNumClasses
+};
+
+// DeviceScheduler admits at most max_inflight device requests at a time.
+// Requests beyond that wait in per-class FIFO queues, which are served by
+// strict priority with aging: a waiter is promoted by one class for every
+// kAgingStepUs it has waited, so lower classes are never starved.
+class DeviceScheduler {
+private:
+  constexpr static uint32_t kNumClasses =
+      static_cast<uint32_t>(TrafficClass::kNumClasses);
+  constexpr static uint64_t kAgingStepUs = 50;
+
+  struct Waiter {
+    uint64_t enqueue_us;
+    bool admitted = false;
+    rt::CondVar cv;
+  };
+
+  struct alignas(64) ClassStats {
+    std::atomic<uint64_t> num_requests{0};
+    std::atomic<uint64_t> queue_delay_us{0};
+    std::atomic<uint64_t> latency_us{0};
+  };
+
+  uint32_t max_inflight_;
+  uint32_t num_inflight_ = 0;
+  rt::Spin spin_;
+  std::deque<Waiter *> queues_[kNumClasses];
+  ClassStats stats_[kNumClasses];
+
+  void release(TrafficClass cls, uint64_t admit_us, uint64_t enqueue_us);
+
+public:
+  // Holds an admitted request; it leaves the device once destructed.
+  class Ticket {
+  private:
+    DeviceScheduler *scheduler_;
+    TrafficClass cls_;
+    uint64_t enqueue_us_;
+    uint64_t admit_us_;
+    friend class DeviceScheduler;
+
+    Ticket(DeviceScheduler *scheduler, TrafficClass cls, uint64_t enqueue_us,
+           uint64_t admit_us);
+
+  public:
+    Ticket(const Ticket &) = delete;
+    Ticket &operator=(const Ticket &) = delete;
+    Ticket(Ticket &&other);
+    ~Ticket();
+  };
+
+  DeviceScheduler(uint32_t max_inflight);
+  // Blocks until the request is admitted.
+  Ticket admit(TrafficClass cls);
+  // A ticket that does not go through any scheduler.
+  static Ticket bypass(TrafficClass cls);
+  uint32_t get_queue_depth(TrafficClass cls);
+  uint64_t get_num_requests(TrafficClass cls) const;
+  // Averages over all admitted requests of the class. The queue delay is the
+  // time spent waiting for admission; the latency also covers the request.
+  double get_avg_queue_delay_us(TrafficClass cls) const;
+  double get_avg_latency_us(TrafficClass cls) const;
+};
+
+} // namespace far_memory
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "sync.h"
+
+#include "helpers.hpp"
+
+#include <cstdint>
+
+namespace far_memory {
+
+// Decides when the cache GC should start and how many GC threads it should
+// use, in the spirit of the Go GC pacer. It keeps EWMAs of the mutators'
+// allocation rate and the GC's per-thread evacuation rate, and sets the
+// trigger so that a GC cycle started there finishes before the free cache
+// drops to the almost-empty watermark.
+class GCPacer {
+private:
+  constexpr static uint64_t kSampleIntervalUs = 1000;
+  constexpr static double kEWMAWeight = 0.25;
+  // Safety factor applied to the estimated allocation during a GC cycle.
+  constexpr static double kHeadroom = 1.5;
+  // Keeps the trigger at least this far below the goal.
+  constexpr static double kMinTriggerGoalGap = 0.02;
+
+  const double kAlmostEmptyRatio_;
+  const double kMinTriggerRatio_;
+  const double kGoalRatio_;
+  const uint32_t kMaxNumGCThreads_;
+
+  uint64_t num_allocated_bytes_ = 0;
+  uint64_t last_sample_us_ = 0;
+  uint64_t last_sample_num_allocated_bytes_ = 0;
+  // Serializes the samplers and the GC master, which both update the rates.
+  rt::Spin spin_;
+  double alloc_bytes_per_sec_ = 0;
+  double evac_bytes_per_sec_per_thread_ = 0;
+  double trigger_ratio_;
+  uint32_t num_gc_threads_;
+
+  void update();
+
+public:
+  GCPacer(double almost_empty_ratio, double default_trigger_ratio,
+          double min_trigger_ratio, double goal_ratio,
+          uint32_t max_num_gc_threads);
+  NOT_COPYABLE(GCPacer);
+  NOT_MOVEABLE(GCPacer);
+  void add_allocated_bytes(uint64_t bytes);
+  void sample();
+  void add_gc_round(uint64_t evacuated_bytes, uint64_t duration_us,
+                    uint32_t num_gc_threads);
+  double get_trigger_ratio() const;
+  uint32_t get_num_gc_threads() const;
+  double get_alloc_bytes_per_sec() const;
+  double get_evac_bytes_per_sec() const;
+};
+
+} // namespace far_memory
+
+#include "internal/gc_pacer.ipp"
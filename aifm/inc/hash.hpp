@@ -2,6 +2,9 @@
 
 namespace far_memory {
 uint32_t hash_32(const void *key, int len);
+// Spreads the bits of h, e.g., of std::hash's identity hashes of integers, over
+// all bits of the result.
+uint64_t hash_mix_64(uint64_t h);
 }
 
 #include "internal/hash.ipp"
@@ -1,6 +1,7 @@
 #pragma once
 
 extern "C" {
+#include <base/limits.h>
 #include <net/ip.h>
 #include <runtime/tcp.h>
 }
@@ -43,8 +44,9 @@ extern "C" {
     exit(-1);                                                                  \
   }
 
-#define FOR_ALL_SOCKET0_CORES(core_id)                                         \
-  for (uint32_t core_id = 0; core_id < helpers::kNumCPUs; core_id++)
+#define FOR_ALL_CORES(core_id)                                                 \
+  for (uint32_t core_id = 0, num_cores = helpers::get_num_runtime_cores();     \
+       core_id < num_cores; core_id++)
 
 #define CachelineAligned(type)                                                 \
   struct alignas(64) CachelineAligned_##type {                                 \
@@ -64,12 +66,21 @@ constexpr uint8_t kPageShift = 12;
 constexpr uint32_t kPageSize = (1 << kPageShift);
 constexpr uint8_t kHugepageShift = 21;
 constexpr uint32_t kHugepageSize = (1 << kHugepageShift);
+// Upper bound of get_core_num(); per-core structures are sized by
+// get_num_runtime_cores() instead whenever possible.
+constexpr uint32_t kMaxNumCPUs = NCPU;
+// The number of cores that the experiments under exp/ are configured with. The
+// library itself discovers the topology at runtime.
 constexpr uint8_t kNumCPUs = 20;
-constexpr uint8_t kNumSocket1CPUs = 24;
 
 static uint64_t round_to_hugepage_size(uint64_t size);
 static void *allocate_hugepage(uint64_t size);
 static int get_num_cores();
+static uint32_t get_num_runtime_cores();
+static uint32_t get_num_numa_nodes();
+static uint32_t get_cur_numa_node();
+static uint32_t get_numa_node_of_cpu(uint32_t cpu);
+static void bind_to_numa_node(void *addr, uint64_t len, uint32_t node);
 static void timer_start(unsigned *cycles_high_start,
                         unsigned *cycles_low_start);
 static void timer_end(unsigned *cycles_high_end, unsigned *cycles_low_end);
@@ -96,6 +107,7 @@ static void tcp_read_until(tcpconn_t *c, void *buf, size_t expect);
 static void tcp_write_until(tcpconn_t *c, const void *buf, size_t expect);
 static void tcp_write2_until(tcpconn_t *c, const void *buf_0, size_t expect_0,
                              const void *buf_1, size_t expect_1);
+static void file_write_until(int fd, const void *buf, size_t expect);
 static constexpr size_t static_log(uint64_t b, uint64_t n);
 static uint32_t align_to(uint32_t n, uint32_t factor);
 static uint64_t align_to(uint64_t n, uint64_t factor);
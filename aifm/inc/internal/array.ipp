@@ -1,8 +1,12 @@
 #pragma once
 
 #include "helpers.hpp"
+#include "parallel.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstring>
 #include <stdexcept>
 #include <type_traits>
 
@@ -159,4 +163,208 @@ Array<T, Dims...>::static_prefetch(std::tuple<ArgsStart...> start,
   GenericArray::static_prefetch(start_flat_idx, step_flat_idx, num);
 }
 
+template <typename T, uint64_t... Dims>
+KernelSum_t<T> Array<T, Dims...>::sum(Index_t start, Index_t end) {
+  KernelSum_t<T> sum = 0;
+  std::vector<uint8_t> args{static_cast<uint8_t>(get_kernel_type<T>())};
+  scan(
+      "sum", args, start, end,
+      [&](Index_t idx, const uint8_t *data) {
+        sum += *reinterpret_cast<const T *>(data);
+        return true;
+      },
+      [&](const Index_t *idxs, uint32_t num_idxs, const uint8_t *output,
+          uint16_t output_len) {
+        KernelSum_t<T> partial_sum;
+        BUG_ON(output_len != sizeof(partial_sum));
+        __builtin_memcpy(&partial_sum, output, sizeof(partial_sum));
+        sum += partial_sum;
+        return true;
+      });
+  return sum;
+}
+
+// Predicate kernels' args: |op(1B)|type(1B)|value|.
+template <typename T>
+FORCE_INLINE std::vector<uint8_t> get_predicate_args(KernelCmpOp op,
+                                                     const T &val) {
+  std::vector<uint8_t> args{static_cast<uint8_t>(op),
+                            static_cast<uint8_t>(get_kernel_type<T>())};
+  auto *val_ptr = reinterpret_cast<const uint8_t *>(&val);
+  args.insert(args.end(), val_ptr, val_ptr + sizeof(T));
+  return args;
+}
+
+template <typename T, uint64_t... Dims>
+std::optional<GenericArray::Index_t>
+Array<T, Dims...>::find_first(KernelCmpOp op, const T &val, Index_t start,
+                              Index_t end) {
+  std::optional<Index_t> found;
+  auto update = [&](Index_t idx) {
+    if (!found || idx < *found) {
+      found = idx;
+    }
+  };
+  scan(
+      "find_first", get_predicate_args(op, val), start, end,
+      [&](Index_t idx, const uint8_t *data) {
+        if (kernel_compare(op, *reinterpret_cast<const T *>(data), val)) {
+          update(idx);
+        }
+        return !found;
+      },
+      [&](const Index_t *idxs, uint32_t num_idxs, const uint8_t *output,
+          uint16_t output_len) {
+        uint32_t pos;
+        BUG_ON(output_len != sizeof(pos));
+        __builtin_memcpy(&pos, output, sizeof(pos));
+        if (pos != kKernelNotFound) {
+          update(idxs[pos]);
+        }
+        return !found;
+      });
+  return found;
+}
+
+template <typename T, uint64_t... Dims>
+std::vector<GenericArray::Index_t>
+Array<T, Dims...>::filter(KernelCmpOp op, const T &val, Index_t start,
+                          Index_t end) {
+  std::vector<Index_t> matched;
+  scan(
+      "filter", get_predicate_args(op, val), start, end,
+      [&](Index_t idx, const uint8_t *data) {
+        if (kernel_compare(op, *reinterpret_cast<const T *>(data), val)) {
+          matched.push_back(idx);
+        }
+        return true;
+      },
+      [&](const Index_t *idxs, uint32_t num_idxs, const uint8_t *output,
+          uint16_t output_len) {
+        BUG_ON(output_len != (num_idxs + 7) / 8);
+        for (uint32_t i = 0; i < num_idxs; i++) {
+          if (output[i / 8] & (1 << (i % 8))) {
+            matched.push_back(idxs[i]);
+          }
+        }
+        return true;
+      });
+  // Local and remote matches of a window are interleaved.
+  std::sort(matched.begin(), matched.end());
+  return matched;
+}
+
+template <typename T, uint64_t... Dims>
+std::vector<GenericArray::Index_t>
+Array<T, Dims...>::search(const void *pattern, uint16_t pattern_len,
+                          Index_t start, Index_t end) {
+  std::vector<Index_t> matched;
+  auto *pattern_ptr = reinterpret_cast<const uint8_t *>(pattern);
+  std::vector<uint8_t> args(pattern_ptr, pattern_ptr + pattern_len);
+  scan(
+      "search", args, start, end,
+      [&](Index_t idx, const uint8_t *data) {
+        if (memmem(data, sizeof(T), pattern, pattern_len)) {
+          matched.push_back(idx);
+        }
+        return true;
+      },
+      [&](const Index_t *idxs, uint32_t num_idxs, const uint8_t *output,
+          uint16_t output_len) {
+        BUG_ON(output_len != (num_idxs + 7) / 8);
+        for (uint32_t i = 0; i < num_idxs; i++) {
+          if (output[i / 8] & (1 << (i % 8))) {
+            matched.push_back(idxs[i]);
+          }
+        }
+        return true;
+      });
+  std::sort(matched.begin(), matched.end());
+  return matched;
+}
+
+template <typename T, uint64_t... Dims>
+template <bool Mut, typename F>
+FORCE_INLINE void Array<T, Dims...>::parallel_walk(Index_t start, Index_t end,
+                                                   uint32_t num_threads,
+                                                   F &&f) {
+  assert(!DerefScope::is_in_deref_scope());
+  if (start >= end) {
+    return;
+  }
+  // The workers bypass prefetcher_, which is not thread-safe; each has a
+  // prefetch stream over its own items instead.
+  parallel_for_prefetched(
+      end - start, num_threads, get_prefetch_win_num_items(),
+      [&](uint64_t i) {
+        ptrs_[start + i].swap_in(/* nt = */ false, TrafficClass::kPrefetch);
+      },
+      [&](uint32_t tid, uint64_t begin, uint64_t stop,
+          std::atomic<uint64_t> &cursor) {
+        DerefScope scope;
+        for (auto i = begin; i < stop; i++) {
+          if (i != begin && (i - begin) % kNumItemsPerScope == 0) {
+            scope.renew();
+          }
+          cursor.store(i, std::memory_order_relaxed);
+          auto ptr = reinterpret_cast<UniquePtr<T> *>(&ptrs_[start + i]);
+          if constexpr (Mut) {
+            f(tid, static_cast<const DerefScope &>(scope), start + i,
+              *(ptr->deref_mut(scope)));
+          } else {
+            f(tid, static_cast<const DerefScope &>(scope), start + i,
+              *(ptr->deref(scope)));
+          }
+        }
+      });
+}
+
+template <typename T, uint64_t... Dims>
+template <typename F>
+FORCE_INLINE void Array<T, Dims...>::parallel_for(F &&f, Index_t start,
+                                                  Index_t end) {
+  parallel_walk</* Mut = */ true>(
+      start, end,
+      get_num_parallel_threads(end - std::min(start, end),
+                               kMinNumItemsPerThread),
+      [&](uint32_t tid, const DerefScope &scope, Index_t idx, T &item) {
+        f(scope, idx, item);
+      });
+}
+
+template <typename T, uint64_t... Dims>
+template <typename F>
+FORCE_INLINE void Array<T, Dims...>::parallel_for(F &&f, Index_t start,
+                                                  Index_t end) const {
+  const_cast<Array<T, Dims...> *>(this)->template parallel_walk<
+      /* Mut = */ false>(
+      start, end,
+      get_num_parallel_threads(end - std::min(start, end),
+                               kMinNumItemsPerThread),
+      [&](uint32_t tid, const DerefScope &scope, Index_t idx, const T &item) {
+        f(scope, idx, item);
+      });
+}
+
+template <typename T, uint64_t... Dims>
+template <typename Acc, typename F, typename C>
+FORCE_INLINE Acc Array<T, Dims...>::parallel_reduce(Acc init, F &&f,
+                                                    C &&combine, Index_t start,
+                                                    Index_t end) {
+  auto num_threads = get_num_parallel_threads(end - std::min(start, end),
+                                              kMinNumItemsPerThread);
+  // Keeps the accumulators of the workers off each other's cache lines.
+  CachelineAligned(Acc);
+  std::vector<CachelineAligned_Acc> accs(num_threads, {init});
+  parallel_walk</* Mut = */ false>(
+      start, end, num_threads,
+      [&](uint32_t tid, const DerefScope &scope, Index_t idx, const T &item) {
+        f(accs[tid].data, scope, idx, item);
+      });
+  for (uint32_t tid = 1; tid < num_threads; tid++) {
+    combine(accs[0].data, accs[tid].data);
+  }
+  return std::move(accs[0].data);
+}
+
 } // namespace far_memory
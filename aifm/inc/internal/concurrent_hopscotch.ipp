@@ -160,7 +160,9 @@ FORCE_INLINE ConcurrentHopscotch<K, V>::ConcurrentHopscotch(
     uint8_t ds_id, uint32_t local_num_entries_shift,
     uint32_t remote_num_entries_shift, uint64_t remote_data_size)
     : GenericConcurrentHopscotch(ds_id, local_num_entries_shift,
-                                 remote_num_entries_shift, remote_data_size) {}
+                                 remote_num_entries_shift, remote_data_size),
+      per_core_size_(
+          new CachelineAligned_int64_t[helpers::get_num_runtime_cores()]()) {}
 
 template <typename K, typename V>
 FORCE_INLINE std::optional<V> ConcurrentHopscotch<K, V>::_find(const K &key) {
@@ -208,7 +210,7 @@ FORCE_INLINE bool ConcurrentHopscotch<K, V>::empty() const {
 template <typename K, typename V>
 FORCE_INLINE uint64_t ConcurrentHopscotch<K, V>::size() const {
   int64_t sum = 0;
-  FOR_ALL_SOCKET0_CORES(i) { sum += per_core_size_[i].data; }
+  FOR_ALL_CORES(i) { sum += per_core_size_[i].data; }
   return sum;
 }
 
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace far_memory {
+
+// Encoded chunk: |encoding(1B)|...|, where ... is
+//   RunLength:        |num_runs(2B)|values(num_runs * sizeof(T) B)|
+//                     |run ends(num_runs * 2B)|,
+//   Dictionary:       |dict_size - 1(1B)|code_bits(1B)|
+//                     |dict(dict_size * sizeof(T) B)|codes|,
+//   FrameOfReference: |ref(sizeof(T) B)|width(1B)|offsets(n * width B)|.
+
+template <typename T>
+FORCE_INLINE typename DataFrameChunkCodec<T>::Bits_t
+DataFrameChunkCodec<T>::to_bits(const T &val) {
+  if constexpr (std::is_same<T, SimpleTime>::value) {
+    // Packs the fields most significant first, so that a time series spans a
+    // narrow range of bits.
+    uint8_t bytes[sizeof(T)];
+    __builtin_memcpy(bytes, &val, sizeof(T));
+    Bits_t bits = (static_cast<Bits_t>(bytes[1]) << 8) | bytes[0];
+    for (uint32_t i = 2; i < sizeof(T); i++) {
+      bits = (bits << 8) | bytes[i];
+    }
+    return bits;
+  } else {
+    Bits_t bits;
+    __builtin_memcpy(&bits, &val, sizeof(T));
+    if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+      // Keeps the order, so that small negative and positive elements are
+      // close.
+      bits ^= static_cast<Bits_t>(1) << (8 * sizeof(T) - 1);
+    }
+    return bits;
+  }
+}
+
+template <typename T>
+FORCE_INLINE T DataFrameChunkCodec<T>::from_bits(Bits_t bits) {
+  T val;
+  if constexpr (std::is_same<T, SimpleTime>::value) {
+    uint8_t bytes[sizeof(T)];
+    for (uint32_t i = sizeof(T) - 1; i >= 2; i--) {
+      bytes[i] = bits & 0xff;
+      bits >>= 8;
+    }
+    bytes[0] = bits & 0xff;
+    bytes[1] = bits >> 8;
+    __builtin_memcpy(&val, bytes, sizeof(T));
+  } else {
+    if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+      bits ^= static_cast<Bits_t>(1) << (8 * sizeof(T) - 1);
+    }
+    __builtin_memcpy(&val, &bits, sizeof(T));
+  }
+  return val;
+}
+
+template <typename T>
+FORCE_INLINE uint32_t DataFrameChunkCodec<T>::get_run_length_size(const T *data,
+                                                                uint32_t n) {
+  uint32_t num_runs = 1;
+  for (uint32_t i = 1; i < n; i++) {
+    num_runs += (to_bits(data[i]) != to_bits(data[i - 1]));
+  }
+  return 1 + sizeof(uint16_t) + num_runs * (sizeof(T) + sizeof(uint16_t));
+}
+
+template <typename T>
+FORCE_INLINE uint32_t DataFrameChunkCodec<T>::get_dictionary_size(
+    const T *data, uint32_t n, Bits_t *dict, uint32_t *dict_size,
+    uint8_t *codes) {
+  Bits_t keys[kDictTableSize];
+  int16_t key_codes[kDictTableSize];
+  std::fill(key_codes, key_codes + kDictTableSize, -1);
+  *dict_size = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    auto bits = to_bits(data[i]);
+    auto slot = hash_mix_64(bits) & (kDictTableSize - 1);
+    while (key_codes[slot] != -1 && keys[slot] != bits) {
+      slot = (slot + 1) & (kDictTableSize - 1);
+    }
+    if (key_codes[slot] == -1) {
+      if (*dict_size == kMaxDictSize) {
+        return std::numeric_limits<uint32_t>::max();
+      }
+      keys[slot] = bits;
+      key_codes[slot] = *dict_size;
+      dict[(*dict_size)++] = bits;
+    }
+    codes[i] = key_codes[slot];
+  }
+  uint32_t code_bits = 1;
+  while ((1U << code_bits) < *dict_size) {
+    code_bits *= 2;
+  }
+  return 3 + *dict_size * sizeof(T) + (n * code_bits + 7) / 8;
+}
+
+template <typename T>
+FORCE_INLINE uint32_t DataFrameChunkCodec<T>::get_frame_of_reference_size(
+    const T *data, uint32_t n, Bits_t *ref, uint8_t *width) {
+  auto min = to_bits(data[0]);
+  auto max = min;
+  for (uint32_t i = 1; i < n; i++) {
+    auto bits = to_bits(data[i]);
+    min = std::min(min, bits);
+    max = std::max(max, bits);
+  }
+  uint64_t range = max - min;
+  *ref = min;
+  *width = 1;
+  while (*width < sizeof(T) && (range >> (8 * *width))) {
+    *width *= 2;
+  }
+  if (*width >= sizeof(T)) {
+    return std::numeric_limits<uint32_t>::max();
+  }
+  return 2 + sizeof(T) + n * *width;
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameChunkCodec<T>::encode_run_length(const T *data,
+                                                            uint32_t n,
+                                                            uint8_t *buf) {
+  uint16_t num_runs = 0;
+  auto *values = buf + 1 + sizeof(uint16_t);
+  for (uint32_t i = 0; i < n; i++) {
+    if (i == 0 || to_bits(data[i]) != to_bits(data[i - 1])) {
+      auto bits = to_bits(data[i]);
+      __builtin_memcpy(values + num_runs++ * sizeof(T), &bits, sizeof(T));
+    }
+  }
+  auto *ends = values + num_runs * sizeof(T);
+  uint16_t run = 0;
+  for (uint32_t i = 1; i <= n; i++) {
+    if (i == n || to_bits(data[i]) != to_bits(data[i - 1])) {
+      uint16_t end = i;
+      __builtin_memcpy(ends + run++ * sizeof(end), &end, sizeof(end));
+    }
+  }
+  __builtin_memcpy(buf + 1, &num_runs, sizeof(num_runs));
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameChunkCodec<T>::encode_dictionary(
+    const Bits_t *dict, uint32_t dict_size, const uint8_t *codes, uint32_t n,
+    uint8_t *buf) {
+  uint8_t code_bits = 1;
+  while ((1U << code_bits) < dict_size) {
+    code_bits *= 2;
+  }
+  buf[1] = dict_size - 1;
+  buf[2] = code_bits;
+  __builtin_memcpy(buf + 3, dict, dict_size * sizeof(T));
+  auto *packed = buf + 3 + dict_size * sizeof(T);
+  std::fill(packed, packed + (n * code_bits + 7) / 8, 0);
+  for (uint32_t i = 0; i < n; i++) {
+    auto bit = i * code_bits;
+    packed[bit / 8] |= codes[i] << (bit % 8);
+  }
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameChunkCodec<T>::encode_frame_of_reference(
+    const T *data, uint32_t n, Bits_t ref, uint8_t width, uint8_t *buf) {
+  __builtin_memcpy(buf + 1, &ref, sizeof(T));
+  buf[1 + sizeof(T)] = width;
+  auto *offsets = buf + 2 + sizeof(T);
+  for (uint32_t i = 0; i < n; i++) {
+    // Little endian, so the low bytes of the offset come first.
+    uint64_t offset = to_bits(data[i]) - ref;
+    __builtin_memcpy(offsets + i * width, &offset, width);
+  }
+}
+
+template <typename T>
+FORCE_INLINE uint32_t DataFrameChunkCodec<T>::encode(const T *data,
+                                                     uint32_t n,
+                                                     uint8_t *buf) {
+  BUG_ON(n == 0 || n > kMaxNumEntries);
+  Bits_t dict[kMaxDictSize];
+  uint32_t dict_size;
+  uint8_t codes[kMaxNumEntries];
+  Bits_t ref;
+  uint8_t width;
+  auto run_length_size = get_run_length_size(data, n);
+  auto dictionary_size =
+      get_dictionary_size(data, n, dict, &dict_size, codes);
+  auto frame_of_reference_size =
+      get_frame_of_reference_size(data, n, &ref, &width);
+  auto size = std::min(
+      {run_length_size, dictionary_size, frame_of_reference_size});
+  if (size >= n * sizeof(T)) {
+    return 0;
+  }
+  if (size == run_length_size) {
+    buf[0] = static_cast<uint8_t>(DataFrameChunkEncoding::RunLength);
+    encode_run_length(data, n, buf);
+  } else if (size == dictionary_size) {
+    buf[0] = static_cast<uint8_t>(DataFrameChunkEncoding::Dictionary);
+    encode_dictionary(dict, dict_size, codes, n, buf);
+  } else {
+    buf[0] = static_cast<uint8_t>(DataFrameChunkEncoding::FrameOfReference);
+    encode_frame_of_reference(data, n, ref, width, buf);
+  }
+  return size;
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameChunkCodec<T>::decode(const uint8_t *buf,
+                                                 uint32_t len, T *data,
+                                                 uint32_t n) {
+  switch (static_cast<DataFrameChunkEncoding>(buf[0])) {
+  case DataFrameChunkEncoding::RunLength: {
+    uint16_t num_runs;
+    __builtin_memcpy(&num_runs, buf + 1, sizeof(num_runs));
+    auto *values = buf + 1 + sizeof(uint16_t);
+    auto *ends = values + num_runs * sizeof(T);
+    uint32_t i = 0;
+    for (uint32_t run = 0; run < num_runs; run++) {
+      Bits_t bits;
+      uint16_t end;
+      __builtin_memcpy(&bits, values + run * sizeof(T), sizeof(T));
+      __builtin_memcpy(&end, ends + run * sizeof(end), sizeof(end));
+      std::fill(data + i, data + end, from_bits(bits));
+      i = end;
+    }
+    assert(i == n);
+    assert(len == 1 + sizeof(uint16_t) +
+                      num_runs * (sizeof(T) + sizeof(uint16_t)));
+    break;
+  }
+  case DataFrameChunkEncoding::Dictionary: {
+    uint32_t dict_size = buf[1] + 1;
+    uint8_t code_bits = buf[2];
+    T dict[kMaxDictSize];
+    for (uint32_t i = 0; i < dict_size; i++) {
+      Bits_t bits;
+      __builtin_memcpy(&bits, buf + 3 + i * sizeof(T), sizeof(T));
+      dict[i] = from_bits(bits);
+    }
+    auto *packed = buf + 3 + dict_size * sizeof(T);
+    assert(len == 3 + dict_size * sizeof(T) + (n * code_bits + 7) / 8);
+    uint8_t mask = (1U << code_bits) - 1;
+    for (uint32_t i = 0; i < n; i++) {
+      auto bit = i * code_bits;
+      data[i] = dict[(packed[bit / 8] >> (bit % 8)) & mask];
+    }
+    break;
+  }
+  case DataFrameChunkEncoding::FrameOfReference: {
+    Bits_t ref;
+    __builtin_memcpy(&ref, buf + 1, sizeof(T));
+    uint8_t width = buf[1 + sizeof(T)];
+    auto *offsets = buf + 2 + sizeof(T);
+    assert(len == 2 + sizeof(T) + n * width);
+    for (uint32_t i = 0; i < n; i++) {
+      uint64_t offset = 0;
+      __builtin_memcpy(&offset, offsets + i * width, width);
+      data[i] = from_bits(ref + offset);
+    }
+    break;
+  }
+  default:
+    BUG();
+  }
+}
+
+} // namespace far_memory
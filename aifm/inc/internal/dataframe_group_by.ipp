@@ -0,0 +1,39 @@
+#pragma once
+
+#include <limits>
+
+namespace far_memory {
+
+template <typename T, typename U>
+FORCE_INLINE DataFrameGroupBy::Column
+DataFrameGroupBy::make_column(DataFrameVector<T> &vec,
+                              DataFrameVector<U> *out) {
+  BUG_ON(!out->empty());
+  auto set_result = [out](uint64_t size, uint64_t capacity) {
+    out->size_ = size;
+    out->remote_vec_capacity_ = capacity;
+    out->expand_no_alloc(capacity);
+  };
+  return Column{&vec, static_cast<uint8_t>(get_dataframe_type_id<T>()), out,
+                set_result};
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameGroupBy::key(DataFrameVector<T> &vec,
+                                        DataFrameVector<T> *out) {
+  BUG_ON(keys_.size() == std::numeric_limits<uint8_t>::max());
+  keys_.push_back(make_column(vec, out));
+}
+
+template <GroupByAggFn Fn, typename T>
+FORCE_INLINE void
+DataFrameGroupBy::agg(DataFrameVector<T> &vec,
+                      DataFrameVector<GroupByResult_t<T, Fn>> *out) {
+  static_assert(std::is_arithmetic<T>::value || Fn == GroupByAggFn::Count ||
+                    Fn == GroupByAggFn::Min || Fn == GroupByAggFn::Max,
+                "SimpleTime columns only support Count, Min and Max.");
+  BUG_ON(aggs_.size() == std::numeric_limits<uint8_t>::max());
+  aggs_.push_back(Agg{make_column(vec, out), Fn});
+}
+
+} // namespace far_memory
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "deref_scope.hpp"
+
+#include <cstring>
+#include <limits>
+
+namespace far_memory {
+
+template <typename T>
+FORCE_INLINE void DataFramePredicate::append(const T &val) {
+  auto offset = buf_.size();
+  buf_.resize(offset + sizeof(T));
+  __builtin_memcpy(buf_.data() + offset, &val, sizeof(T));
+}
+
+template <typename T>
+FORCE_INLINE DataFramePredicate
+DataFramePredicate::leaf(Kind kind, DataFrameVector<T> &col) {
+  DataFramePredicate pred;
+  pred.append(kind);
+  pred.append(col.ds_id_);
+  pred.append(static_cast<uint8_t>(get_dataframe_type_id<T>()));
+  auto read = [col_ptr = &col](uint64_t begin, uint32_t len, uint8_t *buf) {
+    auto *elems = reinterpret_cast<T *>(buf);
+    DerefScope scope;
+    auto it = col_ptr->cfbegin(scope);
+    it += begin;
+    for (uint32_t i = 0; i < len; i++, ++it) {
+      if (unlikely(i % kNumElementsPerScope == 0)) {
+        scope.renew();
+        it.renew(scope);
+      }
+      elems[i] = *it;
+    }
+  };
+  pred.columns_[col.ds_id_] = Column{&col, sizeof(T), read};
+  return pred;
+}
+
+template <typename T>
+FORCE_INLINE DataFramePredicate DataFramePredicate::cmp(
+    DataFrameVector<T> &col, KernelCmpOp op, std::type_identity_t<T> val) {
+  auto pred = leaf(Kind::Cmp, col);
+  pred.append(op);
+  pred.append(val);
+  return pred;
+}
+
+template <typename T>
+FORCE_INLINE DataFramePredicate
+DataFramePredicate::range(DataFrameVector<T> &col, std::type_identity_t<T> lo,
+                          std::type_identity_t<T> hi) {
+  auto pred = leaf(Kind::Range, col);
+  pred.append(lo);
+  pred.append(hi);
+  return pred;
+}
+
+template <typename T>
+FORCE_INLINE DataFramePredicate
+DataFramePredicate::in(DataFrameVector<T> &col,
+                       const std::vector<std::type_identity_t<T>> &vals) {
+  BUG_ON(vals.size() > std::numeric_limits<uint16_t>::max());
+  auto pred = leaf(Kind::In, col);
+  pred.append(static_cast<uint16_t>(vals.size()));
+  for (const auto &val : vals) {
+    pred.append(val);
+  }
+  return pred;
+}
+
+} // namespace far_memory
@@ -1,9 +1,14 @@
 #pragma once
 
+extern "C" {
+#include <base/stddef.h>
+}
+
 #include "../DataFrame/AIFM/include/simple_time.hpp"
 #include "helpers.hpp"
 
 #include <cstdint>
+#include <limits>
 #include <type_traits>
 
 namespace far_memory {
@@ -62,4 +67,51 @@ template <typename T> FORCE_INLINE constexpr int8_t get_dataframe_type_id() {
 template <typename T> FORCE_INLINE constexpr bool is_basic_dataframe_types() {
   return get_dataframe_type_id<T>() != -1;
 }
+
+// An index that refers to no row, e.g., to the missing side of a row that an
+// outer join keeps.
+constexpr uint64_t kDataFrameNullIdx = std::numeric_limits<uint64_t>::max();
+
+// The value that a kDataFrameNullIdx index selects: NaN for floating points and
+// zero otherwise.
+template <typename T> FORCE_INLINE T get_dataframe_null_value() {
+  if constexpr (std::is_floating_point<T>::value) {
+    return std::numeric_limits<T>::quiet_NaN();
+  } else if constexpr (std::is_same<T, SimpleTime>::value) {
+    return SimpleTime(0, 0, 0, 0, 0, 0);
+  } else {
+    return 0;
+  }
+}
+
+// Calls f with a null T *, where T is the type of dt_id.
+template <typename F>
+FORCE_INLINE void visit_dataframe_type(uint8_t dt_id, F &&f) {
+  switch (dt_id) {
+  case DataFrameTypeID::Char:
+    return f(static_cast<char *>(nullptr));
+  case DataFrameTypeID::Short:
+    return f(static_cast<short *>(nullptr));
+  case DataFrameTypeID::Int:
+    return f(static_cast<int *>(nullptr));
+  case DataFrameTypeID::UnsignedInt:
+    return f(static_cast<unsigned int *>(nullptr));
+  case DataFrameTypeID::Long:
+    return f(static_cast<long *>(nullptr));
+  case DataFrameTypeID::UnsignedLong:
+    return f(static_cast<unsigned long *>(nullptr));
+  case DataFrameTypeID::LongLong:
+    return f(static_cast<long long *>(nullptr));
+  case DataFrameTypeID::UnsignedLongLong:
+    return f(static_cast<unsigned long long *>(nullptr));
+  case DataFrameTypeID::Float:
+    return f(static_cast<float *>(nullptr));
+  case DataFrameTypeID::Double:
+    return f(static_cast<double *>(nullptr));
+  case DataFrameTypeID::Time:
+    return f(static_cast<SimpleTime *>(nullptr));
+  default:
+    BUG();
+  }
+}
 } // namespace far_memory
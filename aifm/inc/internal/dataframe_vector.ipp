@@ -3,7 +3,9 @@
 #include "aggregator.hpp"
 #include "helpers.hpp"
 #include "manager.hpp"
+#include "parallel.hpp"
 
+#include <cmath>
 #include <cstring>
 #include <ctime>
 #include <unordered_set>
@@ -42,6 +44,19 @@ FORCE_INLINE DataFrameVector<T>::DataFrameVector(FarMemManager *manager)
           manager->get_device(), reinterpret_cast<uint8_t *>(&lock_),
           kRealChunkSize)) {}
 
+template <typename T>
+FORCE_INLINE DataFrameVector<T>::DataFrameVector(FarMemManager *manager,
+                                                 uint8_t ds_id)
+    : GenericDataFrameVector(kRealChunkSize, kRealChunkNumEntries,
+                             manager->reserve_ds_id(ds_id),
+                             get_dataframe_type_id<T>()),
+      prefetcher_(new Prefetcher<decltype(kInduceFn), decltype(kInferFn),
+                                 decltype(kMappingFn)>(
+          manager->get_device(), reinterpret_cast<uint8_t *>(&lock_),
+          kRealChunkSize)) {
+  adopt_remote();
+}
+
 template <typename T>
 FORCE_INLINE DataFrameVector<T>::DataFrameVector(const DataFrameVector &other)
     : DataFrameVector(FarMemManagerFactory::get()) {
@@ -91,6 +106,8 @@ GenericDataFrameVector::GenericDataFrameVector(GenericDataFrameVector &&other)
     : chunk_size_(other.chunk_size_),
       chunk_num_entries_(other.chunk_num_entries_), device_(other.device_),
       ds_id_(other.ds_id_), size_(other.size_),
+      remote_vec_capacity_(other.remote_vec_capacity_),
+      flushed_size_(other.flushed_size_),
       chunk_ptrs_(std::move(other.chunk_ptrs_)), moved_(false),
       dirty_(other.dirty_) {
   assert(!other.moved_);
@@ -105,6 +122,8 @@ operator=(GenericDataFrameVector &&other) {
   device_ = other.device_;
   ds_id_ = other.ds_id_;
   size_ = other.size_;
+  remote_vec_capacity_ = other.remote_vec_capacity_;
+  flushed_size_ = other.flushed_size_;
   chunk_ptrs_ = std::move(other.chunk_ptrs_);
   moved_ = false;
   dirty_ = other.dirty_;
@@ -256,24 +275,39 @@ DataFrameVector<T>::Iterator::operator-(const Iterator &other) const {
           static_cast<int64_t>(other.chunk_offset_));
 }
 
+// Points [data_ptr_begin_, data_ptr_end_) at the chunk of chunk_ptr_, or at
+// nothing if the iterator is past the last chunk. Any element of the chunk may
+// be written through a mutable iterator from then on, so its zone map is reset
+// on every such dereference, including the ones of renew().
+template <typename T>
+template <bool Mut>
+template <bool Nt>
+FORCE_INLINE bool DataFrameVector<T>::FastIterator<Mut>::deref_chunk() {
+  if (unlikely(chunk_ptr_ > &dataframe_vec_->chunk_ptrs_.back() ||
+               chunk_ptr_ < &dataframe_vec_->chunk_ptrs_.front())) {
+    data_ptr_begin_ = data_ptr_end_ = nullptr;
+    return false;
+  }
+  if constexpr (Mut) {
+    dataframe_vec_->invalidate_zone_map(
+        chunk_ptr_ - &(dataframe_vec_->chunk_ptrs_.front()));
+    data_ptr_begin_ =
+        reinterpret_cast<T *>(chunk_ptr_->template deref_mut<Nt>(*scope_));
+  } else {
+    data_ptr_begin_ =
+        reinterpret_cast<const T *>(chunk_ptr_->template deref<Nt>(*scope_));
+  }
+  data_ptr_end_ = data_ptr_begin_ + kRealChunkNumEntries;
+  return true;
+}
+
 template <typename T>
 template <bool Mut>
 template <bool Nt>
 FORCE_INLINE void DataFrameVector<T>::FastIterator<Mut>::update_on_new_chunk() {
-  if (likely(chunk_ptr_ <= &dataframe_vec_->chunk_ptrs_.back() &&
-             chunk_ptr_ >= &dataframe_vec_->chunk_ptrs_.front())) {
+  if (likely(deref_chunk<Nt>())) {
     dataframe_vec_->prefetcher_->add_trace(
         Nt, chunk_ptr_ - &(dataframe_vec_->chunk_ptrs_.front()));
-    if constexpr (Mut) {
-      data_ptr_begin_ =
-          reinterpret_cast<T *>(chunk_ptr_->deref_mut<Nt>(*scope_));
-    } else {
-      data_ptr_begin_ =
-          reinterpret_cast<const T *>(chunk_ptr_->deref<Nt>(*scope_));
-    }
-    data_ptr_end_ = data_ptr_begin_ + kRealChunkNumEntries;
-  } else {
-    data_ptr_begin_ = data_ptr_end_ = nullptr;
   }
 }
 
@@ -420,15 +454,8 @@ template <bool Nt>
 FORCE_INLINE void
 DataFrameVector<T>::FastIterator<Mut>::renew(DerefScope &scope) {
   auto offset = data_ptr_ - data_ptr_begin_;
-  if constexpr (Mut) {
-    data_ptr_begin_ =
-        reinterpret_cast<T *>(chunk_ptr_->template deref_mut<Nt>(*scope_));
-  } else {
-    data_ptr_begin_ =
-        reinterpret_cast<const T *>(chunk_ptr_->template deref<Nt>(*scope_));
-  }
+  deref_chunk<Nt>();
   data_ptr_ = data_ptr_begin_ + offset;
-  data_ptr_end_ = data_ptr_begin_ + kRealChunkNumEntries;
 }
 
 template <typename T>
@@ -455,7 +482,8 @@ operator=(const DataFrameVector &other) {
 template <typename T>
 FORCE_INLINE DataFrameVector<T>::DataFrameVector(DataFrameVector &&other)
     : GenericDataFrameVector(std::move(other.lock())),
-      prefetcher_(std::move(other.prefetcher_)) {
+      prefetcher_(std::move(other.prefetcher_)),
+      zone_maps_(std::move(other.zone_maps_)) {
   prefetcher_->update_state(reinterpret_cast<uint8_t *>(&lock_));
   other.lock_.unlock_writer();
 }
@@ -466,6 +494,7 @@ operator=(DataFrameVector &&other) {
   auto writer_lock = other.lock_.get_writer_lock();
   GenericDataFrameVector::operator=(std::move(other));
   prefetcher_ = std::move(other.prefetcher_);
+  zone_maps_ = std::move(other.zone_maps_);
   prefetcher_->update_state(reinterpret_cast<uint8_t *>(&lock_));
   return *this;
 }
@@ -494,6 +523,8 @@ FORCE_INLINE void DataFrameVector<T>::expand(uint64_t num) {
 
 template <typename T>
 FORCE_INLINE void DataFrameVector<T>::expand_no_alloc(uint64_t num) {
+  // It follows every operation that the server writes the vector in.
+  zone_maps_.clear();
   GenericDataFrameVector::expand_no_alloc(
       (num == 0) ? 0 : (num - 1) / kRealChunkNumEntries + 1);
 }
@@ -512,10 +543,106 @@ FORCE_INLINE void DataFrameVector<T>::push_back(const DerefScope &scope,
   auto *raw_mut_ptr = chunk_ptrs_[chunk_idx].template deref_mut<Nt>(scope);
   __builtin_memcpy(reinterpret_cast<T *>(raw_mut_ptr) + chunk_offset, &u,
                    sizeof(u));
+  update_zone_map(chunk_idx, chunk_offset, u);
   prefetch_record(Nt, chunk_idx);
   dirty_ = true;
 }
 
+template <typename T>
+template <bool Bypass>
+FORCE_INLINE void DataFrameVector<T>::append(const T *data, uint64_t n) {
+  assert(!DerefScope::is_in_deref_scope());
+  DerefScope scope;
+  while (n) {
+    auto [chunk_idx, chunk_offset] = get_chunk_stats(size_);
+    auto num = std::min<uint64_t>(n, kRealChunkNumEntries - chunk_offset);
+    if (chunk_idx == chunk_ptrs_.size()) {
+      if (Bypass && num == kRealChunkNumEntries) {
+        // Hands the whole chunks to the server, which leaves them remote.
+        auto num_chunks = n / kRealChunkNumEntries;
+        num = num_chunks * kRealChunkNumEntries;
+        reserve_remote(size_ + num);
+        GenericDataFrameVector::expand_no_alloc(num_chunks);
+        for (uint64_t i = 0; i < num_chunks; i++) {
+          auto written = write_remote_chunk(
+              chunk_idx + i, reinterpret_cast<const uint8_t *>(
+                                 data + i * kRealChunkNumEntries));
+          BUG_ON(!written);
+        }
+        for (uint64_t i = 0; i < num; i++) {
+          update_zone_map(chunk_idx + i / kRealChunkNumEntries,
+                          i % kRealChunkNumEntries, data[i]);
+        }
+        size_ += num;
+        data += num;
+        n -= num;
+        continue;
+      }
+      expand(Bypass ? n : std::max<uint64_t>(n, kNumEntriesPerExpansion));
+    }
+    auto *chunk =
+        reinterpret_cast<T *>(chunk_ptrs_[chunk_idx].deref_mut(scope));
+    memcpy(chunk + chunk_offset, data, num * sizeof(T));
+    for (uint64_t i = 0; i < num; i++) {
+      update_zone_map(chunk_idx, chunk_offset + i, data[i]);
+    }
+    size_ += num;
+    data += num;
+    n -= num;
+    scope.renew();
+  }
+  dirty_ = true;
+}
+
+template <typename T>
+template <bool Bypass>
+FORCE_INLINE void DataFrameVector<T>::read_range(uint64_t begin, uint64_t n,
+                                                 T *out) {
+  assert(!DerefScope::is_in_deref_scope());
+  BUG_ON(begin + n > size_);
+  DerefScope scope;
+  while (n) {
+    auto [chunk_idx, chunk_offset] = get_chunk_stats(begin);
+    auto num = std::min<uint64_t>(n, kRealChunkNumEntries - chunk_offset);
+    if (!Bypass || num != kRealChunkNumEntries ||
+        !read_remote_chunk(chunk_idx, reinterpret_cast<uint8_t *>(out))) {
+      auto *chunk =
+          reinterpret_cast<const T *>(chunk_ptrs_[chunk_idx].deref(scope));
+      memcpy(out, chunk + chunk_offset, num * sizeof(T));
+    }
+    begin += num;
+    out += num;
+    n -= num;
+    scope.renew();
+  }
+}
+
+template <typename T>
+template <bool Bypass>
+FORCE_INLINE void DataFrameVector<T>::write_range(uint64_t begin, uint64_t n,
+                                                  const T *data) {
+  assert(!DerefScope::is_in_deref_scope());
+  BUG_ON(begin + n > size_);
+  DerefScope scope;
+  while (n) {
+    auto [chunk_idx, chunk_offset] = get_chunk_stats(begin);
+    auto num = std::min<uint64_t>(n, kRealChunkNumEntries - chunk_offset);
+    invalidate_zone_map(chunk_idx);
+    if (!Bypass || num != kRealChunkNumEntries ||
+        !write_remote_chunk(chunk_idx,
+                            reinterpret_cast<const uint8_t *>(data))) {
+      auto *chunk =
+          reinterpret_cast<T *>(chunk_ptrs_[chunk_idx].deref_mut(scope));
+      memcpy(chunk + chunk_offset, data, num * sizeof(T));
+      dirty_ = true;
+    }
+    begin += num;
+    data += num;
+    n -= num;
+    scope.renew();
+  }
+}
+
 template <typename T>
 FORCE_INLINE void DataFrameVector<T>::pop_back(const DerefScope &scope) {
   size_--;
@@ -617,6 +744,59 @@ FORCE_INLINE void DataFrameVector<T>::prefetch_record(bool nt, Index_t idx) {
   }
 }
 
+template <typename T>
+FORCE_INLINE bool DataFrameVector<T>::is_nan(const T &val) {
+  if constexpr (std::is_floating_point<T>::value) {
+    return std::isnan(val);
+  } else {
+    return false;
+  }
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<T>::ZoneMap &
+DataFrameVector<T>::get_zone_map(uint64_t chunk_idx) {
+  if (unlikely(zone_maps_.size() <= chunk_idx)) {
+    zone_maps_.resize(chunk_ptrs_.size());
+  }
+  return zone_maps_[chunk_idx];
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::update_zone_map(uint64_t chunk_idx,
+                                                      uint64_t chunk_offset,
+                                                      const T &val) {
+  auto &zone_map = get_zone_map(chunk_idx);
+  // The elements from chunk_offset on were popped. [min, max] still covers the
+  // ones left, but which of them are NaNs is unknown, so unless all of them
+  // are, they are summarized as non-NaNs.
+  if (unlikely(zone_map.count > chunk_offset)) {
+    zone_map.num_nans =
+        (zone_map.num_nans == zone_map.count) ? chunk_offset : 0;
+    zone_map.count = chunk_offset;
+  }
+  if (unlikely(zone_map.count < chunk_offset)) {
+    return;
+  }
+  if (is_nan(val)) {
+    zone_map.num_nans++;
+  } else if (zone_map.num_nans == zone_map.count) {
+    zone_map.min = zone_map.max = val;
+  } else if (val < zone_map.min) {
+    zone_map.min = val;
+  } else if (val > zone_map.max) {
+    zone_map.max = val;
+  }
+  zone_map.count++;
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::invalidate_zone_map(uint64_t chunk_idx) {
+  if (chunk_idx < zone_maps_.size()) {
+    zone_maps_[chunk_idx].count = zone_maps_[chunk_idx].num_nans = 0;
+  }
+}
+
 template <typename T>
 template <bool Prefetch, bool Nt>
 FORCE_INLINE T &DataFrameVector<T>::at_mut(const DerefScope &scope,
@@ -627,6 +807,7 @@ FORCE_INLINE T &DataFrameVector<T>::at_mut(const DerefScope &scope,
     prefetch_record(Nt, chunk_idx);
   }
   dirty_ = true;
+  invalidate_zone_map(chunk_idx);
   auto *raw_mut_ptr = chunk_ptrs_[chunk_idx].template deref_mut<Nt>(scope);
   return *(reinterpret_cast<T *>(raw_mut_ptr) + chunk_offset);
 }
@@ -747,8 +928,11 @@ DataFrameVector<T>::get_col_unique_values_remotely(FarMemManager *manager) {
   __builtin_memcpy(input_data + sizeof(ds_id_), &size_, sizeof(size_));
   uint16_t output_len;
   uint64_t output_data[2];
-  device_->compute(ds_id_, OpCode::Unique, input_len, input_data, &output_len,
-                   reinterpret_cast<uint8_t *>(output_data));
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::Unique, input_len, input_data, &output_len,
+                     reinterpret_cast<uint8_t *>(output_data));
+  }
   assert(output_len == sizeof(output_data));
   unique_dataframe_vec.size_ = output_data[0];
   unique_dataframe_vec.remote_vec_capacity_ = output_data[1];
@@ -757,6 +941,31 @@ DataFrameVector<T>::get_col_unique_values_remotely(FarMemManager *manager) {
   return unique_dataframe_vec;
 }
 
+template <typename T>
+FORCE_INLINE DataFrameVector<T>
+DataFrameVector<T>::get_col_unique_values_streamed(FarMemManager *manager) {
+  flush();
+  auto unique_dataframe_vec = DataFrameVector<T>(manager);
+  // Not admitted by the device scheduler: the consumer issues device requests
+  // of its own, which could otherwise wait for the slot held by the stream.
+  device_->compute_stream(
+      ds_id_, OpCode::UniqueStream, sizeof(size_),
+      reinterpret_cast<const uint8_t *>(&size_),
+      [&](const uint8_t *chunk, uint32_t len) {
+        assert(len % sizeof(T) == 0);
+        DerefScope scope;
+        for (uint32_t i = 0; i < len / sizeof(T); i++) {
+          if (unlikely(i % kNumElementsPerScope == 0)) {
+            scope.renew();
+          }
+          T val;
+          __builtin_memcpy(&val, chunk + i * sizeof(T), sizeof(T));
+          unique_dataframe_vec.push_back(scope, val);
+        }
+      });
+  return unique_dataframe_vec;
+}
+
 template <typename T>
 FORCE_INLINE DataFrameVector<T> DataFrameVector<T>::copy_data_by_idx(
     FarMemManager *manager, DataFrameVector<unsigned long long> &idx_vec) {
@@ -782,7 +991,8 @@ FORCE_INLINE DataFrameVector<T> DataFrameVector<T>::copy_data_by_idx_locally(
       to_it.renew(scope);
       idx_it.renew(scope);
     }
-    *to_it = at(scope, *idx_it);
+    *to_it = (*idx_it == kDataFrameNullIdx) ? get_dataframe_null_value<T>()
+                                            : at(scope, *idx_it);
   }
 
   return ret;
@@ -804,9 +1014,12 @@ FORCE_INLINE DataFrameVector<T> DataFrameVector<T>::copy_data_by_idx_remotely(
   __builtin_memcpy(input_data + sizeof(ret.ds_id_) + sizeof(idx_vec.ds_id_),
                    &idx_vec_size, sizeof(idx_vec_size));
   uint16_t output_len;
-  device_->compute(ds_id_, OpCode::CopyDataByIdx, input_len, input_data,
-                   &output_len,
-                   reinterpret_cast<uint8_t *>(&ret.remote_vec_capacity_));
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::CopyDataByIdx, input_len, input_data,
+                     &output_len,
+                     reinterpret_cast<uint8_t *>(&ret.remote_vec_capacity_));
+  }
   assert(output_len == sizeof(remote_vec_capacity_));
   ret.size_ = idx_vec.size();
   ret.expand_no_alloc(ret.remote_vec_capacity_);
@@ -861,15 +1074,288 @@ DataFrameVector<T>::shuffle_data_by_idx_remotely(
   __builtin_memcpy(input_data + sizeof(ret.ds_id_) + sizeof(idx_vec.ds_id_),
                    &idx_vec_size, sizeof(idx_vec_size));
   uint16_t output_len;
-  device_->compute(ds_id_, OpCode::ShuffleDataByIdx, input_len, input_data,
-                   &output_len,
-                   reinterpret_cast<uint8_t *>(&ret.remote_vec_capacity_));
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::ShuffleDataByIdx, input_len, input_data,
+                     &output_len,
+                     reinterpret_cast<uint8_t *>(&ret.remote_vec_capacity_));
+  }
   assert(output_len == sizeof(remote_vec_capacity_));
   ret.size_ = idx_vec.size();
   ret.expand_no_alloc(ret.remote_vec_capacity_);
   return ret;
 }
 
+template <typename T>
+template <typename F>
+FORCE_INLINE void DataFrameVector<T>::scan(const T &lo, const T &hi, F &&f) {
+  // Handing out a mutable reference resets the zone map of its chunk, and the
+  // reference is bound to its DerefScope, so none can be written through
+  // after the chunk gets summarized below.
+  BUG_ON(DerefScope::is_in_deref_scope());
+  auto num_chunks = (size_ + kRealChunkNumEntries - 1) / kRealChunkNumEntries;
+  for (uint64_t chunk_idx = 0; chunk_idx < num_chunks; chunk_idx++) {
+    auto begin = chunk_idx * kRealChunkNumEntries;
+    auto num_elements =
+        std::min<uint64_t>(kRealChunkNumEntries, size_ - begin);
+    auto &zone_map = get_zone_map(chunk_idx);
+    bool summarized = (zone_map.count >= num_elements);
+    if (summarized && (zone_map.num_nans == zone_map.count ||
+                       zone_map.max < lo || hi < zone_map.min)) {
+      continue;
+    }
+    DerefScope scope;
+    prefetch_record(/* nt = */ false, chunk_idx);
+    auto *data =
+        reinterpret_cast<const T *>(chunk_ptrs_[chunk_idx].deref(scope));
+    if (!summarized) {
+      zone_map.count = zone_map.num_nans = 0;
+      for (uint64_t i = 0; i < num_elements; i++) {
+        update_zone_map(chunk_idx, i, data[i]);
+      }
+    }
+    for (uint64_t i = 0; i < num_elements; i++) {
+      if (!is_nan(data[i]) && !(data[i] < lo) && !(hi < data[i])) {
+        f(static_cast<const DerefScope &>(scope), begin + i, data[i]);
+      }
+    }
+  }
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<unsigned long long>
+DataFrameVector<T>::filter_range(FarMemManager *manager, const T &lo,
+                                 const T &hi) {
+  auto ret = DataFrameVector<unsigned long long>(manager);
+  scan(lo, hi, [&](const DerefScope &scope, uint64_t idx, const T &val) {
+    ret.push_back(scope, static_cast<unsigned long long>(idx));
+  });
+  return ret;
+}
+
+template <typename T>
+FORCE_INLINE uint32_t DataFrameVector<T>::get_num_walk_threads(uint64_t begin,
+                                                               uint64_t end) {
+  if (begin >= end) {
+    return 1;
+  }
+  auto num_chunks = (end - 1) / kRealChunkNumEntries -
+                    begin / kRealChunkNumEntries + 1;
+  return far_memory::get_num_parallel_threads(num_chunks,
+                                              kMinNumChunksPerThread);
+}
+
+// Runs f(tid, scope, index, element) on every element in [begin, end) with
+// num_threads workers, each taking a contiguous run of whole chunks. The
+// workers bypass prefetcher_, which is not thread-safe; each has a prefetch
+// stream over its own chunks instead.
+template <typename T>
+template <bool Mut, typename F>
+FORCE_INLINE void DataFrameVector<T>::parallel_walk(uint64_t begin,
+                                                    uint64_t end,
+                                                    uint32_t num_threads,
+                                                    F &&f) {
+  assert(!DerefScope::is_in_deref_scope());
+  if (begin >= end) {
+    return;
+  }
+  if constexpr (Mut) {
+    dirty_ = true;
+  }
+  auto first_chunk_idx = begin / kRealChunkNumEntries;
+  auto num_chunks = (end - 1) / kRealChunkNumEntries - first_chunk_idx + 1;
+  auto win_size =
+      std::max<uint64_t>(1, device_->get_prefetch_win_size() / kRealChunkSize);
+  parallel_for_prefetched(
+      num_chunks, num_threads, win_size,
+      [&](uint64_t i) {
+        chunk_ptrs_[first_chunk_idx + i].swap_in(/* nt = */ false,
+                                                 TrafficClass::kPrefetch);
+      },
+      [&](uint32_t tid, uint64_t chunk_begin, uint64_t chunk_end,
+          std::atomic<uint64_t> &cursor) {
+        DerefScope scope;
+        for (auto i = chunk_begin; i < chunk_end; i++) {
+          cursor.store(i, std::memory_order_relaxed);
+          auto chunk_idx = first_chunk_idx + i;
+          auto chunk_start = chunk_idx * kRealChunkNumEntries;
+          auto idx = std::max(begin, chunk_start);
+          auto chunk_stop = std::min(end, chunk_start + kRealChunkNumEntries);
+          while (idx < chunk_stop) {
+            auto batch_end = std::min(chunk_stop, idx + kNumElementsPerScope);
+            if constexpr (Mut) {
+              invalidate_zone_map(chunk_idx);
+              auto *data = reinterpret_cast<T *>(
+                  chunk_ptrs_[chunk_idx].deref_mut(scope));
+              for (; idx < batch_end; idx++) {
+                f(tid, static_cast<const DerefScope &>(scope), idx,
+                  data[idx - chunk_start]);
+              }
+            } else {
+              auto *data = reinterpret_cast<const T *>(
+                  chunk_ptrs_[chunk_idx].deref(scope));
+              for (; idx < batch_end; idx++) {
+                f(tid, static_cast<const DerefScope &>(scope), idx,
+                  data[idx - chunk_start]);
+              }
+            }
+            scope.renew();
+          }
+        }
+      });
+}
+
+template <typename T>
+template <typename F>
+FORCE_INLINE void DataFrameVector<T>::parallel_for(F &&f, uint64_t begin,
+                                                   uint64_t end) {
+  end = std::min(end, size_);
+  parallel_walk</* Mut = */ true>(
+      begin, end, get_num_walk_threads(begin, end),
+      [&](uint32_t tid, const DerefScope &scope, uint64_t idx, T &val) {
+        f(scope, idx, val);
+      });
+}
+
+template <typename T>
+template <typename F>
+FORCE_INLINE void DataFrameVector<T>::parallel_for(F &&f, uint64_t begin,
+                                                   uint64_t end) const {
+  auto *self = const_cast<DataFrameVector<T> *>(this);
+  end = std::min(end, size_);
+  self->template parallel_walk</* Mut = */ false>(
+      begin, end, self->get_num_walk_threads(begin, end),
+      [&](uint32_t tid, const DerefScope &scope, uint64_t idx, const T &val) {
+        f(scope, idx, val);
+      });
+}
+
+template <typename T>
+template <typename Acc, typename F, typename C>
+FORCE_INLINE Acc DataFrameVector<T>::parallel_reduce(Acc init, F &&f,
+                                                     C &&combine,
+                                                     uint64_t begin,
+                                                     uint64_t end) {
+  end = std::min(end, size_);
+  auto num_threads = get_num_walk_threads(begin, end);
+  // Keeps the accumulators of the workers off each other's cache lines.
+  CachelineAligned(Acc);
+  std::vector<CachelineAligned_Acc> accs(num_threads, {init});
+  parallel_walk</* Mut = */ false>(
+      begin, end, num_threads,
+      [&](uint32_t tid, const DerefScope &scope, uint64_t idx, const T &val) {
+        f(accs[tid].data, scope, idx, val);
+      });
+  for (uint32_t tid = 1; tid < num_threads; tid++) {
+    combine(accs[0].data, accs[tid].data);
+  }
+  return std::move(accs[0].data);
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<unsigned long long>
+DataFrameVector<T>::filter(FarMemManager *manager,
+                           const DataFramePredicate &pred) {
+  BUG_ON(pred.get_min_column_size() < size_);
+  if constexpr (DISABLE_OFFLOAD_FILTER) {
+    return filter_locally(manager, pred);
+  } else {
+    return filter_remotely(manager, pred);
+  }
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<unsigned long long>
+DataFrameVector<T>::filter_locally(FarMemManager *manager,
+                                   const DataFramePredicate &pred) {
+  constexpr auto kBlockSize = DataFramePredicateEvaluator::kBlockSize;
+  auto ret = DataFrameVector<unsigned long long>(manager);
+  DataFramePredicateEvaluator evaluator(pred.buf_.data(), pred.buf_.size());
+  std::vector<uint8_t> column_buf(kBlockSize * pred.get_max_elem_size());
+  auto loader = [&](uint8_t ds_id, uint8_t dt_id, uint64_t begin,
+                    uint32_t len) -> const uint8_t * {
+    pred.columns_.at(ds_id).read(begin, len, column_buf.data());
+    return column_buf.data();
+  };
+  uint8_t mask[kBlockSize];
+  for (uint64_t begin = 0; begin < size_; begin += kBlockSize) {
+    auto len =
+        static_cast<uint32_t>(std::min<uint64_t>(kBlockSize, size_ - begin));
+    evaluator.eval(loader, begin, len, mask);
+    DerefScope scope;
+    for (uint32_t i = 0; i < len; i++) {
+      if (mask[i]) {
+        ret.push_back(scope, static_cast<unsigned long long>(begin + i));
+      }
+    }
+  }
+  return ret;
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<unsigned long long>
+DataFrameVector<T>::filter_remotely(FarMemManager *manager,
+                                    const DataFramePredicate &pred) {
+  flush();
+  pred.flush_columns();
+  auto ret = DataFrameVector<unsigned long long>(manager);
+  auto &pred_buf = pred.buf_;
+  uint64_t input_len = sizeof(ret.ds_id_) + sizeof(size_) + pred_buf.size();
+  BUG_ON(input_len > TCPDevice::kMaxComputeDataLen);
+  std::unique_ptr<uint8_t[]> input_data(new uint8_t[input_len]);
+  __builtin_memcpy(input_data.get(), &ret.ds_id_, sizeof(ret.ds_id_));
+  __builtin_memcpy(input_data.get() + sizeof(ret.ds_id_), &size_,
+                   sizeof(size_));
+  __builtin_memcpy(input_data.get() + sizeof(ret.ds_id_) + sizeof(size_),
+                   pred_buf.data(), pred_buf.size());
+  uint16_t output_len;
+  uint64_t output_data[2];
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::Filter, input_len, input_data.get(),
+                     &output_len, reinterpret_cast<uint8_t *>(output_data));
+  }
+  assert(output_len == sizeof(output_data));
+  ret.size_ = output_data[0];
+  ret.remote_vec_capacity_ = output_data[1];
+  ret.expand_no_alloc(ret.remote_vec_capacity_);
+  return ret;
+}
+
+template <typename T>
+FORCE_INLINE std::pair<DataFrameVector<unsigned long long>,
+                       DataFrameVector<unsigned long long>>
+DataFrameVector<T>::join(FarMemManager *manager, DataFrameVector<T> &rhs,
+                         DataFrameJoinPolicy policy) {
+  flush();
+  rhs.flush();
+  auto lhs_ret = DataFrameVector<unsigned long long>(manager);
+  auto rhs_ret = DataFrameVector<unsigned long long>(manager);
+  uint8_t input_data[3 * sizeof(ds_id_) + 2 * sizeof(size_) + sizeof(policy)];
+  uint16_t input_len = sizeof(input_data);
+  auto *input = input_data;
+  for (auto ds_id : {lhs_ret.ds_id_, rhs_ret.ds_id_, rhs.ds_id_}) {
+    *input++ = ds_id;
+  }
+  __builtin_memcpy(input, &size_, sizeof(size_));
+  __builtin_memcpy(input + sizeof(size_), &rhs.size_, sizeof(rhs.size_));
+  __builtin_memcpy(input + 2 * sizeof(size_), &policy, sizeof(policy));
+  uint16_t output_len;
+  uint64_t output_data[3];
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::Join, input_len, input_data, &output_len,
+                     reinterpret_cast<uint8_t *>(output_data));
+  }
+  assert(output_len == sizeof(output_data));
+  lhs_ret.size_ = rhs_ret.size_ = output_data[0];
+  lhs_ret.remote_vec_capacity_ = output_data[1];
+  rhs_ret.remote_vec_capacity_ = output_data[2];
+  lhs_ret.expand_no_alloc(lhs_ret.remote_vec_capacity_);
+  rhs_ret.expand_no_alloc(rhs_ret.remote_vec_capacity_);
+  return std::make_pair(std::move(lhs_ret), std::move(rhs_ret));
+}
+
 template <typename T>
 FORCE_INLINE void
 DataFrameVector<T>::assign(const DataFrameVector<T>::Iterator &begin,
@@ -919,18 +1405,63 @@ DataFrameVector<T>::assign_remotely(const DataFrameVector<T>::Iterator &begin,
   __builtin_memcpy(input_data + sizeof(ds_id_) + sizeof(begin_flat_idx),
                    &end_flat_idx, sizeof(end_flat_idx));
   uint16_t output_len;
-  device_->compute(ds_id_, OpCode::Assign, input_len, input_data, &output_len,
-                   reinterpret_cast<uint8_t *>(&remote_vec_capacity_));
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::Assign, input_len, input_data, &output_len,
+                     reinterpret_cast<uint8_t *>(&remote_vec_capacity_));
+  }
   size_ = end - begin;
   expand_no_alloc(remote_vec_capacity_);
 }
 
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::enable_encoding() {
+  static_assert(kRealChunkNumEntries <= DataFrameChunkCodec<T>::kMaxNumEntries);
+  BUG_ON(!chunk_ptrs_.empty());
+  FarMemManagerFactory::get()->register_object_codec(
+      ds_id_,
+      [](const uint8_t *data, uint16_t data_len,
+         const FarMemManager::WriteEncodedFn &write) {
+        assert(data_len == kRealChunkSize);
+        uint8_t buf[kRealChunkSize];
+        auto len = DataFrameChunkCodec<T>::encode(
+            reinterpret_cast<const T *>(data), kRealChunkNumEntries, buf);
+        if (!len) {
+          return false;
+        }
+        write(buf, len);
+        return true;
+      },
+      [](uint8_t *data, uint16_t len) -> uint16_t {
+        // A chunk is sent as is unless its encoding is shorter.
+        if (len == kRealChunkSize) {
+          return len;
+        }
+        uint8_t buf[kRealChunkSize];
+        __builtin_memcpy(buf, data, len);
+        DataFrameChunkCodec<T>::decode(buf, len, reinterpret_cast<T *>(data),
+                                       kRealChunkNumEntries);
+        return kRealChunkSize;
+      });
+  uint8_t enabled = true;
+  uint16_t output_len;
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::SetEncoding, sizeof(enabled), &enabled,
+                     &output_len, nullptr);
+  }
+  assert(output_len == 0);
+}
+
 template <typename T>
 template <bool Ascending>
 FORCE_INLINE DataFrameVector<unsigned long long>
 DataFrameVector<T>::get_sorted_indices(FarMemManager *manager,
                                        bool already_sorted_asc) {
   assert(!DerefScope::is_in_deref_scope());
+  if (!already_sorted_asc && !DISABLE_OFFLOAD_ARG_SORT) {
+    return get_sorted_indices_remotely<Ascending>(manager);
+  }
   auto indices = DataFrameVector<unsigned long long>(manager);
   if (already_sorted_asc) {
     DerefScope scope;
@@ -942,6 +1473,7 @@ DataFrameVector<T>::get_sorted_indices(FarMemManager *manager,
       auto idx = Ascending ? i : size_ - i - 1;
       indices.push_back(scope, idx);
     }
+    return indices;
   }
   if constexpr (sizeof(T) <= 2 && std::is_integral<T>::value) {
     // T is small. Use counting sort.
@@ -994,6 +1526,34 @@ FORCE_INLINE void DataFrameVector<T>::_get_sorted_indices_counting_sort(
   }
 }
 
+template <typename T>
+template <bool Ascending>
+FORCE_INLINE DataFrameVector<unsigned long long>
+DataFrameVector<T>::get_sorted_indices_remotely(FarMemManager *manager) {
+  flush();
+  auto indices = DataFrameVector<unsigned long long>(manager);
+  uint8_t ascending = Ascending;
+  uint8_t input_data[sizeof(indices.ds_id_) + sizeof(size_) +
+                     sizeof(ascending)];
+  uint16_t input_len = sizeof(input_data);
+  __builtin_memcpy(input_data, &indices.ds_id_, sizeof(indices.ds_id_));
+  __builtin_memcpy(input_data + sizeof(indices.ds_id_), &size_, sizeof(size_));
+  __builtin_memcpy(input_data + sizeof(indices.ds_id_) + sizeof(size_),
+                   &ascending, sizeof(ascending));
+  uint16_t output_len;
+  uint64_t output_data[2];
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::ArgSort, input_len, input_data,
+                     &output_len, reinterpret_cast<uint8_t *>(output_data));
+  }
+  assert(output_len == sizeof(output_data));
+  indices.size_ = output_data[0];
+  indices.remote_vec_capacity_ = output_data[1];
+  indices.expand_no_alloc(indices.remote_vec_capacity_);
+  return indices;
+}
+
 template <typename T>
 template <typename U>
 FORCE_INLINE DataFrameVector<T>
@@ -1018,8 +1578,11 @@ DataFrameVector<T>::aggregate_remotely(FarMemManager *manager, const U &key_vec,
                    &key_vec_type_id, sizeof(key_vec_type_id));
   uint16_t output_len;
   uint64_t output_data[2];
-  device_->compute(ds_id_, opcode, input_len, input_data, &output_len,
-                   reinterpret_cast<uint8_t *>(output_data));
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, opcode, input_len, input_data, &output_len,
+                     reinterpret_cast<uint8_t *>(output_data));
+  }
   assert(output_len == sizeof(output_data));
   result.size_ = output_data[0];
   result.remote_vec_capacity_ = output_data[1];
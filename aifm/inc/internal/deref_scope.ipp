@@ -73,7 +73,7 @@ FORCE_INLINE bool DerefScope::is_status_expected() {
 
 FORCE_INLINE int32_t DerefScope::get_num_threads(Status status) {
   int32_t sum = 0;
-  for (uint8_t i = 0; i < helpers::kNumCPUs; i++) {
+  FOR_ALL_CORES(i) {
     int *ptr = ACCESS_ONCE(num_threads_on_status_ptrs[i]);
     if (ptr) {
       sum += ACCESS_ONCE(*(ptr + static_cast<int>(status)));
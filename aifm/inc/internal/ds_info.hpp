@@ -20,4 +20,7 @@ constexpr static uint8_t kHashTableDSType = 1;
 // DataFrameVector.
 constexpr static uint8_t kDataFrameVectorDSType = 2;
 
+// Fast tier of TieredDevice.
+constexpr static uint8_t kTierCacheDSType = 3;
+
 } // namespace far_memory
@@ -0,0 +1,25 @@
+#pragma once
+
+namespace far_memory {
+
+FORCE_INLINE void GCPacer::add_allocated_bytes(uint64_t bytes) {
+  __atomic_add_fetch(&num_allocated_bytes_, bytes, __ATOMIC_RELAXED);
+}
+
+FORCE_INLINE double GCPacer::get_trigger_ratio() const {
+  return ACCESS_ONCE(trigger_ratio_);
+}
+
+FORCE_INLINE uint32_t GCPacer::get_num_gc_threads() const {
+  return ACCESS_ONCE(num_gc_threads_);
+}
+
+FORCE_INLINE double GCPacer::get_alloc_bytes_per_sec() const {
+  return ACCESS_ONCE(alloc_bytes_per_sec_);
+}
+
+FORCE_INLINE double GCPacer::get_evac_bytes_per_sec() const {
+  return ACCESS_ONCE(evac_bytes_per_sec_per_thread_) * get_num_gc_threads();
+}
+
+} // namespace far_memory
@@ -10,4 +10,14 @@ FORCE_INLINE uint32_t hash_32(const void *key, int len) {
   MurmurHash3_x86_32(key, len, 0xDEADBEEF, &ret);
   return ret;
 }
+
+// The finalizer of MurmurHash3_x64_128.
+FORCE_INLINE uint64_t hash_mix_64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
 } // namespace far_memory
@@ -1,18 +1,26 @@
 #pragma once
 
 extern "C" {
+#include <base/cpu.h>
 #include <base/time.h>
 #include <runtime/preempt.h>
+#include <runtime/runtime.h>
 #include <runtime/timer.h>
 }
 
 #include <cassert>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <dirent.h>
+#include <linux/mempolicy.h>
 #include <memory>
+#include <sched.h>
 #include <signal.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
 namespace helpers {
 
@@ -33,6 +41,55 @@ static FORCE_INLINE void *allocate_hugepage(uint64_t size) {
 
 static FORCE_INLINE int get_num_cores() { return get_nprocs(); }
 
+// The number of kthreads of the runtime, i.e., the range of get_core_num().
+// Falls back to the upper bound if the runtime has not been initialized yet.
+static FORCE_INLINE uint32_t get_num_runtime_cores() {
+  auto num_cores = runtime_max_cores();
+  return num_cores > 0 ? num_cores : kMaxNumCPUs;
+}
+
+static FORCE_INLINE uint32_t get_num_numa_nodes() {
+  return numa_count > 0 ? numa_count : 1;
+}
+
+static FORCE_INLINE uint32_t get_cur_numa_node() {
+  // Kthreads are not pinned, so query the node that we are running on. Unlike
+  // the physical package, it accounts for sub-NUMA clustering (SNC/NPS).
+  unsigned cpu, node;
+  return getcpu(&cpu, &node) == 0 ? node % get_num_numa_nodes() : 0;
+}
+
+// Slow (it walks sysfs); only meant for initialization.
+static FORCE_INLINE uint32_t get_numa_node_of_cpu(uint32_t cpu) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+  auto *dir = opendir(path);
+  if (!dir) {
+    return 0;
+  }
+  uint32_t node = 0;
+  while (auto *entry = readdir(dir)) {
+    if (sscanf(entry->d_name, "node%u", &node) == 1) {
+      break;
+    }
+  }
+  closedir(dir);
+  return node % get_num_numa_nodes();
+}
+
+static FORCE_INLINE void bind_to_numa_node(void *addr, uint64_t len,
+                                           uint32_t node) {
+  if (get_num_numa_nodes() == 1) {
+    return;
+  }
+  unsigned long nodemask = (1UL << node);
+  // Preferred rather than strict binding, so that we never OOM just because
+  // one node runs out of memory. Issue the syscall directly to avoid depending
+  // on libnuma.
+  BUG_ON(syscall(SYS_mbind, addr, len, MPOL_PREFERRED, &nodemask,
+                 sizeof(nodemask) * 8, 0) != 0);
+}
+
 static FORCE_INLINE void timer_start(unsigned *cycles_high_start,
                                      unsigned *cycles_low_start) {
   asm volatile("xorl %%eax, %%eax\n\t"
@@ -246,6 +303,17 @@ static FORCE_INLINE void tcp_write2_until(tcpconn_t *c, const void *buf_0,
   }
 }
 
+static FORCE_INLINE void file_write_until(int fd, const void *buf,
+                                          size_t expect) {
+  size_t real = 0;
+  while (real < expect) {
+    auto ret =
+        write(fd, reinterpret_cast<const uint8_t *>(buf) + real, expect - real);
+    BUG_ON(ret <= 0);
+    real += ret;
+  }
+}
+
 static FORCE_INLINE constexpr size_t static_log(uint64_t b, uint64_t n) {
   return ((n < b) ? 1 : 1 + static_log(b, n / b));
 }
@@ -9,9 +9,9 @@ FORCE_INLINE
 LocalConcurrentHopscotch<K, V>::LocalConcurrentHopscotch(uint32_t index_num_kv,
                                                          uint64_t data_num_kv)
     : LocalGenericConcurrentHopscotch(helpers::bsr_64(index_num_kv - 1) + 1,
-                                      (data_num_kv - 1) / kKVDataSize + 1) {
-  memset(per_core_size_, 0, sizeof(per_core_size_));
-}
+                                      (data_num_kv - 1) / kKVDataSize + 1),
+      per_core_size_(
+          new CachelineAligned_int64_t[helpers::get_num_runtime_cores()]()) {}
 
 template <typename K, typename V>
 FORCE_INLINE bool LocalConcurrentHopscotch<K, V>::empty() const {
@@ -21,7 +21,7 @@ FORCE_INLINE bool LocalConcurrentHopscotch<K, V>::empty() const {
 template <typename K, typename V>
 FORCE_INLINE uint64_t LocalConcurrentHopscotch<K, V>::size() const {
   int64_t sum = 0;
-  FOR_ALL_SOCKET0_CORES(i) { sum += per_core_size_[i].data; }
+  FOR_ALL_CORES(i) { sum += per_core_size_[i].data; }
   return sum;
 }
 
@@ -19,11 +19,50 @@ FarMemManager::RegionManager::core_local_free_region(bool nt) {
 
 FORCE_INLINE double
 FarMemManager::RegionManager::get_free_region_ratio() const {
-  return static_cast<double>(free_regions_.size()) / get_num_regions();
+  return static_cast<double>(ACCESS_ONCE(num_free_regions_)) /
+         get_num_regions();
 }
 
 FORCE_INLINE uint32_t FarMemManager::RegionManager::get_num_regions() const {
-  return free_regions_.capacity();
+  return ACCESS_ONCE(num_regions_);
+}
+
+FORCE_INLINE uint32_t
+FarMemManager::RegionManager::get_max_num_regions() const {
+  return max_num_regions_;
+}
+
+FORCE_INLINE bool
+FarMemManager::RegionManager::is_retiring(const Region &region) const {
+  return region.get_idx() >= num_regions_;
+}
+
+FORCE_INLINE uint32_t
+FarMemManager::RegionManager::get_node(uint32_t region_idx) const {
+  return num_nodes_ > 1 ? group_nodes_[region_idx / kNumRegionsPerGroup] : 0;
+}
+
+FORCE_INLINE bool FarMemManager::RegionManager::has_retiring_regions() const {
+  return ACCESS_ONCE(num_retiring_regions_);
+}
+
+FORCE_INLINE bool
+FarMemManager::RegionManager::has_retiring_used_regions() const {
+  return ACCESS_ONCE(num_retiring_used_regions_);
+}
+
+FORCE_INLINE uint64_t FarMemManager::get_cache_size() const {
+  return static_cast<uint64_t>(cache_region_manager_.get_num_regions()) *
+         Region::kSize;
+}
+
+FORCE_INLINE uint64_t FarMemManager::get_max_cache_size() const {
+  return static_cast<uint64_t>(cache_region_manager_.get_max_num_regions()) *
+         Region::kSize;
+}
+
+FORCE_INLINE void FarMemManager::request_cache_resize(uint64_t new_size) {
+  ACCESS_ONCE(pending_cache_size_) = new_size;
 }
 
 FORCE_INLINE double FarMemManager::get_free_mem_ratio() const {
@@ -31,7 +70,11 @@ FORCE_INLINE double FarMemManager::get_free_mem_ratio() const {
 }
 
 FORCE_INLINE bool FarMemManager::is_free_cache_low() const {
+#ifdef DISABLE_GC_PACING
   return get_free_mem_ratio() <= kFreeCacheLowThresh;
+#else
+  return get_free_mem_ratio() <= gc_pacer_.get_trigger_ratio();
+#endif
 }
 
 FORCE_INLINE bool FarMemManager::is_free_cache_almost_empty() const {
@@ -115,6 +158,12 @@ FarMemManager::allocate_dataframe_vector_heap() {
   return new DataFrameVector<T>(this);
 }
 
+template <typename T>
+FORCE_INLINE DataFrameVector<T>
+FarMemManager::adopt_dataframe_vector(uint8_t ds_id) {
+  return DataFrameVector<T>(this, ds_id);
+}
+
 FORCE_INLINE FarMemManager *FarMemManagerFactory::get() { return ptr_; }
 
 FORCE_INLINE void FarMemManager::register_eval_notifier(uint8_t ds_id,
@@ -127,11 +176,40 @@ FORCE_INLINE void FarMemManager::register_copy_notifier(uint8_t ds_id,
   copy_notifiers_[ds_id] = notifier;
 }
 
+FORCE_INLINE void FarMemManager::register_object_codec(uint8_t ds_id,
+                                                       ObjectEncoder encoder,
+                                                       ObjectDecoder decoder) {
+  object_encoders_[ds_id] = std::move(encoder);
+  object_decoders_[ds_id] = std::move(decoder);
+}
+
+FORCE_INLINE void FarMemManager::write_object_data(uint8_t ds_id,
+                                                   uint8_t obj_id_len,
+                                                   const uint8_t *obj_id,
+                                                   uint16_t data_len,
+                                                   const uint8_t *data_buf) {
+  auto &encoder = object_encoders_[ds_id];
+  if (encoder && encoder(data_buf, data_len,
+                         [&](const uint8_t *buf, uint16_t len) {
+                           device_ptr_->write_object(ds_id, obj_id_len, obj_id,
+                                                     len, buf);
+                         })) {
+    return;
+  }
+  device_ptr_->write_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+}
+
 FORCE_INLINE void FarMemManager::read_object(uint8_t ds_id, uint8_t obj_id_len,
                                              const uint8_t *obj_id,
                                              uint16_t *data_len,
                                              uint8_t *data_buf) {
-  device_ptr_->read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+  {
+    auto ticket = device_ptr_->admit(TrafficClass::kDemandRead);
+    device_ptr_->read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+  }
+  if (auto &decoder = object_decoders_[ds_id]) {
+    *data_len = decoder(data_buf, *data_len);
+  }
 }
 
 FORCE_INLINE bool FarMemManager::remove_object(uint64_t ds_id,
@@ -147,6 +225,9 @@ FORCE_INLINE void FarMemManager::construct(uint8_t ds_type, uint8_t ds_id,
 }
 
 FORCE_INLINE void FarMemManager::destruct(uint8_t ds_id) {
+  // The ds_id gets recycled, and its next owner must not inherit the codec.
+  object_encoders_[ds_id] = nullptr;
+  object_decoders_[ds_id] = nullptr;
   free_ds_id(ds_id);
   device_ptr_->destruct(ds_id);
 }
@@ -180,6 +261,11 @@ FORCE_INLINE void FarMemManager::unlock_object(uint8_t obj_id_len,
 }
 
 FORCE_INLINE void FarMemManager::gc_check() {
+#ifndef DISABLE_GC_PACING
+  // Invoked once per refilled core-local region.
+  gc_pacer_.add_allocated_bytes(Region::kSize);
+  gc_pacer_.sample();
+#endif
   if (unlikely(is_free_cache_low())) {
     Stats::add_free_mem_ratio_record();
     ACCESS_ONCE(almost_empty) = is_free_cache_almost_empty();
@@ -208,4 +294,15 @@ FarMemManager::allocate_concurrent_hopscotch_heap(
       remote_data_size);
 }
 
+template <typename K, typename V>
+FORCE_INLINE ConcurrentHopscotch<K, V>
+FarMemManager::adopt_concurrent_hopscotch(uint8_t ds_id,
+                                          uint32_t local_num_entries_shift,
+                                          uint32_t remote_num_entries_shift,
+                                          uint64_t remote_data_size) {
+  return ConcurrentHopscotch<K, V>(reserve_ds_id(ds_id),
+                                   local_num_entries_shift,
+                                   remote_num_entries_shift, remote_data_size);
+}
+
 } // namespace far_memory
@@ -6,6 +6,7 @@ extern "C" {
 
 #include "helpers.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 namespace far_memory {
@@ -18,7 +19,7 @@ FORCE_INLINE Parallelizer<Task>::Parallelizer(uint32_t num_slaves,
     std::cerr << "Error: invalid arguments in Parallelizer." << std::endl;
     exit(-EINVAL);
   }
-  num_slaves_ = num_slaves;
+  num_slaves_ = num_active_slaves_ = num_slaves;
   preempt_disable();
   task_queues_ =
       std::make_unique<std::unique_ptr<CircularBuffer<Task, true>>[]>(
@@ -38,7 +39,7 @@ FORCE_INLINE void Parallelizer<Task>::master_enqueue_task(T &&task) {
     pushed = task_queues_[enqueue_thread_id_]->push_back(task);
     // Dispatch task to workers in a round-robin fashion.
     enqueue_thread_id_++;
-    if (unlikely(enqueue_thread_id_ == num_slaves_)) {
+    if (unlikely(enqueue_thread_id_ == num_active_slaves_)) {
       enqueue_thread_id_ = 0;
     }
   }
@@ -57,7 +58,7 @@ FORCE_INLINE bool Parallelizer<Task>::slave_can_exit(uint32_t tid) {
   }
   if (unlikely(task_queues_[tid]->size() == 0)) {
     // Work stealing.
-    for (uint32_t i = 0; i < num_slaves_; i++) {
+    for (uint32_t i = 0; i < num_active_slaves_; i++) {
       if (i == tid) {
         continue;
       }
@@ -70,9 +71,16 @@ done:
   return master_done_ && task_queues_[tid]->size() == 0;
 }
 
+template <typename Task>
+FORCE_INLINE void Parallelizer<Task>::set_num_active_slaves(uint32_t num) {
+  BUG_ON(!num || num > num_slaves_);
+  num_active_slaves_ = num;
+  enqueue_thread_id_ = 0;
+}
+
 template <typename Task>
 FORCE_INLINE void Parallelizer<Task>::spawn(Status *slaves_status) {
-  for (uint8_t i = 0; i < num_slaves_; i++) {
+  for (uint8_t i = 0; i < num_active_slaves_; i++) {
     threads_[i] =
         std::move(rt::Thread([&, i] { slave_fn(i); },
                              /* round-robin = */ true, slaves_status[i]));
@@ -86,8 +94,8 @@ template <typename Task> FORCE_INLINE void Parallelizer<Task>::execute() {
   master_fn();
   master_done_ = true;
   preempt_enable();
-  for (auto &thread : threads_) {
-    thread.Join();
+  for (uint32_t i = 0; i < num_active_slaves_; i++) {
+    threads_[i].Join();
   }
 #ifdef DEBUG
   for (uint8_t i = 0; i < num_slaves_; i++) {
@@ -97,4 +105,64 @@ template <typename Task> FORCE_INLINE void Parallelizer<Task>::execute() {
   master_up_ = false;
   master_done_ = false;
 }
+
+template <typename F>
+FORCE_INLINE void parallel_run(uint32_t num_threads, F &&f) {
+  std::vector<rt::Thread> threads;
+  for (uint32_t tid = 1; tid < num_threads; tid++) {
+    threads.emplace_back([&f, tid]() { f(tid); });
+  }
+  f(0);
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+}
+
+FORCE_INLINE uint32_t
+get_num_parallel_threads(uint64_t num_elements,
+                         uint64_t min_num_elements_per_thread) {
+  return std::max<uint64_t>(
+      1, std::min<uint64_t>(helpers::get_num_runtime_cores(),
+                            num_elements / min_num_elements_per_thread));
+}
+
+FORCE_INLINE uint64_t get_parallel_range_begin(uint64_t num_elements,
+                                               uint32_t tid,
+                                               uint32_t num_threads) {
+  return static_cast<unsigned __int128>(num_elements) * tid / num_threads;
+}
+
+template <typename PrefetchFn, typename F>
+FORCE_INLINE void parallel_for_prefetched(uint64_t num_objects,
+                                          uint32_t num_threads,
+                                          uint64_t win_size,
+                                          PrefetchFn &&prefetch_fn, F &&f) {
+  parallel_run(num_threads, [&](uint32_t tid) {
+    auto begin = get_parallel_range_begin(num_objects, tid, num_threads);
+    auto end = get_parallel_range_begin(num_objects, tid + 1, num_threads);
+    if (begin == end) {
+      return;
+    }
+    std::atomic<uint64_t> cursor{begin};
+    std::atomic<bool> done{false};
+    rt::Thread prefetch_thread([&]() {
+      for (auto i = begin + 1; i < end; i++) {
+        while (i >= cursor.load(std::memory_order_relaxed) + win_size) {
+          if (done.load(std::memory_order_relaxed)) {
+            return;
+          }
+          thread_yield();
+        }
+        if (done.load(std::memory_order_relaxed)) {
+          return;
+        }
+        prefetch_fn(i);
+      }
+    });
+    f(tid, begin, end, cursor);
+    done.store(true, std::memory_order_relaxed);
+    prefetch_thread.Join();
+  });
+}
+
 } // namespace far_memory
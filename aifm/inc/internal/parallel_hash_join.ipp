@@ -0,0 +1,130 @@
+#pragma once
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace far_memory {
+
+template <typename T>
+FORCE_INLINE uint64_t ParallelHashJoin<T>::Result::size() const {
+  return thread_offsets_.back();
+}
+
+template <typename T>
+FORCE_INLINE void ParallelHashJoin<T>::Result::copy_to(uint64_t *build_rows,
+                                                       uint64_t *probe_rows) {
+  parallel_run(thread_pairs_.size(), [&](uint32_t tid) {
+    auto offset = thread_offsets_[tid];
+    for (auto &[build_row, probe_row] : thread_pairs_[tid]) {
+      build_rows[offset] = build_row;
+      probe_rows[offset] = probe_row;
+      offset++;
+    }
+  });
+}
+
+template <typename T>
+FORCE_INLINE uint32_t
+ParallelHashJoin<T>::get_num_threads(uint64_t num_elements) {
+  return std::max<uint64_t>(
+      1, std::min<uint64_t>(helpers::get_num_runtime_cores(),
+                            num_elements / kMinNumElementsPerThread));
+}
+
+template <typename T>
+FORCE_INLINE uint64_t ParallelHashJoin<T>::get_begin(uint64_t num_elements,
+                                                     uint32_t tid,
+                                                     uint32_t num_threads) {
+  return static_cast<unsigned __int128>(num_elements) * tid / num_threads;
+}
+
+template <typename T>
+FORCE_INLINE uint64_t ParallelHashJoin<T>::get_bucket(const T &val) const {
+  return hash_mix_64(std::hash<T>{}(val)) & mask_;
+}
+
+template <typename T>
+FORCE_INLINE ParallelHashJoin<T>::ParallelHashJoin(const T *build,
+                                                   uint64_t build_size)
+    : build_(build), build_size_(build_size) {
+  uint64_t num_buckets = 1;
+  while (num_buckets < build_size) {
+    num_buckets *= 2;
+  }
+  mask_ = num_buckets - 1;
+  heads_.reset(new std::atomic<uint64_t>[num_buckets]);
+  nexts_.reset(new uint64_t[build_size]);
+  auto num_threads = get_num_threads(std::max(num_buckets, build_size));
+  parallel_run(num_threads, [&](uint32_t tid) {
+    for (auto i = get_begin(num_buckets, tid, num_threads);
+         i < get_begin(num_buckets, tid + 1, num_threads); i++) {
+      heads_[i].store(kNullIdx, std::memory_order_relaxed);
+    }
+  });
+  parallel_run(num_threads, [&](uint32_t tid) {
+    for (auto i = get_begin(build_size, tid, num_threads);
+         i < get_begin(build_size, tid + 1, num_threads); i++) {
+      auto &head = heads_[get_bucket(build[i])];
+      auto next = head.load(std::memory_order_relaxed);
+      do {
+        nexts_[i] = next;
+      } while (!head.compare_exchange_weak(next, i, std::memory_order_relaxed));
+    }
+  });
+}
+
+template <typename T>
+FORCE_INLINE typename ParallelHashJoin<T>::Result
+ParallelHashJoin<T>::probe(const T *probe, uint64_t probe_size,
+                           bool keep_build, bool keep_probe) {
+  std::unique_ptr<std::atomic<bool>[]> matched;
+  if (keep_build) {
+    matched.reset(new std::atomic<bool>[build_size_]());
+  }
+  auto num_threads = get_num_threads(std::max(build_size_, probe_size));
+  Result result;
+  result.thread_pairs_.resize(num_threads);
+  parallel_run(num_threads, [&](uint32_t tid) {
+    auto &pairs = result.thread_pairs_[tid];
+    for (auto i = get_begin(probe_size, tid, num_threads);
+         i < get_begin(probe_size, tid + 1, num_threads); i++) {
+      bool found = false;
+      auto &head = heads_[get_bucket(probe[i])];
+      for (auto j = head.load(std::memory_order_relaxed); j != kNullIdx;
+           j = nexts_[j]) {
+        if (build_[j] == probe[i]) {
+          found = true;
+          pairs.emplace_back(j, i);
+          if (keep_build) {
+            matched[j].store(true, std::memory_order_relaxed);
+          }
+        }
+      }
+      if (!found && keep_probe) {
+        pairs.emplace_back(kNullIdx, i);
+      }
+    }
+  });
+  if (keep_build) {
+    // The threads have joined, so all their stores to matched are visible.
+    parallel_run(num_threads, [&](uint32_t tid) {
+      auto &pairs = result.thread_pairs_[tid];
+      for (auto i = get_begin(build_size_, tid, num_threads);
+           i < get_begin(build_size_, tid + 1, num_threads); i++) {
+        if (!matched[i].load(std::memory_order_relaxed)) {
+          pairs.emplace_back(i, kNullIdx);
+        }
+      }
+    });
+  }
+  result.thread_offsets_.push_back(0);
+  for (auto &pairs : result.thread_pairs_) {
+    result.thread_offsets_.push_back(result.thread_offsets_.back() +
+                                     pairs.size());
+  }
+  return result;
+}
+
+} // namespace far_memory
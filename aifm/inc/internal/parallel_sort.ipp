@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace far_memory {
+
+template <typename T>
+FORCE_INLINE ParallelSorter<T>::ParallelSorter(uint64_t num_elements)
+    : num_elements_(num_elements) {
+  num_threads_ = std::max<uint64_t>(
+      1, std::min<uint64_t>(helpers::get_num_runtime_cores(),
+                            num_elements / kMinNumElementsPerThread));
+}
+
+template <typename T>
+FORCE_INLINE uint64_t ParallelSorter<T>::get_begin(uint32_t tid,
+                                                   uint32_t num_parts) const {
+  return static_cast<unsigned __int128>(num_elements_) * tid / num_parts;
+}
+
+template <typename T>
+FORCE_INLINE typename ParallelSorter<T>::Key_t
+ParallelSorter<T>::to_key(const T &val) {
+  if constexpr (std::is_same<T, SimpleTime>::value) {
+    // Flip the sign bits so that the unsigned order is the signed one.
+    Key_t key = static_cast<uint16_t>(val.year_) ^ 0x8000;
+    for (auto field :
+         {val.month_, val.day_, val.hour_, val.min_, val.second_}) {
+      key = (key << 8) | (static_cast<uint8_t>(field) ^ 0x80);
+    }
+    return key;
+  } else if constexpr (std::is_signed<T>::value) {
+    return static_cast<Key_t>(val) ^
+           (static_cast<Key_t>(1) << (sizeof(Key_t) * 8 - 1));
+  } else {
+    return val;
+  }
+}
+
+template <typename T>
+FORCE_INLINE std::unique_ptr<uint64_t[]>
+ParallelSorter<T>::radix_sort(const T *data) {
+  auto n = num_elements_;
+  std::unique_ptr<Key_t[]> keys(new Key_t[n]);
+  std::unique_ptr<Key_t[]> keys_tmp(new Key_t[n]);
+  std::unique_ptr<uint64_t[]> idxs(new uint64_t[n]);
+  std::unique_ptr<uint64_t[]> idxs_tmp(new uint64_t[n]);
+  std::unique_ptr<uint64_t[]> cnts(new uint64_t[num_threads_ * kRadix]);
+
+  parallel_run(num_threads_, [&](uint32_t tid) {
+    for (auto i = get_begin(tid, num_threads_);
+         i < get_begin(tid + 1, num_threads_); i++) {
+      keys[i] = to_key(data[i]);
+      idxs[i] = i;
+    }
+  });
+
+  for (uint32_t byte = 0; byte < Key<T>::kNumBytes; byte++) {
+    auto shift = byte * kRadixBits;
+    parallel_run(num_threads_, [&](uint32_t tid) {
+      auto *thread_cnts = &cnts[tid * kRadix];
+      std::fill(thread_cnts, thread_cnts + kRadix, 0);
+      for (auto i = get_begin(tid, num_threads_);
+           i < get_begin(tid + 1, num_threads_); i++) {
+        thread_cnts[(keys[i] >> shift) & (kRadix - 1)]++;
+      }
+    });
+    // Turn the counts into the scatter offsets of each (digit, thread), in
+    // that order, which keeps the sort stable.
+    uint64_t offset = 0;
+    bool single_digit = false;
+    for (uint32_t digit = 0; digit < kRadix; digit++) {
+      auto digit_begin = offset;
+      for (uint32_t tid = 0; tid < num_threads_; tid++) {
+        auto cnt = cnts[tid * kRadix + digit];
+        cnts[tid * kRadix + digit] = offset;
+        offset += cnt;
+      }
+      single_digit |= (offset - digit_begin == n);
+    }
+    if (single_digit) {
+      continue;
+    }
+    parallel_run(num_threads_, [&](uint32_t tid) {
+      auto *thread_offsets = &cnts[tid * kRadix];
+      for (auto i = get_begin(tid, num_threads_);
+           i < get_begin(tid + 1, num_threads_); i++) {
+        auto pos = thread_offsets[(keys[i] >> shift) & (kRadix - 1)]++;
+        keys_tmp[pos] = keys[i];
+        idxs_tmp[pos] = idxs[i];
+      }
+    });
+    std::swap(keys, keys_tmp);
+    std::swap(idxs, idxs_tmp);
+  }
+  return idxs;
+}
+
+template <typename T>
+FORCE_INLINE std::unique_ptr<uint64_t[]>
+ParallelSorter<T>::merge_sort(const T *data) {
+  auto n = num_elements_;
+  std::unique_ptr<uint64_t[]> idxs(new uint64_t[n]);
+  std::unique_ptr<uint64_t[]> idxs_tmp(new uint64_t[n]);
+  auto cmp = [data](uint64_t a, uint64_t b) { return data[a] < data[b]; };
+
+  parallel_run(num_threads_, [&](uint32_t tid) {
+    auto begin = get_begin(tid, num_threads_);
+    auto end = get_begin(tid + 1, num_threads_);
+    for (auto i = begin; i < end; i++) {
+      idxs[i] = i;
+    }
+    std::stable_sort(idxs.get() + begin, idxs.get() + end, cmp);
+  });
+  // std::merge() prefers the first range on ties, so merging adjacent runs
+  // keeps the sort stable.
+  for (uint32_t width = 1; width < num_threads_; width *= 2) {
+    auto num_merges = (num_threads_ + 2 * width - 1) / (2 * width);
+    parallel_run(num_merges, [&](uint32_t merge_id) {
+      auto first = merge_id * 2 * width;
+      auto begin = get_begin(first, num_threads_);
+      auto mid = get_begin(std::min(first + width, num_threads_), num_threads_);
+      auto end =
+          get_begin(std::min(first + 2 * width, num_threads_), num_threads_);
+      std::merge(idxs.get() + begin, idxs.get() + mid, idxs.get() + mid,
+                 idxs.get() + end, idxs_tmp.get() + begin, cmp);
+    });
+    std::swap(idxs, idxs_tmp);
+  }
+  return idxs;
+}
+
+template <typename T>
+FORCE_INLINE void ParallelSorter<T>::rank(const T *data, bool ascending,
+                                          uint64_t *ranks) {
+  std::unique_ptr<uint64_t[]> idxs;
+  if constexpr (kUseRadixSort) {
+    idxs = radix_sort(data);
+  } else {
+    idxs = merge_sort(data);
+  }
+  auto n = num_elements_;
+  parallel_run(num_threads_, [&](uint32_t tid) {
+    for (auto i = get_begin(tid, num_threads_);
+         i < get_begin(tid + 1, num_threads_); i++) {
+      ranks[idxs[i]] = ascending ? i : n - i - 1;
+    }
+  });
+}
+
+} // namespace far_memory
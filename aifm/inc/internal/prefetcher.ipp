@@ -81,7 +81,7 @@ Prefetcher<InduceFn, InferFn, MappingFn>::generate_prefetch_tasks() {
         wmb();
         status.cv.Signal();
       } else {
-        task->swap_in(nt_);
+        task->swap_in(nt_, TrafficClass::kPrefetch);
       }
     }
   }
@@ -100,7 +100,7 @@ Prefetcher<InduceFn, InferFn, MappingFn>::prefetch_slave_fn(uint32_t tid) {
     if (likely(ACCESS_ONCE(*task_ptr))) {
       GenericUniquePtr *task = *task_ptr;
       ACCESS_ONCE(*task_ptr) = nullptr;
-      task->swap_in(nt_);
+      task->swap_in(nt_, TrafficClass::kPrefetch);
     } else {
       auto start_us = microtime();
       while (ACCESS_ONCE(*task_ptr) == nullptr &&
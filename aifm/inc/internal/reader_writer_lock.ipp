@@ -27,9 +27,9 @@ FORCE_INLINE WriterLockNp::WriterLockNp(ReaderWriterLock &lock) : lock_(lock) {
 
 FORCE_INLINE WriterLockNp::~WriterLockNp() { lock_.unlock_writer_np(); }
 
-FORCE_INLINE ReaderWriterLock::ReaderWriterLock() {
-  memset(reader_cnts_, 0, sizeof(reader_cnts_));
-}
+FORCE_INLINE ReaderWriterLock::ReaderWriterLock()
+    : reader_cnts_(
+          new CachelineAligned_int32_t[helpers::get_num_runtime_cores()]()) {}
 
 FORCE_INLINE void ReaderWriterLock::lock_reader() {
   while (unlikely(ACCESS_ONCE(writer_locked_))) {
@@ -57,7 +57,7 @@ retry:
     goto retry;
   }
   int32_t sum = 0;
-  FOR_ALL_SOCKET0_CORES(i) { sum += ACCESS_ONCE(reader_cnts_[i].data); }
+  FOR_ALL_CORES(i) { sum += ACCESS_ONCE(reader_cnts_[i].data); }
   if (sum) {
     store_release(&writer_locked_, false);
     preempt_enable();
@@ -78,7 +78,7 @@ FORCE_INLINE void ReaderWriterLock::lock_writer() {
   }
 retry:
   int32_t sum = 0;
-  FOR_ALL_SOCKET0_CORES(i) { sum += ACCESS_ONCE(reader_cnts_[i].data); }
+  FOR_ALL_CORES(i) { sum += ACCESS_ONCE(reader_cnts_[i].data); }
   if (sum) {
     thread_yield();
     goto retry;
@@ -12,6 +12,8 @@ FORCE_INLINE bool Region::is_invalid() const {
   return region_idx_ == kInvalidIdx;
 }
 
+FORCE_INLINE uint32_t Region::get_idx() const { return region_idx_; }
+
 FORCE_INLINE void Region::invalidate() { region_idx_ = kInvalidIdx; }
 
 FORCE_INLINE void Region::reset() {
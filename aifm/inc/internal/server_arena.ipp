@@ -0,0 +1,34 @@
+#pragma once
+
+namespace far_memory {
+
+FORCE_INLINE bool ServerArena::is_in_arena(const void *ptr) const {
+  auto *p = static_cast<const uint8_t *>(ptr);
+  return p >= base_ && p < base_ + capacity_;
+}
+
+template <typename T>
+FORCE_INLINE T *ServerArena::Allocator<T>::allocate(std::size_t n) {
+  return static_cast<T *>(ServerArena::get().allocate(n * sizeof(T)));
+}
+
+template <typename T>
+FORCE_INLINE void ServerArena::Allocator<T>::deallocate(T *ptr,
+                                                        std::size_t n) {
+  ServerArena::get().free(ptr, n * sizeof(T));
+}
+
+template <typename T>
+template <typename U>
+FORCE_INLINE void ServerArena::Allocator<T>::construct(U *ptr) {
+  ::new (static_cast<void *>(ptr)) U;
+}
+
+template <typename T>
+template <typename U, typename... Args>
+FORCE_INLINE void ServerArena::Allocator<T>::construct(U *ptr,
+                                                       Args &&... args) {
+  ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+}
+
+} // namespace far_memory
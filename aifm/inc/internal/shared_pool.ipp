@@ -4,7 +4,9 @@ namespace far_memory {
 
 template <typename T>
 FORCE_INLINE SharedPool<T>::SharedPool(uint32_t capacity)
-    : global_pool_(capacity) {}
+    : cache_(new CircularBuffer<T, false, kNumCachedItemsPerCPU>
+                 [helpers::get_num_runtime_cores()]),
+      global_pool_(capacity) {}
 
 template <typename T> FORCE_INLINE void SharedPool<T>::push(T item) {
   preempt_disable();
@@ -46,7 +48,7 @@ template <typename T> FORCE_INLINE T SharedPool<T>::pop() {
 
 template <typename T>
 FORCE_INLINE void SharedPool<T>::for_each(const std::function<void(T)> &f) {
-  FOR_ALL_SOCKET0_CORES(core_id) { cache_[core_id].for_each(f); }
+  FOR_ALL_CORES(core_id) { cache_[core_id].for_each(f); }
   global_spin_.Lock();
   global_pool_.for_each(f);
   global_spin_.Unlock();
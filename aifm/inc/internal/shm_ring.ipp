@@ -0,0 +1,79 @@
+#pragma once
+
+extern "C" {
+#include <asm/atomic.h>
+#include <base/assert.h>
+#include <base/compiler.h>
+#include <runtime/thread.h>
+}
+
+#include <algorithm>
+#include <cstring>
+
+namespace far_memory {
+
+FORCE_INLINE uint64_t ShmRing::get_size(uint32_t capacity) {
+  return sizeof(ShmRing) + capacity;
+}
+
+FORCE_INLINE uint8_t *ShmRing::get_data() {
+  return reinterpret_cast<uint8_t *>(this) + sizeof(ShmRing);
+}
+
+FORCE_INLINE void ShmRing::init(uint32_t capacity) {
+  BUG_ON(!capacity || (capacity & (capacity - 1)));
+  head_ = tail_ = 0;
+  capacity_ = capacity;
+}
+
+FORCE_INLINE uint32_t ShmRing::push(const void *buf, uint32_t len) {
+  auto head = load_acquire(&head_);
+  auto tail = tail_;
+  len = std::min(static_cast<uint64_t>(len), capacity_ - (tail - head));
+  auto offset = tail & (capacity_ - 1);
+  auto first_len = std::min(len, static_cast<uint32_t>(capacity_ - offset));
+  auto *src = reinterpret_cast<const uint8_t *>(buf);
+  memcpy(get_data() + offset, src, first_len);
+  memcpy(get_data(), src + first_len, len - first_len);
+  store_release(&tail_, tail + len);
+  return len;
+}
+
+FORCE_INLINE uint32_t ShmRing::pop(void *buf, uint32_t len) {
+  auto tail = load_acquire(&tail_);
+  auto head = head_;
+  len = std::min(static_cast<uint64_t>(len), tail - head);
+  auto offset = head & (capacity_ - 1);
+  auto first_len = std::min(len, static_cast<uint32_t>(capacity_ - offset));
+  auto *dest = reinterpret_cast<uint8_t *>(buf);
+  memcpy(dest, get_data() + offset, first_len);
+  memcpy(dest + first_len, get_data(), len - first_len);
+  store_release(&head_, head + len);
+  return len;
+}
+
+FORCE_INLINE void ShmRing::push_until(const void *buf, uint32_t len) {
+  auto *src = reinterpret_cast<const uint8_t *>(buf);
+  while (len) {
+    auto pushed = push(src, len);
+    if (!pushed) {
+      thread_yield();
+    }
+    src += pushed;
+    len -= pushed;
+  }
+}
+
+FORCE_INLINE void ShmRing::pop_until(void *buf, uint32_t len) {
+  auto *dest = reinterpret_cast<uint8_t *>(buf);
+  while (len) {
+    auto popped = pop(dest, len);
+    if (!popped) {
+      thread_yield();
+    }
+    dest += popped;
+    len -= popped;
+  }
+}
+
+} // namespace far_memory
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <immintrin.h>
+#include <type_traits>
+
+namespace far_memory {
+namespace simd {
+
+template <typename T> FORCE_INLINE T load(const T *ptr) {
+  T val;
+  __builtin_memcpy(&val, ptr, sizeof(T));
+  return val;
+}
+
+#ifdef __AVX2__
+// The AVX2 operations on 32 B of T; kEnabled is false for types with no
+// native vector min and max (64-bit integers and SimpleTime).
+template <typename T, typename = void> struct Avx2Ops {
+  constexpr static bool kEnabled = false;
+};
+
+template <> struct Avx2Ops<float> {
+  constexpr static bool kEnabled = true;
+  using V = __m256;
+  static V load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+  static V min(V a, V b) { return _mm256_min_ps(a, b); }
+  static V max(V a, V b) { return _mm256_max_ps(a, b); }
+};
+
+template <> struct Avx2Ops<double> {
+  constexpr static bool kEnabled = true;
+  using V = __m256d;
+  static V load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+  static V min(V a, V b) { return _mm256_min_pd(a, b); }
+  static V max(V a, V b) { return _mm256_max_pd(a, b); }
+};
+
+template <typename T>
+struct Avx2Ops<T, std::enable_if_t<std::is_integral<T>::value &&
+                                   sizeof(T) <= sizeof(uint32_t)>> {
+  constexpr static bool kEnabled = true;
+  constexpr static bool kSigned = std::is_signed<T>::value;
+  using V = __m256i;
+  static V load(const T *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const V *>(p));
+  }
+  static void store(T *p, V v) {
+    _mm256_storeu_si256(reinterpret_cast<V *>(p), v);
+  }
+  static V min(V a, V b) {
+    if constexpr (sizeof(T) == 1) {
+      return kSigned ? _mm256_min_epi8(a, b) : _mm256_min_epu8(a, b);
+    } else if constexpr (sizeof(T) == 2) {
+      return kSigned ? _mm256_min_epi16(a, b) : _mm256_min_epu16(a, b);
+    } else {
+      return kSigned ? _mm256_min_epi32(a, b) : _mm256_min_epu32(a, b);
+    }
+  }
+  static V max(V a, V b) {
+    if constexpr (sizeof(T) == 1) {
+      return kSigned ? _mm256_max_epi8(a, b) : _mm256_max_epu8(a, b);
+    } else if constexpr (sizeof(T) == 2) {
+      return kSigned ? _mm256_max_epi16(a, b) : _mm256_max_epu16(a, b);
+    } else {
+      return kSigned ? _mm256_max_epi32(a, b) : _mm256_max_epu32(a, b);
+    }
+  }
+};
+#endif
+
+template <typename T>
+FORCE_INLINE void gather(const T *src, const uint64_t *idxs, uint64_t n,
+                         uint64_t null_idx, T null_val, T *dst) {
+  uint64_t i = 0;
+#ifdef __AVX2__
+  if constexpr (std::is_arithmetic<T>::value &&
+                (sizeof(T) == 4 || sizeof(T) == 8)) {
+    auto null_idxs = _mm256_set1_epi64x(null_idx);
+    for (; i + 4 <= n; i += 4) {
+      auto vidxs =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(idxs + i));
+      // Leave the quads with a null index to the scalar loop.
+      if (unlikely(
+              _mm256_movemask_epi8(_mm256_cmpeq_epi64(vidxs, null_idxs)))) {
+        for (uint32_t j = 0; j < 4; j++) {
+          dst[i + j] = (idxs[i + j] == null_idx) ? null_val : src[idxs[i + j]];
+        }
+        continue;
+      }
+      if constexpr (sizeof(T) == 8) {
+        auto vals = _mm256_i64gather_epi64(
+            reinterpret_cast<const long long *>(src), vidxs, 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), vals);
+      } else {
+        auto vals = _mm256_i64gather_epi32(reinterpret_cast<const int *>(src),
+                                           vidxs, 4);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), vals);
+      }
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = (idxs[i] == null_idx) ? null_val : src[idxs[i]];
+  }
+}
+
+template <bool Min, typename T>
+FORCE_INLINE T reduce_min_max(const T *data, uint64_t n) {
+  auto ret = load(data);
+  uint64_t i = 1;
+#ifdef __AVX2__
+  if constexpr (Avx2Ops<T>::kEnabled) {
+    using Ops = Avx2Ops<T>;
+    constexpr uint32_t kNumLanes = 32 / sizeof(T);
+    if (n >= kNumLanes) {
+      auto acc = Ops::load(data);
+      for (i = kNumLanes; i + kNumLanes <= n; i += kNumLanes) {
+        auto vals = Ops::load(data + i);
+        acc = Min ? Ops::min(acc, vals) : Ops::max(acc, vals);
+      }
+      T lanes[kNumLanes];
+      Ops::store(lanes, acc);
+      for (uint32_t j = 0; j < kNumLanes; j++) {
+        ret = Min ? std::min(ret, lanes[j]) : std::max(ret, lanes[j]);
+      }
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    auto val = load(data + i);
+    ret = Min ? std::min(ret, val) : std::max(ret, val);
+  }
+  return ret;
+}
+
+template <typename T> FORCE_INLINE T reduce_min(const T *data, uint64_t n) {
+  return reduce_min_max</* Min = */ true>(data, n);
+}
+
+template <typename T> FORCE_INLINE T reduce_max(const T *data, uint64_t n) {
+  return reduce_min_max</* Min = */ false>(data, n);
+}
+
+template <typename T>
+FORCE_INLINE KernelSum_t<T> reduce_sum(const T *data, uint64_t n) {
+  uint64_t i = 0;
+  KernelSum_t<T> sum = 0;
+#ifdef __AVX2__
+  // The compiler vectorizes the integer sums by itself, but not the floating
+  // point ones, as that reorders the additions.
+  if constexpr (std::is_floating_point<T>::value) {
+    auto acc = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+      if constexpr (std::is_same<T, float>::value) {
+        acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm_loadu_ps(data + i)));
+      } else {
+        acc = _mm256_add_pd(acc, _mm256_loadu_pd(data + i));
+      }
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+#endif
+  for (; i < n; i++) {
+    sum += load(data + i);
+  }
+  return sum;
+}
+
+template <typename T>
+FORCE_INLINE HashSet<T>::HashSet(uint64_t expected_size) {
+  // Stay below the 7/8 load factor that triggers grow().
+  num_groups_ = kMinNumGroups;
+  while (num_groups_ * kGroupSize * 3 / 4 < expected_size) {
+    num_groups_ *= 2;
+  }
+  ctrls_.reset(new int8_t[num_groups_ * kGroupSize]);
+  std::fill(ctrls_.get(), ctrls_.get() + num_groups_ * kGroupSize, kEmpty);
+  slots_.reset(new T[num_groups_ * kGroupSize]);
+}
+
+template <typename T>
+FORCE_INLINE uint64_t HashSet<T>::get_hash(const T &val) {
+  return hash_mix_64(std::hash<T>{}(val));
+}
+
+// Returns the bitmap of the slots of group whose control byte is tag.
+template <typename T>
+FORCE_INLINE uint32_t HashSet<T>::match(uint64_t group, int8_t tag) const {
+  auto *ctrls = &ctrls_[group * kGroupSize];
+#ifdef __SSE2__
+  auto vctrls = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrls));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(vctrls, _mm_set1_epi8(tag)));
+#else
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < kGroupSize; i++) {
+    mask |= static_cast<uint32_t>(ctrls[i] == tag) << i;
+  }
+  return mask;
+#endif
+}
+
+template <typename T>
+FORCE_INLINE bool HashSet<T>::insert(const T &val, uint64_t hash) {
+  // The low 7 bits are the tag and the rest pick the first group to probe.
+  int8_t tag = hash & 0x7f;
+  auto group = (hash >> 7) & (num_groups_ - 1);
+  while (true) {
+    for (auto mask = match(group, tag); mask; mask &= mask - 1) {
+      if (slots_[group * kGroupSize + __builtin_ctz(mask)] == val) {
+        return false;
+      }
+    }
+    // The set never erases, so an empty slot ends the probe sequence.
+    auto empty_mask = match(group, kEmpty);
+    if (empty_mask) {
+      auto slot = group * kGroupSize + __builtin_ctz(empty_mask);
+      ctrls_[slot] = tag;
+      slots_[slot] = val;
+      if (unlikely(++size_ * 8 > num_groups_ * kGroupSize * 7)) {
+        grow();
+      }
+      return true;
+    }
+    group = (group + 1) & (num_groups_ - 1);
+  }
+}
+
+template <typename T> void HashSet<T>::grow() {
+  auto old_num_slots = num_groups_ * kGroupSize;
+  auto old_ctrls = std::move(ctrls_);
+  auto old_slots = std::move(slots_);
+  num_groups_ *= 2;
+  ctrls_.reset(new int8_t[num_groups_ * kGroupSize]);
+  std::fill(ctrls_.get(), ctrls_.get() + num_groups_ * kGroupSize, kEmpty);
+  slots_.reset(new T[num_groups_ * kGroupSize]);
+  size_ = 0;
+  for (uint64_t i = 0; i < old_num_slots; i++) {
+    if (old_ctrls[i] != kEmpty) {
+      insert(old_slots[i], get_hash(old_slots[i]));
+    }
+  }
+}
+
+template <typename T> FORCE_INLINE uint64_t HashSet<T>::size() const {
+  return size_;
+}
+
+} // namespace simd
+} // namespace far_memory
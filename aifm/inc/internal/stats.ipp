@@ -8,19 +8,19 @@ FORCE_INLINE void Stats::disable_swap() { enable_swap_ = false; }
 
 FORCE_INLINE uint64_t Stats::get_schedule_us() {
   uint64_t sum = 0;
-  FOR_ALL_SOCKET0_CORES(i) { sum += ACCESS_ONCE(duration_schedule_us[i].c); }
+  FOR_ALL_CORES(i) { sum += ACCESS_ONCE(duration_schedule_us[i].c); }
   return sum;
 }
 
 FORCE_INLINE uint64_t Stats::get_softirq_us() {
   uint64_t sum = 0;
-  FOR_ALL_SOCKET0_CORES(i) { sum += ACCESS_ONCE(duration_softirq_us[i].c); }
+  FOR_ALL_CORES(i) { sum += ACCESS_ONCE(duration_softirq_us[i].c); }
   return sum;
 }
 
 FORCE_INLINE uint64_t Stats::get_gc_us() {
   uint64_t sum = 0;
-  FOR_ALL_SOCKET0_CORES(i) { sum += ACCESS_ONCE(duration_gc_us[i].c); }
+  FOR_ALL_CORES(i) { sum += ACCESS_ONCE(duration_gc_us[i].c); }
   return sum;
 }
 
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "sync.h"
+
+#include <cstdint>
+#include <linux/io_uring.h>
+
+namespace far_memory {
+
+// A minimal io_uring wrapper that lets many uthreads share one ring. Requests
+// are queued to the SQ and submitted lazily in batches by whichever uthread
+// polls next; completions are reaped by any waiting uthread, so no kthread
+// ever blocks inside io_uring_enter().
+class IOUring {
+private:
+  struct Request {
+    int32_t res;
+    bool done;
+  };
+
+  int ring_fd_;
+  uint32_t num_entries_;
+  uint32_t *sq_head_;
+  uint32_t *sq_tail_;
+  uint32_t *sq_mask_;
+  uint32_t *sq_array_;
+  io_uring_sqe *sqes_;
+  uint32_t *cq_head_;
+  uint32_t *cq_tail_;
+  uint32_t *cq_mask_;
+  io_uring_cqe *cqes_;
+  void *sq_ring_ptr_;
+  uint64_t sq_ring_size_;
+  void *cq_ring_ptr_;
+  uint64_t cq_ring_size_;
+  uint32_t num_unsubmitted_;
+  rt::Spin spin_;
+
+  bool queue(uint8_t opcode, int fd, void *buf, uint32_t len, uint64_t offset,
+             Request *req);
+  void poll();
+
+public:
+  IOUring(uint32_t num_entries);
+  ~IOUring();
+  // Blocking for the calling uthread only. Return the number of bytes
+  // transferred, or a negative errno.
+  int32_t read(int fd, void *buf, uint32_t len, uint64_t offset);
+  int32_t write(int fd, const void *buf, uint32_t len, uint64_t offset);
+};
+
+} // namespace far_memory
@@ -6,11 +6,14 @@
 #include "slab.hpp"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 
 namespace far_memory {
 
+class ServerArena;
+
 class LocalGenericConcurrentHopscotch {
 private:
 #pragma pack(push, 1)
@@ -40,6 +43,8 @@ private:
 
   const uint32_t kHashMask_;
   const uint32_t kNumEntries_;
+  ServerArena *arena_;
+  uint64_t data_size_;
   std::unique_ptr<uint8_t> buckets_mem_;
   uint64_t slab_base_addr_;
   Slab slab_;
@@ -47,16 +52,24 @@ private:
   friend class FarMemTest;
 
   void do_remove(BucketEntry *bucket, BucketEntry *entry);
+  uint8_t *allocate(uint64_t size);
 
 public:
+  // Allocates its memory from arena if given (i.e., when running inside a
+  // memory server).
   LocalGenericConcurrentHopscotch(uint32_t num_entries_shift,
-                                  uint64_t data_size);
+                                  uint64_t data_size,
+                                  ServerArena *arena = nullptr);
   ~LocalGenericConcurrentHopscotch();
   void get(uint8_t key_len, const uint8_t *key, uint16_t *val_len, uint8_t *val,
            bool remove = false);
   bool put(uint8_t key_len, const uint8_t *key, uint16_t val_len,
            const uint8_t *val);
   bool remove(uint8_t key_len, const uint8_t *key);
+  // Invokes f on every kv pair. Not safe against concurrent updates.
+  void for_each(const std::function<void(uint8_t key_len, const uint8_t *key,
+                                         uint16_t val_len, const uint8_t *val)>
+                    &f);
 };
 
 template <typename K, typename V>
@@ -64,7 +77,8 @@ class LocalConcurrentHopscotch : public LocalGenericConcurrentHopscotch {
 private:
   constexpr static uint64_t kKVDataSize =
       sizeof(K) + sizeof(V) + sizeof(KVDataHeader);
-  CachelineAligned(int64_t) per_core_size_[helpers::kNumCPUs];
+  CachelineAligned(int64_t);
+  std::unique_ptr<CachelineAligned_int64_t[]> per_core_size_;
 
 public:
   LocalConcurrentHopscotch(uint32_t index_num_kv, uint64_t data_num_kv);
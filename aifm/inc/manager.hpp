@@ -1,11 +1,13 @@
 #pragma once
 
 #include "sync.h"
+#include "thread.h"
 
 #include "array.hpp"
 #include "cb.hpp"
 #include "concurrent_hopscotch.hpp"
 #include "device.hpp"
+#include "gc_pacer.hpp"
 #include "helpers.hpp"
 #include "internal/ds_info.hpp"
 #include "list.hpp"
@@ -48,44 +50,87 @@ public:
 };
 
 class GCParallelWriteBacker : public GCParallelizer {
+  // The size of the live objects evacuated since the last reset.
+  std::atomic<uint64_t> num_evacuated_bytes_{0};
+
   void slave_fn(uint32_t tid);
 
 public:
   GCParallelWriteBacker(uint32_t num_slaves, uint32_t task_queues_depth,
                         std::vector<Region> *from_regions);
+  uint64_t reset_num_evacuated_bytes();
 };
 
 class FarMemManager {
 private:
   constexpr static double kFreeCacheAlmostEmptyThresh = 0.03;
   constexpr static double kFreeCacheLowThresh = 0.12;
+  constexpr static double kFreeCacheMinLowThresh = 0.05;
   constexpr static double kFreeCacheHighThresh = 0.22;
   constexpr static uint8_t kGCSlaveThreadTaskQueueDepth = 8;
   constexpr static uint32_t kMaxNumRegionsPerGCRound = 128;
   constexpr static double kMaxRatioRegionsPerGCRound = 0.1;
   constexpr static double kMinRatioRegionsPerGCRound = 0.03;
 
+  constexpr static uint64_t kResizeCachePollUs = 1000;
+  constexpr static uint64_t kResizeCacheTimeoutUs = 10 * 1000 * 1000;
+
   class RegionManager {
   private:
     constexpr static double kPickRegionMaxRetryTimes = 3;
+    constexpr static uint32_t kNumRegionsPerGroup =
+        helpers::kHugepageSize / Region::kSize;
 
     std::unique_ptr<uint8_t> local_cache_ptr_;
-    CircularBuffer<Region, false> free_regions_;
+    // Free regions are kept per NUMA node. The hugepage groups of the local
+    // cache are interleaved across the nodes in proportion to their CPUs, so
+    // that every core mostly gets regions from its own node, and memory-only
+    // nodes hold none of the cache.
+    uint32_t num_nodes_;
+    std::vector<uint8_t> group_nodes_;
+    std::unique_ptr<CircularBuffer<Region, false>[]> free_regions_;
+    uint32_t num_free_regions_ = 0;
     CircularBuffer<Region, false> used_regions_;
     CircularBuffer<Region, false> nt_used_regions_;
+    // Used regions beyond the budget are kept apart so that GC can find them
+    // without scanning the used lists.
+    std::vector<Region> retiring_used_regions_;
+    uint32_t num_retiring_used_regions_ = 0;
     rt::Spin region_spin_;
-    Region core_local_free_regions_[helpers::kNumCPUs];
-    Region core_local_free_nt_regions_[helpers::kNumCPUs];
+    std::unique_ptr<Region[]> core_local_free_regions_;
+    std::unique_ptr<Region[]> core_local_free_nt_regions_;
+    uint32_t min_num_regions_;
+    // Regions whose idx >= num_regions_ are out of the budget. They are
+    // retiring until they become free, after which they are released.
+    uint32_t num_regions_;
+    uint32_t max_num_regions_;
+    uint32_t num_retiring_regions_ = 0;
+    std::vector<bool> released_;
     friend class FarMemTest;
 
+    bool is_retiring(const Region &region) const;
+    uint32_t get_node(uint32_t region_idx) const;
+    void assign_group_nodes();
+    void push_free_region_locked(Region &region);
+    bool pop_free_region_locked(Region *region);
+    uint8_t *release_region(Region &region);
+    void count_retiring_regions();
+    void push_used_region_locked(Region &region);
+    void retire_used_regions_locked(CircularBuffer<Region, false> *regions);
+
   public:
-    RegionManager(uint64_t size, bool is_local);
+    RegionManager(uint64_t size, uint64_t max_size, bool is_local);
     void push_free_region(Region &region);
     std::optional<Region> pop_used_region();
+    std::optional<Region> pop_retiring_used_region();
     bool try_refill_core_local_free_region(bool nt, Region *full_region);
     Region &core_local_free_region(bool nt);
     double get_free_region_ratio() const;
     uint32_t get_num_regions() const;
+    uint32_t get_max_num_regions() const;
+    void resize(uint64_t size);
+    bool has_retiring_regions() const;
+    bool has_retiring_used_regions() const;
   };
 
   RegionManager cache_region_manager_;
@@ -98,9 +143,14 @@ private:
   rt::Spin gc_lock_;
   GCParallelMarker parallel_marker_;
   GCParallelWriteBacker parallel_write_backer_;
+  GCPacer gc_pacer_;
   std::vector<Region> from_regions_{kMaxNumRegionsPerGCRound};
   int ksched_fd_;
   std::queue<uint8_t> available_ds_ids_;
+  rt::Mutex resize_mutex_;
+  uint64_t pending_cache_size_ = 0;
+  bool resize_ctrl_exit_ = false;
+  std::unique_ptr<rt::Thread> resize_ctrl_thread_;
   static ObjLocker obj_locker_;
 
   friend class FarMemTest;
@@ -114,14 +164,16 @@ private:
   friend class GenericConcurrentHopscotch;
   template <typename T> friend class DataFrameVector;
 
-  FarMemManager(uint64_t cache_size, uint64_t far_mem_size,
-                uint32_t num_gc_threads, FarMemDevice *device);
+  FarMemManager(uint64_t cache_size, uint64_t max_cache_size,
+                uint64_t far_mem_size, uint32_t num_gc_threads,
+                FarMemDevice *device);
   bool is_free_cache_almost_empty() const;
   bool is_free_cache_low() const;
   bool is_free_cache_high() const;
   std::optional<Region> pop_cache_used_region();
   void push_cache_free_region(Region &region);
-  void swap_in(bool nt, GenericFarMemPtr *ptr);
+  void swap_in(bool nt, GenericFarMemPtr *ptr,
+               TrafficClass cls = TrafficClass::kDemandRead);
   void swap_out(GenericFarMemPtr *ptr, Object obj);
   void launch_gc_master();
   void gc_cache();
@@ -136,9 +188,12 @@ private:
   void wait_mutators_observation();
   void write_back_regions();
   void gc_check();
+  void wake_up_mutators();
   void start_prioritizing(Status status);
   void stop_prioritizing();
   uint8_t allocate_ds_id();
+  // Allocates the given ds_id, which must be available, and returns it.
+  uint8_t reserve_ds_id(uint8_t ds_id);
   void free_ds_id(uint8_t ds_id);
 
 public:
@@ -146,12 +201,25 @@ public:
   using EvacNotifier = std::function<bool(Object, WriteObjectFn)>;
   using CopyNotifier = std::function<void(Object dest, Object src)>;
 
+  using WriteEncodedFn = std::function<void(const uint8_t *buf, uint16_t len)>;
+  // Calls write with the wire form of an object's data, or returns false
+  // without calling it if the data should be written as is.
+  using ObjectEncoder = std::function<bool(
+      const uint8_t *data, uint16_t data_len, const WriteEncodedFn &write)>;
+  // Turns the len bytes that were read into data back into the object's data
+  // in place and returns its length. The device returns the data in the form
+  // it was written in, which need not be the encoded one.
+  using ObjectDecoder = std::function<uint16_t(uint8_t *data, uint16_t len)>;
+
   uint32_t num_gc_threads_;
   EvacNotifier evac_notifiers_[kMaxNumDSIDs];
   CopyNotifier copy_notifiers_[kMaxNumDSIDs];
+  ObjectEncoder object_encoders_[kMaxNumDSIDs];
+  ObjectDecoder object_decoders_[kMaxNumDSIDs];
 
   ~FarMemManager();
   FarMemDevice *get_device() const { return device_ptr_.get(); }
+  const GCPacer &get_gc_pacer() const { return gc_pacer_; }
   double get_free_mem_ratio() const;
   bool allocate_generic_unique_ptr_nb(
       GenericUniquePtr *ptr, uint8_t ds_id, uint16_t item_size,
@@ -192,12 +260,40 @@ public:
                                      uint64_t remote_data_size);
   template <typename T> DataFrameVector<T> allocate_dataframe_vector();
   template <typename T> DataFrameVector<T> *allocate_dataframe_vector_heap();
+  // The adopt_*() counterparts of allocate_*() take over the ds_id of a ds
+  // that the server restored from its snapshot (see TCPDevice's reattach),
+  // with the contents it had as of the snapshot; they must be called before
+  // the ds_id gets allocated otherwise. A ds that the server has not restored
+  // with the same params starts out empty, just as an allocated one.
+  GenericConcurrentHopscotch
+  adopt_concurrent_hopscotch(uint8_t ds_id, uint32_t local_num_entries_shift,
+                             uint32_t remote_num_entries_shift,
+                             uint64_t remote_data_size);
+  template <typename K, typename V>
+  ConcurrentHopscotch<K, V>
+  adopt_concurrent_hopscotch(uint8_t ds_id, uint32_t local_num_entries_shift,
+                             uint32_t remote_num_entries_shift,
+                             uint64_t remote_data_size);
+  // Only what the vector had flushed by the snapshot is adopted.
+  template <typename T>
+  DataFrameVector<T> adopt_dataframe_vector(uint8_t ds_id);
   template <typename T>
   List<T> allocate_list(const DerefScope &scope, bool enable_merge = false);
   template <typename T> Queue<T> allocate_queue(const DerefScope &scope);
   template <typename T> Stack<T> allocate_stack(const DerefScope &scope);
   void register_eval_notifier(uint8_t ds_id, EvacNotifier notifier);
   void register_copy_notifier(uint8_t ds_id, CopyNotifier notifier);
+  // Must be called while the data structure has no objects. destruct()
+  // unregisters the codec.
+  void register_object_codec(uint8_t ds_id, ObjectEncoder encoder,
+                             ObjectDecoder decoder);
+  // Writes an object's data to the device, encoded if its data structure has
+  // an encoder. The caller must have been admitted.
+  void write_object_data(uint8_t ds_id, uint8_t obj_id_len,
+                         const uint8_t *obj_id, uint16_t data_len,
+                         const uint8_t *data_buf);
+  // Reads an object's data from the device, decoded if its data structure
+  // has a decoder, so data_buf must hold the decoded data.
   void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
                    uint16_t *data_len, uint8_t *data_buf);
   bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
@@ -205,6 +301,19 @@ public:
                  uint8_t *params);
   void destruct(uint8_t ds_id);
   void mutator_wait_for_gc_cache();
+  // Changes the local cache budget at runtime. Growing takes effect
+  // immediately; shrinking evacuates the regions beyond the new budget and
+  // returns their hugepages to the OS. Must be called outside DerefScope.
+  // Returns false if the shrink times out with some regions still in use;
+  // those are released by later GC rounds.
+  bool resize_cache(uint64_t new_size);
+  // Async-signal-safe; applied later by the resize control thread.
+  void request_cache_resize(uint64_t new_size);
+  // On signal signum, reads the new cache size (in bytes) from ctrl_file_path
+  // and resizes the cache accordingly.
+  void start_cache_resize_ctrl(int signum, const char *ctrl_file_path);
+  uint64_t get_cache_size() const;
+  uint64_t get_max_cache_size() const;
   static void lock_object(uint8_t obj_id_len, const uint8_t *obj_id);
   static void unlock_object(uint8_t obj_id_len, const uint8_t *obj_id);
 };
@@ -217,9 +326,10 @@ private:
   friend class FarMemManager;
 
 public:
-  static FarMemManager *build(uint64_t cache_size,
-                              std::optional<uint32_t> optional_num_gc_threads,
-                              FarMemDevice *device);
+  static FarMemManager *
+  build(uint64_t cache_size, std::optional<uint32_t> optional_num_gc_threads,
+        FarMemDevice *device,
+        std::optional<uint64_t> optional_max_cache_size = {});
   static FarMemManager *get();
 };
 
@@ -3,6 +3,7 @@
 #include "thread.h"
 
 #include "cb.hpp"
+#include "deref_scope.hpp"
 
 #include <atomic>
 #include <cstdint>
@@ -19,6 +20,7 @@ private:
   std::vector<rt::Thread> threads_;
   uint32_t enqueue_thread_id_ = 0;
   uint32_t num_slaves_;
+  uint32_t num_active_slaves_;
 
 public:
   NOT_COPYABLE(Parallelizer);
@@ -30,10 +32,37 @@ public:
   template <typename T> void master_enqueue_task(T &&task);
   bool slave_dequeue_task(uint32_t tid, Task *task);
   bool slave_can_exit(uint32_t tid);
+  // Only the first num slaves are spawned in the following executions.
+  void set_num_active_slaves(uint32_t num);
   void spawn(Status *slaves_status);
   void execute();
 };
 
+// Runs f(tid) for every tid in [0, num_threads), each on its own uthread; the
+// caller runs tid 0 itself. Returns once all of them are done.
+template <typename F> void parallel_run(uint32_t num_threads, F &&f);
+// Returns the number of threads, one per runtime core at most, that split
+// num_elements elements so that each gets at least min_num_elements_per_thread
+// of them (but at least one thread).
+uint32_t get_num_parallel_threads(uint64_t num_elements,
+                                  uint64_t min_num_elements_per_thread);
+// Returns the first element of the share of thread tid when num_elements
+// elements are split evenly across num_threads threads; the share ends where
+// that of tid + 1 begins.
+uint64_t get_parallel_range_begin(uint64_t num_elements, uint32_t tid,
+                                  uint32_t num_threads);
+// Splits the far-memory objects [0, num_objects) evenly across num_threads
+// threads (see parallel_run()) and runs f(tid, begin, end, cursor) for the
+// share [begin, end) of each of them, where f stores the object it works on to
+// cursor (a std::atomic<uint64_t>) as it advances. Alongside each thread, a
+// helper uthread calls prefetch_fn(i) on the objects of its share in order, at
+// most win_size objects past the cursor, so that every thread has a prefetch
+// stream of its own.
+template <typename PrefetchFn, typename F>
+void parallel_for_prefetched(uint64_t num_objects, uint32_t num_threads,
+                             uint64_t win_size, PrefetchFn &&prefetch_fn,
+                             F &&f);
+
 } // namespace far_memory
 
 #include "internal/parallel.ipp"
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "parallel.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace far_memory {
+
+// An equi-join of two arrays that runs on all runtime cores. The build side
+// goes into a chained hash table whose buckets are pushed to lock-free, and
+// the probe side is then split across the threads, each of which collects its
+// matches locally. A row that has no match but must be kept by the join policy
+// is paired with kNullIdx.
+template <typename T> class ParallelHashJoin {
+public:
+  constexpr static uint64_t kNullIdx = std::numeric_limits<uint64_t>::max();
+
+  // The (build row, probe row) pairs, in an unspecified order.
+  class Result {
+  private:
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> thread_pairs_;
+    std::vector<uint64_t> thread_offsets_;
+    friend class ParallelHashJoin;
+
+  public:
+    uint64_t size() const;
+    // Writes the build rows of the pairs to build_rows and their probe rows to
+    // probe_rows, both of which must hold size() elements.
+    void copy_to(uint64_t *build_rows, uint64_t *probe_rows);
+  };
+
+  ParallelHashJoin(const T *build, uint64_t build_size);
+  Result probe(const T *probe, uint64_t probe_size, bool keep_build,
+               bool keep_probe);
+
+private:
+  constexpr static uint64_t kMinNumElementsPerThread = 1 << 16;
+
+  const T *build_;
+  uint64_t build_size_;
+  uint64_t mask_;
+  std::unique_ptr<std::atomic<uint64_t>[]> heads_;
+  std::unique_ptr<uint64_t[]> nexts_;
+
+  static uint32_t get_num_threads(uint64_t num_elements);
+  static uint64_t get_begin(uint64_t num_elements, uint32_t tid,
+                            uint32_t num_threads);
+  uint64_t get_bucket(const T &val) const;
+};
+
+} // namespace far_memory
+
+#include "internal/parallel_hash_join.ipp"
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "internal/dataframe_types.hpp"
+#include "parallel.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace far_memory {
+
+// Ranks an array by a stable sort that runs on all runtime cores: ranks[i] is
+// the position of data[i] in the sorted order, i.e., the index vector that
+// DataFrameVector::shuffle_data_by_idx() consumes. Integral types and
+// SimpleTime are LSD radix sorted over their bytes; everything else (floating
+// points) is sorted per thread and then merged pairwise.
+template <typename T> class ParallelSorter {
+private:
+  constexpr static uint64_t kMinNumElementsPerThread = 1 << 16;
+  constexpr static uint32_t kRadixBits = 8;
+  constexpr static uint32_t kRadix = 1 << kRadixBits;
+  constexpr static bool kUseRadixSort =
+      std::is_integral<T>::value || std::is_same<T, SimpleTime>::value;
+
+  template <typename U, typename = void> struct Key {
+    using type = uint64_t;
+    // SimpleTime packs 7 single-field bytes.
+    constexpr static uint32_t kNumBytes = 7;
+  };
+  template <typename U>
+  struct Key<U, std::enable_if_t<std::is_integral<U>::value>> {
+    using type = std::make_unsigned_t<U>;
+    constexpr static uint32_t kNumBytes = sizeof(U);
+  };
+  using Key_t = typename Key<T>::type;
+
+  uint32_t num_threads_;
+  uint64_t num_elements_;
+
+  uint64_t get_begin(uint32_t tid, uint32_t num_parts) const;
+  static Key_t to_key(const T &val);
+  std::unique_ptr<uint64_t[]> radix_sort(const T *data);
+  std::unique_ptr<uint64_t[]> merge_sort(const T *data);
+
+public:
+  ParallelSorter(uint64_t num_elements);
+  void rank(const T *data, bool ascending, uint64_t *ranks);
+};
+
+} // namespace far_memory
+
+#include "internal/parallel_sort.ipp"
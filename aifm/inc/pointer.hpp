@@ -1,6 +1,7 @@
 #pragma once
 
 #include "deref_scope.hpp"
+#include "device_scheduler.hpp"
 #include "object.hpp"
 
 namespace far_memory {
@@ -93,6 +94,7 @@ private:
   FarMemPtrMeta meta_;
 
 protected:
+  friend class GenericArray;
   friend class GenericDataFrameVector;
   friend class GenericConcurrentHopscotch;
   friend class FarMemManager;
@@ -112,7 +114,7 @@ protected:
 public:
   void nullify();
   bool is_null() const;
-  void swap_in(bool nt);
+  void swap_in(bool nt, TrafficClass cls = TrafficClass::kDemandRead);
   void flush();
   void move(GenericFarMemPtr &other, uint64_t reset_value);
 };
@@ -2,6 +2,8 @@
 
 #include "helpers.hpp"
 
+#include <memory>
+
 namespace far_memory {
 
 class ReaderWriterLock;
@@ -46,7 +48,8 @@ public:
 class ReaderWriterLock {
 private:
   bool writer_locked_ = false;
-  CachelineAligned(int32_t) reader_cnts_[helpers::kNumCPUs];
+  CachelineAligned(int32_t);
+  std::unique_ptr<CachelineAligned_int32_t[]> reader_cnts_;
 
 public:
   ReaderWriterLock();
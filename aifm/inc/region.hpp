@@ -47,6 +47,7 @@ public:
   ~Region();
   std::optional<uint64_t> allocate_object(uint16_t object_size);
   bool is_invalid() const;
+  uint32_t get_idx() const;
   void invalidate();
   void reset();
   bool is_local() const;
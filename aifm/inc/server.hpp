@@ -1,16 +1,45 @@
 #pragma once
 
 #include "internal/ds_info.hpp"
+#include "reader_writer_lock.hpp"
 #include "server_ds.hpp"
 
 #include <functional>
+#include <limits>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace far_memory {
 class Server {
 private:
+  // Snapshot file of a ds, <dir>/ds_<ds_id>:
+  //     |SnapshotHeader|Padding|State (state_len B)|
+  // The state starts at kSnapshotStateOffset so that it can be mmapped.
+  struct SnapshotHeader {
+    uint64_t magic;
+    uint8_t ds_type;
+    uint8_t param_len;
+    uint8_t params[std::numeric_limits<uint8_t>::max()];
+    uint64_t state_len;
+  };
+  constexpr static uint64_t kSnapshotMagic = 0x41494653534e4150ULL;
+  constexpr static uint64_t kSnapshotStateOffset = 4096;
+  static_assert(sizeof(SnapshotHeader) <= kSnapshotStateOffset);
+
   ServerDSFactory *registered_server_ds_factorys_[kMaxNumDSTypes];
-  static std::unique_ptr<ServerDS> server_ds_ptrs_[kMaxNumDSIDs];
+  std::unique_ptr<ServerDS> server_ds_ptrs_[kMaxNumDSIDs];
+  uint8_t ds_types_[kMaxNumDSIDs];
+  std::vector<uint8_t> ds_params_[kMaxNumDSIDs];
+  // Restored from a snapshot and not yet reattached by the client.
+  bool restored_[kMaxNumDSIDs] = {};
+  // Every request but compute_stream() holds the reader side, so that
+  // snapshot() takes a point-in-time copy of all ds under the writer side.
+  ReaderWriterLock quiesce_lock_;
+
+  static std::string get_snapshot_path(const std::string &dir, uint8_t ds_id);
+  bool snapshot_ds(const std::string &dir, uint8_t ds_id);
+  bool restore_ds(const std::string &dir, uint8_t ds_id);
 
 public:
   Server();
@@ -22,10 +51,29 @@ public:
                    uint16_t *data_len, uint8_t *data_buf);
   void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
                     uint16_t data_len, const uint8_t *data_buf);
+  bool read_object_zero_copy(
+      uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+      const std::function<void(const uint8_t *, uint16_t)> &f);
+  bool write_object_zero_copy(uint8_t ds_id, uint8_t obj_id_len,
+                              const uint8_t *obj_id, uint16_t data_len,
+                              const std::function<void(uint8_t *)> &f);
   bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
   void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                const uint8_t *input_buf, uint16_t *output_len,
                uint8_t *output_buf);
-  static ServerDS *get_server_ds(uint8_t ds_id);
+  void compute_stream(
+      uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+      const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &emit);
+  ServerDS *get_server_ds(uint8_t ds_id);
+  // Persists all ds into dir, replacing the previous snapshot. Returns false
+  // if some ds could not be snapshotted. Concurrent requests are held off
+  // until it returns, except for compute_stream(), which only reads.
+  bool snapshot(const std::string &dir);
+  // Loads the ds snapshotted into dir. A restored ds is reattached when the
+  // client constructs it again with the same ds_id, type and params; until
+  // then, discard_restored() drops it.
+  void restore(const std::string &dir);
+  void discard_restored();
 };
 } // namespace far_memory
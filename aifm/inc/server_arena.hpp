@@ -0,0 +1,75 @@
+#pragma once
+
+#include "sync.h"
+
+#include "helpers.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace far_memory {
+
+// ServerArena backs the memory of all server ds. It reserves a single virtual
+// region up front, advises it to use transparent hugepages, and binds it to
+// the NUMA node of the worker cores; pages are populated lazily on first
+// touch. Allocations of at least kMinArenaAllocSize are carved out of the
+// region at hugepage granularity and their pages are returned to the kernel
+// once freed; smaller ones are served by malloc(), whose internal
+// fragmentation is not worth a hugepage.
+class ServerArena {
+private:
+  constexpr static uint64_t kMinArenaAllocSize = helpers::kHugepageSize;
+
+  uint8_t *base_;
+  uint64_t capacity_;
+  uint32_t numa_node_;
+  rt::Mutex mutex_;
+  // Offset -> length of the free ranges, which are never adjacent.
+  std::map<uint64_t, uint64_t> free_ranges_;
+
+  bool is_in_arena(const void *ptr) const;
+
+public:
+  ServerArena(uint64_t capacity, uint32_t numa_node);
+  ~ServerArena();
+  // The arena of this process. It spans the physical memory of the host and
+  // binds to the NUMA node of the first core that calls get().
+  static ServerArena &get();
+  uint64_t get_capacity() const { return capacity_; }
+  uint32_t get_numa_node() const { return numa_node_; }
+  void *allocate(uint64_t size);
+  void free(void *ptr, uint64_t size);
+
+  // Lets STL containers allocate from the arena of this process. Elements are
+  // default-initialized rather than value-initialized, so that resizing a
+  // vector of trivial types does not touch (and thus populate) its pages.
+  template <typename T> class Allocator {
+  public:
+    using value_type = T;
+
+    Allocator() = default;
+    template <typename U> Allocator(const Allocator<U> &) {}
+    T *allocate(std::size_t n);
+    void deallocate(T *ptr, std::size_t n);
+    template <typename U> void construct(U *ptr);
+    template <typename U, typename... Args>
+    void construct(U *ptr, Args &&... args);
+    template <typename U> bool operator==(const Allocator<U> &) const {
+      return true;
+    }
+    template <typename U> bool operator!=(const Allocator<U> &) const {
+      return false;
+    }
+  };
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ServerArena::Allocator<T>>;
+
+} // namespace far_memory
+
+#include "internal/server_arena.ipp"
@@ -3,6 +3,7 @@
 #include "helpers.hpp"
 #include "reader_writer_lock.hpp"
 #include "server.hpp"
+#include "server_arena.hpp"
 
 #include <algorithm>
 #include <cstring>
@@ -15,6 +16,13 @@ namespace far_memory {
 template <typename T> class ServerDataFrameVector : public ServerDS {
 private:
   ReaderWriterLock lock_;
+  Server *server_;
+  // Whether the chunks are read in their DataFrameChunkCodec encoding. They
+  // are stored decoded anyway.
+  bool encoding_enabled_ = false;
+  // The size of the client's vector as of its last flush(), which vec_ does
+  // not track. It lets a client adopt the vector after a restore.
+  uint64_t client_size_ = 0;
   friend class ServerDataFrameVectorFactory;
 
   void compute_reserve(uint16_t input_len, const uint8_t *input_buf,
@@ -27,6 +35,18 @@ private:
                                    uint16_t *output_len, uint8_t *output_buf);
   void compute_assign(uint16_t input_len, const uint8_t *input_buf,
                       uint16_t *output_len, uint8_t *output_buf);
+  void compute_filter(uint16_t input_len, const uint8_t *input_buf,
+                      uint16_t *output_len, uint8_t *output_buf);
+  void compute_join(uint16_t input_len, const uint8_t *input_buf,
+                    uint16_t *output_len, uint8_t *output_buf);
+  void compute_set_encoding(uint16_t input_len, const uint8_t *input_buf,
+                            uint16_t *output_len, uint8_t *output_buf);
+  void compute_set_size(uint16_t input_len, const uint8_t *input_buf,
+                        uint16_t *output_len, uint8_t *output_buf);
+  void compute_get_size(uint16_t input_len, const uint8_t *input_buf,
+                        uint16_t *output_len, uint8_t *output_buf);
+  void compute_arg_sort(uint16_t input_len, const uint8_t *input_buf,
+                        uint16_t *output_len, uint8_t *output_buf);
   void compute_aggregate(uint8_t opcode, uint16_t input_len,
                          const uint8_t *input_buf, uint16_t *output_len,
                          uint8_t *output_buf);
@@ -35,24 +55,42 @@ private:
   _compute_aggregate(uint8_t opcode, uint8_t result_ds, uint8_t key_ds,
                      uint64_t size);
   template <typename U>
-  void _compute_unique(uint64_t vec_size, std::vector<U> &unique_vec);
+  void _compute_unique(uint64_t vec_size, ArenaVector<U> &unique_vec);
+  void compute_unique_stream(
+      uint64_t input_len, const uint8_t *input_buf,
+      const std::function<void(const uint8_t *, uint32_t)> &emit);
 
 public:
-  std::vector<T> vec_;
+  ArenaVector<T> vec_;
 
-  ServerDataFrameVector();
+  ServerDataFrameVector(Server *server);
   ~ServerDataFrameVector();
   void read_object(uint8_t obj_id_len, const uint8_t *obj_id,
                    uint16_t *data_len, uint8_t *data_buf);
   void write_object(uint8_t obj_id_len, const uint8_t *obj_id,
                     uint16_t data_len, const uint8_t *data_buf);
+  bool read_object_zero_copy(
+      uint8_t obj_id_len, const uint8_t *obj_id,
+      const std::function<void(const uint8_t *, uint16_t)> &f);
+  bool write_object_zero_copy(uint8_t obj_id_len, const uint8_t *obj_id,
+                              uint16_t data_len,
+                              const std::function<void(uint8_t *)> &f);
   bool remove_object(uint8_t obj_id_len, const uint8_t *obj_id);
   void compute(uint8_t opcode, uint16_t input_len, const uint8_t *input_buf,
                uint16_t *output_len, uint8_t *output_buf);
+  void
+  compute_stream(uint8_t opcode, uint64_t input_len, const uint8_t *input_buf,
+                 const std::function<void(const uint8_t *, uint32_t)> &emit);
+  bool snapshot(int fd);
+  bool restore(int fd, uint64_t offset, uint64_t len);
 };
 
 class ServerDataFrameVectorFactory : public ServerDSFactory {
+private:
+  Server *server_;
+
 public:
+  ServerDataFrameVectorFactory(Server *server);
   ServerDS *build(uint32_t param_len, uint8_t *params);
 };
 
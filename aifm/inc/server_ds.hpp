@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
 
 class ServerDS {
 public:
@@ -13,6 +17,43 @@ public:
   virtual void compute(uint8_t opcode, uint16_t input_len,
                        const uint8_t *input_buf, uint16_t *output_len,
                        uint8_t *output_buf) = 0;
+  // Zero-copy variants. They invoke f with the in-place object data (and
+  // keep it stable during the call); return false if unsupported so that the
+  // caller falls back to the copying variants.
+  virtual bool read_object_zero_copy(
+      uint8_t obj_id_len, const uint8_t *obj_id,
+      const std::function<void(const uint8_t *, uint16_t)> &f) {
+    return false;
+  }
+  virtual bool
+  write_object_zero_copy(uint8_t obj_id_len, const uint8_t *obj_id,
+                         uint16_t data_len,
+                         const std::function<void(uint8_t *)> &f) {
+    return false;
+  }
+  // Streaming variant of compute() without its 16-bit limits: the output is
+  // passed to emit chunk by chunk, as it is produced. By default it wraps
+  // compute() and emits its output as a single chunk.
+  virtual void
+  compute_stream(uint8_t opcode, uint64_t input_len, const uint8_t *input_buf,
+                 const std::function<void(const uint8_t *, uint32_t)> &emit) {
+    constexpr uint32_t kMaxLen = std::numeric_limits<uint16_t>::max();
+    assert(input_len <= kMaxLen);
+    uint16_t output_len;
+    std::unique_ptr<uint8_t[]> output_buf(new uint8_t[kMaxLen]);
+    compute(opcode, input_len, input_buf, &output_len, output_buf.get());
+    if (output_len) {
+      emit(output_buf.get(), output_len);
+    }
+  }
+  // Snapshot support. snapshot() appends the ds state to fd; restore() loads
+  // the len bytes of state that snapshot() wrote to fd at (page-aligned)
+  // offset into a freshly built ds. Both return false if unsupported. The
+  // caller makes sure that the ds is not accessed concurrently.
+  virtual bool snapshot(int fd) { return false; }
+  virtual bool restore(int fd, uint64_t offset, uint64_t len) {
+    return false;
+  }
 };
 
 class ServerDSFactory {
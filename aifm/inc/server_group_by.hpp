@@ -0,0 +1,80 @@
+#pragma once
+
+#include "dataframe_group_by.hpp"
+#include "server.hpp"
+#include "server_arena.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace far_memory {
+
+// The server side of DataFrameGroupBy. Rows are radix partitioned by the hash
+// of their key tuple into partitions that fit the cache, and then each
+// partition is grouped by its own open-addressing hash table and aggregated,
+// one partition per thread at a time. Groups never span partitions, so the
+// threads share no state beyond the prefix sum of their group counts.
+class ServerGroupBy {
+private:
+  constexpr static uint64_t kMinNumRowsPerThread = 1 << 16;
+  // Sized so that a partition's rows, hashes and hash table stay in L2.
+  constexpr static uint64_t kNumRowsPerPartition = 1 << 14;
+  constexpr static uint32_t kMaxNumPartitionBits = 12;
+  constexpr static uint32_t kInitTableSize = 1024;
+  constexpr static uint32_t kEmptySlot = static_cast<uint32_t>(-1);
+
+  struct Partition {
+    // Positions in rows_ and hashes_.
+    uint64_t begin;
+    uint64_t end;
+    // The index of the partition's first group in the output columns.
+    uint64_t group_offset;
+    // One row per group, the one that first had its key.
+    std::vector<uint64_t> rep_rows;
+    // The group of every row of the partition, relative to group_offset.
+    std::vector<uint32_t> row_groups;
+    std::vector<uint64_t> group_sizes;
+  };
+  // Returns whether rows a and b hold the same key in one key column.
+  using KeyEqualFn = std::function<bool(uint64_t a, uint64_t b)>;
+
+  Server *server_;
+  uint64_t num_rows_ = 0;
+  uint32_t num_threads_ = 1;
+  uint32_t num_partition_bits_ = 0;
+  uint64_t num_groups_ = 0;
+  std::unique_ptr<uint64_t[]> rows_;
+  std::unique_ptr<uint64_t[]> hashes_;
+  std::vector<Partition> partitions_;
+  std::vector<KeyEqualFn> key_equal_fns_;
+
+  uint64_t get_begin(uint32_t tid) const;
+  template <typename T> ArenaVector<T> &get_vec(uint8_t ds_id);
+  template <typename F> void for_each_partition(F &&f);
+  template <typename T> void hash_key_column(const T *data);
+  void partition();
+  void build_groups(Partition &partition);
+  // The fill functions return the capacity of the output column.
+  template <typename T>
+  uint64_t fill_key_column(const T *data, uint8_t out_ds_id);
+  template <typename T>
+  uint64_t fill_agg_column(const T *data, GroupByAggFn fn, uint8_t out_ds_id);
+  // Sets out[g] to init(partition, g) for every group g, and then calls
+  // update(out[g], row) for every row of g.
+  template <typename U, typename Init, typename Update>
+  uint64_t fold(uint8_t out_ds_id, Init &&init, Update &&update);
+
+public:
+  ServerGroupBy(Server *server);
+  // Input: |size(8B)|num_keys(1B)|num_aggs(1B)|keys|aggs|, where each key is
+  //        |ds_id(1B)|dt_id(1B)|out_ds_id(1B)| and each agg is
+  //        |ds_id(1B)|dt_id(1B)|fn(1B)|out_ds_id(1B)|.
+  // Output: |num_groups(8B)|, followed by the capacity(8B) of every output
+  //         column, keys first.
+  void compute(uint16_t input_len, const uint8_t *input_buf,
+               uint16_t *output_len, uint8_t *output_buf);
+};
+
+} // namespace far_memory
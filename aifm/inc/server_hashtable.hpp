@@ -22,6 +22,8 @@ public:
   bool remove_object(uint8_t obj_id_len, const uint8_t *obj_id);
   void compute(uint8_t opcode, uint16_t input_len, const uint8_t *input_buf,
                uint16_t *output_len, uint8_t *output_buf);
+  bool snapshot(int fd);
+  bool restore(int fd, uint64_t offset, uint64_t len);
 };
 
 class ServerHashTableFactory : public ServerDSFactory {
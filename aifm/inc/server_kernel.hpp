@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+namespace far_memory {
+
+// A kernel is a function compiled into the memory server that computes over
+// a batch of vanilla objects without shipping them to the client. It is
+// invoked through FarMemDevice::compute() on kVanillaPtrDSID (see
+// ServerPtr::compute()); objects[i] points to the data of the i-th requested
+// object and lens[i] is its length.
+using ServerKernel = void (*)(const uint8_t *args, uint16_t args_len,
+                              uint32_t num_objects,
+                              const uint8_t *const *objects,
+                              const uint16_t *lens, uint16_t *output_len,
+                              uint8_t *output_buf);
+
+class ServerKernelRegistry {
+private:
+  static std::unordered_map<std::string, ServerKernel> &get_kernels();
+
+public:
+  // Registration is meant to happen at static initialization time, see
+  // REGISTER_SERVER_KERNEL.
+  static bool register_kernel(const std::string &name, ServerKernel kernel);
+  // Returns nullptr if no such kernel.
+  static ServerKernel find(const std::string &name);
+};
+
+#define REGISTER_SERVER_KERNEL(name, kernel)                                   \
+  static bool __attribute__((unused)) kernel##_registered =                    \
+      far_memory::ServerKernelRegistry::register_kernel(name, kernel)
+
+// Built-in kernels. Each object holds one or more elements of the type given
+// by the args.
+//
+// "sum": args |type(1B)|, output |sum(8B)| of type KernelSum_t.
+// "find_first": args |op(1B)|type(1B)|value|, output |pos(4B)|, the position
+//     of the first object with an element satisfying op, or
+//     kKernelNotFound.
+// "filter": args |op(1B)|type(1B)|value|, output a bitmap with one bit per
+//     object, set if the object has an element satisfying op.
+// "search": args |pattern|, output a bitmap with one bit per object, set if
+//     the object data contains the byte pattern.
+constexpr static uint32_t kKernelNotFound = 0xFFFFFFFF;
+
+enum class KernelType : uint8_t {
+  Int8 = 0,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Int64,
+  UInt64,
+  Float,
+  Double
+};
+
+enum class KernelCmpOp : uint8_t { Eq = 0, Ne, Lt, Le, Gt, Ge };
+
+template <typename T> constexpr KernelType get_kernel_type() {
+  static_assert(std::is_arithmetic<T>::value);
+  if constexpr (std::is_same<T, float>::value) {
+    return KernelType::Float;
+  } else if constexpr (std::is_same<T, double>::value) {
+    return KernelType::Double;
+  } else {
+    static_assert(std::is_integral<T>::value && sizeof(T) <= 8);
+    constexpr uint8_t kLog2Size =
+        (sizeof(T) == 1) ? 0 : (sizeof(T) == 2) ? 1 : (sizeof(T) == 4) ? 2 : 3;
+    return static_cast<KernelType>(kLog2Size * 2 +
+                                   (std::is_signed<T>::value ? 0 : 1));
+  }
+}
+
+template <typename T> inline bool kernel_compare(KernelCmpOp op, T a, T b) {
+  switch (op) {
+  case KernelCmpOp::Eq:
+    return a == b;
+  case KernelCmpOp::Ne:
+    return a != b;
+  case KernelCmpOp::Lt:
+    return a < b;
+  case KernelCmpOp::Le:
+    return a <= b;
+  case KernelCmpOp::Gt:
+    return a > b;
+  case KernelCmpOp::Ge:
+    return a >= b;
+  default:
+    return false;
+  }
+}
+
+template <typename T>
+using KernelSum_t = std::conditional_t<
+    std::is_floating_point<T>::value, double,
+    std::conditional_t<std::is_signed<T>::value, int64_t, uint64_t>>;
+
+} // namespace far_memory
@@ -2,24 +2,40 @@
 
 #include "server_ds.hpp"
 
+#include <functional>
 #include <memory>
 
 namespace far_memory {
 class ServerPtr : public ServerDS {
 private:
-  std::unique_ptr<uint8_t> buf_;
+  uint64_t size_;
+  // Either allocated from ServerArena or, once restored, a private mapping of
+  // the snapshot.
+  std::unique_ptr<uint8_t, std::function<void(uint8_t *)>> buf_;
   friend class ServerPtrFactory;
 
 public:
+  // Runs a kernel of ServerKernelRegistry. Input:
+  // |name_len(1B)|name|args_len(2B)|args|obj_id(8B)|obj_id(8B)|...
+  constexpr static uint8_t kOpRunKernel = 0;
+
   ServerPtr(uint32_t param_len, uint8_t *params);
   ~ServerPtr();
   void read_object(uint8_t obj_id_len, const uint8_t *obj_id,
                    uint16_t *data_len, uint8_t *data_buf);
   void write_object(uint8_t obj_id_len, const uint8_t *obj_id,
                     uint16_t data_len, const uint8_t *data_buf);
+  bool read_object_zero_copy(
+      uint8_t obj_id_len, const uint8_t *obj_id,
+      const std::function<void(const uint8_t *, uint16_t)> &f);
+  bool write_object_zero_copy(uint8_t obj_id_len, const uint8_t *obj_id,
+                              uint16_t data_len,
+                              const std::function<void(uint8_t *)> &f);
   bool remove_object(uint8_t obj_id_len, const uint8_t *obj_id);
   void compute(uint8_t opcode, uint16_t input_len, const uint8_t *input_buf,
                uint16_t *output_len, uint8_t *output_buf);
+  bool snapshot(int fd);
+  bool restore(int fd, uint64_t offset, uint64_t len);
 };
 
 class ServerPtrFactory : public ServerDSFactory {
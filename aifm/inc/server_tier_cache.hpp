@@ -0,0 +1,97 @@
+#pragma once
+
+#include "sync.h"
+
+#include "server.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace far_memory {
+
+// The fast tier of TieredDevice, which constructs it in place of the vanilla
+// ptr ds of the fast device. It caches vanilla objects by their object ID
+// within a budget of fast_tier_size bytes, which it allocates object by
+// object, and tracks when each of them was last read so that the least
+// recently read ones can be demoted to the slow tier. Reading an object that
+// is not cached returns no data (data_len = 0).
+class ServerTierCache : public ServerDS {
+private:
+  constexpr static uint32_t kNumShards = 1024;
+  constexpr static double kDemoteHighWatermark = 0.9;
+  constexpr static double kDemoteLowWatermark = 0.8;
+
+  struct Entry {
+    uint8_t *data;
+    uint16_t data_len;
+    uint32_t last_access_epoch;
+    // Bumped on every put so that an eviction can detect concurrent puts.
+    uint32_t version;
+  };
+
+  struct Shard {
+    rt::Spin spin;
+    std::unordered_map<uint64_t, Entry> entries;
+  };
+
+  uint64_t capacity_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<uint64_t> used_size_;
+  uint32_t epoch_;
+  friend class ServerTierCacheFactory;
+
+  Shard *get_shard(uint64_t object_id);
+  void free_entry(const Entry &entry);
+  void compute_put(uint16_t input_len, const uint8_t *input_buf,
+                   uint16_t *output_len, uint8_t *output_buf);
+  void compute_evict(uint16_t input_len, const uint8_t *input_buf,
+                     uint16_t *output_len, uint8_t *output_buf);
+  void
+  compute_demote(const std::function<void(const uint8_t *, uint32_t)> &emit);
+
+public:
+  // Input: |obj_id(8B)|data|.
+  // Output: |stored(1B)|.
+  // Caches the object, unless that would exceed the budget.
+  constexpr static uint8_t kOpPut = 0;
+  // Input: |obj_id(8B)|version(4B)|...
+  // Output: |num_evicted(4B)|.
+  // Drops the objects that have not been put again since kOpDemote emitted
+  // them with the given versions.
+  constexpr static uint8_t kOpEvict = 1;
+  // Input: ||.
+  // Output: |used_size(8B)|.
+  constexpr static uint8_t kOpGetUsedSize = 2;
+  // Served by compute_stream() only, once per demotion interval.
+  // Input: ||.
+  // Output: a chunk of |obj_id(8B)|version(4B)|data_len(2B)|data| per object.
+  // Starts a new epoch. Once more than kDemoteHighWatermark of the budget is
+  // used, it emits the least recently read objects until the others fit in
+  // kDemoteLowWatermark of the budget; the caller evicts them with kOpEvict
+  // after it has written them to the slow tier.
+  constexpr static uint8_t kOpDemote = 3;
+  constexpr static uint32_t kDemoteHeaderSize =
+      sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t);
+
+  ServerTierCache(uint32_t param_len, uint8_t *params);
+  ~ServerTierCache();
+  void read_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                   uint16_t *data_len, uint8_t *data_buf);
+  void write_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                    uint16_t data_len, const uint8_t *data_buf);
+  bool remove_object(uint8_t obj_id_len, const uint8_t *obj_id);
+  void compute(uint8_t opcode, uint16_t input_len, const uint8_t *input_buf,
+               uint16_t *output_len, uint8_t *output_buf);
+  void
+  compute_stream(uint8_t opcode, uint64_t input_len, const uint8_t *input_buf,
+                 const std::function<void(const uint8_t *, uint32_t)> &emit);
+};
+
+class ServerTierCacheFactory : public ServerDSFactory {
+public:
+  ServerDS *build(uint32_t param_len, uint8_t *params);
+};
+
+} // namespace far_memory
@@ -6,14 +6,16 @@
 #include "helpers.hpp"
 
 #include <functional>
+#include <memory>
 
 namespace far_memory {
 template <typename T> class SharedPool {
 private:
   constexpr static uint32_t kNumCachedItemsPerCPU = 8;
 
-  alignas(64) CircularBuffer<T, /* sync = */ false,
-                             kNumCachedItemsPerCPU> cache_[helpers::kNumCPUs];
+  std::unique_ptr<
+      CircularBuffer<T, /* sync = */ false, kNumCachedItemsPerCPU>[]>
+      cache_;
   CircularBuffer<T, /* sync = */ false> global_pool_;
   rt::Spin global_spin_;
 
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <cstdint>
+
+namespace far_memory {
+
+// A lock-free single-producer single-consumer byte ring that lives in memory
+// shared between two processes. It carries a byte stream, so messages can be
+// larger than the ring itself as long as both ends make progress.
+class ShmRing {
+private:
+  alignas(64) uint64_t head_; // Only updated by the consumer.
+  alignas(64) uint64_t tail_; // Only updated by the producer.
+  alignas(64) uint32_t capacity_;
+
+  uint8_t *get_data();
+
+public:
+  // Returns the number of bytes needed to place a ring of the given capacity.
+  static uint64_t get_size(uint32_t capacity);
+  // Initializes the ring in place. Capacity must be a power of 2.
+  void init(uint32_t capacity);
+  // Non-blocking; return the number of bytes actually pushed/popped.
+  uint32_t push(const void *buf, uint32_t len);
+  uint32_t pop(void *buf, uint32_t len);
+  // Blocking; yield the current uthread while the ring is full/empty.
+  void push_until(const void *buf, uint32_t len);
+  void pop_until(void *buf, uint32_t len);
+};
+
+} // namespace far_memory
+
+#include "internal/shm_ring.ipp"
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "server_kernel.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace far_memory {
+
+// The inner loops of the offloaded DataFrameVector operations. Each kernel has
+// an AVX2 (or SSE2) path for the element types that fit it, which is picked at
+// compile time since the tree builds with -march=native, and a scalar one for
+// the rest. The arrays need not be aligned.
+namespace simd {
+
+// Sets dst[i] to src[idxs[i]], or to null_val if idxs[i] is null_idx, for every
+// i in [0, n).
+template <typename T>
+void gather(const T *src, const uint64_t *idxs, uint64_t n, uint64_t null_idx,
+            T null_val, T *dst);
+// n must be positive.
+template <typename T> T reduce_min(const T *data, uint64_t n);
+template <typename T> T reduce_max(const T *data, uint64_t n);
+template <typename T> KernelSum_t<T> reduce_sum(const T *data, uint64_t n);
+
+// An insert-only open-addressing hash set. Its slots come in groups of 16, each
+// with a control byte that holds 7 bits of the slot's hash or kEmpty, so that
+// a probe matches a whole group with one SSE2 compare and only looks at the
+// slots whose tag matches.
+template <typename T> class HashSet {
+private:
+  constexpr static uint32_t kGroupSize = 16;
+  constexpr static int8_t kEmpty = -128;
+  constexpr static uint64_t kMinNumGroups = 4;
+
+  std::unique_ptr<int8_t[]> ctrls_;
+  std::unique_ptr<T[]> slots_;
+  uint64_t num_groups_;
+  uint64_t size_ = 0;
+
+  uint32_t match(uint64_t group, int8_t tag) const;
+  void grow();
+
+public:
+  HashSet(uint64_t expected_size);
+  static uint64_t get_hash(const T &val);
+  // Returns whether val was not in the set yet. hash must be get_hash(val).
+  bool insert(const T &val, uint64_t hash);
+  uint64_t size() const;
+};
+
+} // namespace simd
+} // namespace far_memory
+
+#include "internal/simd_kernels.ipp"
@@ -22,7 +22,7 @@ private:
   uint64_t len_;
   uint8_t *cur_;
   rt::Spin spin_;
-  std::vector<uint8_t *> slabs_[helpers::kNumCPUs][kNumSlabClasses];
+  std::unique_ptr<std::vector<uint8_t *>[][kNumSlabClasses]> slabs_;
   friend class FarMemTest;
 
   static uint32_t get_slab_idx(uint32_t size);
@@ -20,7 +20,7 @@ private:
   static bool enable_swap_;
 #ifdef MONITOR_FREE_MEM_RATIO
   static std::vector<std::pair<uint64_t, double>>
-      free_mem_ratio_records_[helpers::kNumCPUs];
+      free_mem_ratio_records_[helpers::kMaxNumCPUs];
 #endif
 
 #ifdef MONITOR_READ_OBJECT_CYCLES
@@ -54,7 +54,7 @@ public:                                                                        \
 
 #define ADD_PER_CORE_STAT(type, x, enable_flag)                                \
 private:                                                                       \
-  static Cacheline x##_[helpers::kNumCPUs];                                    \
+  static Cacheline x##_[helpers::kMaxNumCPUs];                                 \
                                                                                \
 public:                                                                        \
   FORCE_INLINE static void inc_##x(type num) {                                 \
@@ -66,10 +66,19 @@ public:                                                                        \
   }                                                                            \
   FORCE_INLINE static type get_##x() {                                         \
     type sum = 0;                                                              \
-    FOR_ALL_SOCKET0_CORES(i) { sum += ACCESS_ONCE(*((type *)(x##_ + i))); }    \
+    FOR_ALL_CORES(i) { sum += ACCESS_ONCE(*((type *)(x##_ + i))); }            \
     return sum;                                                                \
   }
 
+  // Time (and times) mutators spend waiting for GC to free up the cache.
+  ADD_PER_CORE_STAT(uint64_t, mutator_stall_us, true)
+  ADD_PER_CORE_STAT(uint64_t, num_mutator_stalls, true)
+  // Reads that TCPDevice may hedge, the ones it did hedge, and the ones
+  // where the duplicate answered first (see TCPDevice::enable_hedged_reads()).
+  ADD_PER_CORE_STAT(uint64_t, num_hedgeable_reads, true)
+  ADD_PER_CORE_STAT(uint64_t, num_hedged_reads, true)
+  ADD_PER_CORE_STAT(uint64_t, num_hedge_wins, true)
+
   static void enable_swap();
   static void disable_swap();
   static void clear_free_mem_ratio_records();
@@ -6,6 +6,7 @@ SHENANGO_PATH=$AIFM_PATH/../shenango
 MEM_SERVER_DPDK_IP=18.18.1.3
 MEM_SERVER_PORT=8000
 MEM_SERVER_STACK_KB=65536
+SHM_SERVER_NAME=/aifm_shm
 
 source $AIFM_PATH/configs/ssh
 
@@ -84,6 +85,23 @@ function rerun_mem_server {
     run_mem_server
 }
 
+function kill_shm_server {
+    kill_process shm_device_serv
+}
+
+function run_shm_server {
+    sudo sh -c "ulimit -s $MEM_SERVER_STACK_KB; \
+                $AIFM_PATH/bin/shm_device_server $AIFM_PATH/configs/shm_server.config \
+                $SHM_SERVER_NAME" > /dev/null 2>&1 &
+    disown -r
+    sleep 3
+}
+
+function rerun_shm_server {
+    kill_shm_server
+    run_shm_server
+}
+
 function run_program {    
     sudo stdbuf -o0 sh -c "$1 $AIFM_PATH/configs/client.config \
                            $MEM_SERVER_DPDK_IP:$MEM_SERVER_PORT"
@@ -1,13 +1,19 @@
 #include "array.hpp"
+#include "device.hpp"
 #include "internal/ds_info.hpp"
 #include "manager.hpp"
 #include "pointer.hpp"
+#include "server_ptr.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 namespace far_memory {
 
 GenericArray::GenericArray(FarMemManager *manager, uint32_t item_size,
                            uint64_t num_items)
     : kNumItems_(num_items), kItemSize_(item_size),
+      device_(manager->get_device()),
       prefetcher_(manager->get_device(), reinterpret_cast<uint8_t *>(&ptrs_),
                   item_size) {
   preempt_disable();
@@ -35,4 +41,73 @@ void GenericArray::static_prefetch(Index_t start, Index_t step, uint32_t num) {
   prefetcher_.static_prefetch(start, step, num);
 }
 
+uint64_t GenericArray::get_prefetch_win_num_items() const {
+  return std::max<uint64_t>(1, device_->get_prefetch_win_size() / kItemSize_);
+}
+
+// Kernel input: |name_len(1B)|name|args_len(2B)|args|obj_id(8B)|...
+void GenericArray::scan(
+    const std::string &kernel, const std::vector<uint8_t> &args, Index_t start,
+    Index_t end,
+    const std::function<bool(Index_t, const uint8_t *)> &local_fn,
+    const std::function<bool(const Index_t *, uint32_t, const uint8_t *,
+                             uint16_t)> &remote_fn) {
+  BUG_ON(start > end || end > kNumItems_);
+  bool offload = device_->is_kernel_supported();
+
+  std::vector<uint8_t> input;
+  uint8_t name_len = kernel.size();
+  uint16_t args_len = args.size();
+  input.push_back(name_len);
+  input.insert(input.end(), kernel.begin(), kernel.end());
+  auto *args_len_ptr = reinterpret_cast<uint8_t *>(&args_len);
+  input.insert(input.end(), args_len_ptr, args_len_ptr + sizeof(args_len));
+  input.insert(input.end(), args.begin(), args.end());
+  auto header_len = input.size();
+  input.resize(header_len + kMaxKernelBatchSize * sizeof(uint64_t));
+  BUG_ON(input.size() > std::numeric_limits<uint16_t>::max());
+  std::unique_ptr<uint8_t[]> output(
+      offload ? new uint8_t[std::numeric_limits<uint16_t>::max()] : nullptr);
+  std::vector<Index_t> remote_idxs(kMaxKernelBatchSize);
+
+  for (Index_t window_start = start; window_start < end;
+       window_start += kMaxKernelBatchSize) {
+    auto window_end =
+        std::min(end, window_start + static_cast<Index_t>(kMaxKernelBatchSize));
+    uint32_t num_remote = 0;
+    bool proceed = true;
+    {
+      DerefScope scope;
+      for (auto idx = window_start; idx < window_end; idx++) {
+        // Snapshot the metadata as it may be swapped in concurrently.
+        FarMemPtrMeta meta = ptrs_[idx].meta();
+        if (!offload || meta.is_present()) {
+          auto *data = reinterpret_cast<const uint8_t *>(
+              ptrs_[idx]._deref</* Mut = */ false, /* Nt = */ false>());
+          proceed &= local_fn(idx, data);
+        } else {
+          auto obj_id = meta.get_object_id();
+          __builtin_memcpy(&input[header_len + num_remote * sizeof(obj_id)],
+                           &obj_id, sizeof(obj_id));
+          remote_idxs[num_remote++] = idx;
+        }
+      }
+    }
+    if (num_remote) {
+      uint16_t output_len;
+      {
+        auto ticket = device_->admit(TrafficClass::kCompute);
+        device_->compute(kVanillaPtrDSID, ServerPtr::kOpRunKernel,
+                         header_len + num_remote * sizeof(uint64_t),
+                         input.data(), &output_len, output.get());
+      }
+      proceed &= remote_fn(remote_idxs.data(), num_remote, output.get(),
+                           output_len);
+    }
+    if (!proceed) {
+      break;
+    }
+  }
+}
+
 } // namespace far_memory
@@ -0,0 +1,66 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/stddef.h>
+}
+
+#include "dataframe_group_by.hpp"
+#include "dataframe_vector.hpp"
+
+#include <memory>
+
+namespace far_memory {
+
+uint64_t DataFrameGroupBy::run() {
+  BUG_ON(keys_.empty());
+  auto *vec = keys_.front().vec;
+  uint64_t size = vec->size();
+  uint8_t num_keys = keys_.size();
+  uint8_t num_aggs = aggs_.size();
+  std::vector<uint8_t> input;
+  auto append = [&](const auto &val) {
+    auto offset = input.size();
+    input.resize(offset + sizeof(val));
+    __builtin_memcpy(input.data() + offset, &val, sizeof(val));
+  };
+  append(size);
+  append(num_keys);
+  append(num_aggs);
+  for (auto &key : keys_) {
+    BUG_ON(key.vec->size() < size);
+    key.vec->flush();
+    append(key.vec->ds_id_);
+    append(key.dt_id);
+    append(key.out->ds_id_);
+  }
+  for (auto &agg : aggs_) {
+    BUG_ON(agg.col.vec->size() < size);
+    agg.col.vec->flush();
+    append(agg.col.vec->ds_id_);
+    append(agg.col.dt_id);
+    append(agg.fn);
+    append(agg.col.out->ds_id_);
+  }
+  BUG_ON(input.size() > TCPDevice::kMaxComputeDataLen);
+
+  uint16_t output_len;
+  std::unique_ptr<uint64_t[]> output_data(
+      new uint64_t[1 + num_keys + num_aggs]);
+  {
+    auto ticket = vec->device_->admit(TrafficClass::kCompute);
+    vec->device_->compute(vec->ds_id_, GenericDataFrameVector::OpCode::GroupBy,
+                          input.size(), input.data(), &output_len,
+                          reinterpret_cast<uint8_t *>(output_data.get()));
+  }
+  assert(output_len == (1 + num_keys + num_aggs) * sizeof(uint64_t));
+  auto num_groups = output_data[0];
+  auto *capacities = &output_data[1];
+  for (auto &key : keys_) {
+    key.set_result(num_groups, *capacities++);
+  }
+  for (auto &agg : aggs_) {
+    agg.col.set_result(num_groups, *capacities++);
+  }
+  return num_groups;
+}
+
+} // namespace far_memory
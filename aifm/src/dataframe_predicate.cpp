@@ -0,0 +1,244 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/compiler.h>
+#include <base/stddef.h>
+}
+
+#include "dataframe_predicate.hpp"
+#include "dataframe_vector.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace far_memory {
+
+namespace {
+
+template <typename T> T read_val(const uint8_t *&buf, const uint8_t *end) {
+  T val;
+  BUG_ON(buf + sizeof(T) > end);
+  __builtin_memcpy(&val, buf, sizeof(T));
+  buf += sizeof(T);
+  return val;
+}
+
+// Only relies on operator< and operator==, which is all SimpleTime has.
+template <typename T, typename Fn>
+std::function<void(const uint8_t *, uint32_t, uint8_t *)> make_leaf_fn(Fn fn) {
+  return [=](const uint8_t *data, uint32_t len, uint8_t *mask) {
+    auto *elems = reinterpret_cast<const T *>(data);
+    for (uint32_t i = 0; i < len; i++) {
+      mask[i] = fn(elems[i]);
+    }
+  };
+}
+
+} // namespace
+
+DataFramePredicate
+DataFramePredicate::combine(Kind kind, const DataFramePredicate *rhs) const {
+  DataFramePredicate pred;
+  pred.append(kind);
+  pred.buf_.insert(pred.buf_.end(), buf_.begin(), buf_.end());
+  pred.columns_ = columns_;
+  if (rhs) {
+    pred.buf_.insert(pred.buf_.end(), rhs->buf_.begin(), rhs->buf_.end());
+    pred.columns_.insert(rhs->columns_.begin(), rhs->columns_.end());
+  }
+  return pred;
+}
+
+DataFramePredicate
+DataFramePredicate::operator&&(const DataFramePredicate &other) const {
+  return combine(Kind::And, &other);
+}
+
+DataFramePredicate
+DataFramePredicate::operator||(const DataFramePredicate &other) const {
+  return combine(Kind::Or, &other);
+}
+
+DataFramePredicate DataFramePredicate::operator!() const {
+  return combine(Kind::Not, nullptr);
+}
+
+void DataFramePredicate::flush_columns() const {
+  for (auto &[ds_id, column] : columns_) {
+    column.vec->flush();
+  }
+}
+
+uint64_t DataFramePredicate::get_min_column_size() const {
+  uint64_t min_size = std::numeric_limits<uint64_t>::max();
+  for (auto &[ds_id, column] : columns_) {
+    min_size = std::min(min_size, column.vec->size());
+  }
+  return min_size;
+}
+
+uint32_t DataFramePredicate::get_max_elem_size() const {
+  uint32_t max_elem_size = 0;
+  for (auto &[ds_id, column] : columns_) {
+    max_elem_size = std::max(max_elem_size, column.elem_size);
+  }
+  return max_elem_size;
+}
+
+DataFramePredicateEvaluator::DataFramePredicateEvaluator(const uint8_t *buf,
+                                                         uint32_t len) {
+  auto *end = buf + len;
+  parse(buf, end);
+  BUG_ON(buf != end);
+}
+
+uint32_t DataFramePredicateEvaluator::parse(const uint8_t *&buf,
+                                            const uint8_t *end) {
+  using Kind = DataFramePredicate::Kind;
+  auto node_idx = static_cast<uint32_t>(nodes_.size());
+  nodes_.emplace_back();
+  auto kind = read_val<Kind>(buf, end);
+  nodes_[node_idx].kind = kind;
+  switch (kind) {
+  case Kind::Cmp:
+  case Kind::Range:
+  case Kind::In: {
+    auto ds_id = read_val<uint8_t>(buf, end);
+    auto dt_id = read_val<uint8_t>(buf, end);
+    LeafFn leaf_fn;
+    visit_dataframe_type(dt_id, [&](auto *type_tag) {
+      using T = std::remove_pointer_t<decltype(type_tag)>;
+      leaf_fn = parse_leaf<T>(kind, buf, end);
+    });
+    auto &node = nodes_[node_idx];
+    node.ds_id = ds_id;
+    node.dt_id = dt_id;
+    node.leaf_fn = std::move(leaf_fn);
+    break;
+  }
+  case Kind::And:
+  case Kind::Or: {
+    auto lhs = parse(buf, end);
+    auto rhs = parse(buf, end);
+    auto &node = nodes_[node_idx];
+    node.children[0] = lhs;
+    node.children[1] = rhs;
+    node.scratch.resize(kBlockSize);
+    break;
+  }
+  case Kind::Not: {
+    auto child = parse(buf, end);
+    nodes_[node_idx].children[0] = child;
+    break;
+  }
+  default:
+    BUG();
+  }
+  return node_idx;
+}
+
+template <typename T>
+DataFramePredicateEvaluator::LeafFn
+DataFramePredicateEvaluator::parse_leaf(DataFramePredicate::Kind kind,
+                                        const uint8_t *&buf,
+                                        const uint8_t *end) {
+  using Kind = DataFramePredicate::Kind;
+  switch (kind) {
+  case Kind::Cmp: {
+    auto op = read_val<KernelCmpOp>(buf, end);
+    auto val = read_val<T>(buf, end);
+    switch (op) {
+    case KernelCmpOp::Eq:
+      return make_leaf_fn<T>([=](const T &x) { return x == val; });
+    case KernelCmpOp::Ne:
+      return make_leaf_fn<T>([=](const T &x) { return !(x == val); });
+    case KernelCmpOp::Lt:
+      return make_leaf_fn<T>([=](const T &x) { return x < val; });
+    case KernelCmpOp::Le:
+      return make_leaf_fn<T>([=](const T &x) { return !(val < x); });
+    case KernelCmpOp::Gt:
+      return make_leaf_fn<T>([=](const T &x) { return val < x; });
+    case KernelCmpOp::Ge:
+      return make_leaf_fn<T>([=](const T &x) { return !(x < val); });
+    default:
+      BUG();
+    }
+  }
+  case Kind::Range: {
+    auto lo = read_val<T>(buf, end);
+    auto hi = read_val<T>(buf, end);
+    return make_leaf_fn<T>(
+        [=](const T &x) { return !(x < lo) && !(hi < x); });
+  }
+  case Kind::In: {
+    auto num_vals = read_val<uint16_t>(buf, end);
+    std::vector<T> vals;
+    vals.reserve(num_vals);
+    for (uint16_t i = 0; i < num_vals; i++) {
+      vals.push_back(read_val<T>(buf, end));
+    }
+    std::sort(vals.begin(), vals.end());
+    return make_leaf_fn<T>([vals = std::move(vals)](const T &x) {
+      return std::binary_search(vals.begin(), vals.end(), x);
+    });
+  }
+  default:
+    BUG();
+  }
+}
+
+void DataFramePredicateEvaluator::eval(const ColumnLoader &loader,
+                                       uint64_t begin, uint32_t len,
+                                       uint8_t *mask) {
+  BUG_ON(len > kBlockSize);
+  eval(0, loader, begin, len, mask);
+}
+
+void DataFramePredicateEvaluator::eval(uint32_t node_idx,
+                                       const ColumnLoader &loader,
+                                       uint64_t begin, uint32_t len,
+                                       uint8_t *mask) {
+  using Kind = DataFramePredicate::Kind;
+  auto &node = nodes_[node_idx];
+  switch (node.kind) {
+  case Kind::Cmp:
+  case Kind::Range:
+  case Kind::In:
+    node.leaf_fn(loader(node.ds_id, node.dt_id, begin, len), len, mask);
+    break;
+  case Kind::And:
+  case Kind::Or: {
+    eval(node.children[0], loader, begin, len, mask);
+    // Skip the second child if the first one already decides every row.
+    bool decided = true;
+    for (uint32_t i = 0; i < len && decided; i++) {
+      decided = (mask[i] == (node.kind == Kind::Or));
+    }
+    if (decided) {
+      break;
+    }
+    auto *rhs_mask = node.scratch.data();
+    eval(node.children[1], loader, begin, len, rhs_mask);
+    if (node.kind == Kind::And) {
+      for (uint32_t i = 0; i < len; i++) {
+        mask[i] &= rhs_mask[i];
+      }
+    } else {
+      for (uint32_t i = 0; i < len; i++) {
+        mask[i] |= rhs_mask[i];
+      }
+    }
+    break;
+  }
+  case Kind::Not:
+    eval(node.children[0], loader, begin, len, mask);
+    for (uint32_t i = 0; i < len; i++) {
+      mask[i] = !mask[i];
+    }
+    break;
+  default:
+    BUG();
+  }
+}
+
+} // namespace far_memory
@@ -22,12 +22,12 @@ void GenericDataFrameVector::cleanup() {
     FarMemManagerFactory::get()->destruct(ds_id_);
   }
   std::vector<rt::Thread> threads;
-  for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
+  for (uint32_t tid = 0; tid < helpers::get_num_runtime_cores(); tid++) {
     threads.emplace_back(rt::Thread([&, tid]() {
       auto num_tasks_per_threads =
           (chunk_ptrs_.size() == 0)
               ? 0
-              : (chunk_ptrs_.size() - 1) / helpers::kNumCPUs + 1;
+              : (chunk_ptrs_.size() - 1) / helpers::get_num_runtime_cores() + 1;
       auto left = num_tasks_per_threads * tid;
       auto right = std::min(left + num_tasks_per_threads, chunk_ptrs_.size());
       for (uint64_t i = left; i < right; i++) {
@@ -43,13 +43,32 @@ void GenericDataFrameVector::cleanup() {
 void GenericDataFrameVector::reserve_remote(uint64_t num) {
   if (num > remote_vec_capacity_) {
     uint16_t output_len;
-    device_->compute(ds_id_, OpCode::Reserve, sizeof(num),
-                     reinterpret_cast<const uint8_t *>(&num), &output_len,
-                     reinterpret_cast<uint8_t *>(&remote_vec_capacity_));
+    {
+      auto ticket = device_->admit(TrafficClass::kCompute);
+      device_->compute(ds_id_, OpCode::Reserve, sizeof(num),
+                       reinterpret_cast<const uint8_t *>(&num), &output_len,
+                       reinterpret_cast<uint8_t *>(&remote_vec_capacity_));
+    }
     assert(output_len == sizeof(remote_vec_capacity_));
   }
 }
 
+void GenericDataFrameVector::adopt_remote() {
+  uint64_t output_data[2];
+  uint16_t output_len;
+  {
+    auto ticket = device_->admit(TrafficClass::kCompute);
+    device_->compute(ds_id_, OpCode::GetSize, 0, nullptr, &output_len,
+                     reinterpret_cast<uint8_t *>(output_data));
+  }
+  assert(output_len == sizeof(output_data));
+  size_ = flushed_size_ = output_data[0];
+  remote_vec_capacity_ = output_data[1];
+  expand_no_alloc((remote_vec_capacity_ == 0)
+                      ? 0
+                      : (remote_vec_capacity_ - 1) / chunk_num_entries_ + 1);
+}
+
 void GenericDataFrameVector::expand(uint64_t num) {
   auto old_chunk_ptrs_size = chunk_ptrs_.size();
   uint64_t new_capacity = (old_chunk_ptrs_size + num) * chunk_num_entries_;
@@ -58,10 +77,10 @@ void GenericDataFrameVector::expand(uint64_t num) {
   chunk_ptrs_.resize(old_chunk_ptrs_size + num);
 
   std::vector<rt::Thread> threads;
-  for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
+  for (uint32_t tid = 0; tid < helpers::get_num_runtime_cores(); tid++) {
     threads.emplace_back(rt::Thread([&, tid]() {
       auto num_tasks_per_threads =
-          (num == 0) ? 0 : (num - 1) / helpers::kNumCPUs + 1;
+          (num == 0) ? 0 : (num - 1) / helpers::get_num_runtime_cores() + 1;
       auto left = num_tasks_per_threads * tid;
       auto right = std::min(left + num_tasks_per_threads, num);
       for (uint64_t i = left; i < right; i++) {
@@ -88,10 +107,10 @@ void GenericDataFrameVector::expand_no_alloc(uint64_t num) {
 
   const auto obj_size = Object::kHeaderSize + chunk_size_ + sizeof(uint64_t);
   std::vector<rt::Thread> threads;
-  for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
+  for (uint32_t tid = 0; tid < helpers::get_num_runtime_cores(); tid++) {
     threads.emplace_back(rt::Thread([&, tid]() {
       auto num_tasks_per_threads =
-          (num == 0) ? 0 : (num - 1) / helpers::kNumCPUs + 1;
+          (num == 0) ? 0 : (num - 1) / helpers::get_num_runtime_cores() + 1;
       auto left = num_tasks_per_threads * tid;
       auto right = std::min(left + num_tasks_per_threads, num);
       for (uint64_t i = left; i < right; i++) {
@@ -106,19 +125,78 @@ void GenericDataFrameVector::expand_no_alloc(uint64_t num) {
   }
 }
 
+bool GenericDataFrameVector::read_remote_chunk(uint64_t chunk_idx,
+                                               uint8_t *buf) {
+  auto &meta = chunk_ptrs_[chunk_idx].meta();
+  if (meta.is_present()) {
+    return false;
+  }
+  uint64_t obj_id = chunk_idx;
+  // Keeps the chunk from being swapped in meanwhile, as in swap_in().
+  FarMemManager::lock_object(sizeof(obj_id),
+                             reinterpret_cast<const uint8_t *>(&obj_id));
+  auto guard = helpers::finally([&]() {
+    FarMemManager::unlock_object(sizeof(obj_id),
+                                 reinterpret_cast<const uint8_t *>(&obj_id));
+  });
+  if (meta.is_present()) {
+    return false;
+  }
+  uint16_t data_len;
+  FarMemManagerFactory::get()->read_object(
+      ds_id_, sizeof(obj_id), reinterpret_cast<const uint8_t *>(&obj_id),
+      &data_len, buf);
+  BUG_ON(data_len != chunk_size_);
+  return true;
+}
+
+bool GenericDataFrameVector::write_remote_chunk(uint64_t chunk_idx,
+                                                const uint8_t *buf) {
+  auto &meta = chunk_ptrs_[chunk_idx].meta();
+  if (meta.is_present()) {
+    return false;
+  }
+  uint64_t obj_id = chunk_idx;
+  FarMemManager::lock_object(sizeof(obj_id),
+                             reinterpret_cast<const uint8_t *>(&obj_id));
+  auto guard = helpers::finally([&]() {
+    FarMemManager::unlock_object(sizeof(obj_id),
+                                 reinterpret_cast<const uint8_t *>(&obj_id));
+  });
+  if (meta.is_present()) {
+    return false;
+  }
+  auto *manager = FarMemManagerFactory::get();
+  auto ticket = device_->admit(TrafficClass::kGCWrite);
+  manager->write_object_data(ds_id_, sizeof(obj_id),
+                             reinterpret_cast<const uint8_t *>(&obj_id),
+                             chunk_size_, buf);
+  return true;
+}
+
 void GenericDataFrameVector::flush() {
+  if (size_ != flushed_size_) {
+    uint16_t output_len;
+    {
+      auto ticket = device_->admit(TrafficClass::kCompute);
+      device_->compute(ds_id_, OpCode::SetSize, sizeof(size_),
+                       reinterpret_cast<const uint8_t *>(&size_), &output_len,
+                       nullptr);
+    }
+    assert(output_len == 0);
+    flushed_size_ = size_;
+  }
   if constexpr (!DISABLE_OFFLOAD) {
     if (!dirty_) {
       return;
     }
     dirty_ = false;
     std::vector<rt::Thread> threads;
-    for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
+    for (uint32_t tid = 0; tid < helpers::get_num_runtime_cores(); tid++) {
       threads.emplace_back(rt::Thread([&, tid]() {
+        auto num_cores = helpers::get_num_runtime_cores();
         auto num_tasks_per_threads =
-            (chunk_ptrs_.size() == 0)
-                ? 0
-                : (chunk_ptrs_.size() - 1) / helpers::kNumCPUs + 1;
+            chunk_ptrs_.empty() ? 0 : (chunk_ptrs_.size() - 1) / num_cores + 1;
         auto left = num_tasks_per_threads * tid;
         auto right = std::min(left + num_tasks_per_threads, chunk_ptrs_.size());
         for (uint64_t i = left; i < right; i++) {
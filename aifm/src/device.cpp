@@ -1,19 +1,50 @@
 extern "C" {
 #include <net/ip.h>
 #include <runtime/storage.h>
+#include <runtime/timer.h>
 }
 
 #include "device.hpp"
 #include "object.hpp"
+#include "region.hpp"
+#include "server_tier_cache.hpp"
 #include "stats.hpp"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace far_memory {
 
 FarMemDevice::FarMemDevice(uint64_t far_mem_size, uint32_t prefetch_win_size)
     : far_mem_size_(far_mem_size), prefetch_win_size_(prefetch_win_size) {}
 
+void FarMemDevice::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  BUG_ON(input_len > TCPDevice::kMaxComputeDataLen);
+  uint16_t output_len;
+  std::unique_ptr<uint8_t[]> output_buf(
+      new uint8_t[TCPDevice::kMaxComputeDataLen]);
+  compute(ds_id, opcode, input_len, input_buf, &output_len, output_buf.get());
+  if (output_len) {
+    consumer(output_buf.get(), output_len);
+  }
+}
+
+void FarMemDevice::enable_scheduler(uint32_t max_inflight) {
+  scheduler_.reset(new DeviceScheduler(max_inflight));
+}
+
+DeviceScheduler::Ticket FarMemDevice::admit(TrafficClass cls) {
+  return scheduler_ ? scheduler_->admit(cls) : DeviceScheduler::bypass(cls);
+}
+
 FakeDevice::FakeDevice(uint64_t far_mem_size)
     : FarMemDevice(far_mem_size, kPrefetchWinSize), server_() {
   server_.construct(kVanillaPtrDSType, kVanillaPtrDSID, sizeof(far_mem_size),
@@ -52,29 +83,40 @@ void FakeDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
   server_.compute(ds_id, opcode, input_len, input_buf, output_len, output_buf);
 }
 
+void FakeDevice::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  server_.compute_stream(ds_id, opcode, input_len, input_buf, consumer);
+}
+
 // Request:
-//     |OpCode = Init (1B)|Far Mem Size (8B)|
+//     |OpCode = Init (1B)|Far Mem Size (8B)|Reattach (1B)|
 // Response:
 //     |Ack (1B)|
 TCPDevice::TCPDevice(netaddr raddr, uint32_t num_connections,
-                     uint64_t far_mem_size)
+                     uint64_t far_mem_size, bool reattach)
     : FarMemDevice(far_mem_size, kPrefetchWinSize),
-      shared_pool_(num_connections) {
+      num_connections_(num_connections),
+      connections_(new Connection[num_connections]) {
   // Initialize the master connection.
   netaddr laddr = {.ip = MAKE_IP_ADDR(0, 0, 0, 0), .port = 0};
   BUG_ON(tcp_dial(laddr, raddr, &remote_master_) != 0);
-  char req[kOpcodeSize + sizeof(far_mem_size)];
+  char req[kOpcodeSize + sizeof(far_mem_size) + sizeof(reattach)];
   __builtin_memcpy(req, &kOpInit, kOpcodeSize);
   __builtin_memcpy(req + kOpcodeSize, &far_mem_size, sizeof(far_mem_size));
+  __builtin_memcpy(req + kOpcodeSize + sizeof(far_mem_size), &reattach,
+                   sizeof(reattach));
   helpers::tcp_write_until(remote_master_, req, sizeof(req));
   uint8_t ack;
   helpers::tcp_read_until(remote_master_, &ack, sizeof(ack));
 
   // Initialize slave connections.
-  tcpconn_t *remote_slave;
-  for (uint32_t i = 0; i < num_connections; i++) {
-    BUG_ON(tcp_dial(laddr, raddr, &remote_slave) != 0);
-    shared_pool_.push(remote_slave);
+  for (uint32_t i = 0; i < num_connections_; i++) {
+    auto *connection = &connections_[i];
+    BUG_ON(tcp_dial(laddr, raddr, &connection->conn) != 0);
+    connection->rx_thread =
+        rt::Thread([&, connection]() { receive(connection); });
   }
 
   construct(kVanillaPtrDSType, kVanillaPtrDSID, sizeof(far_mem_size),
@@ -92,242 +134,1406 @@ TCPDevice::~TCPDevice() {
   uint8_t ack;
   helpers::tcp_read_until(remote_master_, &ack, sizeof(ack));
   tcp_close(remote_master_);
-  shared_pool_.for_each([&](auto remote_slave) { tcp_close(remote_slave); });
+  for (uint32_t i = 0; i < num_connections_; i++) {
+    auto *connection = &connections_[i];
+    tcp_shutdown(connection->conn, SHUT_RDWR);
+    connection->rx_thread.Join();
+    tcp_close(connection->conn);
+  }
+}
+
+TCPDevice::Connection *TCPDevice::get_connection() {
+  return &connections_[get_core_num() % num_connections_];
+}
+
+void TCPDevice::receive(Connection *connection) {
+  uint8_t resp_header[kRespHeaderSize];
+  while (true) {
+    uint32_t received = 0;
+    while (received < kRespHeaderSize) {
+      auto ret = tcp_read(connection->conn, &resp_header[received],
+                          kRespHeaderSize - received);
+      if (ret <= 0) {
+        // The connection is shut down.
+        return;
+      }
+      received += ret;
+    }
+    auto *pending = *reinterpret_cast<Pending **>(&resp_header[0]);
+    auto len = *reinterpret_cast<uint32_t *>(&resp_header[kTagSize]);
+    if (pending->stream) {
+      auto *stream = pending->stream;
+      std::vector<uint8_t> chunk(len);
+      if (len) {
+        helpers::tcp_read_until(connection->conn, chunk.data(), len);
+      }
+      {
+        rt::ScopedLock<rt::Spin> lock(&stream->spin);
+        if (len) {
+          stream->chunks.emplace_back(std::move(chunk));
+        } else {
+          stream->done = true;
+        }
+        stream->cv.Signal();
+      }
+      if (!len) {
+        // The requester may return (and free pending) right after this.
+        pending->wg.Done();
+      }
+      continue;
+    }
+    if (pending->hedge) {
+      receive_hedged(connection, pending, len);
+      continue;
+    }
+    scatter(connection, pending, len);
+    pending->wg.Done();
+  }
+}
+
+void TCPDevice::scatter(Connection *connection, Pending *pending,
+                        uint32_t len) {
+  auto header_len = std::min(len, pending->header_len);
+  helpers::tcp_read_until(connection->conn, pending->header, header_len);
+  if (len > header_len) {
+    helpers::tcp_read_until(connection->conn, pending->data, len - header_len);
+  }
+}
+
+void TCPDevice::receive_hedged(Connection *connection, Pending *pending,
+                               uint32_t len) {
+  auto *hedge = pending->hedge;
+  bool won;
+  {
+    rt::ScopedLock<rt::Spin> lock(&hedge->spin);
+    won = !hedge->winner;
+    if (won) {
+      hedge->winner = pending;
+    }
+  }
+  if (won) {
+    scatter(connection, pending, len);
+  } else {
+    uint8_t buf[kDrainBufSize];
+    for (uint32_t drained = 0; drained < len;) {
+      auto drain_len = std::min(len - drained, kDrainBufSize);
+      helpers::tcp_read_until(connection->conn, buf, drain_len);
+      drained += drain_len;
+    }
+  }
+  pending->wg.Done();
+
+  bool last;
+  {
+    rt::ScopedLock<rt::Spin> lock(&hedge->spin);
+    if (won) {
+      hedge->done = true;
+      hedge->cv.Signal();
+    }
+    last = (--hedge->refcnt == 0);
+  }
+  if (last) {
+    delete hedge;
+  }
+}
+
+void TCPDevice::enable_hedged_reads(double percentile) {
+  BUG_ON(percentile <= 0 || percentile >= 1);
+  if (num_connections_ < 2) {
+    LOG_PRINTF("%s\n", "Warn: hedged reads need two connections or more.");
+    return;
+  }
+  latency_samples_.reset(new std::atomic<uint32_t>[kNumLatencySamples]);
+  hedge_percentile_ = percentile;
+}
+
+bool TCPDevice::is_hedgeable(uint8_t ds_id) const {
+#ifdef HASHTABLE_EXCLUSIVE
+  // Hashtable reads remove the kv pair, so only vanilla reads are idempotent.
+  if (ds_id != kVanillaPtrDSID) {
+    return false;
+  }
+#endif
+  return hedge_percentile_ > 0;
+}
+
+// The hedge delay is refreshed from the latest kNumLatencySamples samples
+// every time the sample buffer wraps around.
+void TCPDevice::record_read_latency(uint64_t latency_us) {
+  auto idx = num_latency_samples_++;
+  latency_samples_[idx % kNumLatencySamples] = latency_us;
+  if ((idx + 1) % kNumLatencySamples == 0) {
+    std::vector<uint32_t> samples(kNumLatencySamples);
+    for (uint32_t i = 0; i < kNumLatencySamples; i++) {
+      samples[i] = latency_samples_[i];
+    }
+    auto nth = samples.begin() + hedge_percentile_ * (kNumLatencySamples - 1);
+    std::nth_element(samples.begin(), nth, samples.end());
+    hedge_delay_us_ = std::max(*nth, static_cast<uint32_t>(1));
+  }
+}
+
+// req must reserve |Tag (8B)| right after the opcode; it is filled in here.
+void TCPDevice::send(Connection *connection, Pending *pending, uint8_t *req,
+                     uint32_t req_len, const uint8_t *payload,
+                     uint64_t payload_len) {
+  __builtin_memcpy(&req[kOpcodeSize], &pending, kTagSize);
+  rt::ScopedLock<rt::Mutex> lock(&connection->tx_mutex);
+  if (payload_len) {
+    helpers::tcp_write2_until(connection->conn, req, req_len, payload,
+                              payload_len);
+  } else {
+    helpers::tcp_write_until(connection->conn, req, req_len);
+  }
+}
+
+void TCPDevice::send_and_wait(Connection *connection, Pending *pending,
+                              uint8_t *req, uint32_t req_len,
+                              const uint8_t *payload, uint32_t payload_len) {
+  send(connection, pending, req, req_len, payload, payload_len);
+  pending->wg.Wait();
 }
 
 void TCPDevice::read_object(uint8_t ds_id, uint8_t obj_id_len,
                             const uint8_t *obj_id, uint16_t *data_len,
                             uint8_t *data_buf) {
-  auto remote_slave = shared_pool_.pop();
-  _read_object(remote_slave, ds_id, obj_id_len, obj_id, data_len, data_buf);
-  shared_pool_.push(remote_slave);
+  if (is_hedgeable(ds_id)) {
+    _hedged_read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+    return;
+  }
+  _read_object(get_connection(), ds_id, obj_id_len, obj_id, data_len,
+               data_buf);
 }
 
 void TCPDevice::write_object(uint8_t ds_id, uint8_t obj_id_len,
                              const uint8_t *obj_id, uint16_t data_len,
                              const uint8_t *data_buf) {
-  auto remote_slave = shared_pool_.pop();
-  _write_object(remote_slave, ds_id, obj_id_len, obj_id, data_len, data_buf);
-  shared_pool_.push(remote_slave);
+  _write_object(get_connection(), ds_id, obj_id_len, obj_id, data_len,
+                data_buf);
 }
 
 bool TCPDevice::remove_object(uint64_t ds_id, uint8_t obj_id_len,
                               const uint8_t *obj_id) {
-  auto remote_slave = shared_pool_.pop();
-  auto ret = _remove_object(remote_slave, ds_id, obj_id_len, obj_id);
-  shared_pool_.push(remote_slave);
-
-  return ret;
+  return _remove_object(get_connection(), ds_id, obj_id_len, obj_id);
 }
 
 void TCPDevice::construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                           uint8_t *params) {
-  auto remote_slave = shared_pool_.pop();
-  _construct(remote_slave, ds_type, ds_id, param_len, params);
-  shared_pool_.push(remote_slave);
+  _construct(get_connection(), ds_type, ds_id, param_len, params);
 }
 
-void TCPDevice::destruct(uint8_t ds_id) {
-  auto remote_slave = shared_pool_.pop();
-  _destruct(remote_slave, ds_id);
-  shared_pool_.push(remote_slave);
-}
+void TCPDevice::destruct(uint8_t ds_id) { _destruct(get_connection(), ds_id); }
 
 void TCPDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                         const uint8_t *input_buf, uint16_t *output_len,
                         uint8_t *output_buf) {
-  auto remote_slave = shared_pool_.pop();
-  _compute(remote_slave, ds_id, opcode, input_len, input_buf, output_len,
+  _compute(get_connection(), ds_id, opcode, input_len, input_buf, output_len,
            output_buf);
-  shared_pool_.push(remote_slave);
 }
 
+void TCPDevice::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  _compute_stream(get_connection(), ds_id, opcode, input_len, input_buf,
+                  consumer);
+}
+
+bool TCPDevice::snapshot() { return _snapshot(get_connection()); }
+
 // Request:
-// |Opcode = KOpReadObject(1B) | ds_id(1B) | obj_id_len(1B) | obj_id |
+// |Opcode = KOpReadObject(1B)|Tag(8B)|ds_id(1B)|obj_id_len(1B)|obj_id|
 // Response:
-// |data_len(2B)|data_buf(data_len B)|
-void TCPDevice::_read_object(tcpconn_t *remote_slave, uint8_t ds_id,
-                             uint8_t obj_id_len, const uint8_t *obj_id,
-                             uint16_t *data_len, uint8_t *data_buf) {
-  Stats::start_measure_read_object_cycles();
-  
-  uint8_t req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
-              Object::kMaxObjectIDSize];
+// |Tag(8B)|Len(4B)|data_len(2B)|data_buf(data_len B)|
+constexpr static uint32_t kMaxReadObjectReqLen =
+    TCPDevice::kOpcodeSize + TCPDevice::kTagSize + Object::kDSIDSize +
+    Object::kIDLenSize + Object::kMaxObjectIDSize;
 
+uint32_t TCPDevice::fill_read_object_req(uint8_t *req, uint8_t ds_id,
+                                         uint8_t obj_id_len,
+                                         const uint8_t *obj_id) {
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
   __builtin_memcpy(&req[0], &kOpReadObject, sizeof(kOpReadObject));
-  __builtin_memcpy(&req[kOpcodeSize], &ds_id, Object::kDSIDSize);
-  __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize], &obj_id_len,
+  __builtin_memcpy(&req[kHeaderSize], &ds_id, Object::kDSIDSize);
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize], &obj_id_len,
                    Object::kIDLenSize);
-  memcpy(&req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize], obj_id,
+  memcpy(&req[kHeaderSize + Object::kDSIDSize + Object::kIDLenSize], obj_id,
          obj_id_len);
+  return kHeaderSize + Object::kDSIDSize + Object::kIDLenSize + obj_id_len;
+}
+
+void TCPDevice::_read_object(Connection *connection, uint8_t ds_id,
+                             uint8_t obj_id_len, const uint8_t *obj_id,
+                             uint16_t *data_len, uint8_t *data_buf) {
+  Stats::start_measure_read_object_cycles();
 
-  helpers::tcp_write_until(remote_slave, req,
-                           kOpcodeSize + Object::kDSIDSize +
-                               Object::kIDLenSize + obj_id_len);
+  uint8_t req[kMaxReadObjectReqLen];
+  auto req_len = fill_read_object_req(req, ds_id, obj_id_len, obj_id);
 
-  helpers::tcp_read_until(remote_slave, data_len, sizeof(*data_len));
-  if (*data_len) {
-    helpers::tcp_read_until(remote_slave, data_buf, *data_len);
+  Pending pending;
+  pending.header = reinterpret_cast<uint8_t *>(data_len);
+  pending.header_len = sizeof(*data_len);
+  pending.data = data_buf;
+  send_and_wait(connection, &pending, req, req_len);
+
+  Stats::finish_measure_read_object_cycles();
+}
+
+// Same wire format as _read_object(). The read is sent on the connection of
+// the current core; if it is still outstanding after hedge_delay_us_, it is
+// duplicated on the next connection.
+void TCPDevice::_hedged_read_object(uint8_t ds_id, uint8_t obj_id_len,
+                                    const uint8_t *obj_id, uint16_t *data_len,
+                                    uint8_t *data_buf) {
+  Stats::start_measure_read_object_cycles();
+
+  uint8_t req[kMaxReadObjectReqLen];
+  auto req_len = fill_read_object_req(req, ds_id, obj_id_len, obj_id);
+
+  auto *hedge = new Hedge();
+  auto issue = [&](uint32_t idx, Connection *connection) {
+    auto *pending = new Pending();
+    pending->header = reinterpret_cast<uint8_t *>(data_len);
+    pending->header_len = sizeof(*data_len);
+    pending->data = data_buf;
+    pending->hedge = hedge;
+    {
+      rt::ScopedLock<rt::Spin> lock(&hedge->spin);
+      hedge->pendings[idx].reset(pending);
+      hedge->refcnt++;
+    }
+    send(connection, pending, req, req_len);
+  };
+
+  auto start_us = microtime();
+  auto hedge_delay_us = hedge_delay_us_.load();
+  auto connection_idx = get_core_num() % num_connections_;
+  issue(0, &connections_[connection_idx]);
+  Stats::inc_num_hedgeable_reads(1);
+
+  bool hedged = false;
+  if (hedge_delay_us != kNoHedgeDelay) {
+    while (true) {
+      {
+        rt::ScopedLock<rt::Spin> lock(&hedge->spin);
+        if (hedge->done) {
+          break;
+        }
+      }
+      if (microtime() - start_us >= hedge_delay_us) {
+        issue(1, &connections_[(connection_idx + 1) % num_connections_]);
+        Stats::inc_num_hedged_reads(1);
+        hedged = true;
+        break;
+      }
+      thread_yield();
+    }
   }
 
+  bool hedge_won;
+  bool last;
+  {
+    rt::ScopedLock<rt::Spin> lock(&hedge->spin);
+    while (!hedge->done) {
+      hedge->cv.Wait(&hedge->spin);
+    }
+    hedge_won = hedged && hedge->winner == hedge->pendings[1].get();
+    last = (--hedge->refcnt == 0);
+  }
+  if (last) {
+    delete hedge;
+  }
+  if (hedge_won) {
+    Stats::inc_num_hedge_wins(1);
+  }
+  record_read_latency(microtime() - start_us);
+
   Stats::finish_measure_read_object_cycles();
 }
 
 // Request:
-// |Opcode = KOpWriteObject (1B)|ds_id(1B)|obj_id_len(1B)|data_len(2B)|
-// |obj_id(obj_id_len B)|data_buf(data_len)|
+// |Opcode = KOpWriteObject (1B)|Tag(8B)|ds_id(1B)|obj_id_len(1B)|
+// |data_len(2B)|obj_id(obj_id_len B)|data_buf(data_len)|
 // Response:
-// |Ack (1B)|
-void TCPDevice::_write_object(tcpconn_t *remote_slave, uint8_t ds_id,
+// |Tag(8B)|Len(4B)|Ack (1B)|
+void TCPDevice::_write_object(Connection *connection, uint8_t ds_id,
                               uint8_t obj_id_len, const uint8_t *obj_id,
                               uint16_t data_len, const uint8_t *data_buf) {
   Stats::start_measure_write_object_cycles();
 
-  uint8_t req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
+  uint8_t req[kHeaderSize + Object::kDSIDSize + Object::kIDLenSize +
               Object::kDataLenSize + Object::kMaxObjectIDSize + kLargeDataSize];
 
   __builtin_memcpy(&req[0], &kOpWriteObject, sizeof(kOpWriteObject));
-  __builtin_memcpy(&req[kOpcodeSize], &ds_id, Object::kDSIDSize);
-  __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize], &obj_id_len,
+  __builtin_memcpy(&req[kHeaderSize], &ds_id, Object::kDSIDSize);
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize], &obj_id_len,
                    Object::kIDLenSize);
-  __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize],
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize + Object::kIDLenSize],
                    &data_len, Object::kDataLenSize);
-  memcpy(&req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
+  memcpy(&req[kHeaderSize + Object::kDSIDSize + Object::kIDLenSize +
               Object::kDataLenSize],
          obj_id, obj_id_len);
 
+  uint8_t ack;
+  Pending pending;
+  pending.header = &ack;
+  pending.header_len = sizeof(ack);
+  pending.data = nullptr;
+  auto req_len = kHeaderSize + Object::kDSIDSize + Object::kIDLenSize +
+                 Object::kDataLenSize + obj_id_len;
   if (likely(data_len <= kLargeDataSize)) {
-    memcpy(&req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
-                Object::kDataLenSize + obj_id_len],
-           data_buf, data_len);
-    helpers::tcp_write_until(remote_slave, req,
-                             kOpcodeSize + Object::kDSIDSize +
-                                 Object::kIDLenSize + Object::kDataLenSize +
-                                 obj_id_len + data_len);
+    memcpy(&req[req_len], data_buf, data_len);
+    send_and_wait(connection, &pending, req, req_len + data_len);
   } else {
-    helpers::tcp_write2_until(remote_slave, req,
-                              kOpcodeSize + Object::kDSIDSize +
-                                  Object::kIDLenSize + Object::kDataLenSize +
-                                  obj_id_len,
-                              data_buf, data_len);
+    send_and_wait(connection, &pending, req, req_len, data_buf, data_len);
   }
 
-  uint8_t ack;
-  helpers::tcp_read_until(remote_slave, &ack, sizeof(ack));
-
   Stats::finish_measure_write_object_cycles();
 }
 
 // Request:
-// |Opcode = kOpRemoveObject (1B)|ds_id(1B)|obj_id_len(1B)|obj_id(obj_id_len B)|
+// |Opcode = kOpRemoveObject (1B)|Tag(8B)|ds_id(1B)|obj_id_len(1B)|
+// |obj_id(obj_id_len B)|
 // Response:
-// |exists (1B)|
-bool TCPDevice::_remove_object(tcpconn_t *remote_slave, uint64_t ds_id,
+// |Tag(8B)|Len(4B)|exists (1B)|
+bool TCPDevice::_remove_object(Connection *connection, uint64_t ds_id,
                                uint8_t obj_id_len, const uint8_t *obj_id) {
-
-  uint8_t req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
+  uint8_t req[kHeaderSize + Object::kDSIDSize + Object::kIDLenSize +
               Object::kMaxObjectIDSize];
 
   __builtin_memcpy(&req[0], &kOpRemoveObject, sizeof(kOpRemoveObject));
-  __builtin_memcpy(&req[kOpcodeSize], &ds_id, Object::kDSIDSize);
-  __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize], &obj_id_len,
+  __builtin_memcpy(&req[kHeaderSize], &ds_id, Object::kDSIDSize);
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize], &obj_id_len,
                    Object::kIDLenSize);
-  memcpy(&req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize], obj_id,
+  memcpy(&req[kHeaderSize + Object::kDSIDSize + Object::kIDLenSize], obj_id,
          obj_id_len);
 
-  helpers::tcp_write_until(remote_slave, req,
-                           kOpcodeSize + Object::kDSIDSize +
-                               Object::kIDLenSize + obj_id_len);
-
   bool exists;
-  helpers::tcp_read_until(remote_slave, &exists, sizeof(exists));
+  Pending pending;
+  pending.header = reinterpret_cast<uint8_t *>(&exists);
+  pending.header_len = sizeof(exists);
+  pending.data = nullptr;
+  send_and_wait(connection, &pending, req,
+                kHeaderSize + Object::kDSIDSize + Object::kIDLenSize +
+                    obj_id_len);
 
   return exists;
 }
 
 // Request:
-// |Opcode = kOpConstruct (1B)|ds_type(1B)|ds_id(1B)|
+// |Opcode = kOpConstruct (1B)|Tag(8B)|ds_type(1B)|ds_id(1B)|
 // |param_len(1B)|params(param_len B)|
 // Response:
-// |Ack (1B)|
-void TCPDevice::_construct(tcpconn_t *remote_slave, uint8_t ds_type,
+// |Tag(8B)|Len(4B)|Ack (1B)|
+void TCPDevice::_construct(Connection *connection, uint8_t ds_type,
                            uint8_t ds_id, uint8_t param_len, uint8_t *params) {
-  uint8_t req[kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize +
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
+  uint8_t req[kHeaderSize + sizeof(ds_type) + Object::kDSIDSize +
               sizeof(param_len) +
               std::numeric_limits<decltype(param_len)>::max()];
 
   __builtin_memcpy(&req[0], &kOpConstruct, sizeof(kOpConstruct));
-  __builtin_memcpy(&req[kOpcodeSize], &ds_type, sizeof(ds_type));
-  __builtin_memcpy(&req[kOpcodeSize + sizeof(ds_type)], &ds_id,
+  __builtin_memcpy(&req[kHeaderSize], &ds_type, sizeof(ds_type));
+  __builtin_memcpy(&req[kHeaderSize + sizeof(ds_type)], &ds_id,
                    Object::kDSIDSize);
-  __builtin_memcpy(&req[kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize],
+  __builtin_memcpy(&req[kHeaderSize + sizeof(ds_type) + Object::kDSIDSize],
                    &param_len, sizeof(param_len));
 
-  memcpy(&req[kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize +
+  memcpy(&req[kHeaderSize + sizeof(ds_type) + Object::kDSIDSize +
               sizeof(param_len)],
          params, param_len);
-  helpers::tcp_write_until(remote_slave, req,
-                           kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize +
-                               sizeof(param_len) + param_len);
 
   uint8_t ack;
-  helpers::tcp_read_until(remote_slave, &ack, sizeof(ack));
+  Pending pending;
+  pending.header = &ack;
+  pending.header_len = sizeof(ack);
+  pending.data = nullptr;
+  send_and_wait(connection, &pending, req,
+                kHeaderSize + sizeof(ds_type) + Object::kDSIDSize +
+                    sizeof(param_len) + param_len);
 }
 
 // Request:
-// |Opcode = kOpDeconstruct (1B)|ds_id(1B)|
+// |Opcode = kOpDeconstruct (1B)|Tag(8B)|ds_id(1B)|
 // Response:
-// |Ack (1B)|
-void TCPDevice::_destruct(tcpconn_t *remote_slave, uint8_t ds_id) {
-  uint8_t req[kOpcodeSize + Object::kDSIDSize];
+// |Tag(8B)|Len(4B)|Ack (1B)|
+void TCPDevice::_destruct(Connection *connection, uint8_t ds_id) {
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
+  uint8_t req[kHeaderSize + Object::kDSIDSize];
 
   __builtin_memcpy(&req[0], &kOpDeconstruct, sizeof(kOpDeconstruct));
-  __builtin_memcpy(&req[kOpcodeSize], &ds_id, Object::kDSIDSize);
-
-  helpers::tcp_write_until(remote_slave, req, kOpcodeSize + Object::kDSIDSize);
+  __builtin_memcpy(&req[kHeaderSize], &ds_id, Object::kDSIDSize);
 
   uint8_t ack;
-  helpers::tcp_read_until(remote_slave, &ack, sizeof(ack));
+  Pending pending;
+  pending.header = &ack;
+  pending.header_len = sizeof(ack);
+  pending.data = nullptr;
+  send_and_wait(connection, &pending, req, kHeaderSize + Object::kDSIDSize);
 }
 
 // Request:
-// |Opcode = kOpCompute(1B)|ds_id(1B)|opcode(1B)|input_len(2B)|
+// |Opcode = kOpCompute(1B)|Tag(8B)|ds_id(1B)|opcode(1B)|input_len(2B)|
 // |input_buf(input_len)|
 // Response:
-// |output_len(2B)|output_buf(output_len B)|
-void TCPDevice::_compute(tcpconn_t *remote_slave, uint8_t ds_id, uint8_t opcode,
+// |Tag(8B)|Len(4B)|output_len(2B)|output_buf(output_len B)|
+void TCPDevice::_compute(Connection *connection, uint8_t ds_id, uint8_t opcode,
                          uint16_t input_len, const uint8_t *input_buf,
                          uint16_t *output_len, uint8_t *output_buf) {
   assert(input_len <= kMaxComputeDataLen);
-  uint8_t req[kOpcodeSize + Object::kDSIDSize + sizeof(opcode) +
-              +sizeof(input_len) + kLargeDataSize];
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
+  uint8_t req[kHeaderSize + Object::kDSIDSize + sizeof(opcode) +
+              sizeof(input_len) + kLargeDataSize];
 
-  __builtin_memcpy(&req[0], &kOpCompute, sizeof(kOpWriteObject));
-  __builtin_memcpy(&req[kOpcodeSize], &ds_id, Object::kDSIDSize);
-  __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize], &opcode,
+  __builtin_memcpy(&req[0], &kOpCompute, sizeof(kOpCompute));
+  __builtin_memcpy(&req[kHeaderSize], &ds_id, Object::kDSIDSize);
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize], &opcode,
                    sizeof(opcode));
-  __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize + sizeof(opcode)],
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize + sizeof(opcode)],
                    &input_len, sizeof(input_len));
 
+  Pending pending;
+  pending.header = reinterpret_cast<uint8_t *>(output_len);
+  pending.header_len = sizeof(*output_len);
+  pending.data = output_buf;
+  uint32_t req_len =
+      kHeaderSize + Object::kDSIDSize + sizeof(opcode) + sizeof(input_len);
   if (likely(input_len <= kLargeDataSize)) {
-    memcpy(&req[kOpcodeSize + Object::kDSIDSize + sizeof(opcode) +
-                sizeof(input_len)],
-           input_buf, input_len);
-    helpers::tcp_write_until(remote_slave, req,
-                             kOpcodeSize + Object::kDSIDSize + sizeof(opcode) +
-                                 sizeof(input_len) + input_len);
+    memcpy(&req[req_len], input_buf, input_len);
+    send_and_wait(connection, &pending, req, req_len + input_len);
+  } else {
+    send_and_wait(connection, &pending, req, req_len, input_buf, input_len);
+  }
+  assert(*output_len <= kMaxComputeDataLen);
+}
+
+// Request:
+// |Opcode = kOpComputeStream(1B)|Tag(8B)|ds_id(1B)|opcode(1B)|input_len(8B)|
+// |input_buf(input_len)|
+// Response:
+// |Tag(8B)|Len(4B)|chunk(Len B)|...|Tag(8B)|Len = 0 (4B)|
+void TCPDevice::_compute_stream(
+    Connection *connection, uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
+  uint8_t req[kHeaderSize + Object::kDSIDSize + sizeof(opcode) +
+              sizeof(input_len)];
+
+  __builtin_memcpy(&req[0], &kOpComputeStream, sizeof(kOpComputeStream));
+  __builtin_memcpy(&req[kHeaderSize], &ds_id, Object::kDSIDSize);
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize], &opcode,
+                   sizeof(opcode));
+  __builtin_memcpy(&req[kHeaderSize + Object::kDSIDSize + sizeof(opcode)],
+                   &input_len, sizeof(input_len));
+
+  Stream stream;
+  Pending pending;
+  pending.stream = &stream;
+  send(connection, &pending, req, sizeof(req), input_buf, input_len);
+
+  uint32_t num_unacked_bytes = 0;
+  while (true) {
+    std::vector<uint8_t> chunk;
+    bool done;
+    {
+      rt::ScopedLock<rt::Spin> lock(&stream.spin);
+      while (stream.chunks.empty() && !stream.done) {
+        stream.cv.Wait(&stream.spin);
+      }
+      if (stream.chunks.empty()) {
+        break;
+      }
+      chunk = std::move(stream.chunks.front());
+      stream.chunks.pop_front();
+      done = stream.done;
+    }
+    consumer(chunk.data(), chunk.size());
+    num_unacked_bytes += chunk.size();
+    // Once the response is complete, the server no longer needs credit.
+    if (num_unacked_bytes >= kStreamCreditBatchSize && !done) {
+      send_stream_credit(connection, &pending, num_unacked_bytes);
+      num_unacked_bytes = 0;
+    }
+  }
+  pending.wg.Wait();
+}
+
+// Request:
+// |Opcode = kOpStreamCredit (1B)|Tag(8B)|credit(4B)|
+// No response.
+void TCPDevice::send_stream_credit(Connection *connection, Pending *pending,
+                                   uint32_t credit) {
+  constexpr uint32_t kHeaderSize = kOpcodeSize + kTagSize;
+  uint8_t req[kHeaderSize + sizeof(credit)];
+
+  __builtin_memcpy(&req[0], &kOpStreamCredit, sizeof(kOpStreamCredit));
+  __builtin_memcpy(&req[kHeaderSize], &credit, sizeof(credit));
+  send(connection, pending, req, sizeof(req));
+}
+
+// Request:
+// |Opcode = kOpSnapshot (1B)|Tag(8B)|
+// Response:
+// |Tag(8B)|Len(4B)|succeed (1B)|
+bool TCPDevice::_snapshot(Connection *connection) {
+  uint8_t req[kOpcodeSize + kTagSize];
+
+  __builtin_memcpy(&req[0], &kOpSnapshot, sizeof(kOpSnapshot));
+
+  bool succeed;
+  Pending pending;
+  pending.header = reinterpret_cast<uint8_t *>(&succeed);
+  pending.header_len = sizeof(succeed);
+  pending.data = nullptr;
+  send_and_wait(connection, &pending, req, sizeof(req));
+
+  return succeed;
+}
+
+uint64_t ShmDevice::get_ring_offset(uint32_t ring_idx) {
+  auto header_size = align_up(sizeof(Header), 64);
+  auto ring_size = align_up(ShmRing::get_size(kRingCapacity), 64);
+  return header_size + ring_idx * ring_size;
+}
+
+uint64_t ShmDevice::get_arena_offset(uint32_t num_channels) {
+  return helpers::round_to_hugepage_size(get_ring_offset(2 * num_channels));
+}
+
+ShmDevice::Channel ShmDevice::get_channel(uint8_t *shm, uint32_t channel_idx) {
+  Channel channel;
+  channel.req =
+      reinterpret_cast<ShmRing *>(shm + get_ring_offset(2 * channel_idx));
+  channel.resp =
+      reinterpret_cast<ShmRing *>(shm + get_ring_offset(2 * channel_idx + 1));
+  return channel;
+}
+
+ShmDevice::ShmDevice(const std::string &shm_name, uint32_t num_channels,
+                     uint64_t far_mem_size)
+    : FarMemDevice(far_mem_size, kPrefetchWinSize), shm_name_(shm_name),
+      shared_pool_(num_channels) {
+  auto arena_offset = get_arena_offset(num_channels);
+  auto shm_size = arena_offset + helpers::round_to_hugepage_size(far_mem_size);
+
+  // Removes the stale segment left by a crashed client, if any.
+  shm_unlink(shm_name_.c_str());
+  int fd = shm_open(shm_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  BUG_ON(fd < 0);
+  BUG_ON(ftruncate(fd, shm_size) != 0);
+  auto ptr =
+      mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  BUG_ON(ptr == MAP_FAILED);
+  close(fd);
+  shm_ = reinterpret_cast<uint8_t *>(ptr);
+  arena_ = shm_ + arena_offset;
+
+  header_ = reinterpret_cast<Header *>(shm_);
+  header_->shm_size = shm_size;
+  header_->arena_offset = arena_offset;
+  header_->far_mem_size = far_mem_size;
+  header_->num_channels = num_channels;
+  header_->ring_capacity = kRingCapacity;
+  header_->shutdown = header_->server_attached = header_->server_exit = 0;
+
+  channels_.reset(new Channel[num_channels]);
+  for (uint32_t i = 0; i < num_channels; i++) {
+    channels_[i] = get_channel(shm_, i);
+    channels_[i].req->init(kRingCapacity);
+    channels_[i].resp->init(kRingCapacity);
+    shared_pool_.push(&channels_[i]);
+  }
+  memset(constructed_, 0, sizeof(constructed_));
+
+  // Publishes the segment to the server.
+  store_release(&header_->magic, kMagic);
+}
+
+ShmDevice::~ShmDevice() {
+  store_release(&header_->shutdown, 1);
+  if (load_acquire(&header_->server_attached)) {
+    while (!load_acquire(&header_->server_exit)) {
+      timer_sleep(kWaitServerExitUs);
+    }
+  }
+  munmap(shm_, header_->shm_size);
+  shm_unlink(shm_name_.c_str());
+}
+
+void ShmDevice::read_object(uint8_t ds_id, uint8_t obj_id_len,
+                            const uint8_t *obj_id, uint16_t *data_len,
+                            uint8_t *data_buf) {
+  if (!constructed_[ds_id]) {
+    // Vanilla ptr ds, read it from the arena directly.
+    Stats::start_measure_read_object_cycles();
+    assert(obj_id_len == sizeof(uint64_t));
+    auto object_id = *reinterpret_cast<const uint64_t *>(obj_id);
+    Object remote_object(reinterpret_cast<uint64_t>(arena_) + object_id);
+    *data_len = remote_object.get_data_len();
+    memcpy(data_buf, reinterpret_cast<uint8_t *>(remote_object.get_data_addr()),
+           *data_len);
+    Stats::finish_measure_read_object_cycles();
+    return;
+  }
+  auto channel = shared_pool_.pop();
+  _read_object(channel, ds_id, obj_id_len, obj_id, data_len, data_buf);
+  shared_pool_.push(channel);
+}
+
+void ShmDevice::write_object(uint8_t ds_id, uint8_t obj_id_len,
+                             const uint8_t *obj_id, uint16_t data_len,
+                             const uint8_t *data_buf) {
+  if (!constructed_[ds_id]) {
+    // Vanilla ptr ds, write it into the arena directly.
+    Stats::start_measure_write_object_cycles();
+    assert(obj_id_len == sizeof(uint64_t));
+    auto object_id = *reinterpret_cast<const uint64_t *>(obj_id);
+    Object remote_object(reinterpret_cast<uint64_t>(arena_) + object_id);
+    memcpy(reinterpret_cast<uint8_t *>(remote_object.get_data_addr()), data_buf,
+           data_len);
+    remote_object.set_data_len(data_len);
+    remote_object.set_obj_id_len(obj_id_len);
+    Stats::finish_measure_write_object_cycles();
+    return;
+  }
+  auto channel = shared_pool_.pop();
+  _write_object(channel, ds_id, obj_id_len, obj_id, data_len, data_buf);
+  shared_pool_.push(channel);
+}
+
+bool ShmDevice::remove_object(uint64_t ds_id, uint8_t obj_id_len,
+                              const uint8_t *obj_id) {
+  // The vanilla ptr ds does not support remove_object().
+  BUG_ON(!constructed_[ds_id]);
+  auto channel = shared_pool_.pop();
+  auto ret = _remove_object(channel, ds_id, obj_id_len, obj_id);
+  shared_pool_.push(channel);
+  return ret;
+}
+
+void ShmDevice::construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
+                          uint8_t *params) {
+  BUG_ON(ds_id == kVanillaPtrDSID);
+  auto channel = shared_pool_.pop();
+  _construct(channel, ds_type, ds_id, param_len, params);
+  shared_pool_.push(channel);
+  ACCESS_ONCE(constructed_[ds_id]) = true;
+}
+
+void ShmDevice::destruct(uint8_t ds_id) {
+  ACCESS_ONCE(constructed_[ds_id]) = false;
+  auto channel = shared_pool_.pop();
+  _destruct(channel, ds_id);
+  shared_pool_.push(channel);
+}
+
+void ShmDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+                        const uint8_t *input_buf, uint16_t *output_len,
+                        uint8_t *output_buf) {
+  auto channel = shared_pool_.pop();
+  _compute(channel, ds_id, opcode, input_len, input_buf, output_len,
+           output_buf);
+  shared_pool_.push(channel);
+}
+
+void ShmDevice::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  // The channel is released before running the consumer, which may issue
+  // requests itself.
+  std::vector<std::vector<uint8_t>> chunks;
+  auto channel = shared_pool_.pop();
+  _compute_stream(channel, ds_id, opcode, input_len, input_buf, &chunks);
+  shared_pool_.push(channel);
+  for (auto &chunk : chunks) {
+    consumer(chunk.data(), chunk.size());
+  }
+}
+
+// Request:
+// |Opcode = KOpReadObject(1B) | ds_id(1B) | obj_id_len(1B) | obj_id |
+// Response:
+// |data_len(2B)|data_buf(data_len B)|
+void ShmDevice::_read_object(Channel *channel, uint8_t ds_id,
+                             uint8_t obj_id_len, const uint8_t *obj_id,
+                             uint16_t *data_len, uint8_t *data_buf) {
+  Stats::start_measure_read_object_cycles();
+
+  uint8_t req[TCPDevice::kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize];
+  req[0] = TCPDevice::kOpReadObject;
+  req[TCPDevice::kOpcodeSize] = ds_id;
+  req[TCPDevice::kOpcodeSize + Object::kDSIDSize] = obj_id_len;
+  channel->req->push_until(req, sizeof(req));
+  channel->req->push_until(obj_id, obj_id_len);
+
+  channel->resp->pop_until(data_len, sizeof(*data_len));
+  channel->resp->pop_until(data_buf, *data_len);
+
+  Stats::finish_measure_read_object_cycles();
+}
+
+// Request:
+// |Opcode = KOpWriteObject (1B)|ds_id(1B)|obj_id_len(1B)|data_len(2B)|
+// |obj_id(obj_id_len B)|data_buf(data_len)|
+// Response:
+// |Ack (1B)|
+void ShmDevice::_write_object(Channel *channel, uint8_t ds_id,
+                              uint8_t obj_id_len, const uint8_t *obj_id,
+                              uint16_t data_len, const uint8_t *data_buf) {
+  Stats::start_measure_write_object_cycles();
+
+  uint8_t req[TCPDevice::kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
+              Object::kDataLenSize];
+  req[0] = TCPDevice::kOpWriteObject;
+  req[TCPDevice::kOpcodeSize] = ds_id;
+  req[TCPDevice::kOpcodeSize + Object::kDSIDSize] = obj_id_len;
+  __builtin_memcpy(
+      &req[TCPDevice::kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize],
+      &data_len, Object::kDataLenSize);
+  channel->req->push_until(req, sizeof(req));
+  channel->req->push_until(obj_id, obj_id_len);
+  channel->req->push_until(data_buf, data_len);
+
+  uint8_t ack;
+  channel->resp->pop_until(&ack, sizeof(ack));
+
+  Stats::finish_measure_write_object_cycles();
+}
+
+// Request:
+// |Opcode = kOpRemoveObject (1B)|ds_id(1B)|obj_id_len(1B)|obj_id(obj_id_len B)|
+// Response:
+// |exists (1B)|
+bool ShmDevice::_remove_object(Channel *channel, uint64_t ds_id,
+                               uint8_t obj_id_len, const uint8_t *obj_id) {
+  uint8_t req[TCPDevice::kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize];
+  req[0] = TCPDevice::kOpRemoveObject;
+  req[TCPDevice::kOpcodeSize] = ds_id;
+  req[TCPDevice::kOpcodeSize + Object::kDSIDSize] = obj_id_len;
+  channel->req->push_until(req, sizeof(req));
+  channel->req->push_until(obj_id, obj_id_len);
+
+  bool exists;
+  channel->resp->pop_until(&exists, sizeof(exists));
+  return exists;
+}
+
+// Request:
+// |Opcode = kOpConstruct (1B)|ds_type(1B)|ds_id(1B)|
+// |param_len(1B)|params(param_len B)|
+// Response:
+// |Ack (1B)|
+void ShmDevice::_construct(Channel *channel, uint8_t ds_type, uint8_t ds_id,
+                           uint8_t param_len, uint8_t *params) {
+  uint8_t req[TCPDevice::kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize +
+              sizeof(param_len)];
+  req[0] = TCPDevice::kOpConstruct;
+  req[TCPDevice::kOpcodeSize] = ds_type;
+  req[TCPDevice::kOpcodeSize + sizeof(ds_type)] = ds_id;
+  req[TCPDevice::kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize] =
+      param_len;
+  channel->req->push_until(req, sizeof(req));
+  channel->req->push_until(params, param_len);
+
+  uint8_t ack;
+  channel->resp->pop_until(&ack, sizeof(ack));
+}
+
+// Request:
+// |Opcode = kOpDeconstruct (1B)|ds_id(1B)|
+// Response:
+// |Ack (1B)|
+void ShmDevice::_destruct(Channel *channel, uint8_t ds_id) {
+  uint8_t req[TCPDevice::kOpcodeSize + Object::kDSIDSize];
+  req[0] = TCPDevice::kOpDeconstruct;
+  req[TCPDevice::kOpcodeSize] = ds_id;
+  channel->req->push_until(req, sizeof(req));
+
+  uint8_t ack;
+  channel->resp->pop_until(&ack, sizeof(ack));
+}
+
+// Request:
+// |Opcode = kOpCompute(1B)|ds_id(1B)|opcode(1B)|input_len(2B)|
+// |input_buf(input_len)|
+// Response:
+// |output_len(2B)|output_buf(output_len B)|
+void ShmDevice::_compute(Channel *channel, uint8_t ds_id, uint8_t opcode,
+                         uint16_t input_len, const uint8_t *input_buf,
+                         uint16_t *output_len, uint8_t *output_buf) {
+  uint8_t req[TCPDevice::kOpcodeSize + Object::kDSIDSize + sizeof(opcode) +
+              sizeof(input_len)];
+  req[0] = TCPDevice::kOpCompute;
+  req[TCPDevice::kOpcodeSize] = ds_id;
+  req[TCPDevice::kOpcodeSize + Object::kDSIDSize] = opcode;
+  __builtin_memcpy(
+      &req[TCPDevice::kOpcodeSize + Object::kDSIDSize + sizeof(opcode)],
+      &input_len, sizeof(input_len));
+  channel->req->push_until(req, sizeof(req));
+  channel->req->push_until(input_buf, input_len);
+
+  channel->resp->pop_until(output_len, sizeof(*output_len));
+  assert(*output_len <= TCPDevice::kMaxComputeDataLen);
+  channel->resp->pop_until(output_buf, *output_len);
+}
+
+// Request:
+// |Opcode = kOpComputeStream(1B)|ds_id(1B)|opcode(1B)|input_len(8B)|
+// |input_buf(input_len)|
+// Response:
+// |len(4B)|chunk(len B)|...|len = 0 (4B)|
+void ShmDevice::_compute_stream(Channel *channel, uint8_t ds_id,
+                                uint8_t opcode, uint64_t input_len,
+                                const uint8_t *input_buf,
+                                std::vector<std::vector<uint8_t>> *chunks) {
+  uint8_t req[TCPDevice::kOpcodeSize + Object::kDSIDSize + sizeof(opcode) +
+              sizeof(input_len)];
+  req[0] = TCPDevice::kOpComputeStream;
+  req[TCPDevice::kOpcodeSize] = ds_id;
+  req[TCPDevice::kOpcodeSize + Object::kDSIDSize] = opcode;
+  __builtin_memcpy(
+      &req[TCPDevice::kOpcodeSize + Object::kDSIDSize + sizeof(opcode)],
+      &input_len, sizeof(input_len));
+  channel->req->push_until(req, sizeof(req));
+  for (uint64_t pushed = 0; pushed < input_len;) {
+    auto len = std::min(input_len - pushed,
+                        static_cast<uint64_t>(ShmDevice::kRingCapacity));
+    channel->req->push_until(input_buf + pushed, len);
+    pushed += len;
+  }
+
+  while (true) {
+    uint32_t len;
+    channel->resp->pop_until(&len, sizeof(len));
+    if (!len) {
+      break;
+    }
+    chunks->emplace_back(len);
+    channel->resp->pop_until(chunks->back().data(), len);
+  }
+}
+
+StorageDevice::StorageDevice(std::optional<std::string> file_path,
+                             uint64_t far_mem_size)
+    : FarMemDevice(far_mem_size, kPrefetchWinSize), fd_(-1),
+      bounce_bufs_(kNumBounceBufs) {
+  if (file_path) {
+    block_size_ = kFileBlockSize;
+    num_blocks_ = (far_mem_size - 1) / block_size_ + 1;
+    fd_ = open(file_path->c_str(), O_RDWR | O_CREAT | O_DIRECT, 0600);
+    if (fd_ < 0 && errno == EINVAL) {
+      // The file system (e.g., tmpfs) does not support direct I/O.
+      fd_ = open(file_path->c_str(), O_RDWR | O_CREAT, 0600);
+    }
+    BUG_ON(fd_ < 0);
+    BUG_ON(ftruncate(fd_, num_blocks_ * block_size_) != 0);
+    io_uring_.reset(new IOUring(kIOUringNumEntries));
+  } else {
+    block_size_ = storage_block_size();
+    if (!block_size_) {
+      LOG_PRINTF("%s\n", "Warn: Shenango storage is unavailable.");
+      BUG();
+    }
+    num_blocks_ = (far_mem_size - 1) / block_size_ + 1;
+    BUG_ON(num_blocks_ > storage_num_blocks());
+  }
+
+  auto num_bitmap_words = (num_blocks_ - 1) / 64 + 1;
+  written_bitmap_.reset(new uint64_t[num_bitmap_words]);
+  memset(written_bitmap_.get(), 0, num_bitmap_words * sizeof(uint64_t));
+
+  preempt_disable();
+  wc_slots_.reset(new WCSlot[kNumWCSlots]);
+  for (uint32_t i = 0; i < kNumWCSlots; i++) {
+    wc_slots_[i].lba = kInvalidLBA;
+    wc_slots_[i].dirty = false;
+    BUG_ON(posix_memalign(reinterpret_cast<void **>(&wc_slots_[i].image),
+                          kFileBlockSize, block_size_));
+  }
+  for (uint32_t i = 0; i < kNumBounceBufs; i++) {
+    uint8_t *bounce_buf;
+    BUG_ON(posix_memalign(reinterpret_cast<void **>(&bounce_buf),
+                          kFileBlockSize, get_bounce_buf_size()));
+    bounce_bufs_.push(bounce_buf);
+  }
+  preempt_enable();
+
+  memset(constructed_, 0, sizeof(constructed_));
+}
+
+StorageDevice::~StorageDevice() {
+  for (uint32_t i = 0; i < kNumWCSlots; i++) {
+    free(wc_slots_[i].image);
+  }
+  bounce_bufs_.for_each([&](auto bounce_buf) { free(bounce_buf); });
+  io_uring_.reset();
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+uint64_t StorageDevice::get_bounce_buf_size() const {
+  // Large enough for the blocks spanned by any object.
+  return (Object::kMaxObjectSize / block_size_ + 2) * block_size_;
+}
+
+void StorageDevice::io_blocks(bool is_write, uint8_t *buf, uint64_t lba,
+                              uint32_t count) {
+  if (io_uring_) {
+    auto len = count * block_size_;
+    auto offset = lba * block_size_;
+    auto ret = is_write ? io_uring_->write(fd_, buf, len, offset)
+                        : io_uring_->read(fd_, buf, len, offset);
+    BUG_ON(ret != static_cast<int32_t>(len));
   } else {
-    helpers::tcp_write2_until(remote_slave, req,
-                              kOpcodeSize + Object::kDSIDSize + sizeof(opcode) +
-                                  sizeof(input_len),
-                              input_buf, input_len);
+    auto ret = is_write ? storage_write(buf, lba, count)
+                        : storage_read(buf, lba, count);
+    BUG_ON(ret != 0);
+  }
+}
+
+bool StorageDevice::is_written(uint64_t lba) const {
+  return ACCESS_ONCE(written_bitmap_[lba / 64]) & (1ULL << (lba % 64));
+}
+
+void StorageDevice::set_written(uint64_t lba) {
+  __atomic_fetch_or(&written_bitmap_[lba / 64], 1ULL << (lba % 64),
+                    __ATOMIC_RELAXED);
+}
+
+StorageDevice::WCSlot *StorageDevice::get_wc_slot(uint64_t lba) {
+  return &wc_slots_[lba % kNumWCSlots];
+}
+
+StorageDevice::WCSlot *StorageDevice::lock_wc_slot(uint64_t lba) {
+  auto *slot = get_wc_slot(lba);
+  slot->mutex.Lock();
+  return slot;
+}
+
+void StorageDevice::flush_wc_slot(WCSlot *slot) {
+  if (slot->dirty) {
+    io_blocks(/* is_write = */ true, slot->image, slot->lba, 1);
+    set_written(slot->lba);
+    slot->dirty = false;
+  }
+}
+
+// Returns the address of [offset, offset + len) inside bounce_buf. Blocks
+// staged in the write-combining buffer take precedence over the storage.
+uint8_t *StorageDevice::read_bytes(uint8_t *bounce_buf, uint64_t offset,
+                                   uint32_t len) {
+  auto first_lba = offset / block_size_;
+  uint32_t count = (offset + len - 1) / block_size_ - first_lba + 1;
+  assert(count * block_size_ <= get_bounce_buf_size());
+  assert(count <= kNumWCSlots);
+
+  // Slots of consecutive blocks are distinct and always locked in the LBA
+  // order, so it is deadlock-free. The slot of a block is a function of its
+  // LBA, so the locked slots need not be remembered.
+  bool all_hit = true;
+  for (uint32_t i = 0; i < count; i++) {
+    auto *slot = lock_wc_slot(first_lba + i);
+    all_hit &= (slot->lba == first_lba + i);
   }
+  if (!all_hit) {
+    io_blocks(/* is_write = */ false, bounce_buf, first_lba, count);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    auto *slot = get_wc_slot(first_lba + i);
+    if (slot->lba == first_lba + i) {
+      memcpy(bounce_buf + i * block_size_, slot->image, block_size_);
+    }
+    slot->mutex.Unlock();
+  }
+  return bounce_buf + offset % block_size_;
+}
+
+void StorageDevice::write_bytes(uint64_t offset, uint32_t len,
+                                const uint8_t *src) {
+  while (len) {
+    auto lba = offset / block_size_;
+    auto offset_in_block = offset % block_size_;
+    auto cur_len = std::min(len, static_cast<uint32_t>(block_size_ -
+                                                       offset_in_block));
+    auto *slot = lock_wc_slot(lba);
+    if (slot->lba != lba) {
+      flush_wc_slot(slot);
+      if (is_written(lba)) {
+        io_blocks(/* is_write = */ false, slot->image, lba, 1);
+      } else {
+        memset(slot->image, 0, block_size_);
+      }
+      slot->lba = lba;
+    }
+    memcpy(slot->image + offset_in_block, src, cur_len);
+    slot->dirty = true;
+    if (offset_in_block + cur_len == block_size_) {
+      // Remote objects are bump-allocated, so the block is likely full.
+      flush_wc_slot(slot);
+    }
+    slot->mutex.Unlock();
+    offset += cur_len;
+    src += cur_len;
+    len -= cur_len;
+  }
+}
+
+void StorageDevice::read_object(uint8_t ds_id, uint8_t obj_id_len,
+                                const uint8_t *obj_id, uint16_t *data_len,
+                                uint8_t *data_buf) {
+  if (constructed_[ds_id]) {
+    server_.read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+    return;
+  }
+  Stats::start_measure_read_object_cycles();
+  assert(obj_id_len == sizeof(uint64_t));
+  auto offset = *reinterpret_cast<const uint64_t *>(obj_id);
+  auto bounce_buf = bounce_bufs_.pop();
+
+  // Reads till the end of the first block, which covers most small objects.
+  auto first_len = std::max(block_size_ - offset % block_size_,
+                            static_cast<uint64_t>(Object::kDataLenSize));
+  auto *ptr = read_bytes(bounce_buf, offset, first_len);
+  __builtin_memcpy(data_len, ptr, Object::kDataLenSize);
+  auto cur_len = std::min(static_cast<uint64_t>(*data_len),
+                          first_len - Object::kDataLenSize);
+  memcpy(data_buf, ptr + Object::kDataLenSize, cur_len);
+  if (cur_len < *data_len) {
+    ptr = read_bytes(bounce_buf, offset + Object::kDataLenSize + cur_len,
+                     *data_len - cur_len);
+    memcpy(data_buf + cur_len, ptr, *data_len - cur_len);
+  }
+
+  bounce_bufs_.push(bounce_buf);
+  Stats::finish_measure_read_object_cycles();
+}
+
+void StorageDevice::write_object(uint8_t ds_id, uint8_t obj_id_len,
+                                 const uint8_t *obj_id, uint16_t data_len,
+                                 const uint8_t *data_buf) {
+  if (constructed_[ds_id]) {
+    server_.write_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+    return;
+  }
+  Stats::start_measure_write_object_cycles();
+  assert(obj_id_len == sizeof(uint64_t));
+  auto offset = *reinterpret_cast<const uint64_t *>(obj_id);
+  write_bytes(offset, Object::kDataLenSize,
+              reinterpret_cast<const uint8_t *>(&data_len));
+  write_bytes(offset + Object::kDataLenSize, data_len, data_buf);
+  Stats::finish_measure_write_object_cycles();
+}
+
+bool StorageDevice::remove_object(uint64_t ds_id, uint8_t obj_id_len,
+                                  const uint8_t *obj_id) {
+  // The vanilla ptr ds does not support remove_object().
+  BUG_ON(!constructed_[ds_id]);
+  return server_.remove_object(ds_id, obj_id_len, obj_id);
+}
+
+void StorageDevice::construct(uint8_t ds_type, uint8_t ds_id,
+                              uint8_t param_len, uint8_t *params) {
+  BUG_ON(ds_id == kVanillaPtrDSID);
+  server_.construct(ds_type, ds_id, param_len, params);
+  ACCESS_ONCE(constructed_[ds_id]) = true;
+}
+
+void StorageDevice::destruct(uint8_t ds_id) {
+  ACCESS_ONCE(constructed_[ds_id]) = false;
+  server_.destruct(ds_id);
+}
+
+void StorageDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+                            const uint8_t *input_buf, uint16_t *output_len,
+                            uint8_t *output_buf) {
+  server_.compute(ds_id, opcode, input_len, input_buf, output_len,
+                  output_buf);
+}
+
+void StorageDevice::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  server_.compute_stream(ds_id, opcode, input_len, input_buf, consumer);
+}
+
+TieredDevice::TieredDevice(FarMemDevice *fast_tier, FarMemDevice *slow_tier,
+                           uint64_t fast_tier_size)
+    : FarMemDevice(slow_tier->get_far_mem_size(),
+                   fast_tier->get_prefetch_win_size()),
+      num_demotions_(0), demoter_exit_(false) {
+  tiers_[kFast].reset(fast_tier);
+  tiers_[kSlow].reset(slow_tier);
+  for (auto &num_hits : num_hits_) {
+    num_hits = 0;
+  }
+  memset(constructed_, 0, sizeof(constructed_));
+  tiers_[kFast]->destruct(kVanillaPtrDSID);
+  tiers_[kFast]->construct(kTierCacheDSType, kVanillaPtrDSID,
+                           sizeof(fast_tier_size),
+                           reinterpret_cast<uint8_t *>(&fast_tier_size));
+  demoter_thread_.reset(new rt::Thread([&]() {
+    while (!ACCESS_ONCE(demoter_exit_)) {
+      timer_sleep(kDemoteIntervalUs);
+      demote();
+    }
+  }));
+}
+
+TieredDevice::~TieredDevice() {
+  ACCESS_ONCE(demoter_exit_) = true;
+  demoter_thread_->Join();
+}
+
+// Copies the objects that the fast tier picks to the slow tier first, and only
+// then evicts them from the fast tier, so that a read that misses the fast
+// tier always finds the object in the slow tier. An object that gets written
+// in the meantime stays in the fast tier.
+void TieredDevice::demote() {
+  std::vector<uint8_t> evict_records;
+  tiers_[kFast]->compute_stream(
+      kVanillaPtrDSID, ServerTierCache::kOpDemote, 0, nullptr,
+      [&](const uint8_t *record, uint32_t len) {
+        uint16_t data_len;
+        __builtin_memcpy(&data_len, record + kEvictRecordSize,
+                         sizeof(data_len));
+        assert(len == ServerTierCache::kDemoteHeaderSize + data_len);
+        tiers_[kSlow]->write_object(
+            kVanillaPtrDSID, sizeof(uint64_t), record, data_len,
+            record + ServerTierCache::kDemoteHeaderSize);
+        evict_records.insert(evict_records.end(), record,
+                             record + kEvictRecordSize);
+      });
+  uint64_t pos = 0;
+  while (pos < evict_records.size()) {
+    auto len = std::min<uint64_t>(
+        evict_records.size() - pos,
+        kMaxNumEvictRecordsPerCompute * kEvictRecordSize);
+    uint32_t num_evicted;
+    uint16_t output_len;
+    tiers_[kFast]->compute(kVanillaPtrDSID, ServerTierCache::kOpEvict, len,
+                           &evict_records[pos], &output_len,
+                           reinterpret_cast<uint8_t *>(&num_evicted));
+    assert(output_len == sizeof(num_evicted));
+    num_demotions_ += num_evicted;
+    pos += len;
+  }
+}
+
+uint64_t TieredDevice::get_fast_tier_used_size() {
+  uint64_t used_size;
+  uint16_t output_len;
+  tiers_[kFast]->compute(kVanillaPtrDSID, ServerTierCache::kOpGetUsedSize, 0,
+                         nullptr, &output_len,
+                         reinterpret_cast<uint8_t *>(&used_size));
+  assert(output_len == sizeof(used_size));
+  return used_size;
+}
+
+void TieredDevice::read_object(uint8_t ds_id, uint8_t obj_id_len,
+                               const uint8_t *obj_id, uint16_t *data_len,
+                               uint8_t *data_buf) {
+  tiers_[kFast]->read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+  if (constructed_[ds_id]) {
+    return;
+  }
+  if (*data_len) {
+    num_hits_[kFast]++;
+    return;
+  }
+  num_hits_[kSlow]++;
+  tiers_[kSlow]->read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+}
+
+void TieredDevice::write_object(uint8_t ds_id, uint8_t obj_id_len,
+                                const uint8_t *obj_id, uint16_t data_len,
+                                const uint8_t *data_buf) {
+  if (constructed_[ds_id]) {
+    tiers_[kFast]->write_object(ds_id, obj_id_len, obj_id, data_len,
+                                data_buf);
+    return;
+  }
+  assert(obj_id_len == sizeof(uint64_t));
+  uint8_t input[sizeof(uint64_t) + Object::kMaxObjectDataSize];
+  __builtin_memcpy(input, obj_id, sizeof(uint64_t));
+  memcpy(input + sizeof(uint64_t), data_buf, data_len);
+  while (true) {
+    bool stored;
+    uint16_t output_len;
+    tiers_[kFast]->compute(kVanillaPtrDSID, ServerTierCache::kOpPut,
+                           sizeof(uint64_t) + data_len, input, &output_len,
+                           reinterpret_cast<uint8_t *>(&stored));
+    assert(output_len == sizeof(stored));
+    if (likely(stored)) {
+      return;
+    }
+    // The fast tier is full until the demoter catches up.
+    timer_sleep(kDemoteIntervalUs);
+  }
+}
+
+bool TieredDevice::remove_object(uint64_t ds_id, uint8_t obj_id_len,
+                                 const uint8_t *obj_id) {
+  return tiers_[kFast]->remove_object(ds_id, obj_id_len, obj_id);
+}
+
+void TieredDevice::construct(uint8_t ds_type, uint8_t ds_id,
+                             uint8_t param_len, uint8_t *params) {
+  BUG_ON(ds_id == kVanillaPtrDSID);
+  tiers_[kFast]->construct(ds_type, ds_id, param_len, params);
+  ACCESS_ONCE(constructed_[ds_id]) = true;
+}
+
+void TieredDevice::destruct(uint8_t ds_id) {
+  ACCESS_ONCE(constructed_[ds_id]) = false;
+  tiers_[kFast]->destruct(ds_id);
+}
+
+void TieredDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+                           const uint8_t *input_buf, uint16_t *output_len,
+                           uint8_t *output_buf) {
+  tiers_[kFast]->compute(ds_id, opcode, input_len, input_buf, output_len,
+                         output_buf);
+}
+
+void TieredDevice::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  tiers_[kFast]->compute_stream(ds_id, opcode, input_len, input_buf,
+                                consumer);
+}
+
+static uint64_t
+get_sharded_far_mem_size(const std::vector<FarMemDevice *> &shards) {
+  BUG_ON(shards.empty());
+  uint64_t min_shard_size = std::numeric_limits<uint64_t>::max();
+  for (auto shard : shards) {
+    min_shard_size = std::min(min_shard_size, shard->get_far_mem_size());
+  }
+  auto num_stripes_per_shard = min_shard_size / ShardedDevice::kStripeSize;
+  BUG_ON(!num_stripes_per_shard);
+  return num_stripes_per_shard * ShardedDevice::kStripeSize * shards.size();
+}
+
+static uint32_t
+get_sharded_prefetch_win_size(const std::vector<FarMemDevice *> &shards) {
+  uint32_t prefetch_win_size = std::numeric_limits<uint32_t>::max();
+  for (auto shard : shards) {
+    prefetch_win_size =
+        std::min(prefetch_win_size, shard->get_prefetch_win_size());
+  }
+  return prefetch_win_size;
+}
 
-  helpers::tcp_read_until(remote_slave, output_len, sizeof(*output_len));
-  if (*output_len) {
-    assert(*output_len <= kMaxComputeDataLen);
-    helpers::tcp_read_until(remote_slave, output_buf, *output_len);
+ShardedDevice::ShardedDevice(const std::vector<FarMemDevice *> &shards)
+    : FarMemDevice(get_sharded_far_mem_size(shards),
+                   get_sharded_prefetch_win_size(shards)),
+      next_shard_(0) {
+  static_assert(kStripeSize % Region::kSize == 0);
+  BUG_ON(shards.size() > kUnplaced);
+  for (auto shard : shards) {
+    shards_.emplace_back(shard);
   }
+  // Each shard has already constructed its own vanilla ptr ds, which
+  // ShardedDevice exposes as the concatenation of all stripes.
+  memset(ds_shards_, kUnplaced, sizeof(ds_shards_));
+}
+
+uint32_t ShardedDevice::get_shard_idx(uint8_t ds_id, uint8_t obj_id_len,
+                                      const uint8_t *obj_id) const {
+  auto shard_idx = ds_shards_[ds_id];
+  if (shard_idx != kUnplaced) {
+    return shard_idx;
+  }
+  // Falls back to the vanilla ptr ds, same as Server does.
+  assert(obj_id_len == sizeof(uint64_t));
+  auto stripe = *reinterpret_cast<const uint64_t *>(obj_id) >> kStripeShift;
+  return stripe % shards_.size();
+}
+
+FarMemDevice *ShardedDevice::route(uint8_t ds_id, uint8_t obj_id_len,
+                                   const uint8_t **obj_id,
+                                   uint64_t *shard_obj_id) {
+  auto shard_idx = get_shard_idx(ds_id, obj_id_len, *obj_id);
+  if (ds_shards_[ds_id] == kUnplaced) {
+    // Translates the global remote address into the shard-local one.
+    auto remote_addr = *reinterpret_cast<const uint64_t *>(*obj_id);
+    auto stripe = remote_addr >> kStripeShift;
+    *shard_obj_id = ((stripe / shards_.size()) << kStripeShift) |
+                    (remote_addr & (kStripeSize - 1));
+    *obj_id = reinterpret_cast<const uint8_t *>(shard_obj_id);
+  }
+  return shards_[shard_idx].get();
+}
+
+void ShardedDevice::read_object(uint8_t ds_id, uint8_t obj_id_len,
+                                const uint8_t *obj_id, uint16_t *data_len,
+                                uint8_t *data_buf) {
+  uint64_t shard_obj_id;
+  auto shard = route(ds_id, obj_id_len, &obj_id, &shard_obj_id);
+  shard->read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+}
+
+void ShardedDevice::write_object(uint8_t ds_id, uint8_t obj_id_len,
+                                 const uint8_t *obj_id, uint16_t data_len,
+                                 const uint8_t *data_buf) {
+  uint64_t shard_obj_id;
+  auto shard = route(ds_id, obj_id_len, &obj_id, &shard_obj_id);
+  shard->write_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+}
+
+bool ShardedDevice::remove_object(uint64_t ds_id, uint8_t obj_id_len,
+                                  const uint8_t *obj_id) {
+  uint64_t shard_obj_id;
+  auto shard = route(ds_id, obj_id_len, &obj_id, &shard_obj_id);
+  return shard->remove_object(ds_id, obj_id_len, obj_id);
+}
+
+void ShardedDevice::construct(uint8_t ds_type, uint8_t ds_id,
+                              uint8_t param_len, uint8_t *params) {
+  BUG_ON(ds_id == kVanillaPtrDSID);
+  BUG_ON(ds_shards_[ds_id] != kUnplaced);
+  uint32_t shard_idx;
+  if (ds_type == kDataFrameVectorDSType) {
+    shard_idx = kDataFrameVectorShard;
+  } else {
+    shard_idx = __atomic_fetch_add(&next_shard_, 1, __ATOMIC_RELAXED) %
+                shards_.size();
+  }
+  shards_[shard_idx]->construct(ds_type, ds_id, param_len, params);
+  ACCESS_ONCE(ds_shards_[ds_id]) = shard_idx;
+}
+
+void ShardedDevice::destruct(uint8_t ds_id) {
+  auto shard_idx = ds_shards_[ds_id];
+  BUG_ON(shard_idx == kUnplaced);
+  ACCESS_ONCE(ds_shards_[ds_id]) = kUnplaced;
+  shards_[shard_idx]->destruct(ds_id);
+}
+
+void ShardedDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
+                            const uint8_t *input_buf, uint16_t *output_len,
+                            uint8_t *output_buf) {
+  auto shard_idx = ds_shards_[ds_id];
+  BUG_ON(shard_idx == kUnplaced);
+  shards_[shard_idx]->compute(ds_id, opcode, input_len, input_buf, output_len,
+                              output_buf);
+}
+
+void ShardedDevice::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &consumer) {
+  auto shard_idx = ds_shards_[ds_id];
+  BUG_ON(shard_idx == kUnplaced);
+  shards_[shard_idx]->compute_stream(ds_id, opcode, input_len, input_buf,
+                                     consumer);
 }
 
 } // namespace far_memory
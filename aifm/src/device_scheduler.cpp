@@ -0,0 +1,124 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/compiler.h>
+#include <base/stddef.h>
+#include <base/time.h>
+}
+
+#include "device_scheduler.hpp"
+
+#include <limits>
+
+namespace far_memory {
+
+DeviceScheduler::Ticket::Ticket(DeviceScheduler *scheduler, TrafficClass cls,
+                                uint64_t enqueue_us, uint64_t admit_us)
+    : scheduler_(scheduler), cls_(cls), enqueue_us_(enqueue_us),
+      admit_us_(admit_us) {}
+
+DeviceScheduler::Ticket::Ticket(Ticket &&other)
+    : scheduler_(other.scheduler_), cls_(other.cls_),
+      enqueue_us_(other.enqueue_us_), admit_us_(other.admit_us_) {
+  other.scheduler_ = nullptr;
+}
+
+DeviceScheduler::Ticket::~Ticket() {
+  if (scheduler_) {
+    scheduler_->release(cls_, admit_us_, enqueue_us_);
+  }
+}
+
+DeviceScheduler::DeviceScheduler(uint32_t max_inflight)
+    : max_inflight_(max_inflight) {
+  BUG_ON(!max_inflight_);
+}
+
+DeviceScheduler::Ticket DeviceScheduler::admit(TrafficClass cls) {
+  auto cls_idx = static_cast<uint32_t>(cls);
+  auto enqueue_us = microtime();
+  Waiter waiter;
+  {
+    rt::ScopedLock<rt::Spin> lock(&spin_);
+    bool queued = false;
+    for (auto &queue : queues_) {
+      queued |= !queue.empty();
+    }
+    if (num_inflight_ < max_inflight_ && !queued) {
+      num_inflight_++;
+      return Ticket(this, cls, enqueue_us, enqueue_us);
+    }
+    waiter.enqueue_us = enqueue_us;
+    queues_[cls_idx].push_back(&waiter);
+    while (!waiter.admitted) {
+      waiter.cv.Wait(&spin_);
+    }
+  }
+  return Ticket(this, cls, enqueue_us, microtime());
+}
+
+DeviceScheduler::Ticket DeviceScheduler::bypass(TrafficClass cls) {
+  return Ticket(nullptr, cls, 0, 0);
+}
+
+void DeviceScheduler::release(TrafficClass cls, uint64_t admit_us,
+                              uint64_t enqueue_us) {
+  auto now_us = microtime();
+  auto &stats = stats_[static_cast<uint32_t>(cls)];
+  stats.num_requests++;
+  stats.queue_delay_us += admit_us - enqueue_us;
+  stats.latency_us += now_us - enqueue_us;
+
+  rt::ScopedLock<rt::Spin> lock(&spin_);
+  num_inflight_--;
+  // Pick the queue head with the highest aged priority; ties go to the
+  // higher class.
+  Waiter *next = nullptr;
+  uint32_t next_cls_idx = 0;
+  int64_t next_priority = std::numeric_limits<int64_t>::max();
+  for (uint32_t i = 0; i < kNumClasses; i++) {
+    if (queues_[i].empty()) {
+      continue;
+    }
+    auto *head = queues_[i].front();
+    int64_t priority =
+        static_cast<int64_t>(i) -
+        static_cast<int64_t>((now_us - head->enqueue_us) / kAgingStepUs);
+    if (priority < next_priority) {
+      next = head;
+      next_cls_idx = i;
+      next_priority = priority;
+    }
+  }
+  if (next) {
+    queues_[next_cls_idx].pop_front();
+    num_inflight_++;
+    next->admitted = true;
+    next->cv.Signal();
+  }
+}
+
+uint32_t DeviceScheduler::get_queue_depth(TrafficClass cls) {
+  rt::ScopedLock<rt::Spin> lock(&spin_);
+  return queues_[static_cast<uint32_t>(cls)].size();
+}
+
+uint64_t DeviceScheduler::get_num_requests(TrafficClass cls) const {
+  return stats_[static_cast<uint32_t>(cls)].num_requests;
+}
+
+double DeviceScheduler::get_avg_queue_delay_us(TrafficClass cls) const {
+  auto &stats = stats_[static_cast<uint32_t>(cls)];
+  auto num_requests = stats.num_requests.load();
+  return num_requests
+             ? static_cast<double>(stats.queue_delay_us) / num_requests
+             : 0;
+}
+
+double DeviceScheduler::get_avg_latency_us(TrafficClass cls) const {
+  auto &stats = stats_[static_cast<uint32_t>(cls)];
+  auto num_requests = stats.num_requests.load();
+  return num_requests ? static_cast<double>(stats.latency_us) / num_requests
+                      : 0;
+}
+
+} // namespace far_memory
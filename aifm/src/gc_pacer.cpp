@@ -0,0 +1,87 @@
+extern "C" {
+#include <runtime/timer.h>
+}
+
+#include "gc_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace far_memory {
+
+GCPacer::GCPacer(double almost_empty_ratio, double default_trigger_ratio,
+                 double min_trigger_ratio, double goal_ratio,
+                 uint32_t max_num_gc_threads)
+    : kAlmostEmptyRatio_(almost_empty_ratio),
+      kMinTriggerRatio_(min_trigger_ratio), kGoalRatio_(goal_ratio),
+      kMaxNumGCThreads_(max_num_gc_threads),
+      trigger_ratio_(default_trigger_ratio),
+      num_gc_threads_(max_num_gc_threads) {
+  BUG_ON(!(almost_empty_ratio < min_trigger_ratio &&
+           min_trigger_ratio <= default_trigger_ratio &&
+           default_trigger_ratio < goal_ratio));
+}
+
+void GCPacer::sample() {
+  auto now_us = microtime();
+  if (likely(now_us - ACCESS_ONCE(last_sample_us_) < kSampleIntervalUs)) {
+    return;
+  }
+  // No more than 1 sampler at a time.
+  if (!spin_.TryLock()) {
+    return;
+  }
+  auto num_allocated_bytes = ACCESS_ONCE(num_allocated_bytes_);
+  if (likely(last_sample_us_)) {
+    auto rate = (num_allocated_bytes - last_sample_num_allocated_bytes_) *
+                1e6 / (now_us - last_sample_us_);
+    alloc_bytes_per_sec_ =
+        kEWMAWeight * rate + (1 - kEWMAWeight) * alloc_bytes_per_sec_;
+    update();
+  }
+  last_sample_num_allocated_bytes_ = num_allocated_bytes;
+  ACCESS_ONCE(last_sample_us_) = now_us;
+  spin_.Unlock();
+}
+
+void GCPacer::add_gc_round(uint64_t evacuated_bytes, uint64_t duration_us,
+                           uint32_t num_gc_threads) {
+  if (unlikely(!duration_us || !num_gc_threads)) {
+    return;
+  }
+  auto rate = evacuated_bytes * 1e6 / duration_us / num_gc_threads;
+  rt::ScopedLock<rt::Spin> lock(&spin_);
+  evac_bytes_per_sec_per_thread_ =
+      evac_bytes_per_sec_per_thread_
+          ? kEWMAWeight * rate +
+                (1 - kEWMAWeight) * evac_bytes_per_sec_per_thread_
+          : rate;
+  update();
+}
+
+void GCPacer::update() {
+  if (unlikely(!evac_bytes_per_sec_per_thread_)) {
+    // Keep the defaults until the first GC round is measured.
+    return;
+  }
+  // Use just enough GC threads to outpace the mutators.
+  auto num_gc_threads = static_cast<uint32_t>(
+      ceil(kHeadroom * alloc_bytes_per_sec_ / evac_bytes_per_sec_per_thread_));
+  num_gc_threads = std::max(1U, std::min(num_gc_threads, kMaxNumGCThreads_));
+  // While GC reclaims the cache from the almost-empty watermark up to the
+  // goal, the mutators consume (alloc rate / evac rate) of that amount. Start
+  // GC early enough to leave headroom for it.
+  auto evac_bytes_per_sec = evac_bytes_per_sec_per_thread_ * num_gc_threads;
+  auto trigger_ratio = kAlmostEmptyRatio_ + kHeadroom *
+                                                (kGoalRatio_ -
+                                                 kAlmostEmptyRatio_) *
+                                                alloc_bytes_per_sec_ /
+                                                evac_bytes_per_sec;
+  trigger_ratio = std::max(kMinTriggerRatio_,
+                           std::min(trigger_ratio,
+                                    kGoalRatio_ - kMinTriggerGoalGap));
+  ACCESS_ONCE(num_gc_threads_) = num_gc_threads;
+  ACCESS_ONCE(trigger_ratio_) = trigger_ratio;
+}
+
+} // namespace far_memory
@@ -0,0 +1,127 @@
+extern "C" {
+#include <asm/atomic.h>
+#include <base/assert.h>
+#include <runtime/thread.h>
+}
+
+#include "io_uring.hpp"
+
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace far_memory {
+
+IOUring::IOUring(uint32_t num_entries) : num_unsubmitted_(0) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, num_entries, &params);
+  BUG_ON(ring_fd_ < 0);
+  num_entries_ = params.sq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  sq_ring_ptr_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  BUG_ON(sq_ring_ptr_ == MAP_FAILED);
+  auto *sq_ring = reinterpret_cast<uint8_t *>(sq_ring_ptr_);
+  sq_head_ = reinterpret_cast<uint32_t *>(sq_ring + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t *>(sq_ring + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<uint32_t *>(sq_ring + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32_t *>(sq_ring + params.sq_off.array);
+
+  auto sqes_ptr = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+                       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_SQES);
+  BUG_ON(sqes_ptr == MAP_FAILED);
+  sqes_ = reinterpret_cast<io_uring_sqe *>(sqes_ptr);
+
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  cq_ring_ptr_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  BUG_ON(cq_ring_ptr_ == MAP_FAILED);
+  auto *cq_ring = reinterpret_cast<uint8_t *>(cq_ring_ptr_);
+  cq_head_ = reinterpret_cast<uint32_t *>(cq_ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t *>(cq_ring + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<uint32_t *>(cq_ring + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq_ring + params.cq_off.cqes);
+}
+
+IOUring::~IOUring() {
+  munmap(sqes_, num_entries_ * sizeof(io_uring_sqe));
+  munmap(sq_ring_ptr_, sq_ring_size_);
+  munmap(cq_ring_ptr_, cq_ring_size_);
+  close(ring_fd_);
+}
+
+bool IOUring::queue(uint8_t opcode, int fd, void *buf, uint32_t len,
+                    uint64_t offset, Request *req) {
+  rt::ScopedLock<rt::Spin> guard(&spin_);
+  auto tail = *sq_tail_;
+  if (tail - load_acquire(sq_head_) == num_entries_) {
+    return false;
+  }
+  auto idx = tail & *sq_mask_;
+  auto *sqe = &sqes_[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buf);
+  sqe->len = len;
+  sqe->off = offset;
+  sqe->user_data = reinterpret_cast<uint64_t>(req);
+  sq_array_[idx] = idx;
+  store_release(sq_tail_, tail + 1);
+  num_unsubmitted_++;
+  return true;
+}
+
+void IOUring::poll() {
+  rt::ScopedLock<rt::Spin> guard(&spin_);
+  if (num_unsubmitted_) {
+    // Submits all queued requests in one batch without waiting.
+    auto ret = syscall(__NR_io_uring_enter, ring_fd_, num_unsubmitted_, 0, 0,
+                       nullptr, 0);
+    if (ret > 0) {
+      num_unsubmitted_ -= ret;
+    }
+  }
+  auto head = *cq_head_;
+  auto tail = load_acquire(cq_tail_);
+  for (; head != tail; head++) {
+    auto *cqe = &cqes_[head & *cq_mask_];
+    auto *req = reinterpret_cast<Request *>(cqe->user_data);
+    req->res = cqe->res;
+    store_release(&req->done, true);
+  }
+  store_release(cq_head_, head);
+}
+
+int32_t IOUring::read(int fd, void *buf, uint32_t len, uint64_t offset) {
+  Request req = {.res = 0, .done = false};
+  while (!queue(IORING_OP_READ, fd, buf, len, offset, &req)) {
+    poll();
+    thread_yield();
+  }
+  while (poll(), !load_acquire(&req.done)) {
+    thread_yield();
+  }
+  return req.res;
+}
+
+int32_t IOUring::write(int fd, const void *buf, uint32_t len,
+                       uint64_t offset) {
+  Request req = {.res = 0, .done = false};
+  while (!queue(IORING_OP_WRITE, fd, const_cast<void *>(buf), len, offset,
+                &req)) {
+    poll();
+    thread_yield();
+  }
+  while (poll(), !load_acquire(&req.done)) {
+    thread_yield();
+  }
+  return req.res;
+}
+
+} // namespace far_memory
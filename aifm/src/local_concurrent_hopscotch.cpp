@@ -1,29 +1,39 @@
 #include "local_concurrent_hopscotch.hpp"
 #include "hash.hpp"
 #include "helpers.hpp"
+#include "server_arena.hpp"
 
 #include <cstring>
 
 namespace far_memory {
 
 LocalGenericConcurrentHopscotch::LocalGenericConcurrentHopscotch(
-    uint32_t num_entries_shift, uint64_t data_size)
+    uint32_t num_entries_shift, uint64_t data_size, ServerArena *arena)
     : kHashMask_((1 << num_entries_shift) - 1),
-      kNumEntries_((1 << num_entries_shift) + kNeighborhood),
-      slab_base_addr_(
-          reinterpret_cast<uint64_t>(helpers::allocate_hugepage(data_size))),
+      kNumEntries_((1 << num_entries_shift) + kNeighborhood), arena_(arena),
+      data_size_(data_size),
+      slab_base_addr_(reinterpret_cast<uint64_t>(allocate(data_size))),
       slab_(reinterpret_cast<uint8_t *>(slab_base_addr_), data_size) {
   // Check overflow.
   BUG_ON(((kHashMask_ + 1) >> num_entries_shift) != 1);
 
   // Allocate memory for buckets.
   auto size = kNumEntries_ * sizeof(BucketEntry);
-  buckets_mem_.reset(
-      reinterpret_cast<uint8_t *>(helpers::allocate_hugepage(size)));
+  buckets_mem_.reset(allocate(size));
   buckets_ = new (buckets_mem_.get()) BucketEntry[kNumEntries_];
 }
 
-LocalGenericConcurrentHopscotch::~LocalGenericConcurrentHopscotch() {}
+LocalGenericConcurrentHopscotch::~LocalGenericConcurrentHopscotch() {
+  if (arena_) {
+    arena_->free(buckets_mem_.release(), kNumEntries_ * sizeof(BucketEntry));
+    arena_->free(reinterpret_cast<void *>(slab_base_addr_), data_size_);
+  }
+}
+
+uint8_t *LocalGenericConcurrentHopscotch::allocate(uint64_t size) {
+  return reinterpret_cast<uint8_t *>(
+      arena_ ? arena_->allocate(size) : helpers::allocate_hugepage(size));
+}
 
 void LocalGenericConcurrentHopscotch::do_remove(BucketEntry *bucket,
                                                 BucketEntry *entry) {
@@ -286,4 +296,20 @@ bool LocalGenericConcurrentHopscotch::remove(uint8_t key_len,
   return false;
 }
 
+void LocalGenericConcurrentHopscotch::for_each(
+    const std::function<void(uint8_t key_len, const uint8_t *key,
+                             uint16_t val_len, const uint8_t *val)> &f) {
+  for (uint32_t i = 0; i < kNumEntries_; i++) {
+    auto *header = buckets_[i].ptr;
+    if (!header ||
+        reinterpret_cast<uint64_t>(header) == BucketEntry::kBusyPtr) {
+      continue;
+    }
+    auto *slab_val_ptr =
+        reinterpret_cast<const uint8_t *>(header) + sizeof(KVDataHeader);
+    f(header->key_len, slab_val_ptr + header->val_len, header->val_len,
+      slab_val_ptr);
+  }
+}
+
 } // namespace far_memory
@@ -16,19 +16,23 @@ extern "C" {
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <climits>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <limits>
+#include <numeric>
 #include <optional>
+#include <signal.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/shm.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
@@ -40,6 +44,9 @@ FarMemManager *FarMemManagerFactory::ptr_;
 bool gc_master_active;
 bool almost_empty;
 
+// Control file path of the cache resize signal handler.
+static char resize_ctrl_file_path[PATH_MAX];
+
 void GCParallelizer::master_fn() {
   for (auto &from_region : *from_regions_) {
     for (uint8_t j = 0; j < from_region.get_num_boundaries(); j++) {
@@ -48,14 +55,18 @@ void GCParallelizer::master_fn() {
   }
 }
 
-FarMemManager::FarMemManager(uint64_t cache_size, uint64_t far_mem_size,
-                             uint32_t num_gc_threads, FarMemDevice *device)
-    : cache_region_manager_(cache_size, true),
-      far_mem_region_manager_(far_mem_size, false), device_ptr_(device),
+FarMemManager::FarMemManager(uint64_t cache_size, uint64_t max_cache_size,
+                             uint64_t far_mem_size, uint32_t num_gc_threads,
+                             FarMemDevice *device)
+    : cache_region_manager_(cache_size, max_cache_size, true),
+      far_mem_region_manager_(far_mem_size, far_mem_size, false),
+      device_ptr_(device),
       parallel_marker_(num_gc_threads, kGCSlaveThreadTaskQueueDepth,
                        &from_regions_),
       parallel_write_backer_(num_gc_threads, kGCSlaveThreadTaskQueueDepth,
                              &from_regions_),
+      gc_pacer_(kFreeCacheAlmostEmptyThresh, kFreeCacheLowThresh,
+                kFreeCacheMinLowThresh, kFreeCacheHighThresh, num_gc_threads),
       num_gc_threads_(num_gc_threads) {
 
   BUG_ON(far_mem_size >= (1ULL << FarMemPtrMeta::kObjectIDBitSize));
@@ -78,6 +89,10 @@ FarMemManager::FarMemManager(uint64_t cache_size, uint64_t far_mem_size,
 }
 
 FarMemManager::~FarMemManager() {
+  if (resize_ctrl_thread_) {
+    ACCESS_ONCE(resize_ctrl_exit_) = true;
+    resize_ctrl_thread_->Join();
+  }
   while (ACCESS_ONCE(pending_gcs_)) {
     thread_yield();
   }
@@ -135,11 +150,185 @@ GenericUniquePtr FarMemManager::allocate_generic_unique_ptr(
 
 void FarMemManager::RegionManager::push_free_region(Region &region) {
   region_spin_.Lock();
-  region.reset();
-  BUG_ON(!free_regions_.push_back(region));
+  if (unlikely(is_retiring(region))) {
+    // The group is handed back to the OS before dropping the lock; otherwise
+    // a concurrent grow could rebuild regions in it, which would then be
+    // zeroed by the late madvise().
+    if (auto released_group = release_region(region)) {
+      BUG_ON(madvise(released_group, helpers::kHugepageSize, MADV_DONTNEED));
+    }
+  } else {
+    region.reset();
+    push_free_region_locked(region);
+  }
   region_spin_.Unlock();
 }
 
+void FarMemManager::RegionManager::push_free_region_locked(Region &region) {
+  BUG_ON(!free_regions_[get_node(region.get_idx())].push_back(region));
+  num_free_regions_++;
+}
+
+// Prefers the regions on the NUMA node of the current core.
+bool FarMemManager::RegionManager::pop_free_region_locked(Region *region) {
+  auto node = num_nodes_ > 1 ? helpers::get_cur_numa_node() : 0;
+  for (uint32_t i = 0; i < num_nodes_; i++) {
+    if (free_regions_[(node + i) % num_nodes_].pop_front(region)) {
+      num_free_regions_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Must be called with region_spin_ held. Returns the address of the hugepage
+// group that becomes fully released (which should then be handed back to the
+// OS by the caller), or nullptr otherwise.
+uint8_t *FarMemManager::RegionManager::release_region(Region &region) {
+  auto idx = region.get_idx();
+  region.invalidate();
+  released_[idx] = true;
+  num_retiring_regions_--;
+
+  auto group_begin = idx / kNumRegionsPerGroup * kNumRegionsPerGroup;
+  auto group_end =
+      std::min(group_begin + kNumRegionsPerGroup, max_num_regions_);
+  for (auto i = group_begin; i < group_end; i++) {
+    if (!released_[i]) {
+      return nullptr;
+    }
+  }
+  return local_cache_ptr_.get() + group_begin * Region::kSize;
+}
+
+void FarMemManager::RegionManager::count_retiring_regions() {
+  num_retiring_regions_ = 0;
+  for (auto i = num_regions_; i < max_num_regions_; i++) {
+    num_retiring_regions_ += !released_[i];
+  }
+}
+
+void FarMemManager::RegionManager::resize(uint64_t size) {
+  BUG_ON(!local_cache_ptr_);
+  auto new_num_regions = static_cast<uint32_t>(
+      helpers::align_to(helpers::align_to(size, Region::kSize) / Region::kSize,
+                        static_cast<uint64_t>(kNumRegionsPerGroup)));
+  new_num_regions = std::max(min_num_regions_,
+                             std::min(new_num_regions, max_num_regions_));
+
+  std::vector<uint32_t> new_region_idxes;
+  std::vector<uint8_t *> released_groups;
+  region_spin_.Lock();
+  auto old_num_regions = num_regions_;
+  num_regions_ = new_num_regions;
+  if (new_num_regions > old_num_regions) {
+    // Regions that are still retiring simply rejoin the budget, while the
+    // released ones have to be rebuilt.
+    for (auto i = old_num_regions; i < new_num_regions; i++) {
+      if (released_[i]) {
+        released_[i] = false;
+        new_region_idxes.push_back(i);
+      }
+    }
+    count_retiring_regions();
+    // Used regions that are back in the budget return to the used lists.
+    std::vector<Region> retiring_used_regions;
+    std::swap(retiring_used_regions, retiring_used_regions_);
+    num_retiring_used_regions_ = 0;
+    for (auto &region : retiring_used_regions) {
+      push_used_region_locked(region);
+    }
+  } else {
+    count_retiring_regions();
+    retire_used_regions_locked(&nt_used_regions_);
+    retire_used_regions_locked(&used_regions_);
+    // Free regions beyond the budget can be released right away.
+    for (uint32_t node = 0; node < num_nodes_; node++) {
+      auto &free_regions = free_regions_[node];
+      auto num_free_regions = free_regions.size();
+      for (uint32_t i = 0; i < num_free_regions; i++) {
+        Region region;
+        BUG_ON(!free_regions.pop_front(&region));
+        if (is_retiring(region)) {
+          num_free_regions_--;
+          if (auto group = release_region(region)) {
+            released_groups.push_back(group);
+          }
+        } else {
+          BUG_ON(!free_regions.push_back(region));
+        }
+      }
+    }
+  }
+  region_spin_.Unlock();
+
+  // Only resize() rebuilds released regions, and resize_cache() serializes
+  // it, so these groups stay released until the madvise() is done.
+  for (auto group : released_groups) {
+    BUG_ON(madvise(group, helpers::kHugepageSize, MADV_DONTNEED));
+  }
+  // Build the new regions (which touches their memory) outside the lock so
+  // that mutators are not blocked from refilling their core-local regions.
+  for (auto idx : new_region_idxes) {
+    auto region =
+        Region(idx, true, false, local_cache_ptr_.get() + idx * Region::kSize);
+    region_spin_.Lock();
+    push_free_region_locked(region);
+    region_spin_.Unlock();
+  }
+}
+
+// Must be called with region_spin_ held.
+void FarMemManager::RegionManager::push_used_region_locked(Region &region) {
+  if (unlikely(is_retiring(region))) {
+    retiring_used_regions_.push_back(std::move(region));
+    num_retiring_used_regions_++;
+    return;
+  }
+  bool success =
+      (region.is_local() &&
+       region.is_nt()) // is_nt() can only be called by the local region
+                       // since it uses the runtime's Region space.
+          ? nt_used_regions_.push_back(region)
+          : used_regions_.push_back(region);
+  BUG_ON(!success);
+}
+
+// Must be called with region_spin_ held. Moves the retiring regions out of
+// regions while preserving the order of the others.
+void FarMemManager::RegionManager::retire_used_regions_locked(
+    CircularBuffer<Region, false> *regions) {
+  auto num_regions = regions->size();
+  for (uint32_t i = 0; i < num_regions; i++) {
+    Region region;
+    BUG_ON(!regions->pop_front(&region));
+    if (is_retiring(region)) {
+      retiring_used_regions_.push_back(std::move(region));
+      num_retiring_used_regions_++;
+    } else {
+      BUG_ON(!regions->push_back(region));
+    }
+  }
+}
+
+std::optional<Region> FarMemManager::RegionManager::pop_retiring_used_region() {
+  if (likely(!has_retiring_used_regions())) {
+    return std::nullopt;
+  }
+  region_spin_.Lock();
+  auto guard = helpers::finally([&] { region_spin_.Unlock(); });
+  for (auto &region : retiring_used_regions_) {
+    if (region.is_gcable()) {
+      std::optional<Region> optional_region = std::move(region);
+      region = std::move(retiring_used_regions_.back());
+      retiring_used_regions_.pop_back();
+      num_retiring_used_regions_--;
+      return optional_region;
+    }
+  }
+  return std::nullopt;
+}
+
 std::optional<Region> FarMemManager::RegionManager::pop_used_region() {
   Region region;
   region_spin_.Lock();
@@ -180,19 +369,12 @@ bool FarMemManager::RegionManager::try_refill_core_local_free_region(
   bool success = true;
   if (full_region) {
     if (!full_region->is_invalid()) {
-      success =
-          (full_region->is_local() &&
-           full_region
-               ->is_nt()) // is_nt() can only be called by the local region
-                          // since it uses the runtime's Region space.
-              ? nt_used_regions_.push_back(*full_region)
-              : used_regions_.push_back(*full_region);
-      BUG_ON(!success);
+      push_used_region_locked(*full_region);
     }
   }
   auto &core_local_region = core_local_free_region(nt);
   if (core_local_region.is_invalid()) {
-    success = free_regions_.pop_front(&core_local_region);
+    success = pop_free_region_locked(&core_local_region);
     if (nt) {
       core_local_region.set_nt();
     }
@@ -201,10 +383,9 @@ bool FarMemManager::RegionManager::try_refill_core_local_free_region(
   return success;
 }
 
-FarMemManager *
-FarMemManagerFactory::build(uint64_t cache_size,
-                            std::optional<uint32_t> optional_num_gc_threads,
-                            FarMemDevice *device) {
+FarMemManager *FarMemManagerFactory::build(
+    uint64_t cache_size, std::optional<uint32_t> optional_num_gc_threads,
+    FarMemDevice *device, std::optional<uint64_t> optional_max_cache_size) {
   if (unlikely(ptr_)) {
     return nullptr;
   }
@@ -214,26 +395,86 @@ FarMemManagerFactory::build(uint64_t cache_size,
   if (unlikely(!num_gc_threads)) {
     return nullptr;
   }
-  ptr_ = new FarMemManager(cache_size, device->get_far_mem_size(),
-                           num_gc_threads, device);
+  uint64_t max_cache_size = optional_max_cache_size.has_value()
+                                ? *optional_max_cache_size
+                                : cache_size;
+  if (unlikely(max_cache_size < cache_size)) {
+    return nullptr;
+  }
+  ptr_ = new FarMemManager(cache_size, max_cache_size,
+                           device->get_far_mem_size(), num_gc_threads, device);
   return ptr_;
 }
 
-FarMemManager::RegionManager::RegionManager(uint64_t size, bool is_local) {
+// Smooth weighted round-robin over the nodes, weighted by their number of CPUs.
+void FarMemManager::RegionManager::assign_group_nodes() {
+  if (num_nodes_ == 1) {
+    return;
+  }
+  std::vector<int64_t> weights(num_nodes_);
+  for (int cpu = 0; cpu < helpers::get_num_cores(); cpu++) {
+    weights[helpers::get_numa_node_of_cpu(cpu)]++;
+  }
+  auto total_weight = std::accumulate(weights.begin(), weights.end(), 0L);
+  std::vector<int64_t> credits(num_nodes_);
+  auto num_groups =
+      helpers::align_to(max_num_regions_, kNumRegionsPerGroup) /
+      kNumRegionsPerGroup;
+  group_nodes_.resize(num_groups);
+  for (auto &group_node : group_nodes_) {
+    uint32_t best = 0;
+    for (uint32_t node = 0; node < num_nodes_; node++) {
+      credits[node] += weights[node];
+      if (credits[node] > credits[best]) {
+        best = node;
+      }
+    }
+    credits[best] -= total_weight;
+    group_node = best;
+  }
+}
+
+FarMemManager::RegionManager::RegionManager(uint64_t size, uint64_t max_size,
+                                            bool is_local) {
+  auto num_cores = helpers::get_num_runtime_cores();
   auto free_regions_count = ceil(size / static_cast<double>(Region::kSize));
-  if (free_regions_count <= 2 * helpers::kNumSocket1CPUs) {
+  min_num_regions_ = 2 * num_cores + 1;
+  if (free_regions_count < min_num_regions_) {
     LOG_PRINTF("%s\n", "Error: two few available regions.");
     exit(-ENOSPC);
   }
-  free_regions_ = std::move(CircularBuffer<Region, false>(free_regions_count));
-  used_regions_ = std::move(CircularBuffer<Region, false>(free_regions_count));
-  nt_used_regions_ =
-      std::move(CircularBuffer<Region, false>(free_regions_count));
+  num_regions_ = free_regions_count;
+  auto max_regions_count = ceil(max_size / static_cast<double>(Region::kSize));
+  max_num_regions_ =
+      std::max(num_regions_, static_cast<uint32_t>(max_regions_count));
+  num_nodes_ = is_local ? helpers::get_num_numa_nodes() : 1;
+  free_regions_.reset(new CircularBuffer<Region, false>[num_nodes_]);
+  for (uint32_t node = 0; node < num_nodes_; node++) {
+    free_regions_[node] =
+        std::move(CircularBuffer<Region, false>(max_num_regions_));
+  }
+  used_regions_ = std::move(CircularBuffer<Region, false>(max_num_regions_));
+  nt_used_regions_ = std::move(CircularBuffer<Region, false>(max_num_regions_));
+  retiring_used_regions_.reserve(max_num_regions_);
+  core_local_free_regions_.reset(new Region[num_cores]);
+  core_local_free_nt_regions_.reset(new Region[num_cores]);
   if (is_local) {
+    assign_group_nodes();
+    // Reserve the address space of the max cache size up front; the hugepages
+    // beyond the current budget are not touched until the cache grows.
     local_cache_ptr_.reset(reinterpret_cast<uint8_t *>(
-        helpers::allocate_hugepage(free_regions_count * Region::kSize)));
+        helpers::allocate_hugepage(max_num_regions_ * Region::kSize)));
+    if (num_nodes_ > 1) {
+      for (uint64_t idx = 0; idx < max_num_regions_;
+           idx += kNumRegionsPerGroup) {
+        helpers::bind_to_numa_node(local_cache_ptr_.get() + idx * Region::kSize,
+                                   helpers::kHugepageSize, get_node(idx));
+      }
+    }
+    released_.resize(max_num_regions_, true);
+    std::fill(released_.begin(), released_.begin() + num_regions_, false);
   }
-  free_regions_count -= 2 * helpers::kNumSocket1CPUs;
+  free_regions_count -= 2 * num_cores;
 
   uint32_t idx = 0;
   auto new_region_fn = [&](bool nt) {
@@ -242,17 +483,19 @@ FarMemManager::RegionManager::RegionManager(uint64_t size, bool is_local) {
     return Region(idx++, is_local, nt, buf_ptr);
   };
 
-  FOR_ALL_SOCKET0_CORES(core_id) {
+  FOR_ALL_CORES(core_id) {
     core_local_free_regions_[core_id] = new_region_fn(false);
     core_local_free_nt_regions_[core_id] = new_region_fn(true);
   }
 
   for (uint64_t i = 0; i < free_regions_count; i++) {
-    BUG_ON(!free_regions_.push_back(new_region_fn(false)));
+    auto region = new_region_fn(false);
+    push_free_region_locked(region);
   }
 }
 
-void FarMemManager::swap_in(bool nt, GenericFarMemPtr *ptr) {
+void FarMemManager::swap_in(bool nt, GenericFarMemPtr *ptr,
+                            TrafficClass cls) {
   assert(preempt_enabled());
 
   auto &meta = ptr->meta();
@@ -275,9 +518,15 @@ void FarMemManager::swap_in(bool nt, GenericFarMemPtr *ptr) {
     auto ds_id = meta.get_ds_id();
     uint16_t obj_data_len;
     auto obj_data_addr = reinterpret_cast<uint8_t *>(obj.get_data_addr());
-    device_ptr_->read_object(ds_id, sizeof(obj_id),
-                             reinterpret_cast<uint8_t *>(&obj_id),
-                             &obj_data_len, obj_data_addr);
+    {
+      auto ticket = device_ptr_->admit(cls);
+      device_ptr_->read_object(ds_id, sizeof(obj_id),
+                               reinterpret_cast<uint8_t *>(&obj_id),
+                               &obj_data_len, obj_data_addr);
+    }
+    if (auto &decoder = object_decoders_[ds_id]) {
+      obj_data_len = decoder(obj_data_addr, obj_data_len);
+    }
     wmb();
     obj.init(ds_id, obj_data_len, sizeof(obj_id),
              reinterpret_cast<uint8_t *>(&obj_id));
@@ -353,7 +602,8 @@ void FarMemManager::swap_out(GenericFarMemPtr *ptr, Object obj) {
 
   auto write_object_fn = [&](uint32_t data_len) {
     if (dirty) {
-      device_ptr_->write_object(ds_id, obj_id_len, obj_id, data_len, data_ptr);
+      auto ticket = device_ptr_->admit(TrafficClass::kGCWrite);
+      write_object_data(ds_id, obj_id_len, obj_id, data_len, data_ptr);
     }
   };
 
@@ -391,7 +641,17 @@ void FarMemManager::pick_from_regions() {
                static_cast<uint32_t>(ratio_per_gc_round *
                                      cache_region_manager_.get_num_regions()));
   do {
-    auto optional_region = pop_cache_used_region();
+    // Regions beyond the cache budget are always evacuated first.
+    auto optional_region = cache_region_manager_.pop_retiring_used_region();
+    if (!optional_region) {
+      // Only a shrink keeps GC running with enough free cache; stop once the
+      // evictable retiring regions are all picked.
+      if (cache_region_manager_.has_retiring_regions() &&
+          is_free_cache_high()) {
+        break;
+      }
+      optional_region = pop_cache_used_region();
+    }
     if (unlikely(!optional_region)) {
       break;
     }
@@ -479,6 +739,10 @@ GCParallelWriteBacker::GCParallelWriteBacker(uint32_t num_slaves,
                                              std::vector<Region> *from_regions)
     : GCParallelizer(num_slaves, task_queues_depth, from_regions) {}
 
+uint64_t GCParallelWriteBacker::reset_num_evacuated_bytes() {
+  return num_evacuated_bytes_.exchange(0);
+}
+
 void GCParallelWriteBacker::slave_fn(uint32_t tid) {
   preempt_disable();
   start_gc_us[get_core_num()].c = microtime();
@@ -489,6 +753,7 @@ void GCParallelWriteBacker::slave_fn(uint32_t tid) {
       auto [left, right] = task;
       auto cur = left;
       auto *manager = FarMemManagerFactory::get();
+      uint64_t num_evacuated_bytes = 0;
       while (cur + Object::kHeaderSize < right) {
         auto obj = Object(cur);
         if (!obj.is_freed()) {
@@ -501,10 +766,12 @@ void GCParallelWriteBacker::slave_fn(uint32_t tid) {
             auto *ptr =
                 reinterpret_cast<GenericFarMemPtr *>(obj.get_ptr_addr());
             manager->swap_out(ptr, obj);
+            num_evacuated_bytes += obj.size();
           }
         }
         cur += helpers::align_to(obj.size(), sizeof(FarMemPtrMeta));
       }
+      num_evacuated_bytes_ += num_evacuated_bytes;
     }
   }
 }
@@ -553,7 +820,8 @@ void FarMemManager::gc_cache() {
 #endif
   start_gc_us[get_core_num()].c = microtime();
 
-  if (unlikely(!is_free_cache_low())) {
+  if (unlikely(!is_free_cache_low() &&
+               !cache_region_manager_.has_retiring_used_regions())) {
     return;
   }
 
@@ -567,13 +835,30 @@ void FarMemManager::gc_cache() {
              cache_region_manager_.get_free_region_ratio());
 #endif
 
-  while (!is_free_cache_high()) {
+  while (!is_free_cache_high() ||
+         cache_region_manager_.has_retiring_used_regions()) {
     // Phase 1. Pick regions to be GCed.
 #ifdef GC_LOG
     ts[0] = std::chrono::steady_clock::now();
 #endif
+#ifndef DISABLE_GC_PACING
+    auto round_start_us = microtime();
+    // Use all GC threads when mutators are about to stall.
+    auto num_active_gc_threads = ACCESS_ONCE(almost_empty)
+                                     ? num_gc_threads_
+                                     : gc_pacer_.get_num_gc_threads();
+#else
+    auto num_active_gc_threads = num_gc_threads_;
+#endif
+    parallel_marker_.set_num_active_slaves(num_active_gc_threads);
+    parallel_write_backer_.set_num_active_slaves(num_active_gc_threads);
     pick_from_regions();
     if (unlikely(!from_regions_.size())) {
+      if (is_free_cache_high()) {
+        // The remaining retiring regions are still referenced; they will be
+        // picked up by a later GC round.
+        break;
+      }
       LOG_PRINTF("%s\n", "Warn: GC cannot find any from_regions.");
       thread_yield();
       continue;
@@ -606,14 +891,12 @@ void FarMemManager::gc_cache() {
     for (auto &from_region : from_regions_) {
       push_cache_free_region(from_region);
     }
-    gc_lock_.Lock();
-    if (!is_free_cache_almost_empty()) {
-      ACCESS_ONCE(almost_empty) = false;
-#ifndef STW_GC
-      mutator_cache_condvar_.SignalAll();
+    wake_up_mutators();
+#ifndef DISABLE_GC_PACING
+    gc_pacer_.add_gc_round(parallel_write_backer_.reset_num_evacuated_bytes(),
+                           microtime() - round_start_us,
+                           num_active_gc_threads);
 #endif
-    }
-    gc_lock_.Unlock();
 
 #ifdef GC_LOG
     ts[5] = std::chrono::steady_clock::now();
@@ -739,15 +1022,105 @@ void FarMemManager::mutator_wait_for_gc_cache() {
 #ifdef STW_GC
   launch_gc_master();
 #endif
+  auto stall_start_us = microtime();
   do {
     mutator_cache_condvar_.Wait(&gc_lock_);
   } while (ACCESS_ONCE(almost_empty));
   guard.reset();
+  Stats::inc_mutator_stall_us(microtime() - stall_start_us);
+  Stats::inc_num_mutator_stalls(1);
 #ifdef DEBUG
   LOG_PRINTF("%s\n", "Warn: mutator paused due to insufficient memory.");
 #endif
 }
 
+void FarMemManager::wake_up_mutators() {
+  gc_lock_.Lock();
+  if (!is_free_cache_almost_empty()) {
+    ACCESS_ONCE(almost_empty) = false;
+#ifndef STW_GC
+    mutator_cache_condvar_.SignalAll();
+#endif
+  }
+  gc_lock_.Unlock();
+}
+
+bool FarMemManager::resize_cache(uint64_t new_size) {
+  assert(preempt_enabled());
+  assert(!DerefScope::is_in_deref_scope());
+  resize_mutex_.Lock();
+  auto guard = helpers::finally([&]() { resize_mutex_.Unlock(); });
+
+  auto old_size = get_cache_size();
+  cache_region_manager_.resize(new_size);
+  LOG_PRINTF("%s%llu%s%llu%s\n", "Info: resize cache from ",
+             (unsigned long long)old_size, " to ",
+             (unsigned long long)get_cache_size(), " bytes.");
+  if (get_cache_size() >= old_size) {
+    wake_up_mutators();
+    return true;
+  }
+
+  // Let GC evacuate the used regions beyond the new budget. The core-local
+  // ones are released once they get filled up and GCed.
+  auto deadline_us = microtime() + kResizeCacheTimeoutUs;
+  while (cache_region_manager_.has_retiring_used_regions()) {
+    if (unlikely(microtime() >= deadline_us)) {
+      LOG_PRINTF("%s\n", "Warn: partial cache shrink, some regions beyond "
+                         "the budget are still in use.");
+      return false;
+    }
+    preempt_disable();
+    launch_gc_master();
+    preempt_enable();
+    timer_sleep(kResizeCachePollUs);
+  }
+  return true;
+}
+
+static void resize_ctrl_signal_handler(int signum) {
+  // Only async-signal-safe calls are allowed here.
+  char buf[32];
+  int fd = open(resize_ctrl_file_path, O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  auto len = read(fd, buf, sizeof(buf));
+  close(fd);
+  uint64_t new_size = 0;
+  for (ssize_t i = 0; i < len && buf[i] >= '0' && buf[i] <= '9'; i++) {
+    new_size = new_size * 10 + (buf[i] - '0');
+  }
+  if (new_size) {
+    FarMemManagerFactory::get()->request_cache_resize(new_size);
+  }
+}
+
+void FarMemManager::start_cache_resize_ctrl(int signum,
+                                            const char *ctrl_file_path) {
+  BUG_ON(resize_ctrl_thread_);
+  BUG_ON(strlen(ctrl_file_path) >= sizeof(resize_ctrl_file_path));
+  strcpy(resize_ctrl_file_path, ctrl_file_path);
+
+  struct sigaction act;
+  memset(&act, 0, sizeof(act));
+  act.sa_handler = resize_ctrl_signal_handler;
+  sigemptyset(&act.sa_mask);
+  act.sa_flags = SA_RESTART;
+  BUG_ON(sigaction(signum, &act, nullptr));
+
+  resize_ctrl_thread_.reset(new rt::Thread([&]() {
+    while (!ACCESS_ONCE(resize_ctrl_exit_)) {
+      auto new_size = __atomic_exchange_n(&pending_cache_size_, 0,
+                                          __ATOMIC_SEQ_CST);
+      if (new_size) {
+        resize_cache(new_size);
+      }
+      timer_sleep(kResizeCachePollUs);
+    }
+  }));
+}
+
 void FarMemManager::mutator_wait_for_gc_far_mem() {
   LOG_PRINTF("%s\n", "Warn: GCing far mem has not been implemented yet.");
 }
@@ -776,6 +1149,23 @@ uint8_t FarMemManager::allocate_ds_id() {
   return ds_id;
 }
 
+uint8_t FarMemManager::reserve_ds_id(uint8_t ds_id) {
+  bool available = false;
+  std::queue<uint8_t> ds_ids;
+  while (!available_ds_ids_.empty()) {
+    auto id = available_ds_ids_.front();
+    available_ds_ids_.pop();
+    if (id == ds_id) {
+      available = true;
+    } else {
+      ds_ids.push(id);
+    }
+  }
+  available_ds_ids_ = std::move(ds_ids);
+  BUG_ON(!available);
+  return ds_id;
+}
+
 void FarMemManager::free_ds_id(uint8_t ds_id) { available_ds_ids_.push(ds_id); }
 
 bool FarMemManager::reallocate_generic_unique_ptr_nb(const DerefScope &scope,
@@ -832,4 +1222,12 @@ GenericConcurrentHopscotch *FarMemManager::allocate_concurrent_hopscotch_heap(
       remote_data_size);
 }
 
+GenericConcurrentHopscotch FarMemManager::adopt_concurrent_hopscotch(
+    uint8_t ds_id, uint32_t local_num_entries_shift,
+    uint32_t remote_num_entries_shift, uint64_t remote_data_size) {
+  return GenericConcurrentHopscotch(reserve_ds_id(ds_id),
+                                    local_num_entries_shift,
+                                    remote_num_entries_shift, remote_data_size);
+}
+
 } // namespace far_memory
@@ -54,8 +54,8 @@ void FarMemPtrMeta::gc_wb(uint8_t ds_id, uint16_t object_size,
   from_uint64_t(new_metadata);
 }
 
-void GenericFarMemPtr::swap_in(bool nt) {
-  FarMemManagerFactory::get()->swap_in(nt, this);
+void GenericFarMemPtr::swap_in(bool nt, TrafficClass cls) {
+  FarMemManagerFactory::get()->swap_in(nt, this, cls);
 }
 
 bool GenericFarMemPtr::mutator_migrate_object() {
@@ -130,7 +130,9 @@ restart:
       }
     }
 
-    FarMemManagerFactory::get()->get_device()->write_object(
+    auto *manager = FarMemManagerFactory::get();
+    auto ticket = manager->get_device()->admit(TrafficClass::kGCWrite);
+    manager->write_object_data(
         obj.get_ds_id(), obj_id_len, obj_id_ptr, obj.get_data_len(),
         reinterpret_cast<const uint8_t *>(obj.get_data_addr()));
     if (!meta_snapshot.is_shared()) {
@@ -5,19 +5,25 @@ extern "C" {
 #include <base/stddef.h>
 }
 
+#include "helpers.hpp"
 #include "server.hpp"
 #include "server_dataframe_vector.hpp"
 #include "server_hashtable.hpp"
 #include "server_ptr.hpp"
+#include "server_tier_cache.hpp"
 
-namespace far_memory {
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
-std::unique_ptr<ServerDS> Server::server_ds_ptrs_[kMaxNumDSIDs];
+namespace far_memory {
 
 Server::Server() {
   register_ds(kVanillaPtrDSType, new ServerPtrFactory());
   register_ds(kHashTableDSType, new ServerHashTableFactory());
-  register_ds(kDataFrameVectorDSType, new ServerDataFrameVectorFactory());
+  register_ds(kDataFrameVectorDSType, new ServerDataFrameVectorFactory(this));
+  register_ds(kTierCacheDSType, new ServerTierCacheFactory());
 }
 
 void Server::register_ds(uint8_t ds_type, ServerDSFactory *factory) {
@@ -26,19 +32,35 @@ void Server::register_ds(uint8_t ds_type, ServerDSFactory *factory) {
 
 void Server::construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                        uint8_t *params) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
+  if (unlikely(restored_[ds_id])) {
+    restored_[ds_id] = false;
+    if (ds_types_[ds_id] == ds_type &&
+        ds_params_[ds_id] ==
+            std::vector<uint8_t>(params, params + param_len)) {
+      // Reattach to the restored ds.
+      return;
+    }
+    server_ds_ptrs_[ds_id].reset();
+  }
   auto factory = registered_server_ds_factorys_[ds_type];
   BUG_ON(server_ds_ptrs_[ds_id]);
   server_ds_ptrs_[ds_id].reset(factory->build(param_len, params));
+  ds_types_[ds_id] = ds_type;
+  ds_params_[ds_id].assign(params, params + param_len);
 }
 
 void Server::destruct(uint8_t ds_id) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
   BUG_ON(!server_ds_ptrs_[ds_id]);
   server_ds_ptrs_[ds_id].reset();
+  restored_[ds_id] = false;
 }
 
 void Server::read_object(uint8_t ds_id, uint8_t obj_id_len,
                          const uint8_t *obj_id, uint16_t *data_len,
                          uint8_t *data_buf) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
   auto ds_ptr = server_ds_ptrs_[ds_id].get();
   if (!ds_ptr) {
     ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
@@ -49,6 +71,7 @@ void Server::read_object(uint8_t ds_id, uint8_t obj_id_len,
 void Server::write_object(uint8_t ds_id, uint8_t obj_id_len,
                           const uint8_t *obj_id, uint16_t data_len,
                           const uint8_t *data_buf) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
   auto ds_ptr = server_ds_ptrs_[ds_id].get();
   if (!ds_ptr) {
     ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
@@ -56,8 +79,31 @@ void Server::write_object(uint8_t ds_id, uint8_t obj_id_len,
   ds_ptr->write_object(obj_id_len, obj_id, data_len, data_buf);
 }
 
+bool Server::read_object_zero_copy(
+    uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+    const std::function<void(const uint8_t *, uint16_t)> &f) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
+  auto ds_ptr = server_ds_ptrs_[ds_id].get();
+  if (!ds_ptr) {
+    ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
+  }
+  return ds_ptr->read_object_zero_copy(obj_id_len, obj_id, f);
+}
+
+bool Server::write_object_zero_copy(uint8_t ds_id, uint8_t obj_id_len,
+                                    const uint8_t *obj_id, uint16_t data_len,
+                                    const std::function<void(uint8_t *)> &f) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
+  auto ds_ptr = server_ds_ptrs_[ds_id].get();
+  if (!ds_ptr) {
+    ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
+  }
+  return ds_ptr->write_object_zero_copy(obj_id_len, obj_id, data_len, f);
+}
+
 bool Server::remove_object(uint64_t ds_id, uint8_t obj_id_len,
                            const uint8_t *obj_id) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
   auto ds_ptr = server_ds_ptrs_[ds_id].get();
   if (!ds_ptr) {
     ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
@@ -68,12 +114,115 @@ bool Server::remove_object(uint64_t ds_id, uint8_t obj_id_len,
 void Server::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                      const uint8_t *input_buf, uint16_t *output_len,
                      uint8_t *output_buf) {
+  auto reader_lock = quiesce_lock_.get_reader_lock();
   auto ds_ptr = server_ds_ptrs_[ds_id].get();
   return ds_ptr->compute(opcode, input_len, input_buf, output_len, output_buf);
 }
 
+void Server::compute_stream(
+    uint8_t ds_id, uint8_t opcode, uint64_t input_len,
+    const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &emit) {
+  // Streams only read, and they must not hold off snapshot(): they wait for
+  // the client, which may in turn wait for its other requests to be served.
+  auto ds_ptr = server_ds_ptrs_[ds_id].get();
+  ds_ptr->compute_stream(opcode, input_len, input_buf, emit);
+}
+
 ServerDS *Server::get_server_ds(uint8_t ds_id) {
   return server_ds_ptrs_[ds_id].get();
 }
 
+std::string Server::get_snapshot_path(const std::string &dir, uint8_t ds_id) {
+  return dir + "/ds_" + std::to_string(ds_id);
+}
+
+bool Server::snapshot_ds(const std::string &dir, uint8_t ds_id) {
+  auto path = get_snapshot_path(dir, ds_id);
+  auto tmp_path = path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  auto fd_guard = helpers::finally([&]() { close(fd); });
+
+  BUG_ON(lseek(fd, kSnapshotStateOffset, SEEK_SET) !=
+         static_cast<off_t>(kSnapshotStateOffset));
+  if (!server_ds_ptrs_[ds_id]->snapshot(fd)) {
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kSnapshotMagic;
+  header.ds_type = ds_types_[ds_id];
+  header.param_len = ds_params_[ds_id].size();
+  memcpy(header.params, ds_params_[ds_id].data(), header.param_len);
+  header.state_len = lseek(fd, 0, SEEK_CUR) - kSnapshotStateOffset;
+  BUG_ON(lseek(fd, 0, SEEK_SET) != 0);
+  helpers::file_write_until(fd, &header, sizeof(header));
+  BUG_ON(fsync(fd) != 0);
+
+  // Replace the previous snapshot atomically.
+  return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool Server::snapshot(const std::string &dir) {
+  auto writer_lock = quiesce_lock_.get_writer_lock();
+  bool succeed = true;
+  for (uint32_t ds_id = 0; ds_id < kMaxNumDSIDs; ds_id++) {
+    if (server_ds_ptrs_[ds_id]) {
+      if (!snapshot_ds(dir, ds_id)) {
+        LOG_PRINTF("Warn: failed to snapshot ds %u.\n", ds_id);
+        succeed = false;
+      }
+    } else {
+      unlink(get_snapshot_path(dir, ds_id).c_str());
+    }
+  }
+  return succeed;
+}
+
+bool Server::restore_ds(const std::string &dir, uint8_t ds_id) {
+  int fd = open(get_snapshot_path(dir, ds_id).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  auto fd_guard = helpers::finally([&]() { close(fd); });
+
+  SnapshotHeader header;
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      header.magic != kSnapshotMagic) {
+    LOG_PRINTF("Warn: invalid snapshot of ds %u.\n", ds_id);
+    return false;
+  }
+  auto factory = registered_server_ds_factorys_[header.ds_type];
+  std::unique_ptr<ServerDS> ds(factory->build(header.param_len, header.params));
+  if (!ds->restore(fd, kSnapshotStateOffset, header.state_len)) {
+    LOG_PRINTF("Warn: failed to restore ds %u.\n", ds_id);
+    return false;
+  }
+  server_ds_ptrs_[ds_id] = std::move(ds);
+  ds_types_[ds_id] = header.ds_type;
+  ds_params_[ds_id].assign(header.params, header.params + header.param_len);
+  restored_[ds_id] = true;
+  return true;
+}
+
+void Server::restore(const std::string &dir) {
+  for (uint32_t ds_id = 0; ds_id < kMaxNumDSIDs; ds_id++) {
+    BUG_ON(server_ds_ptrs_[ds_id]);
+    restore_ds(dir, ds_id);
+  }
+}
+
+void Server::discard_restored() {
+  for (uint32_t ds_id = 0; ds_id < kMaxNumDSIDs; ds_id++) {
+    if (restored_[ds_id]) {
+      destruct(ds_id);
+    }
+  }
+}
+
 } // namespace far_memory
@@ -0,0 +1,100 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/compiler.h>
+#include <base/stddef.h>
+}
+
+#include "server_arena.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace far_memory {
+
+ServerArena::ServerArena(uint64_t capacity, uint32_t numa_node)
+    : capacity_(helpers::round_to_hugepage_size(capacity)),
+      numa_node_(numa_node) {
+  // Over-reserve by one hugepage so that the arena can be hugepage-aligned.
+  auto reserved_size = capacity_ + helpers::kHugepageSize;
+  auto ptr = mmap(nullptr, reserved_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  BUG_ON(ptr == MAP_FAILED);
+  auto addr = reinterpret_cast<uint64_t>(ptr);
+  auto aligned_addr = helpers::round_to_hugepage_size(addr);
+  if (aligned_addr != addr) {
+    munmap(ptr, aligned_addr - addr);
+  }
+  auto tail_size = addr + reserved_size - (aligned_addr + capacity_);
+  if (tail_size) {
+    munmap(reinterpret_cast<void *>(aligned_addr + capacity_), tail_size);
+  }
+  base_ = reinterpret_cast<uint8_t *>(aligned_addr);
+
+  BUG_ON(madvise(base_, capacity_, MADV_HUGEPAGE) != 0);
+  helpers::bind_to_numa_node(base_, capacity_, numa_node_);
+  free_ranges_.emplace(0, capacity_);
+}
+
+ServerArena::~ServerArena() { munmap(base_, capacity_); }
+
+ServerArena &ServerArena::get() {
+  // Never destructed, since global ds may free their memory after it would be.
+  static auto *arena = new ServerArena(
+      static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE),
+      helpers::get_cur_numa_node());
+  return *arena;
+}
+
+void *ServerArena::allocate(uint64_t size) {
+  if (size < kMinArenaAllocSize) {
+    return malloc(size);
+  }
+  size = helpers::round_to_hugepage_size(size);
+  {
+    rt::ScopedLock<rt::Mutex> lock(&mutex_);
+    // First fit.
+    for (auto iter = free_ranges_.begin(); iter != free_ranges_.end();
+         iter++) {
+      auto [offset, len] = *iter;
+      if (len >= size) {
+        free_ranges_.erase(iter);
+        if (len > size) {
+          free_ranges_.emplace(offset + size, len - size);
+        }
+        return base_ + offset;
+      }
+    }
+  }
+  LOG_PRINTF("%s\n", "Warn: server arena is exhausted, fall back to malloc.");
+  void *ptr = nullptr;
+  BUG_ON(posix_memalign(&ptr, helpers::kHugepageSize, size));
+  return ptr;
+}
+
+void ServerArena::free(void *ptr, uint64_t size) {
+  if (!is_in_arena(ptr)) {
+    ::free(ptr);
+    return;
+  }
+  size = helpers::round_to_hugepage_size(size);
+  // Give the pages back; the range is repopulated lazily once reused.
+  BUG_ON(madvise(ptr, size, MADV_DONTNEED) != 0);
+
+  uint64_t offset = static_cast<uint8_t *>(ptr) - base_;
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  auto next = free_ranges_.lower_bound(offset);
+  if (next != free_ranges_.end() && offset + size == next->first) {
+    size += next->second;
+    next = free_ranges_.erase(next);
+  }
+  if (next != free_ranges_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return;
+    }
+  }
+  free_ranges_.emplace_hint(next, offset, size);
+}
+
+} // namespace far_memory
@@ -6,17 +6,51 @@ extern "C" {
 
 #include "../DataFrame/AIFM/include/simple_time.hpp"
 #include "aggregator.hpp"
+#include "dataframe_predicate.hpp"
 #include "dataframe_vector.hpp"
 #include "internal/dataframe_types.hpp"
+#include "parallel.hpp"
+#include "parallel_hash_join.hpp"
+#include "parallel_sort.hpp"
 #include "server_dataframe_vector.hpp"
+#include "server_group_by.hpp"
+#include "simd_kernels.hpp"
 
 #include <algorithm>
 #include <cstring>
-#include <unordered_set>
+#include <unistd.h>
 
 namespace far_memory {
 
-template <typename T> ServerDataFrameVector<T>::ServerDataFrameVector() {}
+namespace {
+
+constexpr uint64_t kMinNumElementsPerThread = 1 << 16;
+
+uint32_t get_num_threads(uint64_t num_elements) {
+  return std::max<uint64_t>(
+      1, std::min<uint64_t>(helpers::get_num_runtime_cores(),
+                            num_elements / kMinNumElementsPerThread));
+}
+
+uint64_t get_begin(uint64_t num_elements, uint32_t tid, uint32_t num_threads) {
+  return static_cast<unsigned __int128>(num_elements) * tid / num_threads;
+}
+
+// Splits [0, num_elements) into one range per thread and runs
+// f(tid, begin, end) for each of them.
+template <typename F>
+void parallel_for_ranges(uint64_t num_elements, uint32_t num_threads, F &&f) {
+  parallel_run(num_threads, [&](uint32_t tid) {
+    f(tid, get_begin(num_elements, tid, num_threads),
+      get_begin(num_elements, tid + 1, num_threads));
+  });
+}
+
+} // namespace
+
+template <typename T>
+ServerDataFrameVector<T>::ServerDataFrameVector(Server *server)
+    : server_(server) {}
 
 template <typename T> ServerDataFrameVector<T>::~ServerDataFrameVector() {}
 
@@ -30,6 +64,17 @@ void ServerDataFrameVector<T>::read_object(uint8_t obj_id_len,
   assert(obj_id_len == sizeof(index));
   index = *reinterpret_cast<const uint64_t *>(obj_id);
   auto chunk_size = DataFrameVector<T>::kRealChunkSize;
+  // The tail chunk may be partial, so it is always sent as is.
+  if (encoding_enabled_ &&
+      (index + 1) * chunk_size <= vec_.capacity() * sizeof(T)) {
+    auto len = DataFrameChunkCodec<T>::encode(
+        vec_.data() + index * DataFrameVector<T>::kRealChunkNumEntries,
+        DataFrameVector<T>::kRealChunkNumEntries, data_buf);
+    if (len) {
+      *data_len = len;
+      return;
+    }
+  }
   *data_len = chunk_size;
   __builtin_memcpy(
       data_buf, reinterpret_cast<uint8_t *>(vec_.data()) + index * chunk_size,
@@ -47,13 +92,59 @@ void ServerDataFrameVector<T>::write_object(uint8_t obj_id_len,
   assert(obj_id_len == sizeof(index));
   index = *reinterpret_cast<const uint64_t *>(obj_id);
   auto chunk_size = DataFrameVector<T>::kRealChunkSize;
-  assert(data_len == chunk_size);
+  // The chunk is encoded iff it is shorter.
+  T chunk[DataFrameVector<T>::kRealChunkNumEntries];
+  if (data_len != chunk_size) {
+    DataFrameChunkCodec<T>::decode(data_buf, data_len, chunk,
+                                   DataFrameVector<T>::kRealChunkNumEntries);
+    data_buf = reinterpret_cast<const uint8_t *>(chunk);
+  }
   __builtin_memcpy(
       reinterpret_cast<uint8_t *>(vec_.data()) + index * chunk_size, data_buf,
       std::min(static_cast<std::size_t>(chunk_size),
                vec_.capacity() * sizeof(T) - index * chunk_size));
 }
 
+template <typename T>
+bool ServerDataFrameVector<T>::read_object_zero_copy(
+    uint8_t obj_id_len, const uint8_t *obj_id,
+    const std::function<void(const uint8_t *, uint16_t)> &f) {
+  auto reader_lock = lock_.get_reader_lock();
+  uint64_t index;
+  assert(obj_id_len == sizeof(index));
+  index = *reinterpret_cast<const uint64_t *>(obj_id);
+  auto chunk_size = DataFrameVector<T>::kRealChunkSize;
+  if (unlikely((index + 1) * chunk_size > vec_.capacity() * sizeof(T))) {
+    // The tail chunk is partial; let the caller pad it via the copy path.
+    return false;
+  }
+  if (encoding_enabled_) {
+    // The copy path encodes the chunk.
+    return false;
+  }
+  f(reinterpret_cast<const uint8_t *>(vec_.data()) + index * chunk_size,
+    chunk_size);
+  return true;
+}
+
+template <typename T>
+bool ServerDataFrameVector<T>::write_object_zero_copy(
+    uint8_t obj_id_len, const uint8_t *obj_id, uint16_t data_len,
+    const std::function<void(uint8_t *)> &f) {
+  auto reader_lock = lock_.get_reader_lock();
+  uint64_t index;
+  assert(obj_id_len == sizeof(index));
+  index = *reinterpret_cast<const uint64_t *>(obj_id);
+  auto chunk_size = DataFrameVector<T>::kRealChunkSize;
+  // An encoded chunk goes through the copy path to be decoded.
+  if (unlikely(data_len != chunk_size ||
+               (index + 1) * chunk_size > vec_.capacity() * sizeof(T))) {
+    return false;
+  }
+  f(reinterpret_cast<uint8_t *>(vec_.data()) + index * chunk_size);
+  return true;
+}
+
 template <typename T>
 bool ServerDataFrameVector<T>::remove_object(uint8_t obj_id_len,
                                              const uint8_t *obj_id) {
@@ -61,6 +152,83 @@ bool ServerDataFrameVector<T>::remove_object(uint8_t obj_id_len,
   BUG();
 }
 
+// State: |client size(8B)|size(8B)|data(size * sizeof(T) B)|
+template <typename T> bool ServerDataFrameVector<T>::snapshot(int fd) {
+  auto reader_lock = lock_.get_reader_lock();
+  // The client writes chunks past vec_.size() as long as they fit in the
+  // capacity.
+  uint64_t size = std::max(vec_.size(), client_size_);
+  helpers::file_write_until(fd, &client_size_, sizeof(client_size_));
+  helpers::file_write_until(fd, &size, sizeof(size));
+  helpers::file_write_until(fd, vec_.data(), size * sizeof(T));
+  return true;
+}
+
+template <typename T>
+bool ServerDataFrameVector<T>::restore(int fd, uint64_t offset, uint64_t len) {
+  auto writer_lock_np = lock_.get_writer_lock_np();
+  uint64_t sizes[2];
+  if (len < sizeof(sizes) ||
+      pread(fd, sizes, sizeof(sizes), offset) != sizeof(sizes)) {
+    return false;
+  }
+  auto [client_size, size] = sizes;
+  if (len != sizeof(sizes) + size * sizeof(T) || client_size > size) {
+    return false;
+  }
+  vec_.resize(size);
+  auto *buf = reinterpret_cast<uint8_t *>(vec_.data());
+  uint64_t pos = 0;
+  while (pos < size * sizeof(T)) {
+    auto ret = pread(fd, buf + pos, size * sizeof(T) - pos,
+                     offset + sizeof(sizes) + pos);
+    if (ret <= 0) {
+      return false;
+    }
+    pos += ret;
+  }
+  client_size_ = client_size;
+  return true;
+}
+
+// Input: |enabled(1B)|.
+// Output: ||.
+template <typename T>
+void ServerDataFrameVector<T>::compute_set_encoding(uint16_t input_len,
+                                                   const uint8_t *input_buf,
+                                                   uint16_t *output_len,
+                                                   uint8_t *output_buf) {
+  assert(input_len == sizeof(uint8_t));
+  encoding_enabled_ = input_buf[0];
+  *output_len = 0;
+}
+
+// Input: |size(8B)|.
+// Output: ||.
+template <typename T>
+void ServerDataFrameVector<T>::compute_set_size(uint16_t input_len,
+                                               const uint8_t *input_buf,
+                                               uint16_t *output_len,
+                                               uint8_t *output_buf) {
+  assert(input_len == sizeof(client_size_));
+  client_size_ = *reinterpret_cast<const uint64_t *>(input_buf);
+  *output_len = 0;
+}
+
+// Input: ||.
+// Output: |size(8B)|capacity(8B)|.
+template <typename T>
+void ServerDataFrameVector<T>::compute_get_size(uint16_t input_len,
+                                               const uint8_t *input_buf,
+                                               uint16_t *output_len,
+                                               uint8_t *output_buf) {
+  auto reader_lock = lock_.get_reader_lock();
+  assert(input_len == 0);
+  *output_len = 2 * sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = client_size_;
+  *(reinterpret_cast<uint64_t *>(output_buf) + 1) = vec_.capacity();
+}
+
 template <typename T>
 void ServerDataFrameVector<T>::compute_reserve(uint16_t input_len,
                                                const uint8_t *input_buf,
@@ -89,7 +257,7 @@ void ServerDataFrameVector<T>::compute_unique(uint16_t input_len,
   local_vec_size = *reinterpret_cast<const decltype(local_vec_size) *>(
       input_buf + sizeof(ds_id));
   auto *unique_dataframe_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-      Server::get_server_ds(ds_id));
+      server_->get_server_ds(ds_id));
   auto &unique_stl_vec = unique_dataframe_vec->vec_;
   _compute_unique(local_vec_size, unique_stl_vec);
   *output_len = 2 * sizeof(uint64_t);
@@ -97,29 +265,94 @@ void ServerDataFrameVector<T>::compute_unique(uint16_t input_len,
   *(reinterpret_cast<uint64_t *>(output_buf) + 1) = unique_stl_vec.capacity();
 }
 
+// Appends the unique elements to unique_vec in the order of their first
+// occurrence. The rows are partitioned by hash, one partition per thread, so
+// that each thread dedupes its partition with a private simd::HashSet. The
+// partitions keep the rows in order, which lets each thread flag the first
+// occurrences, and the flagged rows are then compacted in parallel.
 template <typename T>
 template <typename U>
 void ServerDataFrameVector<T>::_compute_unique(uint64_t vec_size,
-                                               std::vector<U> &unique_vec) {
-  auto hash_func = [](std::reference_wrapper<const T> v) -> std::size_t {
-    return (std::hash<T>{}(v.get()));
-  };
-  auto equal_func = [](std::reference_wrapper<const T> lhs,
-                       std::reference_wrapper<const T> rhs) -> bool {
-    return (lhs.get() == rhs.get());
-  };
-  std::unordered_set<typename std::reference_wrapper<T>::type,
-                     decltype(hash_func), decltype(equal_func)>
-      table(vec_size, hash_func, equal_func);
+                                               ArenaVector<U> &unique_vec) {
+  auto num_threads = get_num_threads(vec_size);
+  auto *data = vec_.data();
+  auto offset = unique_vec.size();
+  if (num_threads == 1) {
+    simd::HashSet<T> set(/* expected_size = */ 0);
+    for (uint64_t i = 0; i < vec_size; i++) {
+      if (set.insert(data[i], simd::HashSet<T>::get_hash(data[i]))) {
+        unique_vec.push_back(data[i]);
+      }
+    }
+    return;
+  }
 
-  unique_vec.reserve(vec_size);
-  for (uint64_t i = 0; i < vec_size; i++) {
-    auto citer = vec_[i];
-    const auto insert_ret = table.emplace(std::ref(citer));
+  auto get_partition = [&](uint64_t hash) -> uint32_t {
+    return ((hash >> 32) * num_threads) >> 32;
+  };
+  std::unique_ptr<uint64_t[]> hashes(new uint64_t[vec_size]);
+  std::unique_ptr<uint64_t[]> rows(new uint64_t[vec_size]);
+  std::unique_ptr<uint8_t[]> firsts(new uint8_t[vec_size]());
+  std::unique_ptr<uint64_t[]> cnts(new uint64_t[num_threads * num_threads]);
+  parallel_for_ranges(vec_size, num_threads,
+                      [&](uint32_t tid, uint64_t begin, uint64_t end) {
+                        auto *thread_cnts = &cnts[tid * num_threads];
+                        std::fill(thread_cnts, thread_cnts + num_threads, 0);
+                        for (auto i = begin; i < end; i++) {
+                          hashes[i] = simd::HashSet<T>::get_hash(data[i]);
+                          thread_cnts[get_partition(hashes[i])]++;
+                        }
+                      });
+  std::vector<uint64_t> partition_begins(num_threads + 1);
+  uint64_t pos = 0;
+  for (uint32_t partition = 0; partition < num_threads; partition++) {
+    partition_begins[partition] = pos;
+    for (uint32_t tid = 0; tid < num_threads; tid++) {
+      auto cnt = cnts[tid * num_threads + partition];
+      cnts[tid * num_threads + partition] = pos;
+      pos += cnt;
+    }
+  }
+  partition_begins[num_threads] = pos;
+  parallel_for_ranges(vec_size, num_threads,
+                      [&](uint32_t tid, uint64_t begin, uint64_t end) {
+                        auto *thread_offsets = &cnts[tid * num_threads];
+                        for (auto i = begin; i < end; i++) {
+                          rows[thread_offsets[get_partition(hashes[i])]++] = i;
+                        }
+                      });
+  parallel_run(num_threads, [&](uint32_t partition) {
+    auto begin = partition_begins[partition];
+    auto end = partition_begins[partition + 1];
+    simd::HashSet<T> set(/* expected_size = */ 0);
+    for (auto i = begin; i < end; i++) {
+      auto row = rows[i];
+      firsts[row] = set.insert(data[row], hashes[row]);
+    }
+  });
 
-    if (insert_ret.second)
-      unique_vec.push_back(citer);
+  // Reuse cnts for the number of first occurrences in each range.
+  parallel_for_ranges(vec_size, num_threads,
+                      [&](uint32_t tid, uint64_t begin, uint64_t end) {
+                        cnts[tid] = std::count(firsts.get() + begin,
+                                               firsts.get() + end, 1);
+                      });
+  std::vector<uint64_t> write_offsets(num_threads);
+  for (uint32_t tid = 0; tid < num_threads; tid++) {
+    write_offsets[tid] = offset;
+    offset += cnts[tid];
   }
+  unique_vec.resize(offset);
+  auto *out = unique_vec.data();
+  parallel_for_ranges(vec_size, num_threads,
+                      [&](uint32_t tid, uint64_t begin, uint64_t end) {
+                        auto write_pos = write_offsets[tid];
+                        for (auto i = begin; i < end; i++) {
+                          if (firsts[i]) {
+                            out[write_pos++] = data[i];
+                          }
+                        }
+                      });
 }
 
 template <typename T>
@@ -130,15 +363,21 @@ void ServerDataFrameVector<T>::compute_copy_data_by_idx(
   uint8_t idx_vec_ds_id = input_buf[1];
   uint64_t idx_vec_size = *reinterpret_cast<const uint64_t *>(input_buf + 2);
   auto &ret_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                      Server::get_server_ds(ret_ds_id))
+                      server_->get_server_ds(ret_ds_id))
                       ->vec_;
   auto &idx_vec = reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
-                      Server::get_server_ds(idx_vec_ds_id))
+                      server_->get_server_ds(idx_vec_ds_id))
                       ->vec_;
-  ret_vec.reserve(idx_vec_size);
-  for (uint64_t i = 0; i < idx_vec_size; i++) {
-    ret_vec.push_back(vec_[idx_vec[i]]);
-  }
+  auto offset = ret_vec.size();
+  ret_vec.resize(offset + idx_vec_size);
+  auto *idxs = reinterpret_cast<const uint64_t *>(idx_vec.data());
+  parallel_for_ranges(idx_vec_size, get_num_threads(idx_vec_size),
+                      [&](uint32_t tid, uint64_t begin, uint64_t end) {
+                        simd::gather(vec_.data(), idxs + begin, end - begin,
+                                     kDataFrameNullIdx,
+                                     get_dataframe_null_value<T>(),
+                                     ret_vec.data() + offset + begin);
+                      });
   *output_len = sizeof(uint64_t);
   *reinterpret_cast<uint64_t *>(output_buf) = ret_vec.capacity();
 }
@@ -151,15 +390,20 @@ void ServerDataFrameVector<T>::compute_shuffle_data_by_idx(
   uint8_t idx_vec_ds_id = input_buf[1];
   uint64_t idx_vec_size = *reinterpret_cast<const uint64_t *>(input_buf + 2);
   auto &ret_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                      Server::get_server_ds(ret_ds_id))
+                      server_->get_server_ds(ret_ds_id))
                       ->vec_;
   auto &idx_vec = reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
-                      Server::get_server_ds(idx_vec_ds_id))
+                      server_->get_server_ds(idx_vec_ds_id))
                       ->vec_;
-  ret_vec.reserve(idx_vec_size);
-  for (uint64_t i = 0; i < idx_vec_size; i++) {
-    ret_vec[idx_vec[i]] = vec_[i];
-  }
+  // The elements are written out of order, so they must exist beforehand.
+  ret_vec.resize(idx_vec_size);
+  // idx_vec is a permutation, so the threads never write the same element.
+  parallel_for_ranges(idx_vec_size, get_num_threads(idx_vec_size),
+                      [&](uint32_t tid, uint64_t begin, uint64_t end) {
+                        for (auto i = begin; i < end; i++) {
+                          ret_vec[idx_vec[i]] = vec_[i];
+                        }
+                      });
   *output_len = sizeof(uint64_t);
   *reinterpret_cast<uint64_t *>(output_buf) = ret_vec.capacity();
 }
@@ -176,7 +420,7 @@ void ServerDataFrameVector<T>::compute_assign(uint16_t input_len,
       input_buf + sizeof(from_vec_ds_id) + sizeof(from_vec_begin_idx));
   auto size = from_vec_end_idx - from_vec_begin_idx;
   auto &from_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                       Server::get_server_ds(from_vec_ds_id))
+                       server_->get_server_ds(from_vec_ds_id))
                        ->vec_;
   vec_.resize(size);
   memcpy(vec_.data(), from_vec.data() + from_vec_begin_idx, size * sizeof(T));
@@ -184,6 +428,143 @@ void ServerDataFrameVector<T>::compute_assign(uint16_t input_len,
   *reinterpret_cast<uint64_t *>(output_buf) = vec_.capacity();
 }
 
+// Input: |ret_ds_id(1B)|size(8B)|predicate|, see DataFramePredicate.
+// Output: |ret_size(8B)|ret_capacity(8B)|.
+template <typename T>
+void ServerDataFrameVector<T>::compute_filter(uint16_t input_len,
+                                              const uint8_t *input_buf,
+                                              uint16_t *output_len,
+                                              uint8_t *output_buf) {
+  constexpr auto kBlockSize = DataFramePredicateEvaluator::kBlockSize;
+  uint8_t ret_ds_id;
+  uint64_t size;
+  constexpr uint32_t kHeaderLen = sizeof(ret_ds_id) + sizeof(size);
+  BUG_ON(input_len <= kHeaderLen);
+  ret_ds_id = input_buf[0];
+  size = *reinterpret_cast<const uint64_t *>(input_buf + sizeof(ret_ds_id));
+  auto &ret_vec = reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+                      server_->get_server_ds(ret_ds_id))
+                      ->vec_;
+  DataFramePredicateEvaluator evaluator(input_buf + kHeaderLen,
+                                        input_len - kHeaderLen);
+  auto loader = [&](uint8_t ds_id, uint8_t dt_id, uint64_t begin,
+                    uint32_t len) -> const uint8_t * {
+    const uint8_t *data;
+    visit_dataframe_type(dt_id, [&](auto *type_tag) {
+      using U = std::remove_pointer_t<decltype(type_tag)>;
+      auto &vec = reinterpret_cast<ServerDataFrameVector<U> *>(
+                      server_->get_server_ds(ds_id))
+                      ->vec_;
+      BUG_ON(begin + len > vec.capacity());
+      data = reinterpret_cast<const uint8_t *>(vec.data() + begin);
+    });
+    return data;
+  };
+  uint8_t mask[kBlockSize];
+  for (uint64_t begin = 0; begin < size; begin += kBlockSize) {
+    auto len =
+        static_cast<uint32_t>(std::min<uint64_t>(kBlockSize, size - begin));
+    evaluator.eval(loader, begin, len, mask);
+    for (uint32_t i = 0; i < len; i++) {
+      if (mask[i]) {
+        ret_vec.push_back(begin + i);
+      }
+    }
+  }
+  *output_len = 2 * sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = ret_vec.size();
+  *(reinterpret_cast<uint64_t *>(output_buf) + 1) = ret_vec.capacity();
+}
+
+// Input: |lhs_ret_ds_id(1B)|rhs_ret_ds_id(1B)|rhs_ds_id(1B)|lhs_size(8B)|
+//        |rhs_size(8B)|policy(1B)|.
+// Output: |ret_size(8B)|lhs_ret_capacity(8B)|rhs_ret_capacity(8B)|.
+template <typename T>
+void ServerDataFrameVector<T>::compute_join(uint16_t input_len,
+                                            const uint8_t *input_buf,
+                                            uint16_t *output_len,
+                                            uint8_t *output_buf) {
+  uint8_t lhs_ret_ds_id, rhs_ret_ds_id, rhs_ds_id;
+  uint64_t lhs_size, rhs_size;
+  DataFrameJoinPolicy policy;
+  BUG_ON(input_len != 3 * sizeof(uint8_t) + 2 * sizeof(uint64_t) +
+                          sizeof(policy));
+  lhs_ret_ds_id = input_buf[0];
+  rhs_ret_ds_id = input_buf[1];
+  rhs_ds_id = input_buf[2];
+  __builtin_memcpy(&lhs_size, input_buf + 3, sizeof(lhs_size));
+  __builtin_memcpy(&rhs_size, input_buf + 3 + sizeof(lhs_size),
+                   sizeof(rhs_size));
+  __builtin_memcpy(&policy, input_buf + 3 + 2 * sizeof(lhs_size),
+                   sizeof(policy));
+  auto &rhs_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
+                      server_->get_server_ds(rhs_ds_id))
+                      ->vec_;
+  auto &lhs_ret_vec =
+      reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+          server_->get_server_ds(lhs_ret_ds_id))
+          ->vec_;
+  auto &rhs_ret_vec =
+      reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+          server_->get_server_ds(rhs_ret_ds_id))
+          ->vec_;
+  BUG_ON(lhs_size > vec_.capacity() || rhs_size > rhs_vec.capacity());
+  static_assert(ParallelHashJoin<T>::kNullIdx == kDataFrameNullIdx);
+
+  bool keep_lhs = (policy == DataFrameJoinPolicy::Left ||
+                   policy == DataFrameJoinPolicy::LeftRight);
+  bool keep_rhs = (policy == DataFrameJoinPolicy::Right ||
+                   policy == DataFrameJoinPolicy::LeftRight);
+  // Build on the smaller side, which keeps the hash table small.
+  bool build_lhs = (lhs_size <= rhs_size);
+  auto *build = build_lhs ? vec_.data() : rhs_vec.data();
+  auto *probe = build_lhs ? rhs_vec.data() : vec_.data();
+  auto build_size = build_lhs ? lhs_size : rhs_size;
+  auto probe_size = build_lhs ? rhs_size : lhs_size;
+  auto result =
+      ParallelHashJoin<T>(build, build_size)
+          .probe(probe, probe_size, build_lhs ? keep_lhs : keep_rhs,
+                 build_lhs ? keep_rhs : keep_lhs);
+  lhs_ret_vec.resize(result.size());
+  rhs_ret_vec.resize(result.size());
+  auto *lhs_rows = reinterpret_cast<uint64_t *>(lhs_ret_vec.data());
+  auto *rhs_rows = reinterpret_cast<uint64_t *>(rhs_ret_vec.data());
+  if (build_lhs) {
+    result.copy_to(lhs_rows, rhs_rows);
+  } else {
+    result.copy_to(rhs_rows, lhs_rows);
+  }
+  *output_len = 3 * sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = result.size();
+  *(reinterpret_cast<uint64_t *>(output_buf) + 1) = lhs_ret_vec.capacity();
+  *(reinterpret_cast<uint64_t *>(output_buf) + 2) = rhs_ret_vec.capacity();
+}
+
+// Input: |ret_ds_id(1B)|size(8B)|ascending(1B)|.
+// Output: |ret_size(8B)|ret_capacity(8B)|.
+template <typename T>
+void ServerDataFrameVector<T>::compute_arg_sort(uint16_t input_len,
+                                                const uint8_t *input_buf,
+                                                uint16_t *output_len,
+                                                uint8_t *output_buf) {
+  uint8_t ret_ds_id;
+  uint64_t size;
+  uint8_t ascending;
+  BUG_ON(input_len != sizeof(ret_ds_id) + sizeof(size) + sizeof(ascending));
+  ret_ds_id = input_buf[0];
+  size = *reinterpret_cast<const uint64_t *>(input_buf + sizeof(ret_ds_id));
+  ascending = input_buf[sizeof(ret_ds_id) + sizeof(size)];
+  auto &ret_vec = reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+                      server_->get_server_ds(ret_ds_id))
+                      ->vec_;
+  ret_vec.resize(size);
+  ParallelSorter<T>(size).rank(vec_.data(), ascending,
+                               reinterpret_cast<uint64_t *>(ret_vec.data()));
+  *output_len = 2 * sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = ret_vec.size();
+  *(reinterpret_cast<uint64_t *>(output_buf) + 1) = ret_vec.capacity();
+}
+
 template <typename T>
 void ServerDataFrameVector<T>::compute_aggregate(uint8_t opcode,
                                                  uint16_t input_len,
@@ -257,28 +638,105 @@ std::pair<uint64_t, uint64_t>
 ServerDataFrameVector<T>::_compute_aggregate(uint8_t opcode, uint8_t result_ds,
                                              uint8_t key_ds, uint64_t size) {
   auto &result_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                         Server::get_server_ds(result_ds))
+                         server_->get_server_ds(result_ds))
                          ->vec_;
   auto &key_vec = reinterpret_cast<ServerDataFrameVector<Key_t> *>(
-                      Server::get_server_ds(key_ds))
+                      server_->get_server_ds(key_ds))
                       ->vec_;
-  std::unique_ptr<Aggregator<T>> aggregator(
-      AggregatorFactory<T>::build(opcode, /* limited_mem */ false, nullptr));
-  DerefScope *scope =
-      nullptr; // Never used. Just for complying with add()'s interface.
-  Key_t last_key = key_vec[0];
-  for (uint64_t i = 0; i < size; i++) {
-    auto cur_key = key_vec[i];
-    if (last_key != cur_key) {
-      result_vec.push_back(aggregator->aggregate());
-      last_key = cur_key;
+  auto *data = vec_.data();
+  auto num_threads = get_num_threads(size);
+  // Each thread aggregates the runs of equal keys that start in its range.
+  std::vector<std::vector<T>> thread_results(num_threads);
+  parallel_for_ranges(size, num_threads, [&](uint32_t tid, uint64_t begin,
+                                             uint64_t end) {
+    std::unique_ptr<Aggregator<T>> aggregator;
+    if (opcode == GenericDataFrameVector::OpCode::AggregateMedian) {
+      aggregator.reset(AggregatorFactory<T>::build(
+          opcode, /* limited_mem */ false, nullptr));
+    }
+    DerefScope *scope =
+        nullptr; // Never used. Just for complying with add()'s interface.
+    while (begin > 0 && begin < end && key_vec[begin - 1] == key_vec[begin]) {
+      begin++;
+    }
+    auto &results = thread_results[tid];
+    for (auto run_begin = begin, run_end = begin; run_begin < end;
+         run_begin = run_end) {
+      while (run_end < size && key_vec[run_end] == key_vec[run_begin]) {
+        run_end++;
+      }
+      switch (opcode) {
+      case GenericDataFrameVector::OpCode::AggregateMax:
+        results.push_back(
+            simd::reduce_max(data + run_begin, run_end - run_begin));
+        break;
+      case GenericDataFrameVector::OpCode::AggregateMin:
+        results.push_back(
+            simd::reduce_min(data + run_begin, run_end - run_begin));
+        break;
+      default:
+        for (auto i = run_begin; i < run_end; i++) {
+          aggregator->add(scope, data[i]);
+        }
+        results.push_back(aggregator->aggregate());
+      }
+    }
+  });
+  for (auto &results : thread_results) {
+    for (auto &result : results) {
+      result_vec.push_back(result);
     }
-    aggregator->add(scope, vec_[i]);
   }
-  result_vec.push_back(aggregator->aggregate());
   return std::make_pair(result_vec.size(), result_vec.capacity());
 }
 
+// Input: |vec_size(8B)|.
+// Output: the unique elements in the order of their first occurrence, in
+// chunks of at most kMaxStreamChunkSize B. Unlike _compute_unique(), it
+// dedupes in a single pass, so that each chunk is emitted as soon as it fills
+// up instead of after the whole column has been deduped.
+template <typename T>
+void ServerDataFrameVector<T>::compute_unique_stream(
+    uint64_t input_len, const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &emit) {
+  constexpr uint32_t kMaxStreamChunkSize = 1 << 16;
+  constexpr uint32_t kNumElementsPerChunk = kMaxStreamChunkSize / sizeof(T);
+  uint64_t local_vec_size;
+  BUG_ON(input_len != sizeof(local_vec_size));
+  local_vec_size = *reinterpret_cast<const uint64_t *>(input_buf);
+  auto *data = vec_.data();
+  simd::HashSet<T> set(/* expected_size = */ 0);
+  std::unique_ptr<T[]> chunk(new T[kNumElementsPerChunk]);
+  uint32_t num_elements = 0;
+  for (uint64_t i = 0; i < local_vec_size; i++) {
+    if (set.insert(data[i], simd::HashSet<T>::get_hash(data[i]))) {
+      chunk[num_elements++] = data[i];
+      if (num_elements == kNumElementsPerChunk) {
+        emit(reinterpret_cast<const uint8_t *>(chunk.get()),
+             num_elements * sizeof(T));
+        num_elements = 0;
+      }
+    }
+  }
+  if (num_elements) {
+    emit(reinterpret_cast<const uint8_t *>(chunk.get()),
+         num_elements * sizeof(T));
+  }
+}
+
+template <typename T>
+void ServerDataFrameVector<T>::compute_stream(
+    uint8_t opcode, uint64_t input_len, const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &emit) {
+  switch (opcode) {
+  case GenericDataFrameVector::OpCode::UniqueStream:
+    compute_unique_stream(input_len, input_buf, emit);
+    break;
+  default:
+    ServerDS::compute_stream(opcode, input_len, input_buf, emit);
+  }
+}
+
 template <typename T>
 void ServerDataFrameVector<T>::compute(uint8_t opcode, uint16_t input_len,
                                        const uint8_t *input_buf,
@@ -305,11 +763,36 @@ void ServerDataFrameVector<T>::compute(uint8_t opcode, uint16_t input_len,
   case GenericDataFrameVector::OpCode::AggregateMedian:
     compute_aggregate(opcode, input_len, input_buf, output_len, output_buf);
     break;
+  case GenericDataFrameVector::OpCode::Filter:
+    compute_filter(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::ArgSort:
+    compute_arg_sort(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::Join:
+    compute_join(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::SetEncoding:
+    compute_set_encoding(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::SetSize:
+    compute_set_size(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::GetSize:
+    compute_get_size(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::GroupBy:
+    ServerGroupBy(server_).compute(input_len, input_buf, output_len,
+                                   output_buf);
+    break;
   default:
     BUG();
   }
 }
 
+ServerDataFrameVectorFactory::ServerDataFrameVectorFactory(Server *server)
+    : server_(server) {}
+
 ServerDS *ServerDataFrameVectorFactory::build(uint32_t param_len,
                                               uint8_t *params) {
   uint8_t dt_id;
@@ -318,27 +801,27 @@ ServerDS *ServerDataFrameVectorFactory::build(uint32_t param_len,
 
   switch (dt_id) {
   case DataFrameTypeID::Char:
-    return new ServerDataFrameVector<char>();
+    return new ServerDataFrameVector<char>(server_);
   case DataFrameTypeID::Short:
-    return new ServerDataFrameVector<short>();
+    return new ServerDataFrameVector<short>(server_);
   case DataFrameTypeID::Int:
-    return new ServerDataFrameVector<int>();
+    return new ServerDataFrameVector<int>(server_);
   case DataFrameTypeID::UnsignedInt:
-    return new ServerDataFrameVector<unsigned int>();
+    return new ServerDataFrameVector<unsigned int>(server_);
   case DataFrameTypeID::Long:
-    return new ServerDataFrameVector<long>();
+    return new ServerDataFrameVector<long>(server_);
   case DataFrameTypeID::UnsignedLong:
-    return new ServerDataFrameVector<unsigned long>();
+    return new ServerDataFrameVector<unsigned long>(server_);
   case DataFrameTypeID::LongLong:
-    return new ServerDataFrameVector<long long>();
+    return new ServerDataFrameVector<long long>(server_);
   case DataFrameTypeID::UnsignedLongLong:
-    return new ServerDataFrameVector<unsigned long long>();
+    return new ServerDataFrameVector<unsigned long long>(server_);
   case DataFrameTypeID::Float:
-    return new ServerDataFrameVector<float>();
+    return new ServerDataFrameVector<float>(server_);
   case DataFrameTypeID::Double:
-    return new ServerDataFrameVector<double>();
+    return new ServerDataFrameVector<double>(server_);
   case DataFrameTypeID::Time:
-    return new ServerDataFrameVector<SimpleTime>();
+    return new ServerDataFrameVector<SimpleTime>(server_);
   default:
     BUG();
   }
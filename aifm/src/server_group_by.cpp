@@ -0,0 +1,335 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/stddef.h>
+}
+
+#include "dataframe_group_by.hpp"
+#include "hash.hpp"
+#include "helpers.hpp"
+#include "internal/dataframe_types.hpp"
+#include "parallel.hpp"
+#include "server_dataframe_vector.hpp"
+#include "server_group_by.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace far_memory {
+
+namespace {
+
+template <typename T> T read_val(const uint8_t *&buf, const uint8_t *end) {
+  T val;
+  BUG_ON(buf + sizeof(T) > end);
+  __builtin_memcpy(&val, buf, sizeof(T));
+  buf += sizeof(T);
+  return val;
+}
+
+} // namespace
+
+ServerGroupBy::ServerGroupBy(Server *server) : server_(server) {}
+
+uint64_t ServerGroupBy::get_begin(uint32_t tid) const {
+  return static_cast<unsigned __int128>(num_rows_) * tid / num_threads_;
+}
+
+template <typename T> ArenaVector<T> &ServerGroupBy::get_vec(uint8_t ds_id) {
+  return reinterpret_cast<ServerDataFrameVector<T> *>(
+             server_->get_server_ds(ds_id))
+      ->vec_;
+}
+
+template <typename F> void ServerGroupBy::for_each_partition(F &&f) {
+  parallel_run(num_threads_, [&](uint32_t tid) {
+    for (auto i = tid; i < partitions_.size(); i += num_threads_) {
+      f(partitions_[i]);
+    }
+  });
+}
+
+template <typename T> void ServerGroupBy::hash_key_column(const T *data) {
+  parallel_run(num_threads_, [&](uint32_t tid) {
+    for (auto i = get_begin(tid); i < get_begin(tid + 1); i++) {
+      hashes_[i] = hash_mix_64(hashes_[i] * 31 + std::hash<T>{}(data[i]));
+    }
+  });
+}
+
+void ServerGroupBy::partition() {
+  uint32_t num_partitions = 1 << num_partition_bits_;
+  auto get_partition = [&](uint64_t hash) -> uint32_t {
+    return num_partition_bits_ ? hash >> (64 - num_partition_bits_) : 0;
+  };
+  std::unique_ptr<uint64_t[]> cnts(new uint64_t[num_threads_ * num_partitions]);
+  parallel_run(num_threads_, [&](uint32_t tid) {
+    auto *thread_cnts = &cnts[tid * num_partitions];
+    std::fill(thread_cnts, thread_cnts + num_partitions, 0);
+    for (auto i = get_begin(tid); i < get_begin(tid + 1); i++) {
+      thread_cnts[get_partition(hashes_[i])]++;
+    }
+  });
+  partitions_.resize(num_partitions);
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < num_partitions; i++) {
+    partitions_[i].begin = offset;
+    for (uint32_t tid = 0; tid < num_threads_; tid++) {
+      auto cnt = cnts[tid * num_partitions + i];
+      cnts[tid * num_partitions + i] = offset;
+      offset += cnt;
+    }
+    partitions_[i].end = offset;
+  }
+  rows_.reset(new uint64_t[num_rows_]);
+  std::unique_ptr<uint64_t[]> hashes(new uint64_t[num_rows_]);
+  parallel_run(num_threads_, [&](uint32_t tid) {
+    auto *thread_offsets = &cnts[tid * num_partitions];
+    for (auto i = get_begin(tid); i < get_begin(tid + 1); i++) {
+      auto pos = thread_offsets[get_partition(hashes_[i])]++;
+      rows_[pos] = i;
+      hashes[pos] = hashes_[i];
+    }
+  });
+  hashes_ = std::move(hashes);
+}
+
+void ServerGroupBy::build_groups(Partition &partition) {
+  std::vector<uint64_t> group_hashes;
+  std::vector<uint32_t> table(kInitTableSize, kEmptySlot);
+  auto insert = [&](uint32_t group, uint64_t hash) {
+    auto mask = table.size() - 1;
+    auto slot = hash & mask;
+    while (table[slot] != kEmptySlot) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = group;
+  };
+  auto keys_equal = [&](uint64_t a, uint64_t b) {
+    for (auto &key_equal_fn : key_equal_fns_) {
+      if (!key_equal_fn(a, b)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  partition.row_groups.reserve(partition.end - partition.begin);
+  for (auto i = partition.begin; i < partition.end; i++) {
+    auto hash = hashes_[i];
+    auto row = rows_[i];
+    auto mask = table.size() - 1;
+    auto slot = hash & mask;
+    uint32_t group;
+    while (true) {
+      group = table[slot];
+      if (group == kEmptySlot) {
+        group = partition.rep_rows.size();
+        BUG_ON(group == kEmptySlot);
+        partition.rep_rows.push_back(row);
+        partition.group_sizes.push_back(0);
+        group_hashes.push_back(hash);
+        table[slot] = group;
+        break;
+      }
+      if (group_hashes[group] == hash &&
+          keys_equal(partition.rep_rows[group], row)) {
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+    partition.row_groups.push_back(group);
+    partition.group_sizes[group]++;
+    // Keep the load factor at most 1/2.
+    if (unlikely(group_hashes.size() * 2 > table.size())) {
+      table.assign(table.size() * 2, kEmptySlot);
+      for (uint32_t j = 0; j < group_hashes.size(); j++) {
+        insert(j, group_hashes[j]);
+      }
+    }
+  }
+}
+
+template <typename T>
+uint64_t ServerGroupBy::fill_key_column(const T *data, uint8_t out_ds_id) {
+  auto &out_vec = get_vec<T>(out_ds_id);
+  out_vec.resize(num_groups_);
+  auto *out = out_vec.data();
+  for_each_partition([&](Partition &partition) {
+    for (uint64_t i = 0; i < partition.rep_rows.size(); i++) {
+      out[partition.group_offset + i] = data[partition.rep_rows[i]];
+    }
+  });
+  return out_vec.capacity();
+}
+
+template <typename U, typename Init, typename Update>
+uint64_t ServerGroupBy::fold(uint8_t out_ds_id, Init &&init, Update &&update) {
+  auto &out_vec = get_vec<U>(out_ds_id);
+  out_vec.resize(num_groups_);
+  auto *out = out_vec.data();
+  for_each_partition([&](Partition &partition) {
+    auto *groups = out + partition.group_offset;
+    for (uint32_t i = 0; i < partition.rep_rows.size(); i++) {
+      groups[i] = init(partition, i);
+    }
+    for (auto i = partition.begin; i < partition.end; i++) {
+      update(groups[partition.row_groups[i - partition.begin]], rows_[i]);
+    }
+  });
+  return out_vec.capacity();
+}
+
+template <typename T>
+uint64_t ServerGroupBy::fill_agg_column(const T *data, GroupByAggFn fn,
+                                        uint8_t out_ds_id) {
+  auto init_rep = [&](Partition &partition, uint32_t group) {
+    return data[partition.rep_rows[group]];
+  };
+  switch (fn) {
+  case GroupByAggFn::Count:
+    return fold<unsigned long long>(
+        out_ds_id,
+        [](Partition &partition, uint32_t group) {
+          return partition.group_sizes[group];
+        },
+        [](unsigned long long &, uint64_t) {});
+  case GroupByAggFn::Min:
+    return fold<T>(out_ds_id, init_rep, [&](T &min, uint64_t row) {
+      if (data[row] < min) {
+        min = data[row];
+      }
+    });
+  case GroupByAggFn::Max:
+    return fold<T>(out_ds_id, init_rep, [&](T &max, uint64_t row) {
+      if (max < data[row]) {
+        max = data[row];
+      }
+    });
+  default:
+    break;
+  }
+
+  if constexpr (std::is_arithmetic<T>::value) {
+    switch (fn) {
+    case GroupByAggFn::Sum:
+      return fold<KernelSum_t<T>>(
+          out_ds_id, [](Partition &, uint32_t) { return KernelSum_t<T>(0); },
+          [&](KernelSum_t<T> &sum, uint64_t row) { sum += data[row]; });
+    case GroupByAggFn::Mean: {
+      auto capacity = fold<double>(
+          out_ds_id, [](Partition &, uint32_t) { return 0.0; },
+          [&](double &sum, uint64_t row) { sum += data[row]; });
+      auto *out = get_vec<double>(out_ds_id).data();
+      for_each_partition([&](Partition &partition) {
+        for (uint32_t i = 0; i < partition.rep_rows.size(); i++) {
+          out[partition.group_offset + i] /= partition.group_sizes[i];
+        }
+      });
+      return capacity;
+    }
+    case GroupByAggFn::Std: {
+      // Welford's algorithm, which does not cancel catastrophically like the
+      // sum of squares does.
+      auto &out_vec = get_vec<double>(out_ds_id);
+      out_vec.resize(num_groups_);
+      auto *out = out_vec.data();
+      for_each_partition([&](Partition &partition) {
+        auto num_groups = partition.rep_rows.size();
+        std::vector<uint64_t> cnts(num_groups);
+        std::vector<double> means(num_groups);
+        std::vector<double> m2s(num_groups);
+        for (auto i = partition.begin; i < partition.end; i++) {
+          auto group = partition.row_groups[i - partition.begin];
+          double val = data[rows_[i]];
+          auto delta = val - means[group];
+          means[group] += delta / ++cnts[group];
+          m2s[group] += delta * (val - means[group]);
+        }
+        for (uint32_t i = 0; i < num_groups; i++) {
+          out[partition.group_offset + i] =
+              (cnts[i] < 2) ? 0 : std::sqrt(m2s[i] / (cnts[i] - 1));
+        }
+      });
+      return out_vec.capacity();
+    }
+    default:
+      break;
+    }
+  }
+  BUG();
+}
+
+void ServerGroupBy::compute(uint16_t input_len, const uint8_t *input_buf,
+                            uint16_t *output_len, uint8_t *output_buf) {
+  auto *buf = input_buf;
+  auto *end = input_buf + input_len;
+  num_rows_ = read_val<uint64_t>(buf, end);
+  auto num_keys = read_val<uint8_t>(buf, end);
+  auto num_aggs = read_val<uint8_t>(buf, end);
+  BUG_ON(!num_keys);
+  num_threads_ = std::max<uint64_t>(
+      1, std::min<uint64_t>(helpers::get_num_runtime_cores(),
+                            num_rows_ / kMinNumRowsPerThread));
+  num_partition_bits_ = 0;
+  while (num_partition_bits_ < kMaxNumPartitionBits &&
+         (kNumRowsPerPartition << num_partition_bits_) < num_rows_) {
+    num_partition_bits_++;
+  }
+
+  // Hash the key tuples.
+  auto *keys = buf;
+  hashes_.reset(new uint64_t[num_rows_]());
+  for (uint8_t i = 0; i < num_keys; i++) {
+    auto ds_id = read_val<uint8_t>(buf, end);
+    auto dt_id = read_val<uint8_t>(buf, end);
+    read_val<uint8_t>(buf, end); // out_ds_id.
+    visit_dataframe_type(dt_id, [&](auto *type_tag) {
+      using T = std::remove_pointer_t<decltype(type_tag)>;
+      auto &vec = get_vec<T>(ds_id);
+      BUG_ON(vec.capacity() < num_rows_);
+      const T *data = vec.data();
+      hash_key_column(data);
+      key_equal_fns_.push_back(
+          [data](uint64_t a, uint64_t b) { return data[a] == data[b]; });
+    });
+  }
+
+  // Group.
+  partition();
+  for_each_partition([&](Partition &partition) { build_groups(partition); });
+  num_groups_ = 0;
+  for (auto &partition : partitions_) {
+    partition.group_offset = num_groups_;
+    num_groups_ += partition.rep_rows.size();
+  }
+
+  // Write the output columns.
+  auto *output = reinterpret_cast<uint64_t *>(output_buf);
+  *output++ = num_groups_;
+  for (uint8_t i = 0; i < num_keys; i++) {
+    auto ds_id = read_val<uint8_t>(keys, end);
+    auto dt_id = read_val<uint8_t>(keys, end);
+    auto out_ds_id = read_val<uint8_t>(keys, end);
+    visit_dataframe_type(dt_id, [&](auto *type_tag) {
+      using T = std::remove_pointer_t<decltype(type_tag)>;
+      *output++ = fill_key_column(get_vec<T>(ds_id).data(), out_ds_id);
+    });
+  }
+  for (uint8_t i = 0; i < num_aggs; i++) {
+    auto ds_id = read_val<uint8_t>(buf, end);
+    auto dt_id = read_val<uint8_t>(buf, end);
+    auto fn = read_val<GroupByAggFn>(buf, end);
+    auto out_ds_id = read_val<uint8_t>(buf, end);
+    visit_dataframe_type(dt_id, [&](auto *type_tag) {
+      using T = std::remove_pointer_t<decltype(type_tag)>;
+      auto &vec = get_vec<T>(ds_id);
+      BUG_ON(vec.capacity() < num_rows_);
+      *output++ = fill_agg_column(vec.data(), fn, out_ds_id);
+    });
+  }
+  BUG_ON(buf != end);
+  *output_len = reinterpret_cast<uint8_t *>(output) - output_buf;
+}
+
+} // namespace far_memory
@@ -1,7 +1,10 @@
 #include "server_hashtable.hpp"
 #include "helpers.hpp"
+#include "server_arena.hpp"
 
 #include <cstring>
+#include <sys/mman.h>
+#include <vector>
 
 namespace far_memory {
 
@@ -10,7 +13,7 @@ ServerHashTable::ServerHashTable(uint32_t param_len, uint8_t *params) {
   auto remote_data_size =
       *reinterpret_cast<uint64_t *>(&params[sizeof(remote_num_entries_shift)]);
   local_hopscotch_.reset(new LocalGenericConcurrentHopscotch(
-      remote_num_entries_shift, remote_data_size));
+      remote_num_entries_shift, remote_data_size, &ServerArena::get()));
 }
 
 ServerHashTable::~ServerHashTable() {}
@@ -41,6 +44,53 @@ void ServerHashTable::compute(uint8_t opcode, uint16_t input_len,
   BUG();
 }
 
+// State: a sequence of |key_len(1B)|val_len(2B)|key|val|.
+bool ServerHashTable::snapshot(int fd) {
+  constexpr uint32_t kBufSize = 1 << 20;
+  std::vector<uint8_t> buf;
+  buf.reserve(kBufSize);
+  local_hopscotch_->for_each([&](uint8_t key_len, const uint8_t *key,
+                                 uint16_t val_len, const uint8_t *val) {
+    auto *p = reinterpret_cast<const uint8_t *>(&key_len);
+    buf.insert(buf.end(), p, p + sizeof(key_len));
+    p = reinterpret_cast<const uint8_t *>(&val_len);
+    buf.insert(buf.end(), p, p + sizeof(val_len));
+    buf.insert(buf.end(), key, key + key_len);
+    buf.insert(buf.end(), val, val + val_len);
+    if (buf.size() >= kBufSize) {
+      helpers::file_write_until(fd, buf.data(), buf.size());
+      buf.clear();
+    }
+  });
+  helpers::file_write_until(fd, buf.data(), buf.size());
+  return true;
+}
+
+bool ServerHashTable::restore(int fd, uint64_t offset, uint64_t len) {
+  if (!len) {
+    return true;
+  }
+  auto ptr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, offset);
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+  auto mmap_guard = helpers::finally([&]() { munmap(ptr, len); });
+  auto *cur = reinterpret_cast<const uint8_t *>(ptr);
+  auto *end = cur + len;
+  while (cur < end) {
+    auto key_len = *cur;
+    auto val_len = *reinterpret_cast<const uint16_t *>(cur + sizeof(key_len));
+    auto *key = cur + sizeof(key_len) + sizeof(val_len);
+    auto *val = key + key_len;
+    if (val + val_len > end) {
+      return false;
+    }
+    local_hopscotch_->put(key_len, key, val_len, val);
+    cur = val + val_len;
+  }
+  return true;
+}
+
 ServerDS *ServerHashTableFactory::build(uint32_t param_len, uint8_t *params) {
   return new ServerHashTable(param_len, params);
 }
@@ -0,0 +1,170 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/compiler.h>
+#include <base/stddef.h>
+}
+
+#include "server_kernel.hpp"
+#include "simd_kernels.hpp"
+
+#include <cstring>
+
+namespace far_memory {
+
+std::unordered_map<std::string, ServerKernel> &
+ServerKernelRegistry::get_kernels() {
+  static std::unordered_map<std::string, ServerKernel> kernels;
+  return kernels;
+}
+
+bool ServerKernelRegistry::register_kernel(const std::string &name,
+                                           ServerKernel kernel) {
+  return get_kernels().emplace(name, kernel).second;
+}
+
+ServerKernel ServerKernelRegistry::find(const std::string &name) {
+  auto &kernels = get_kernels();
+  auto iter = kernels.find(name);
+  return iter == kernels.end() ? nullptr : iter->second;
+}
+
+namespace {
+
+// Invokes f with a value of the C++ type that type stands for.
+template <typename F> void dispatch_type(uint8_t type, F &&f) {
+  switch (static_cast<KernelType>(type)) {
+  case KernelType::Int8:
+    f(int8_t());
+    break;
+  case KernelType::UInt8:
+    f(uint8_t());
+    break;
+  case KernelType::Int16:
+    f(int16_t());
+    break;
+  case KernelType::UInt16:
+    f(uint16_t());
+    break;
+  case KernelType::Int32:
+    f(int32_t());
+    break;
+  case KernelType::UInt32:
+    f(uint32_t());
+    break;
+  case KernelType::Int64:
+    f(int64_t());
+    break;
+  case KernelType::UInt64:
+    f(uint64_t());
+    break;
+  case KernelType::Float:
+    f(float());
+    break;
+  case KernelType::Double:
+    f(double());
+    break;
+  default:
+    BUG();
+  }
+}
+
+template <typename T>
+bool any_of(const uint8_t *object, uint16_t len, KernelCmpOp op, T val) {
+  for (uint16_t i = 0; i + sizeof(T) <= len; i += sizeof(T)) {
+    T elem;
+    __builtin_memcpy(&elem, object + i, sizeof(T));
+    if (kernel_compare(op, elem, val)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Predicate kernels' args: |op(1B)|type(1B)|value|.
+template <typename T>
+T parse_predicate(const uint8_t *args, uint16_t args_len, KernelCmpOp *op) {
+  T val;
+  BUG_ON(args_len != 2 * sizeof(uint8_t) + sizeof(T));
+  BUG_ON(args[0] > static_cast<uint8_t>(KernelCmpOp::Ge));
+  *op = static_cast<KernelCmpOp>(args[0]);
+  __builtin_memcpy(&val, &args[2 * sizeof(uint8_t)], sizeof(T));
+  return val;
+}
+
+void sum_kernel(const uint8_t *args, uint16_t args_len, uint32_t num_objects,
+                const uint8_t *const *objects, const uint16_t *lens,
+                uint16_t *output_len, uint8_t *output_buf) {
+  BUG_ON(args_len != sizeof(uint8_t));
+  dispatch_type(args[0], [&](auto type) {
+    using T = decltype(type);
+    KernelSum_t<T> sum = 0;
+    for (uint32_t i = 0; i < num_objects; i++) {
+      sum += simd::reduce_sum(reinterpret_cast<const T *>(objects[i]),
+                              lens[i] / sizeof(T));
+    }
+    *output_len = sizeof(sum);
+    __builtin_memcpy(output_buf, &sum, sizeof(sum));
+  });
+}
+
+void find_first_kernel(const uint8_t *args, uint16_t args_len,
+                       uint32_t num_objects, const uint8_t *const *objects,
+                       const uint16_t *lens, uint16_t *output_len,
+                       uint8_t *output_buf) {
+  BUG_ON(args_len < 2 * sizeof(uint8_t));
+  uint32_t pos = kKernelNotFound;
+  dispatch_type(args[1], [&](auto type) {
+    using T = decltype(type);
+    KernelCmpOp op;
+    auto val = parse_predicate<T>(args, args_len, &op);
+    for (uint32_t i = 0; i < num_objects; i++) {
+      if (any_of(objects[i], lens[i], op, val)) {
+        pos = i;
+        break;
+      }
+    }
+  });
+  *output_len = sizeof(pos);
+  __builtin_memcpy(output_buf, &pos, sizeof(pos));
+}
+
+void filter_kernel(const uint8_t *args, uint16_t args_len,
+                   uint32_t num_objects, const uint8_t *const *objects,
+                   const uint16_t *lens, uint16_t *output_len,
+                   uint8_t *output_buf) {
+  BUG_ON(args_len < 2 * sizeof(uint8_t));
+  *output_len = (num_objects + 7) / 8;
+  memset(output_buf, 0, *output_len);
+  dispatch_type(args[1], [&](auto type) {
+    using T = decltype(type);
+    KernelCmpOp op;
+    auto val = parse_predicate<T>(args, args_len, &op);
+    for (uint32_t i = 0; i < num_objects; i++) {
+      if (any_of(objects[i], lens[i], op, val)) {
+        output_buf[i / 8] |= (1 << (i % 8));
+      }
+    }
+  });
+}
+
+void search_kernel(const uint8_t *args, uint16_t args_len,
+                   uint32_t num_objects, const uint8_t *const *objects,
+                   const uint16_t *lens, uint16_t *output_len,
+                   uint8_t *output_buf) {
+  *output_len = (num_objects + 7) / 8;
+  memset(output_buf, 0, *output_len);
+  for (uint32_t i = 0; i < num_objects; i++) {
+    if (memmem(objects[i], lens[i], args, args_len)) {
+      output_buf[i / 8] |= (1 << (i % 8));
+    }
+  }
+}
+
+} // namespace
+
+REGISTER_SERVER_KERNEL("sum", sum_kernel);
+REGISTER_SERVER_KERNEL("find_first", find_first_kernel);
+REGISTER_SERVER_KERNEL("filter", filter_kernel);
+REGISTER_SERVER_KERNEL("search", search_kernel);
+
+} // namespace far_memory
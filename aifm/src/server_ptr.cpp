@@ -5,16 +5,25 @@ extern "C" {
 #include <base/stddef.h>
 }
 
+#include "helpers.hpp"
 #include "object.hpp"
+#include "server_arena.hpp"
+#include "server_kernel.hpp"
 #include "server_ptr.hpp"
 
+#include <string>
+#include <sys/mman.h>
+#include <vector>
+
 namespace far_memory {
 
 ServerPtr::ServerPtr(uint32_t param_len, uint8_t *params) {
-  uint64_t size;
-  BUG_ON(param_len != sizeof(decltype(size)));
-  size = *(reinterpret_cast<decltype(size) *>(params));
-  buf_.reset(reinterpret_cast<uint8_t *>(malloc(size)));
+  BUG_ON(param_len != sizeof(decltype(size_)));
+  size_ = *(reinterpret_cast<decltype(size_) *>(params));
+  auto size = size_;
+  buf_ = decltype(buf_)(
+      reinterpret_cast<uint8_t *>(ServerArena::get().allocate(size_)),
+      [size](uint8_t *ptr) { ServerArena::get().free(ptr, size); });
 }
 
 ServerPtr::~ServerPtr() {}
@@ -42,6 +51,31 @@ void ServerPtr::write_object(uint8_t obj_id_len, const uint8_t *obj_id,
   remote_object.set_obj_id_len(obj_id_len);
 }
 
+bool ServerPtr::read_object_zero_copy(
+    uint8_t obj_id_len, const uint8_t *obj_id,
+    const std::function<void(const uint8_t *, uint16_t)> &f) {
+  const uint64_t &object_id = *(reinterpret_cast<const uint64_t *>(obj_id));
+  assert(obj_id_len == sizeof(decltype(object_id)));
+  auto remote_object_addr = reinterpret_cast<uint64_t>(buf_.get()) + object_id;
+  Object remote_object(remote_object_addr);
+  f(reinterpret_cast<const uint8_t *>(remote_object.get_data_addr()),
+    remote_object.get_data_len());
+  return true;
+}
+
+bool ServerPtr::write_object_zero_copy(
+    uint8_t obj_id_len, const uint8_t *obj_id, uint16_t data_len,
+    const std::function<void(uint8_t *)> &f) {
+  const uint64_t &object_id = *(reinterpret_cast<const uint64_t *>(obj_id));
+  assert(obj_id_len == sizeof(decltype(object_id)));
+  auto remote_object_addr = reinterpret_cast<uint64_t>(buf_.get()) + object_id;
+  Object remote_object(remote_object_addr);
+  f(reinterpret_cast<uint8_t *>(remote_object.get_data_addr()));
+  remote_object.set_data_len(data_len);
+  remote_object.set_obj_id_len(obj_id_len);
+  return true;
+}
+
 bool ServerPtr::remove_object(uint8_t obj_id_len, const uint8_t *obj_id) {
   BUG();
 }
@@ -49,7 +83,55 @@ bool ServerPtr::remove_object(uint8_t obj_id_len, const uint8_t *obj_id) {
 void ServerPtr::compute(uint8_t opcode, uint16_t input_len,
                         const uint8_t *input_buf, uint16_t *output_len,
                         uint8_t *output_buf) {
-  BUG();
+  BUG_ON(opcode != kOpRunKernel);
+  auto name_len = input_buf[0];
+  std::string name(reinterpret_cast<const char *>(&input_buf[sizeof(name_len)]),
+                   name_len);
+  auto kernel = ServerKernelRegistry::find(name);
+  BUG_ON(!kernel);
+  uint16_t args_len;
+  auto *args_len_ptr = &input_buf[sizeof(name_len) + name_len];
+  __builtin_memcpy(&args_len, args_len_ptr, sizeof(args_len));
+  auto *args = args_len_ptr + sizeof(args_len);
+  auto *obj_ids = args + args_len;
+  BUG_ON((input_buf + input_len - obj_ids) % sizeof(uint64_t));
+  uint32_t num_objects = (input_buf + input_len - obj_ids) / sizeof(uint64_t);
+
+  std::vector<const uint8_t *> objects(num_objects);
+  std::vector<uint16_t> lens(num_objects);
+  for (uint32_t i = 0; i < num_objects; i++) {
+    uint64_t object_id;
+    __builtin_memcpy(&object_id, obj_ids + i * sizeof(object_id),
+                     sizeof(object_id));
+    Object remote_object(reinterpret_cast<uint64_t>(buf_.get()) + object_id);
+    objects[i] =
+        reinterpret_cast<const uint8_t *>(remote_object.get_data_addr());
+    lens[i] = remote_object.get_data_len();
+  }
+  kernel(args, args_len, num_objects, objects.data(), lens.data(), output_len,
+         output_buf);
+}
+
+bool ServerPtr::snapshot(int fd) {
+  helpers::file_write_until(fd, buf_.get(), size_);
+  return true;
+}
+
+bool ServerPtr::restore(int fd, uint64_t offset, uint64_t len) {
+  if (len != size_) {
+    return false;
+  }
+  // Map the snapshot copy-on-write instead of reading it in: pages are
+  // faulted in lazily, and the snapshot file stays intact.
+  auto ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                  offset);
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+  auto size = size_;
+  buf_ = decltype(buf_)(reinterpret_cast<uint8_t *>(ptr),
+                        [size](uint8_t *ptr) { munmap(ptr, size); });
+  return true;
 }
 
 ServerDS *ServerPtrFactory::build(uint32_t param_len, uint8_t *params) {
@@ -0,0 +1,229 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/compiler.h>
+#include <base/hash.h>
+}
+
+#include "helpers.hpp"
+#include "object.hpp"
+#include "server_arena.hpp"
+#include "server_tier_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace far_memory {
+
+ServerTierCache::ServerTierCache(uint32_t param_len, uint8_t *params)
+    : shards_(new Shard[kNumShards]), used_size_(0), epoch_(0) {
+  BUG_ON(param_len != sizeof(capacity_));
+  capacity_ = *reinterpret_cast<decltype(capacity_) *>(params);
+}
+
+ServerTierCache::~ServerTierCache() {
+  for (uint32_t i = 0; i < kNumShards; i++) {
+    for (auto &[object_id, entry] : shards_[i].entries) {
+      free_entry(entry);
+    }
+  }
+}
+
+ServerTierCache::Shard *ServerTierCache::get_shard(uint64_t object_id) {
+  return &shards_[hash_crc32c_one(0, object_id) % kNumShards];
+}
+
+void ServerTierCache::free_entry(const Entry &entry) {
+  ServerArena::get().free(entry.data, entry.data_len);
+  used_size_ -= entry.data_len;
+}
+
+void ServerTierCache::read_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                                  uint16_t *data_len, uint8_t *data_buf) {
+  assert(obj_id_len == sizeof(uint64_t));
+  auto object_id = *reinterpret_cast<const uint64_t *>(obj_id);
+  auto *shard = get_shard(object_id);
+  rt::ScopedLock<rt::Spin> lock(&shard->spin);
+  auto iter = shard->entries.find(object_id);
+  if (iter == shard->entries.end()) {
+    *data_len = 0;
+    return;
+  }
+  auto &entry = iter->second;
+  entry.last_access_epoch = ACCESS_ONCE(epoch_);
+  *data_len = entry.data_len;
+  memcpy(data_buf, entry.data, entry.data_len);
+}
+
+void ServerTierCache::write_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                                   uint16_t data_len,
+                                   const uint8_t *data_buf) {
+  // Writes go through kOpPut, which reports whether the budget allowed it.
+  BUG();
+}
+
+bool ServerTierCache::remove_object(uint8_t obj_id_len, const uint8_t *obj_id) {
+  assert(obj_id_len == sizeof(uint64_t));
+  auto object_id = *reinterpret_cast<const uint64_t *>(obj_id);
+  auto *shard = get_shard(object_id);
+  rt::ScopedLock<rt::Spin> lock(&shard->spin);
+  auto iter = shard->entries.find(object_id);
+  if (iter == shard->entries.end()) {
+    return false;
+  }
+  free_entry(iter->second);
+  shard->entries.erase(iter);
+  return true;
+}
+
+void ServerTierCache::compute_put(uint16_t input_len, const uint8_t *input_buf,
+                                  uint16_t *output_len, uint8_t *output_buf) {
+  uint64_t object_id;
+  assert(input_len >= sizeof(object_id));
+  object_id = *reinterpret_cast<const uint64_t *>(input_buf);
+  const auto *data = input_buf + sizeof(object_id);
+  uint16_t data_len = input_len - sizeof(object_id);
+  *output_len = sizeof(bool);
+  auto &stored = *reinterpret_cast<bool *>(output_buf);
+
+  auto *shard = get_shard(object_id);
+  rt::ScopedLock<rt::Spin> lock(&shard->spin);
+  auto [iter, inserted] = shard->entries.try_emplace(object_id);
+  auto &entry = iter->second;
+  if (inserted || entry.data_len != data_len) {
+    // Reserve the new copy before releasing the old one, so that the budget
+    // holds at any time.
+    auto used_size = used_size_.load();
+    do {
+      if (used_size + data_len > capacity_) {
+        if (inserted) {
+          shard->entries.erase(iter);
+        }
+        stored = false;
+        return;
+      }
+    } while (!used_size_.compare_exchange_weak(used_size,
+                                               used_size + data_len));
+    if (!inserted) {
+      free_entry(entry);
+    }
+    entry.data =
+        reinterpret_cast<uint8_t *>(ServerArena::get().allocate(data_len));
+    entry.data_len = data_len;
+  }
+  memcpy(entry.data, data, data_len);
+  entry.last_access_epoch = ACCESS_ONCE(epoch_);
+  entry.version++;
+  stored = true;
+}
+
+void ServerTierCache::compute_evict(uint16_t input_len,
+                                    const uint8_t *input_buf,
+                                    uint16_t *output_len, uint8_t *output_buf) {
+  constexpr uint32_t kRecordSize = sizeof(uint64_t) + sizeof(uint32_t);
+  assert(input_len % kRecordSize == 0);
+  uint32_t num_evicted = 0;
+  for (uint32_t pos = 0; pos < input_len; pos += kRecordSize) {
+    auto object_id = *reinterpret_cast<const uint64_t *>(input_buf + pos);
+    auto version = *reinterpret_cast<const uint32_t *>(input_buf + pos +
+                                                       sizeof(object_id));
+    auto *shard = get_shard(object_id);
+    rt::ScopedLock<rt::Spin> lock(&shard->spin);
+    auto iter = shard->entries.find(object_id);
+    if (iter == shard->entries.end() || iter->second.version != version) {
+      continue;
+    }
+    free_entry(iter->second);
+    shard->entries.erase(iter);
+    num_evicted++;
+  }
+  *output_len = sizeof(num_evicted);
+  *reinterpret_cast<uint32_t *>(output_buf) = num_evicted;
+}
+
+void ServerTierCache::compute_demote(
+    const std::function<void(const uint8_t *, uint32_t)> &emit) {
+  auto cur_epoch = epoch_ + 1;
+  ACCESS_ONCE(epoch_) = cur_epoch;
+  auto used_size = used_size_.load();
+  if (used_size <= capacity_ * kDemoteHighWatermark) {
+    return;
+  }
+  uint64_t excess_size = used_size - capacity_ * kDemoteLowWatermark;
+
+  // (Epochs since the last read, object ID) of all objects, the least
+  // recently read first.
+  std::vector<std::pair<uint32_t, uint64_t>> candidates;
+  for (uint32_t i = 0; i < kNumShards; i++) {
+    auto &shard = shards_[i];
+    rt::ScopedLock<rt::Spin> lock(&shard.spin);
+    for (auto &[object_id, entry] : shard.entries) {
+      candidates.emplace_back(cur_epoch - entry.last_access_epoch, object_id);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto &a, const auto &b) { return a.first > b.first; });
+
+  // The record is copied out under the shard lock and emitted without it,
+  // since emit() may wait for the client.
+  std::unique_ptr<uint8_t[]> record(
+      new uint8_t[kDemoteHeaderSize + Object::kMaxObjectDataSize]);
+  uint64_t demoted_size = 0;
+  for (auto [_, object_id] : candidates) {
+    if (demoted_size >= excess_size) {
+      break;
+    }
+    uint16_t data_len;
+    {
+      auto *shard = get_shard(object_id);
+      rt::ScopedLock<rt::Spin> lock(&shard->spin);
+      auto iter = shard->entries.find(object_id);
+      if (iter == shard->entries.end()) {
+        continue;
+      }
+      auto &entry = iter->second;
+      data_len = entry.data_len;
+      __builtin_memcpy(&record[0], &object_id, sizeof(object_id));
+      __builtin_memcpy(&record[sizeof(object_id)], &entry.version,
+                       sizeof(entry.version));
+      __builtin_memcpy(&record[sizeof(object_id) + sizeof(entry.version)],
+                       &data_len, sizeof(data_len));
+      memcpy(&record[kDemoteHeaderSize], entry.data, data_len);
+    }
+    demoted_size += data_len;
+    emit(record.get(), kDemoteHeaderSize + data_len);
+  }
+}
+
+void ServerTierCache::compute(uint8_t opcode, uint16_t input_len,
+                              const uint8_t *input_buf, uint16_t *output_len,
+                              uint8_t *output_buf) {
+  switch (opcode) {
+  case kOpPut:
+    compute_put(input_len, input_buf, output_len, output_buf);
+    break;
+  case kOpEvict:
+    compute_evict(input_len, input_buf, output_len, output_buf);
+    break;
+  case kOpGetUsedSize:
+    *output_len = sizeof(uint64_t);
+    *reinterpret_cast<uint64_t *>(output_buf) = used_size_.load();
+    break;
+  default:
+    BUG();
+  }
+}
+
+void ServerTierCache::compute_stream(
+    uint8_t opcode, uint64_t input_len, const uint8_t *input_buf,
+    const std::function<void(const uint8_t *, uint32_t)> &emit) {
+  BUG_ON(opcode != kOpDemote);
+  compute_demote(emit);
+}
+
+ServerDS *ServerTierCacheFactory::build(uint32_t param_len, uint8_t *params) {
+  return new ServerTierCache(param_len, params);
+}
+
+} // namespace far_memory
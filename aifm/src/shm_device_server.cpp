@@ -0,0 +1,340 @@
+extern "C" {
+#include <asm/atomic.h>
+#include <runtime/runtime.h>
+#include <runtime/thread.h>
+#include <runtime/timer.h>
+}
+#include "thread.h"
+
+#include "device.hpp"
+#include "helpers.hpp"
+#include "object.hpp"
+#include "server.hpp"
+#include "shm_ring.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace far_memory;
+
+constexpr static uint32_t kAttachPollUs = 1000;
+
+std::unique_ptr<Server> server;
+
+// Request:
+// |Opcode = KOpReadObject(1B) | ds_id(1B) | obj_id_len(1B) | obj_id |
+// Response:
+// |data_len(2B)|data_buf(data_len B)|
+void process_read_object(ShmDevice::Channel *channel) {
+  uint8_t
+      req[Object::kDSIDSize + Object::kIDLenSize + Object::kMaxObjectIDSize];
+
+  channel->req->pop_until(req, Object::kDSIDSize + Object::kIDLenSize);
+  auto ds_id = req[0];
+  auto object_id_len = req[Object::kDSIDSize];
+  auto *object_id = &req[Object::kDSIDSize + Object::kIDLenSize];
+  channel->req->pop_until(object_id, object_id_len);
+
+  if (likely(server->read_object_zero_copy(
+          ds_id, object_id_len, object_id,
+          [&](const uint8_t *data_buf, uint16_t data_len) {
+            channel->resp->push_until(&data_len, Object::kDataLenSize);
+            channel->resp->push_until(data_buf, data_len);
+          }))) {
+    return;
+  }
+
+  uint8_t resp[Object::kDataLenSize + Object::kMaxObjectDataSize];
+  auto *data_len = reinterpret_cast<uint16_t *>(&resp);
+  auto *data_buf = &resp[Object::kDataLenSize];
+  server->read_object(ds_id, object_id_len, object_id, data_len, data_buf);
+
+  channel->resp->push_until(resp, Object::kDataLenSize + *data_len);
+}
+
+// Request:
+// |Opcode = KOpWriteObject (1B)|ds_id(1B)|obj_id_len(1B)|data_len(2B)|
+// |obj_id(obj_id_len B)|data_buf(data_len)|
+// Response:
+// |Ack (1B)|
+void process_write_object(ShmDevice::Channel *channel) {
+  uint8_t req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize +
+              Object::kMaxObjectIDSize];
+
+  channel->req->pop_until(
+      req, Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize);
+  auto ds_id = req[0];
+  auto object_id_len = req[Object::kDSIDSize];
+  auto data_len = *reinterpret_cast<uint16_t *>(
+      &req[Object::kDSIDSize + Object::kIDLenSize]);
+  auto *object_id =
+      &req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize];
+  channel->req->pop_until(object_id, object_id_len);
+
+  if (unlikely(!server->write_object_zero_copy(
+          ds_id, object_id_len, object_id, data_len, [&](uint8_t *data_buf) {
+            channel->req->pop_until(data_buf, data_len);
+          }))) {
+    uint8_t data_buf[Object::kMaxObjectDataSize];
+    channel->req->pop_until(data_buf, data_len);
+    server->write_object(ds_id, object_id_len, object_id, data_len, data_buf);
+  }
+
+  uint8_t ack;
+  channel->resp->push_until(&ack, sizeof(ack));
+}
+
+// Request:
+// |Opcode = kOpRemoveObject (1B)|ds_id(1B)|obj_id_len(1B)|obj_id(obj_id_len B)|
+// Response:
+// |exists (1B)|
+void process_remove_object(ShmDevice::Channel *channel) {
+  uint8_t
+      req[Object::kDSIDSize + Object::kIDLenSize + Object::kMaxObjectIDSize];
+
+  channel->req->pop_until(req, Object::kDSIDSize + Object::kIDLenSize);
+  auto ds_id = req[0];
+  auto obj_id_len = req[Object::kDSIDSize];
+  auto *obj_id = &req[Object::kDSIDSize + Object::kIDLenSize];
+  channel->req->pop_until(obj_id, obj_id_len);
+
+  bool exists = server->remove_object(ds_id, obj_id_len, obj_id);
+
+  channel->resp->push_until(&exists, sizeof(exists));
+}
+
+// Request:
+// |Opcode = kOpConstruct (1B)|ds_type(1B)|ds_id(1B)|
+// |param_len(1B)|params(param_len B)|
+// Response:
+// |Ack (1B)|
+void process_construct(ShmDevice::Channel *channel) {
+  uint8_t ds_type;
+  uint8_t ds_id;
+  uint8_t param_len;
+  uint8_t req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len) +
+              std::numeric_limits<decltype(param_len)>::max()];
+
+  channel->req->pop_until(req, sizeof(ds_type) + Object::kDSIDSize +
+                                   sizeof(param_len));
+  ds_type = req[0];
+  ds_id = req[sizeof(ds_type)];
+  param_len = req[sizeof(ds_type) + Object::kDSIDSize];
+  auto *params = &req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len)];
+  channel->req->pop_until(params, param_len);
+
+  server->construct(ds_type, ds_id, param_len, params);
+
+  uint8_t ack;
+  channel->resp->push_until(&ack, sizeof(ack));
+}
+
+// Request:
+// |Opcode = kOpDeconstruct (1B)|ds_id(1B)|
+// Response:
+// |Ack (1B)|
+void process_destruct(ShmDevice::Channel *channel) {
+  uint8_t ds_id;
+
+  channel->req->pop_until(&ds_id, Object::kDSIDSize);
+
+  server->destruct(ds_id);
+
+  uint8_t ack;
+  channel->resp->push_until(&ack, sizeof(ack));
+}
+
+// Request:
+// |Opcode = kOpCompute(1B)|ds_id(1B)|opcode(1B)|input_len(2B)|
+// |input_buf(input_len)|
+// Response:
+// |output_len(2B)|output_buf(output_len B)|
+void process_compute(ShmDevice::Channel *channel) {
+  uint8_t opcode;
+  uint16_t input_len;
+  uint8_t req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len) +
+              TCPDevice::kMaxComputeDataLen];
+
+  channel->req->pop_until(
+      req, Object::kDSIDSize + sizeof(opcode) + sizeof(input_len));
+  auto ds_id = req[0];
+  opcode = req[Object::kDSIDSize];
+  input_len =
+      *reinterpret_cast<uint16_t *>(&req[Object::kDSIDSize + sizeof(opcode)]);
+  assert(input_len <= TCPDevice::kMaxComputeDataLen);
+  auto *input_buf =
+      &req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)];
+  channel->req->pop_until(input_buf, input_len);
+
+  uint16_t *output_len;
+  uint8_t resp[sizeof(*output_len) + TCPDevice::kMaxComputeDataLen];
+  output_len = reinterpret_cast<uint16_t *>(&resp[0]);
+  uint8_t *output_buf = &resp[sizeof(*output_len)];
+  server->compute(ds_id, opcode, input_len, input_buf, output_len, output_buf);
+
+  channel->resp->push_until(resp, sizeof(*output_len) + *output_len);
+}
+
+// Request:
+// |Opcode = kOpComputeStream(1B)|ds_id(1B)|opcode(1B)|input_len(8B)|
+// |input_buf(input_len)|
+// Response:
+// |len(4B)|chunk(len B)|...|len = 0 (4B)|
+void process_compute_stream(ShmDevice::Channel *channel) {
+  uint8_t opcode;
+  uint64_t input_len;
+  uint8_t req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)];
+
+  channel->req->pop_until(req, sizeof(req));
+  auto ds_id = req[0];
+  opcode = req[Object::kDSIDSize];
+  input_len =
+      *reinterpret_cast<uint64_t *>(&req[Object::kDSIDSize + sizeof(opcode)]);
+  std::vector<uint8_t> input_buf(input_len);
+  for (uint64_t popped = 0; popped < input_len;) {
+    auto len = std::min(input_len - popped,
+                        static_cast<uint64_t>(ShmDevice::kRingCapacity));
+    channel->req->pop_until(&input_buf[popped], len);
+    popped += len;
+  }
+
+  server->compute_stream(ds_id, opcode, input_len, input_buf.data(),
+                         [&](const uint8_t *chunk, uint32_t len) {
+                           if (len) {
+                             channel->resp->push_until(&len, sizeof(len));
+                             channel->resp->push_until(chunk, len);
+                           }
+                         });
+  uint32_t end = 0;
+  channel->resp->push_until(&end, sizeof(end));
+}
+
+void channel_fn(ShmDevice::Header *header, ShmDevice::Channel channel) {
+  // Run event loop.
+  uint8_t opcode;
+  while (true) {
+    if (!channel.req->pop(&opcode, TCPDevice::kOpcodeSize)) {
+      if (load_acquire(&header->shutdown)) {
+        break;
+      }
+      thread_yield();
+      continue;
+    }
+    switch (opcode) {
+    case TCPDevice::kOpReadObject:
+      process_read_object(&channel);
+      break;
+    case TCPDevice::kOpWriteObject:
+      process_write_object(&channel);
+      break;
+    case TCPDevice::kOpRemoveObject:
+      process_remove_object(&channel);
+      break;
+    case TCPDevice::kOpConstruct:
+      process_construct(&channel);
+      break;
+    case TCPDevice::kOpDeconstruct:
+      process_destruct(&channel);
+      break;
+    case TCPDevice::kOpCompute:
+      process_compute(&channel);
+      break;
+    case TCPDevice::kOpComputeStream:
+      process_compute_stream(&channel);
+      break;
+    default:
+      BUG();
+    }
+  }
+}
+
+// Waits until a client publishes a live segment, and maps it.
+uint8_t *attach(const std::string &shm_name) {
+  while (true) {
+    int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+    if (fd >= 0) {
+      auto ptr = mmap(nullptr, sizeof(ShmDevice::Header),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (ptr != MAP_FAILED) {
+        auto *header = reinterpret_cast<ShmDevice::Header *>(ptr);
+        uint8_t *shm = nullptr;
+        if (load_acquire(&header->magic) == ShmDevice::kMagic &&
+            !load_acquire(&header->shutdown)) {
+          auto shm_ptr = mmap(nullptr, header->shm_size,
+                              PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+          BUG_ON(shm_ptr == MAP_FAILED);
+          shm = reinterpret_cast<uint8_t *>(shm_ptr);
+        }
+        munmap(ptr, sizeof(ShmDevice::Header));
+        if (shm) {
+          close(fd);
+          return shm;
+        }
+      }
+      close(fd);
+    }
+    timer_sleep(kAttachPollUs);
+  }
+}
+
+void do_work(const std::string &shm_name) {
+  while (true) {
+    auto *shm = attach(shm_name);
+    auto *header = reinterpret_cast<ShmDevice::Header *>(shm);
+    BUG_ON(header->ring_capacity != ShmDevice::kRingCapacity);
+    server.reset(new Server());
+    store_release(&header->server_attached, 1);
+
+    std::vector<rt::Thread> channel_threads;
+    for (uint32_t i = 0; i < header->num_channels; i++) {
+      auto channel = ShmDevice::get_channel(shm, i);
+      channel_threads.emplace_back(
+          rt::Thread([header, channel]() { channel_fn(header, channel); }));
+    }
+    for (auto &thread : channel_threads) {
+      thread.Join();
+    }
+
+    server.reset();
+    auto shm_size = header->shm_size;
+    store_release(&header->server_exit, 1);
+    munmap(shm, shm_size);
+  }
+}
+
+void my_main(void *arg) {
+  char **argv = static_cast<char **>(arg);
+  do_work(std::string(argv[1]));
+}
+
+int main(int _argc, char *argv[]) {
+  int ret;
+
+  if (_argc < 3) {
+    std::cerr << "usage: [cfg_file] [shm_name]" << std::endl;
+    return -EINVAL;
+  }
+
+  char conf_path[strlen(argv[1]) + 1];
+  strcpy(conf_path, argv[1]);
+  for (int i = 2; i < _argc; i++) {
+    argv[i - 1] = argv[i];
+  }
+
+  ret = runtime_init(conf_path, my_main, argv);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -2,7 +2,10 @@
 
 namespace far_memory {
 
-Slab::Slab(uint8_t *base, uint64_t len) : base_(base), len_(len), cur_(base) {}
+Slab::Slab(uint8_t *base, uint64_t len)
+    : base_(base), len_(len), cur_(base),
+      slabs_(new std::vector<uint8_t *>[helpers::get_num_runtime_cores()]
+                                       [kNumSlabClasses]) {}
 
 Slab::~Slab() {}
 
@@ -6,9 +6,14 @@
 
 namespace far_memory {
 bool Stats::enable_swap_;
+Cacheline Stats::mutator_stall_us_[helpers::kMaxNumCPUs];
+Cacheline Stats::num_mutator_stalls_[helpers::kMaxNumCPUs];
+Cacheline Stats::num_hedgeable_reads_[helpers::kMaxNumCPUs];
+Cacheline Stats::num_hedged_reads_[helpers::kMaxNumCPUs];
+Cacheline Stats::num_hedge_wins_[helpers::kMaxNumCPUs];
 #ifdef MONITOR_FREE_MEM_RATIO
 std::vector<std::pair<uint64_t, double>>
-    Stats::free_mem_ratio_records_[helpers::kNumCPUs];
+    Stats::free_mem_ratio_records_[helpers::kMaxNumCPUs];
 #endif
 
 #ifdef MONITOR_READ_OBJECT_CYCLES
@@ -40,7 +45,7 @@ void Stats::_add_free_mem_ratio_record() {
 void Stats::print_free_mem_ratio_records() {
 #ifdef MONITOR_FREE_MEM_RATIO
   std::vector<std::pair<uint64_t, double>> all_records;
-  FOR_ALL_SOCKET0_CORES(core_id) {
+  FOR_ALL_CORES(core_id) {
     all_records.insert(all_records.end(),
                        free_mem_ratio_records_[core_id].begin(),
                        free_mem_ratio_records_[core_id].end());
@@ -54,7 +59,7 @@ void Stats::print_free_mem_ratio_records() {
 
 void Stats::clear_free_mem_ratio_records() {
 #ifdef MONITOR_FREE_MEM_RATIO
-  FOR_ALL_SOCKET0_CORES(core_id) { free_mem_ratio_records_[core_id].clear(); }
+  FOR_ALL_CORES(core_id) { free_mem_ratio_records_[core_id].clear(); }
 #endif
 }
 
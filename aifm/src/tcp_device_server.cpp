@@ -10,42 +10,47 @@ extern "C" {
 #include "helpers.hpp"
 #include "object.hpp"
 #include "server.hpp"
+#include "server_arena.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 using namespace far_memory;
 
 std::vector<rt::Thread> slave_threads;
-std::unique_ptr<uint8_t> far_mem;
 
 std::atomic<bool> has_shutdown{true};
 rt::Thread master_thread;
 Server server;
+// Where the ds are snapshotted to and restored from at startup; empty if
+// snapshots are disabled.
+std::string snapshot_dir;
 
 // Request:
-//     |OpCode = Init (1B)|Far Mem Size (8B)|
+//     |OpCode = Init (1B)|Far Mem Size (8B)|Reattach (1B)|
 // Response:
 //     |Ack (1B)|
+// The far memory itself is allocated from ServerArena once the client
+// constructs its vanilla ptr ds.
 void process_init(tcpconn_t *c) {
-  uint64_t *far_mem_size;
-  uint8_t req[sizeof(decltype(*far_mem_size))];
+  uint64_t far_mem_size;
+  uint8_t req[sizeof(far_mem_size) + sizeof(bool)];
   helpers::tcp_read_until(c, req, sizeof(req));
 
-  far_mem_size = reinterpret_cast<uint64_t *>(req);
-  *far_mem_size = ((*far_mem_size - 1) / helpers::kHugepageSize + 1) *
-                  helpers::kHugepageSize;
-  auto far_mem_ptr =
-      static_cast<uint8_t *>(helpers::allocate_hugepage(*far_mem_size));
-  BUG_ON(far_mem_ptr == nullptr);
-  far_mem.reset(far_mem_ptr);
+  bool reattach = req[sizeof(far_mem_size)];
+  if (!reattach) {
+    server.discard_restored();
+  }
 
-  barrier();
   uint8_t ack;
   helpers::tcp_write_until(c, &ack, sizeof(ack));
 }
@@ -55,8 +60,6 @@ void process_init(tcpconn_t *c) {
 // Response:
 //     |Ack (1B)|
 void process_shutdown(tcpconn_t *c) {
-  far_mem.reset();
-
   uint8_t ack;
   helpers::tcp_write_until(c, &ack, sizeof(ack));
 
@@ -66,195 +69,465 @@ void process_shutdown(tcpconn_t *c) {
   slave_threads.clear();
 }
 
+// Slave connections are multiplexed by the client, so requests are decoupled
+// from the connections they arrive on: a per-connection reader parses them
+// and hands them over to a pool of workers, which reply out of order with
+// the request tags. Reads and removes are latency-critical and go to the high
+// priority queue; construct, destruct and compute may run for long and go to
+// the low priority one. Writes are received inline by the reader so that the
+// data lands directly in its destination.
+constexpr static uint32_t kNumPriorities = 2;
+constexpr static uint32_t kHighPriority = 0;
+constexpr static uint32_t kLowPriority = 1;
+// After serving this many high priority requests in a row, a worker serves a
+// pending low priority request, if any.
+constexpr static uint32_t kMaxConsecutiveHighPriority = 16;
+
+// The send window of a compute_stream response (see
+// TCPDevice::kStreamWindowSize).
+struct StreamWindow {
+  rt::CondVar cv;
+  uint64_t num_unacked_bytes = 0;
+};
+
+struct Connection {
+  tcpconn_t *conn;
+  rt::Mutex tx_mutex;
+  // Requests still owned by the workers.
+  rt::WaitGroup inflight;
+  // The compute_stream responses being sent, by tag. Once the client closes
+  // the connection, no more credit arrives, so the windows are then ignored.
+  rt::Spin streams_spin;
+  std::unordered_map<uint64_t, StreamWindow *> streams;
+  bool closed = false;
+};
+
+struct Request {
+  Connection *connection;
+  uint64_t tag;
+  uint8_t opcode;
+  std::vector<uint8_t> buf;
+};
+
+rt::Mutex queue_mutex;
+rt::CondVar queue_cv;
+std::deque<Request *> queues[kNumPriorities];
+uint32_t num_workers;
+uint32_t num_running_low_priority;
+uint32_t num_consecutive_high_priority;
+std::vector<rt::Thread> worker_threads;
+
+// Response:
+// |Tag(8B)|Len(4B)|header(header_len B)|data(data_len B)|
+void respond(Connection *connection, uint64_t tag, const void *header,
+             uint32_t header_len, const void *data = nullptr,
+             uint32_t data_len = 0) {
+  uint8_t resp[TCPDevice::kRespHeaderSize + sizeof(uint16_t)];
+  BUG_ON(header_len > sizeof(uint16_t));
+  uint32_t len = header_len + data_len;
+  __builtin_memcpy(&resp[0], &tag, TCPDevice::kTagSize);
+  __builtin_memcpy(&resp[TCPDevice::kTagSize], &len, TCPDevice::kRespLenSize);
+  if (header_len) {
+    memcpy(&resp[TCPDevice::kRespHeaderSize], header, header_len);
+  }
+
+  rt::ScopedLock<rt::Mutex> lock(&connection->tx_mutex);
+  if (data_len) {
+    helpers::tcp_write2_until(connection->conn, resp,
+                              TCPDevice::kRespHeaderSize + header_len, data,
+                              data_len);
+  } else {
+    helpers::tcp_write_until(connection->conn, resp,
+                             TCPDevice::kRespHeaderSize + header_len);
+  }
+}
+
+void enqueue(Request *request, uint32_t priority) {
+  request->connection->inflight.Add(1);
+  rt::ScopedLock<rt::Mutex> lock(&queue_mutex);
+  queues[priority].push_back(request);
+  queue_cv.Signal();
+}
+
+// Picks the next request, preferring high priority ones. At most
+// num_workers - 1 workers serve low priority requests at once, so that a
+// burst of long computes never blocks reads.
+Request *dequeue(uint32_t *priority) {
+  rt::ScopedLock<rt::Mutex> lock(&queue_mutex);
+  while (true) {
+    bool has_high = !queues[kHighPriority].empty();
+    bool can_low = !queues[kLowPriority].empty() &&
+                   num_running_low_priority + 1 < std::max(num_workers, 2U);
+    if (can_low && (!has_high || num_consecutive_high_priority >=
+                                     kMaxConsecutiveHighPriority)) {
+      *priority = kLowPriority;
+      num_running_low_priority++;
+      num_consecutive_high_priority = 0;
+    } else if (has_high) {
+      *priority = kHighPriority;
+      num_consecutive_high_priority++;
+    } else {
+      queue_cv.Wait(&queue_mutex);
+      continue;
+    }
+    auto *request = queues[*priority].front();
+    queues[*priority].pop_front();
+    return request;
+  }
+}
+
 // Request:
-// |Opcode = KOpReadObject(1B) | ds_id(1B) | obj_id_len(1B) | obj_id |
+// |Opcode = KOpReadObject(1B)|Tag(8B)|ds_id(1B)|obj_id_len(1B)|obj_id|
 // Response:
-// |data_len(2B)|data_buf(data_len B)|
-void process_read_object(tcpconn_t *c) {
-  uint8_t
-      req[Object::kDSIDSize + Object::kIDLenSize + Object::kMaxObjectIDSize];
-  uint8_t resp[Object::kDataLenSize + Object::kMaxObjectDataSize];
-
-  helpers::tcp_read_until(c, req, Object::kDSIDSize + Object::kIDLenSize);
-  auto ds_id = *const_cast<uint8_t *>(&req[0]);
-  auto object_id_len = *const_cast<uint8_t *>(&req[Object::kDSIDSize]);
+// |Tag(8B)|Len(4B)|data_len(2B)|data_buf(data_len B)|
+void process_read_object(Request *request) {
+  auto *req = request->buf.data();
+  auto ds_id = req[0];
+  auto object_id_len = req[Object::kDSIDSize];
   auto *object_id = &req[Object::kDSIDSize + Object::kIDLenSize];
-  helpers::tcp_read_until(c, object_id, object_id_len);
 
-  auto *data_len = reinterpret_cast<uint16_t *>(&resp);
-  auto *data_buf = &resp[Object::kDataLenSize];
-  server.read_object(ds_id, object_id_len, object_id, data_len, data_buf);
+  // Fast path: send the object data in place, i.e., |data_len| and |data_buf|
+  // are gathered by tcp_writev() without being copied.
+  if (likely(server.read_object_zero_copy(
+          ds_id, object_id_len, object_id,
+          [&](const uint8_t *data_buf, uint16_t data_len) {
+            respond(request->connection, request->tag, &data_len,
+                    Object::kDataLenSize, data_buf, data_len);
+          }))) {
+    return;
+  }
 
-  helpers::tcp_write_until(c, resp, Object::kDataLenSize + *data_len);
+  uint16_t data_len;
+  uint8_t data_buf[Object::kMaxObjectDataSize];
+  server.read_object(ds_id, object_id_len, object_id, &data_len, data_buf);
+
+  respond(request->connection, request->tag, &data_len, Object::kDataLenSize,
+          data_buf, data_len);
 }
 
 // Request:
-// |Opcode = KOpWriteObject (1B)|ds_id(1B)|obj_id_len(1B)|data_len(2B)|
-// |obj_id(obj_id_len B)|data_buf(data_len)|
+// |Opcode = KOpWriteObject (1B)|Tag(8B)|ds_id(1B)|obj_id_len(1B)|
+// |data_len(2B)|obj_id(obj_id_len B)|data_buf(data_len)|
 // Response:
-// |Ack (1B)|
-void process_write_object(tcpconn_t *c) {
+// |Tag(8B)|Len(4B)|Ack (1B)|
+// Served inline by the reader.
+void process_write_object(Connection *connection, uint64_t tag) {
+  auto *c = connection->conn;
   uint8_t req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize +
-              Object::kMaxObjectIDSize + Object::kMaxObjectDataSize];
+              Object::kMaxObjectIDSize];
 
   helpers::tcp_read_until(
       c, req, Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize);
 
-  auto ds_id = *const_cast<uint8_t *>(&req[0]);
-  auto object_id_len = *const_cast<uint8_t *>(&req[Object::kDSIDSize]);
+  auto ds_id = req[0];
+  auto object_id_len = req[Object::kDSIDSize];
   auto data_len = *reinterpret_cast<uint16_t *>(
       &req[Object::kDSIDSize + Object::kIDLenSize]);
+  auto *object_id =
+      &req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize];
+  helpers::tcp_read_until(c, object_id, object_id_len);
 
-  helpers::tcp_read_until(
-      c, &req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize],
-      object_id_len + data_len);
-
-  auto *object_id = const_cast<uint8_t *>(
-      &req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize]);
-  auto *data_buf =
-      const_cast<uint8_t *>(&req[Object::kDSIDSize + Object::kIDLenSize +
-                                 Object::kDataLenSize + object_id_len]);
-
-  server.write_object(ds_id, object_id_len, object_id, data_len, data_buf);
+  // Fast path: once the object ID identifies the destination, receive the
+  // data directly into it.
+  if (unlikely(!server.write_object_zero_copy(
+          ds_id, object_id_len, object_id, data_len, [&](uint8_t *data_buf) {
+            helpers::tcp_read_until(c, data_buf, data_len);
+          }))) {
+    uint8_t data_buf[Object::kMaxObjectDataSize];
+    helpers::tcp_read_until(c, data_buf, data_len);
+    server.write_object(ds_id, object_id_len, object_id, data_len, data_buf);
+  }
 
   uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+  respond(connection, tag, &ack, sizeof(ack));
 }
 
 // Request:
-// |Opcode = kOpRemoveObject (1B)|ds_id(1B)|obj_id_len(1B)|obj_id(obj_id_len B)|
+// |Opcode = kOpRemoveObject (1B)|Tag(8B)|ds_id(1B)|obj_id_len(1B)|
+// |obj_id(obj_id_len B)|
 // Response:
-// |exists (1B)|
-void process_remove_object(tcpconn_t *c) {
-  uint8_t
-      req[Object::kDSIDSize + Object::kIDLenSize + Object::kMaxObjectIDSize];
-
-  helpers::tcp_read_until(c, req, Object::kDSIDSize + Object::kIDLenSize);
-  auto ds_id = *const_cast<uint8_t *>(&req[0]);
-  auto obj_id_len = *const_cast<uint8_t *>(&req[Object::kDSIDSize]);
+// |Tag(8B)|Len(4B)|exists (1B)|
+void process_remove_object(Request *request) {
+  auto *req = request->buf.data();
+  auto ds_id = req[0];
+  auto obj_id_len = req[Object::kDSIDSize];
+  auto *obj_id = &req[Object::kDSIDSize + Object::kIDLenSize];
 
-  helpers::tcp_read_until(c, &req[Object::kDSIDSize + Object::kIDLenSize],
-                          obj_id_len);
-
-  auto *obj_id =
-      const_cast<uint8_t *>(&req[Object::kDSIDSize + Object::kIDLenSize]);
   bool exists = server.remove_object(ds_id, obj_id_len, obj_id);
 
-  helpers::tcp_write_until(c, &exists, sizeof(exists));
+  respond(request->connection, request->tag, &exists, sizeof(exists));
 }
 
 // Request:
-// |Opcode = kOpConstruct (1B)|ds_type(1B)|ds_id(1B)|
+// |Opcode = kOpConstruct (1B)|Tag(8B)|ds_type(1B)|ds_id(1B)|
 // |param_len(1B)|params(param_len B)|
 // Response:
-// |Ack (1B)|
-void process_construct(tcpconn_t *c) {
-  uint8_t ds_type;
-  uint8_t ds_id;
-  uint8_t param_len;
-  uint8_t *params;
-  uint8_t req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len) +
-              std::numeric_limits<decltype(param_len)>::max()];
-
-  helpers::tcp_read_until(
-      c, req, sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len));
-  ds_type = *const_cast<uint8_t *>(&req[0]);
-  ds_id = *const_cast<uint8_t *>(&req[sizeof(ds_type)]);
-  param_len = *const_cast<uint8_t *>(&req[sizeof(ds_type) + Object::kDSIDSize]);
-  helpers::tcp_read_until(
-      c, &req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len)],
-      param_len);
-  params = const_cast<uint8_t *>(
-      &req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len)]);
+// |Tag(8B)|Len(4B)|Ack (1B)|
+void process_construct(Request *request) {
+  auto *req = request->buf.data();
+  uint8_t ds_type = req[0];
+  uint8_t ds_id = req[sizeof(ds_type)];
+  uint8_t param_len = req[sizeof(ds_type) + Object::kDSIDSize];
+  auto *params = &req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len)];
 
   server.construct(ds_type, ds_id, param_len, params);
 
   uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+  respond(request->connection, request->tag, &ack, sizeof(ack));
 }
 
 // Request:
-// |Opcode = kOpDeconstruct (1B)|ds_id(1B)|
+// |Opcode = kOpDeconstruct (1B)|Tag(8B)|ds_id(1B)|
 // Response:
-// |Ack (1B)|
-void process_destruct(tcpconn_t *c) {
-  uint8_t ds_id;
-
-  helpers::tcp_read_until(c, &ds_id, Object::kDSIDSize);
+// |Tag(8B)|Len(4B)|Ack (1B)|
+void process_destruct(Request *request) {
+  uint8_t ds_id = request->buf[0];
 
   server.destruct(ds_id);
 
   uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+  respond(request->connection, request->tag, &ack, sizeof(ack));
 }
 
 // Request:
-// |Opcode = kOpCompute(1B)|ds_id(1B)|opcode(1B)|input_len(2B)|
+// |Opcode = kOpCompute(1B)|Tag(8B)|ds_id(1B)|opcode(1B)|input_len(2B)|
 // |input_buf(input_len)|
 // Response:
-// |output_len(2B)|output_buf(output_len B)|
-void process_compute(tcpconn_t *c) {
+// |Tag(8B)|Len(4B)|output_len(2B)|output_buf(output_len B)|
+void process_compute(Request *request) {
+  auto *req = request->buf.data();
   uint8_t opcode;
   uint16_t input_len;
-  uint8_t req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len) +
-              TCPDevice::kMaxComputeDataLen];
-
-  helpers::tcp_read_until(
-      c, req, Object::kDSIDSize + sizeof(opcode) + sizeof(input_len));
-
-  auto ds_id = *reinterpret_cast<uint8_t *>(&req[0]);
-  opcode = *reinterpret_cast<uint8_t *>(&req[Object::kDSIDSize]);
+  auto ds_id = req[0];
+  opcode = req[Object::kDSIDSize];
   input_len =
       *reinterpret_cast<uint16_t *>(&req[Object::kDSIDSize + sizeof(opcode)]);
   assert(input_len <= TCPDevice::kMaxComputeDataLen);
+  auto *input_buf =
+      &req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)];
+
+  uint16_t output_len;
+  uint8_t output_buf[TCPDevice::kMaxComputeDataLen];
+  server.compute(ds_id, opcode, input_len, input_buf, &output_len, output_buf);
+
+  respond(request->connection, request->tag, &output_len, sizeof(output_len),
+          output_buf, output_len);
+}
+
+// Request:
+// |Opcode = kOpComputeStream(1B)|Tag(8B)|ds_id(1B)|opcode(1B)|input_len(8B)|
+// |input_buf(input_len)|
+// Response:
+// |Tag(8B)|Len(4B)|chunk(Len B)|...|Tag(8B)|Len = 0 (4B)|
+// A chunk is only sent while less than kStreamWindowSize bytes are
+// unacknowledged, so the worker waits here for the client to catch up.
+void process_compute_stream(Request *request) {
+  auto *connection = request->connection;
+  auto *req = request->buf.data();
+  auto ds_id = req[0];
+  auto opcode = req[Object::kDSIDSize];
+  auto input_len =
+      *reinterpret_cast<uint64_t *>(&req[Object::kDSIDSize + sizeof(opcode)]);
+  auto *input_buf =
+      &req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)];
+
+  StreamWindow window;
+  {
+    rt::ScopedLock<rt::Spin> lock(&connection->streams_spin);
+    connection->streams[request->tag] = &window;
+  }
+  server.compute_stream(
+      ds_id, opcode, input_len, input_buf,
+      [&](const uint8_t *chunk, uint32_t len) {
+        if (!len) {
+          return;
+        }
+        {
+          rt::ScopedLock<rt::Spin> lock(&connection->streams_spin);
+          while (window.num_unacked_bytes >= TCPDevice::kStreamWindowSize &&
+                 !connection->closed) {
+            window.cv.Wait(&connection->streams_spin);
+          }
+          window.num_unacked_bytes += len;
+        }
+        respond(connection, request->tag, nullptr, 0, chunk, len);
+      });
+  {
+    rt::ScopedLock<rt::Spin> lock(&connection->streams_spin);
+    connection->streams.erase(request->tag);
+  }
+  respond(connection, request->tag, nullptr, 0);
+}
 
-  if (input_len) {
-    helpers::tcp_read_until(
-        c, &req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)],
-        input_len);
+// Request:
+// |Opcode = kOpStreamCredit (1B)|Tag(8B)|credit(4B)|
+// No response. Served inline by the reader, so that a worker blocked on the
+// window of a stream is never waiting for another worker. The stream may have
+// completed already, in which case the credit is dropped.
+void process_stream_credit(Connection *connection, uint64_t tag) {
+  uint32_t credit;
+  helpers::tcp_read_until(connection->conn, &credit, sizeof(credit));
+
+  rt::ScopedLock<rt::Spin> lock(&connection->streams_spin);
+  auto iter = connection->streams.find(tag);
+  if (iter != connection->streams.end()) {
+    auto *window = iter->second;
+    window->num_unacked_bytes -=
+        std::min<uint64_t>(credit, window->num_unacked_bytes);
+    window->cv.Signal();
   }
+}
 
-  auto *input_buf = const_cast<uint8_t *>(
-      &req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)]);
+// Request:
+// |Opcode = kOpSnapshot (1B)|Tag(8B)|
+// Response:
+// |Tag(8B)|Len(4B)|succeed (1B)|
+void process_snapshot(Request *request) {
+  bool succeed = !snapshot_dir.empty() && server.snapshot(snapshot_dir);
 
-  uint16_t *output_len;
-  uint8_t resp[sizeof(*output_len) + TCPDevice::kMaxComputeDataLen];
-  output_len = reinterpret_cast<uint16_t *>(&resp[0]);
-  uint8_t *output_buf = &resp[sizeof(*output_len)];
-  server.compute(ds_id, opcode, input_len, input_buf, output_len, output_buf);
+  respond(request->connection, request->tag, &succeed, sizeof(succeed));
+}
+
+void worker_fn() {
+  while (true) {
+    uint32_t priority;
+    auto *request = dequeue(&priority);
+    switch (request->opcode) {
+    case TCPDevice::kOpReadObject:
+      process_read_object(request);
+      break;
+    case TCPDevice::kOpRemoveObject:
+      process_remove_object(request);
+      break;
+    case TCPDevice::kOpConstruct:
+      process_construct(request);
+      break;
+    case TCPDevice::kOpDeconstruct:
+      process_destruct(request);
+      break;
+    case TCPDevice::kOpCompute:
+      process_compute(request);
+      break;
+    case TCPDevice::kOpComputeStream:
+      process_compute_stream(request);
+      break;
+    case TCPDevice::kOpSnapshot:
+      process_snapshot(request);
+      break;
+    default:
+      BUG();
+    }
+    if (priority == kLowPriority) {
+      rt::ScopedLock<rt::Mutex> lock(&queue_mutex);
+      num_running_low_priority--;
+      queue_cv.Signal();
+    }
+    request->connection->inflight.Done();
+    delete request;
+  }
+}
 
-  helpers::tcp_write_until(c, resp, sizeof(*output_len) + *output_len);
+// Reads the body of a request (everything after the tag) whose fixed-size
+// part is fixed_len bytes; var_len_fn returns the length of the variable-size
+// part given the fixed-size one.
+template <typename F>
+Request *read_request(Connection *connection, uint8_t opcode, uint64_t tag,
+                      uint32_t fixed_len, F &&var_len_fn) {
+  auto *request = new Request();
+  request->connection = connection;
+  request->tag = tag;
+  request->opcode = opcode;
+  request->buf.resize(fixed_len);
+  if (fixed_len) {
+    helpers::tcp_read_until(connection->conn, request->buf.data(), fixed_len);
+  }
+  uint64_t var_len = var_len_fn(request->buf.data());
+  if (var_len) {
+    request->buf.resize(fixed_len + var_len);
+    helpers::tcp_read_until(connection->conn, &request->buf[fixed_len],
+                            var_len);
+  }
+  return request;
 }
 
 void slave_fn(tcpconn_t *c) {
+  Connection connection;
+  connection.conn = c;
+
   // Run event loop.
-  uint8_t opcode;
+  uint8_t header[TCPDevice::kOpcodeSize + TCPDevice::kTagSize];
   int ret;
-  while ((ret = tcp_read(c, &opcode, TCPDevice::kOpcodeSize)) > 0) {
+  while ((ret = tcp_read(c, header, TCPDevice::kOpcodeSize)) > 0) {
     BUG_ON(ret != TCPDevice::kOpcodeSize);
+    helpers::tcp_read_until(c, &header[TCPDevice::kOpcodeSize],
+                            TCPDevice::kTagSize);
+    auto opcode = header[0];
+    auto tag = *reinterpret_cast<uint64_t *>(&header[TCPDevice::kOpcodeSize]);
     switch (opcode) {
     case TCPDevice::kOpReadObject:
-      process_read_object(c);
+    case TCPDevice::kOpRemoveObject:
+      enqueue(read_request(&connection, opcode, tag,
+                           Object::kDSIDSize + Object::kIDLenSize,
+                           [](uint8_t *req) { return req[Object::kDSIDSize]; }),
+              kHighPriority);
       break;
     case TCPDevice::kOpWriteObject:
-      process_write_object(c);
-      break;
-    case TCPDevice::kOpRemoveObject:
-      process_remove_object(c);
+      process_write_object(&connection, tag);
       break;
     case TCPDevice::kOpConstruct:
-      process_construct(c);
+      enqueue(read_request(&connection, opcode, tag,
+                           sizeof(uint8_t) + Object::kDSIDSize +
+                               sizeof(uint8_t),
+                           [](uint8_t *req) {
+                             return req[sizeof(uint8_t) + Object::kDSIDSize];
+                           }),
+              kLowPriority);
       break;
     case TCPDevice::kOpDeconstruct:
-      process_destruct(c);
+      enqueue(read_request(&connection, opcode, tag, Object::kDSIDSize,
+                           [](uint8_t *) { return 0; }),
+              kLowPriority);
       break;
     case TCPDevice::kOpCompute:
-      process_compute(c);
+      enqueue(read_request(&connection, opcode, tag,
+                           Object::kDSIDSize + sizeof(uint8_t) +
+                               sizeof(uint16_t),
+                           [](uint8_t *req) {
+                             return *reinterpret_cast<uint16_t *>(
+                                 &req[Object::kDSIDSize + sizeof(uint8_t)]);
+                           }),
+              kLowPriority);
+      break;
+    case TCPDevice::kOpComputeStream:
+      enqueue(read_request(&connection, opcode, tag,
+                           Object::kDSIDSize + sizeof(uint8_t) +
+                               sizeof(uint64_t),
+                           [](uint8_t *req) {
+                             return *reinterpret_cast<uint64_t *>(
+                                 &req[Object::kDSIDSize + sizeof(uint8_t)]);
+                           }),
+              kLowPriority);
+      break;
+    case TCPDevice::kOpSnapshot:
+      enqueue(read_request(&connection, opcode, tag, 0,
+                           [](uint8_t *) { return 0; }),
+              kLowPriority);
+      break;
+    case TCPDevice::kOpStreamCredit:
+      process_stream_credit(&connection, tag);
       break;
     default:
       BUG();
     }
   }
+  {
+    rt::ScopedLock<rt::Spin> lock(&connection.streams_spin);
+    connection.closed = true;
+    for (auto &[tag, window] : connection.streams) {
+      window->cv.Signal();
+    }
+  }
+  connection.inflight.Wait();
   tcp_close(c);
 }
 
@@ -272,6 +545,17 @@ void master_fn(tcpconn_t *c) {
 }
 
 void do_work(uint16_t port) {
+  // Reserve the arena up front, on the NUMA node of the runtime cores.
+  auto &arena = ServerArena::get();
+  LOG_PRINTF("Info: server arena of %lu B on NUMA node %u.\n",
+             arena.get_capacity(), arena.get_numa_node());
+  if (!snapshot_dir.empty()) {
+    server.restore(snapshot_dir);
+  }
+  for (uint32_t i = 0; i < num_workers; i++) {
+    worker_threads.emplace_back(rt::Thread([]() { worker_fn(); }));
+  }
+
   tcpqueue_t *q;
   struct netaddr server_addr = {.ip = 0, .port = port};
   tcp_listen(server_addr, 1, &q);
@@ -292,6 +576,12 @@ int argc;
 void my_main(void *arg) {
   char **argv = static_cast<char **>(arg);
   int port = atoi(argv[1]);
+  num_workers = (argc > 2) ? atoi(argv[2])
+                           : helpers::get_num_runtime_cores() * 2;
+  BUG_ON(num_workers == 0);
+  if (argc > 3) {
+    snapshot_dir = argv[3];
+  }
   do_work(port);
 }
 
@@ -299,7 +589,9 @@ int main(int _argc, char *argv[]) {
   int ret;
 
   if (_argc < 3) {
-    std::cerr << "usage: [cfg_file] [port]" << std::endl;
+    std::cerr << "usage: [cfg_file] [port] [num_workers (optional)] "
+                 "[snapshot_dir (optional)]"
+              << std::endl;
     return -EINVAL;
   }
 
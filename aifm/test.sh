@@ -10,6 +10,9 @@ function run_single_test {
     if [[ $1 == *"tcp"* ]]; then
     	rerun_mem_server
     fi
+    if [[ $1 == *"shm"* ]]; then
+    	rerun_shm_server
+    fi
     if run_program ./bin/$1 2>/dev/null | grep -q "Passed"; then
         say_passed
     else
@@ -29,6 +32,7 @@ function run_all_tests {
 function cleanup {
     kill_local_iokerneld
     kill_mem_server
+    kill_shm_server
 }
 
 run_all_tests
@@ -66,7 +66,7 @@ public:
   uint64_t small_ptrs_miss_cnt[kSmallPtrsNumEntries];
 
   void flush_core_local_regions(FarMemManager *mgr) {
-    for (int i = 0; i < helpers::kNumCPUs; i++) {
+    for (uint32_t i = 0; i < helpers::get_num_runtime_cores(); i++) {
       mgr->cache_region_manager_.try_refill_core_local_free_region(
           0, &(mgr->cache_region_manager_.core_local_free_regions_[i]));
       mgr->cache_region_manager_.try_refill_core_local_free_region(
@@ -0,0 +1,105 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "array.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr uint64_t kCacheSize = (64ULL << 20);
+constexpr uint64_t kFarMemSize = (4ULL << 30);
+constexpr uint32_t kNumGCThreads = 12;
+constexpr uint32_t kNumEntries =
+    (8ULL << 20); // So the array size is larger than the local cache size.
+constexpr int64_t kModulo = 1000;
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  auto array = manager->allocate_array<int64_t, kNumEntries>();
+  int64_t expected_sum = 0;
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    int64_t val = i % kModulo;
+    array.write(val, i);
+    expected_sum += val;
+  }
+
+  // Most items are remote by now, so the scans below run on both paths.
+  TEST_ASSERT(array.sum() == expected_sum);
+  TEST_ASSERT(array.sum(kModulo, 2 * kModulo) == kModulo * (kModulo - 1) / 2);
+
+  auto found = array.find_first(KernelCmpOp::Eq, kModulo - 1);
+  TEST_ASSERT(found && *found == kModulo - 1);
+  found = array.find_first(KernelCmpOp::Gt, kModulo, 0, kNumEntries);
+  TEST_ASSERT(!found);
+  found = array.find_first(KernelCmpOp::Eq, 7, kNumEntries - kModulo);
+  TEST_ASSERT(found && *found % kModulo == 7);
+
+  auto matched = array.filter(KernelCmpOp::Lt, 3);
+  TEST_ASSERT(matched.size() ==
+              kNumEntries / kModulo * 3 +
+                  std::min<uint64_t>(kNumEntries % kModulo, 3));
+  for (auto idx : matched) {
+    TEST_ASSERT(static_cast<int64_t>(idx % kModulo) < 3);
+  }
+
+  int64_t pattern = 42;
+  matched = array.search(&pattern, sizeof(pattern), 0, 10 * kModulo);
+  TEST_ASSERT(matched.size() == 10);
+  for (uint32_t i = 0; i < matched.size(); i++) {
+    TEST_ASSERT(matched[i] == static_cast<uint64_t>(i * kModulo + 42));
+  }
+
+  // The parallel scans cover every item once, whether cached or not.
+  array.parallel_for(
+      [](const DerefScope &scope, uint64_t idx, int64_t &val) { val += 1; },
+      0, kModulo);
+  auto sum = array.parallel_reduce(
+      static_cast<int64_t>(0),
+      [](int64_t &acc, const DerefScope &scope, uint64_t idx,
+         const int64_t &val) { acc += val; },
+      [](int64_t &acc, const int64_t &other) { acc += other; });
+  TEST_ASSERT(sum == expected_sum + kModulo);
+  std::atomic<int64_t> const_sum = 0;
+  std::as_const(array).parallel_for(
+      [&](const DerefScope &scope, uint64_t idx, const int64_t &val) {
+        const_sum.fetch_add(val, std::memory_order_relaxed);
+      });
+  TEST_ASSERT(const_sum == sum);
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -9,10 +9,12 @@ extern "C" {
 #include "helpers.hpp"
 #include "manager.hpp"
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <unistd.h>
 #include <vector>
 
 using namespace far_memory;
@@ -23,10 +25,76 @@ constexpr uint64_t kFarMemSize = (1ULL << 33); // 8 GB.
 constexpr uint64_t kWorkSetSize = 1 << 30;
 constexpr uint64_t kNumGCThreads = 12;
 constexpr uint64_t kNumEntries = 64 << 20; // 64 million entries.
+constexpr uint64_t kNumGeneratedLines = 400000;
+// Odd, so that the block ends fall in the middle of lines.
+constexpr uint64_t kGeneratedBlockSize = (1 << 20) + 7;
+constexpr uint64_t kGeneratedMinBytesPerThread = 64 << 10;
 
 namespace far_memory {
 class FarMemTest {
 private:
+  // Writes a CSV of several MBs whose last line has no trailing newline, and
+  // returns its path. Some lines end with "\r\n" and some are empty.
+  std::string generate_csv(std::vector<long long> *ids,
+                           std::vector<double> *vals,
+                           std::vector<char> *flags) {
+    char path[] = "/tmp/test_csv_reader_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd != -1);
+    auto file = fdopen(fd, "w");
+    TEST_ASSERT(file);
+    fprintf(file, "flag,id,ignored,val\n");
+    for (uint64_t i = 0; i < kNumGeneratedLines; i++) {
+      if (i % 9973 == 0) {
+        fprintf(file, "\n");
+        continue;
+      }
+      ids->push_back(i * 7919);
+      vals->push_back(static_cast<double>(i) / 4);
+      flags->push_back('A' + i % 26);
+      fprintf(file, "%c,%lld,%lu,%.2f", flags->back(), ids->back(), i * i,
+              vals->back());
+      if (i + 1 != kNumGeneratedLines) {
+        fprintf(file, i % 7 ? "\n" : "\r\n");
+      }
+    }
+    TEST_ASSERT(fclose(file) == 0);
+    return path;
+  }
+
+  void test_generated_csv(FarMemManager *manager) {
+    std::vector<long long> ids;
+    std::vector<double> vals;
+    std::vector<char> flags;
+    auto path = generate_csv(&ids, &vals, &flags);
+
+    // The small blocks make the loader run multiple blocks, realign each of
+    // them to a line boundary, and split each across threads.
+    io::CSVLoadOptions options;
+    options.block_size = kGeneratedBlockSize;
+    options.min_bytes_per_thread = kGeneratedMinBytesPerThread;
+    auto [id_vec, val_vec, flag_vec] =
+        io::parse_csv_to_vectors<long long, double, char>(
+            manager, options, path, "id", "val", "flag");
+    TEST_ASSERT(unlink(path.c_str()) == 0);
+
+    TEST_ASSERT(id_vec.size() == ids.size());
+    TEST_ASSERT(val_vec.size() == ids.size());
+    TEST_ASSERT(flag_vec.size() == ids.size());
+    for (uint64_t i = 0; i < ids.size(); i++) {
+      DerefScope scope;
+      TEST_ASSERT(id_vec.at(scope, i) == ids[i]);
+      TEST_ASSERT(val_vec.at(scope, i) == vals[i]);
+      TEST_ASSERT(flag_vec.at(scope, i) == flags[i]);
+    }
+
+    // The server-side columns are reserved from the first block's row count,
+    // which must not overflow for files of many GBs.
+    TEST_ASSERT(io::detail::estimate_num_rows(1000, 1 << 20, 8 << 20) == 8000);
+    TEST_ASSERT(io::detail::estimate_num_rows(1ULL << 40, 1ULL << 30,
+                                              1ULL << 40) == (1ULL << 50));
+  }
+
 public:
   void do_work(FarMemManager *manager) {
     auto my_tuple =
@@ -42,6 +110,14 @@ public:
             "mta_tax", "tip_amount", "tolls_amount", "improvement_surcharge",
             "total_amount");
 
+    // The loader splits the rows across threads, but every column gets all
+    // of them.
+    constexpr uint64_t kNumRows = 19;
+    TEST_ASSERT(std::get<0>(my_tuple).size() == kNumRows);
+    TEST_ASSERT(
+        std::get<std::tuple_size<decltype(my_tuple)>::value - 1>(my_tuple)
+            .size() == kNumRows);
+
     DerefScope scope;
     TEST_ASSERT(std::get<0>(my_tuple).at(scope, 0) == 2);
     TEST_ASSERT(std::get<1>(my_tuple).at(scope, 0) ==
@@ -65,6 +141,8 @@ public:
                 .at(scope, 17) -
             9.95) < 1E-5);
 
+    test_generated_csv(manager);
+
     cout << "Passed" << endl;
     return;
   }
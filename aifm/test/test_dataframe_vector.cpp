@@ -6,12 +6,16 @@ extern "C" {}
 #include "helpers.hpp"
 #include "manager.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 using namespace far_memory;
@@ -108,6 +112,15 @@ public:
       TEST_ASSERT(insert_pair.second == true);
     }
 
+    auto streamed_unique_vector =
+        dataframe_vector.get_col_unique_values_streamed(manager);
+    TEST_ASSERT(streamed_unique_vector.size() == kNumEntries / 2);
+    for (uint64_t i = 0; i < kNumEntries / 2; i++) {
+      DerefScope scope;
+      auto val = streamed_unique_vector.at(scope, i);
+      TEST_ASSERT(hashset.erase(val) == 1);
+    }
+
     auto index_vector =
         manager->allocate_dataframe_vector<unsigned long long>();
     constexpr auto slice_size = kNumEntries / 4;
@@ -217,6 +230,31 @@ public:
       }
     }
 
+    {
+      // Runs long and many enough to span the ranges of several server threads.
+      constexpr uint64_t kNumRows = 1 << 18;
+      constexpr uint64_t kRunLen = 1000;
+      auto key_vec = manager->allocate_dataframe_vector<int>();
+      auto data_vec = manager->allocate_dataframe_vector<float>();
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        key_vec.push_back(scope, static_cast<int>(i / kRunLen));
+        data_vec.push_back(scope, -static_cast<float>(i % kRunLen));
+      }
+      auto agg_max_vec = data_vec.aggregate_max(manager, key_vec);
+      auto agg_min_vec = data_vec.aggregate_min(manager, key_vec);
+      constexpr uint64_t kNumRuns = (kNumRows - 1) / kRunLen + 1;
+      TEST_ASSERT(agg_max_vec.size() == kNumRuns);
+      TEST_ASSERT(agg_min_vec.size() == kNumRuns);
+      for (uint64_t i = 0; i < kNumRuns; i++) {
+        DerefScope scope;
+        auto run_len = std::min(kRunLen, kNumRows - i * kRunLen);
+        TEST_ASSERT(agg_max_vec.at(scope, i) == 0);
+        TEST_ASSERT(agg_min_vec.at(scope, i) ==
+                    -static_cast<float>(run_len - 1));
+      }
+    }
+
     {
       short data[] = {2, 5, 3, 7, 4, 6, 2, 6, 9, 0, -3, -5, -4, 3, -9};
       auto data_vec = manager->allocate_dataframe_vector<short>();
@@ -235,6 +273,401 @@ public:
       }
     }
 
+    {
+      constexpr uint64_t kNumRows = 1 << 20;
+      auto long_vec = manager->allocate_dataframe_vector<long long>();
+      auto double_vec = manager->allocate_dataframe_vector<double>();
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        long long val = static_cast<long long>(rand()) - RAND_MAX / 2;
+        long_vec.push_back(scope, val);
+        double_vec.push_back(scope, static_cast<double>(val) / 3);
+      }
+      auto long_indices = long_vec.get_sorted_indices(manager, false);
+      auto long_sorted = long_vec.shuffle_data_by_idx(manager, long_indices);
+      auto double_indices =
+          double_vec.get_sorted_indices<false>(manager, false);
+      auto double_sorted =
+          double_vec.shuffle_data_by_idx(manager, double_indices);
+      TEST_ASSERT(long_sorted.size() == kNumRows);
+      TEST_ASSERT(double_sorted.size() == kNumRows);
+      for (uint64_t i = 1; i < kNumRows; i++) {
+        DerefScope scope;
+        TEST_ASSERT(long_sorted.at(scope, i - 1) <= long_sorted.at(scope, i));
+        TEST_ASSERT(double_sorted.at(scope, i - 1) >=
+                    double_sorted.at(scope, i));
+      }
+    }
+
+    {
+      constexpr uint64_t kNumRows = 100000;
+      auto int_vec = manager->allocate_dataframe_vector<int>();
+      auto double_vec = manager->allocate_dataframe_vector<double>();
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        int_vec.push_back(scope, static_cast<int>(i % 100));
+        double_vec.push_back(scope, static_cast<double>(i) / 2);
+      }
+      // (10 <= int <= 19 && double < 10000) || int in {42, 77} || !(int < 99)
+      auto pred =
+          (DataFramePredicate::range(int_vec, 10, 19) &&
+           DataFramePredicate::cmp(double_vec, KernelCmpOp::Lt, 10000.0)) ||
+          DataFramePredicate::in(int_vec, {77, 42}) ||
+          !DataFramePredicate::cmp(int_vec, KernelCmpOp::Lt, 99);
+      auto expected_fn = [](uint64_t i) {
+        auto int_val = static_cast<int>(i % 100);
+        auto double_val = static_cast<double>(i) / 2;
+        return (int_val >= 10 && int_val <= 19 && double_val < 10000) ||
+               int_val == 42 || int_val == 77 || int_val >= 99;
+      };
+      auto indices = int_vec.filter(manager, pred);
+      uint64_t num_expected = 0;
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        if (expected_fn(i)) {
+          DerefScope scope;
+          TEST_ASSERT(indices.at(scope, num_expected++) == i);
+        }
+      }
+      TEST_ASSERT(indices.size() == num_expected);
+
+      auto selected = double_vec.copy_data_by_idx(manager, indices);
+      TEST_ASSERT(selected.size() == num_expected);
+      for (uint64_t i = 0; i < selected.size(); i++) {
+        DerefScope scope;
+        TEST_ASSERT(selected.at(scope, i) ==
+                    static_cast<double>(indices.at(scope, i)) / 2);
+      }
+    }
+
+    {
+      // Both keys cycle, so that the 35 (int, char) groups are interleaved.
+      constexpr uint64_t kNumRows = 1 << 18;
+      constexpr uint64_t kNumGroups = 35;
+      auto int_vec = manager->allocate_dataframe_vector<int>();
+      auto char_vec = manager->allocate_dataframe_vector<char>();
+      auto long_vec = manager->allocate_dataframe_vector<long long>();
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        int_vec.push_back(scope, static_cast<int>(i % 7));
+        char_vec.push_back(scope, static_cast<char>(i * 13 % 5));
+        long_vec.push_back(scope, static_cast<long long>(i));
+      }
+      auto int_out = manager->allocate_dataframe_vector<int>();
+      auto char_out = manager->allocate_dataframe_vector<char>();
+      auto cnt_out = manager->allocate_dataframe_vector<unsigned long long>();
+      auto sum_out = manager->allocate_dataframe_vector<long>();
+      auto mean_out = manager->allocate_dataframe_vector<double>();
+      auto min_out = manager->allocate_dataframe_vector<long long>();
+      auto max_out = manager->allocate_dataframe_vector<long long>();
+      auto std_out = manager->allocate_dataframe_vector<double>();
+      DataFrameGroupBy group_by;
+      group_by.key(int_vec, &int_out);
+      group_by.key(char_vec, &char_out);
+      group_by.agg<GroupByAggFn::Count>(long_vec, &cnt_out);
+      group_by.agg<GroupByAggFn::Sum>(long_vec, &sum_out);
+      group_by.agg<GroupByAggFn::Mean>(long_vec, &mean_out);
+      group_by.agg<GroupByAggFn::Min>(long_vec, &min_out);
+      group_by.agg<GroupByAggFn::Max>(long_vec, &max_out);
+      group_by.agg<GroupByAggFn::Std>(long_vec, &std_out);
+      TEST_ASSERT(group_by.run() == kNumGroups);
+      TEST_ASSERT(std_out.size() == kNumGroups);
+
+      std::unordered_set<uint64_t> seen;
+      for (uint64_t g = 0; g < kNumGroups; g++) {
+        DerefScope scope;
+        // The group holds the rows i = r (mod 35).
+        uint64_t r = 0;
+        while (static_cast<int>(r % 7) != int_out.at(scope, g) ||
+               static_cast<char>(r * 13 % 5) != char_out.at(scope, g)) {
+          r++;
+        }
+        TEST_ASSERT(r < kNumGroups && seen.insert(r).second);
+        uint64_t cnt = (kNumRows - r - 1) / kNumGroups + 1;
+        long sum = 0;
+        for (uint64_t i = r; i < kNumRows; i += kNumGroups) {
+          sum += i;
+        }
+        double mean = static_cast<double>(sum) / cnt;
+        double sq_sum = 0;
+        for (uint64_t i = r; i < kNumRows; i += kNumGroups) {
+          sq_sum += (i - mean) * (i - mean);
+        }
+        TEST_ASSERT(cnt_out.at(scope, g) == cnt);
+        TEST_ASSERT(sum_out.at(scope, g) == sum);
+        TEST_ASSERT(std::abs(mean_out.at(scope, g) - mean) < 1e-6);
+        TEST_ASSERT(min_out.at(scope, g) == static_cast<long long>(r));
+        TEST_ASSERT(max_out.at(scope, g) ==
+                    static_cast<long long>(r + (cnt - 1) * kNumGroups));
+        TEST_ASSERT(std::abs(std_out.at(scope, g) -
+                             std::sqrt(sq_sum / (cnt - 1))) < 1e-6);
+      }
+    }
+
+    {
+      // The left keys in [2500, 5000) match one right row each, the right keys
+      // in [5000, 6500) match none.
+      constexpr uint64_t kNumLhsRows = 1 << 17;
+      constexpr uint64_t kNumRhsRows = 4000;
+      auto lhs_key = [](uint64_t i) -> long long { return i % 5000; };
+      auto rhs_key = [](uint64_t i) -> long long { return i + 2500; };
+      auto lhs_vec = manager->allocate_dataframe_vector<long long>();
+      auto rhs_vec = manager->allocate_dataframe_vector<long long>();
+      auto rhs_val_vec = manager->allocate_dataframe_vector<double>();
+      uint64_t num_matches = 0;
+      for (uint64_t i = 0; i < kNumLhsRows; i++) {
+        DerefScope scope;
+        lhs_vec.push_back(scope, lhs_key(i));
+        num_matches += (lhs_key(i) >= 2500);
+      }
+      for (uint64_t i = 0; i < kNumRhsRows; i++) {
+        DerefScope scope;
+        rhs_vec.push_back(scope, rhs_key(i));
+        rhs_val_vec.push_back(scope, static_cast<double>(i));
+      }
+
+      auto [inner_lhs_idxs, inner_rhs_idxs] =
+          rhs_vec.join(manager, lhs_vec, DataFrameJoinPolicy::Inner);
+      TEST_ASSERT(inner_lhs_idxs.size() == num_matches);
+      TEST_ASSERT(inner_rhs_idxs.size() == num_matches);
+
+      auto [lhs_idxs, rhs_idxs] =
+          lhs_vec.join(manager, rhs_vec, DataFrameJoinPolicy::LeftRight);
+      TEST_ASSERT(lhs_idxs.size() == kNumLhsRows + 1500);
+      auto rhs_vals = rhs_val_vec.copy_data_by_idx(manager, rhs_idxs);
+      for (uint64_t i = 0; i < lhs_idxs.size(); i++) {
+        DerefScope scope;
+        auto lhs_idx = lhs_idxs.at(scope, i);
+        auto rhs_idx = rhs_idxs.at(scope, i);
+        if (lhs_idx == kDataFrameNullIdx) {
+          TEST_ASSERT(rhs_idx < kNumRhsRows && rhs_key(rhs_idx) >= 5000);
+        } else if (rhs_idx == kDataFrameNullIdx) {
+          TEST_ASSERT(lhs_key(lhs_idx) < 2500);
+          TEST_ASSERT(std::isnan(rhs_vals.at(scope, i)));
+        } else {
+          TEST_ASSERT(lhs_key(lhs_idx) == rhs_key(rhs_idx));
+          TEST_ASSERT(rhs_vals.at(scope, i) == rhs_idx);
+        }
+      }
+    }
+
+    {
+      // The zone maps of a sorted column let filter_range() fetch only the
+      // chunks that overlap the range, and the ones that at_mut() writes in
+      // get summarized again.
+      constexpr uint64_t kNumRows = 1 << 18;
+      constexpr uint64_t kChunkNumEntries =
+          DataFrameVector<long long>::kRealChunkNumEntries;
+      auto vec = manager->allocate_dataframe_vector<long long>();
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        vec.push_back(scope, static_cast<long long>(i * 10));
+      }
+      for (uint64_t i = 0; i < kNumRows / kChunkNumEntries; i++) {
+        TEST_ASSERT(vec.zone_maps_[i].count == kChunkNumEntries);
+        TEST_ASSERT(vec.zone_maps_[i].min ==
+                    static_cast<long long>(i * kChunkNumEntries * 10));
+      }
+      {
+        DerefScope scope;
+        vec.at_mut(scope, 7) = 1000005;
+        vec.pop_back(scope);
+        vec.push_back(scope, -5LL);
+      }
+      TEST_ASSERT(vec.zone_maps_[0].count == 0);
+      auto idxs = vec.filter_range(manager, 1000000, 1000100);
+      TEST_ASSERT(idxs.size() == 12);
+      TEST_ASSERT(vec.zone_maps_[0].count == kChunkNumEntries);
+      TEST_ASSERT(vec.zone_maps_[0].max == 1000005);
+      {
+        DerefScope scope;
+        TEST_ASSERT(idxs.at(scope, 0) == 7);
+        for (uint64_t i = 1; i < idxs.size(); i++) {
+          TEST_ASSERT(idxs.at(scope, i) == 100000 + i - 1);
+        }
+      }
+      auto neg_idxs = vec.filter_range(manager, -10, -1);
+      TEST_ASSERT(neg_idxs.size() == 1);
+      {
+        DerefScope scope;
+        TEST_ASSERT(neg_idxs.at(scope, 0) == kNumRows - 1);
+      }
+      // A mutable FastIterator resets the zone map of its chunk again on
+      // renew(), as it may be written through from then on.
+      {
+        DerefScope scope;
+        auto it = vec.fbegin(scope);
+        TEST_ASSERT(vec.zone_maps_[0].count == 0);
+        vec.zone_maps_[0].count = kChunkNumEntries;
+        scope.renew();
+        it.renew(scope);
+        TEST_ASSERT(vec.zone_maps_[0].count == 0);
+        *it = 1000010;
+      }
+      idxs = vec.filter_range(manager, 1000010, 1000010);
+      TEST_ASSERT(idxs.size() == 2);
+    }
+
+    {
+      // A run-heavy and a time series chunk shrink, a random one does not,
+      // and all of them come back intact.
+      constexpr uint32_t kNumEntries = 512;
+      long long runs[kNumEntries], rand_vals[kNumEntries];
+      SimpleTime times[kNumEntries], decoded_times[kNumEntries];
+      for (uint32_t i = 0; i < kNumEntries; i++) {
+        runs[i] = i / 100;
+        rand_vals[i] = (static_cast<long long>(rand()) << 32) | rand();
+        uint32_t sec = 3600 + i * 3;
+        times[i] = SimpleTime(2016, 1, 3, sec / 3600, sec / 60 % 60, sec % 60);
+      }
+      uint8_t buf[kNumEntries * sizeof(long long)];
+      auto len = DataFrameChunkCodec<long long>::encode(runs, kNumEntries, buf);
+      TEST_ASSERT(len > 0 && len < sizeof(runs) / 10);
+      long long decoded[kNumEntries];
+      DataFrameChunkCodec<long long>::decode(buf, len, decoded, kNumEntries);
+      TEST_ASSERT(std::equal(runs, runs + kNumEntries, decoded));
+      TEST_ASSERT(!DataFrameChunkCodec<long long>::encode(rand_vals,
+                                                          kNumEntries, buf));
+      len = DataFrameChunkCodec<SimpleTime>::encode(times, kNumEntries, buf);
+      TEST_ASSERT(len > 0 && len < sizeof(times));
+      DataFrameChunkCodec<SimpleTime>::decode(buf, len, decoded_times,
+                                              kNumEntries);
+      for (uint32_t i = 0; i < kNumEntries; i++) {
+        TEST_ASSERT(!(decoded_times[i] < times[i]) &&
+                    !(decoded_times[i] > times[i]));
+      }
+    }
+
+    {
+      // The chunks of vec reach the server encoded when assign() flushes
+      // them, and the ones of copy come back encoded when read.
+      constexpr uint64_t kNumRows = 1 << 18;
+      auto vec = manager->allocate_dataframe_vector<int>();
+      vec.enable_encoding();
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        vec.push_back(scope, static_cast<int>(i / 100 % 7));
+      }
+      auto copy = manager->allocate_dataframe_vector<int>();
+      copy.enable_encoding();
+      copy.assign(vec.cbegin(), vec.cend());
+      TEST_ASSERT(copy.size() == kNumRows);
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        TEST_ASSERT(copy.at(scope, i) == static_cast<int>(i / 100 % 7));
+      }
+    }
+
+    {
+      // The workers of parallel_for() and parallel_reduce() cover every
+      // element of the range once, including a range that starts and ends
+      // within a chunk.
+      constexpr uint64_t kNumRows = 1 << 20;
+      auto vec = manager->allocate_dataframe_vector<long long>();
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        DerefScope scope;
+        vec.push_back(scope, static_cast<long long>(i));
+      }
+      // The const overload reads the elements without dirtying the chunks or
+      // resetting their zone maps.
+      std::atomic<uint64_t> num_matches = 0;
+      std::as_const(vec).parallel_for(
+          [&](const DerefScope &scope, uint64_t idx, const long long &val) {
+            if (val == static_cast<long long>(idx)) {
+              num_matches.fetch_add(1, std::memory_order_relaxed);
+            }
+          });
+      TEST_ASSERT(num_matches == kNumRows);
+      TEST_ASSERT(vec.zone_maps_[0].count ==
+                  DataFrameVector<long long>::kRealChunkNumEntries);
+      vec.parallel_for([](const DerefScope &scope, uint64_t idx,
+                          long long &val) { val = val * 2 + (idx & 1); });
+      auto sum = [](long long &acc, const DerefScope &scope, uint64_t idx,
+                    const long long &val) { acc += val; };
+      auto add = [](long long &acc, const long long &other) { acc += other; };
+      long long total = 0;
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        total += i * 2 + (i & 1);
+      }
+      TEST_ASSERT(vec.parallel_reduce(0LL, sum, add) == total);
+      constexpr uint64_t kBegin = 1000, kEnd = kNumRows - 1000;
+      total = 0;
+      for (uint64_t i = kBegin; i < kEnd; i++) {
+        total += i * 2 + (i & 1);
+      }
+      TEST_ASSERT(vec.parallel_reduce(0LL, sum, add, kBegin, kEnd) == total);
+      auto first_odd = vec.parallel_reduce(
+          kNumRows,
+          [](uint64_t &acc, const DerefScope &scope, uint64_t idx,
+             const long long &val) {
+            if (val % 2 && acc == kNumRows) {
+              acc = idx;
+            }
+          },
+          [](uint64_t &acc, const uint64_t &other) {
+            acc = std::min(acc, other);
+          });
+      TEST_ASSERT(first_odd == 1);
+    }
+
+    {
+      // append() fills the partial chunk that push_back() left, and the
+      // chunks after it.
+      constexpr uint64_t kNumRows = 3 * 4096 + 5;
+      auto vec = manager->allocate_dataframe_vector<int>();
+      {
+        DerefScope scope;
+        vec.push_back(scope, -1);
+      }
+      std::vector<int> vals(kNumRows);
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        vals[i] = i * 3;
+      }
+      vec.append(vals.data(), kNumRows);
+      TEST_ASSERT(vec.size() == kNumRows + 1);
+      DerefScope scope;
+      TEST_ASSERT(vec.at(scope, 0) == -1);
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        TEST_ASSERT(vec.at(scope, i + 1) == static_cast<int>(i * 3));
+      }
+    }
+
+    {
+      // The bulk copies round-trip whether the chunks go through the local
+      // cache or, with Bypass, straight to and from the server, encoded or
+      // not.
+      constexpr uint64_t kChunkNumEntries =
+          DataFrameVector<int>::kRealChunkNumEntries;
+      constexpr uint64_t kNumRows = 64 * kChunkNumEntries + 7;
+      std::vector<int> vals(kNumRows), out(kNumRows);
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        vals[i] = i / 10;
+      }
+      for (bool encoded : {false, true}) {
+        auto vec = manager->allocate_dataframe_vector<int>();
+        if (encoded) {
+          vec.enable_encoding();
+        }
+        vec.append</* Bypass = */ true>(vals.data(), kNumRows);
+        TEST_ASSERT(vec.size() == kNumRows);
+        TEST_ASSERT(vec.zone_maps_[1].min ==
+                    static_cast<int>(kChunkNumEntries / 10));
+        vec.read_range</* Bypass = */ true>(0, kNumRows, out.data());
+        TEST_ASSERT(out == vals);
+        for (uint64_t i = 0; i < kNumRows; i++) {
+          vals[i] = -vals[i];
+        }
+        vec.write_range</* Bypass = */ true>(3, kNumRows - 3, vals.data() + 3);
+        vec.write_range(0, 3, vals.data());
+        vec.read_range(0, kNumRows, out.data());
+        TEST_ASSERT(out == vals);
+        DerefScope scope;
+        TEST_ASSERT(vec.at(scope, kNumRows - 1) == vals.back());
+        for (uint64_t i = 0; i < kNumRows; i++) {
+          vals[i] = -vals[i];
+        }
+      }
+    }
+
     cout << "Passed" << endl;
   }
 };
@@ -0,0 +1,155 @@
+extern "C" {
+#include <runtime/runtime.h>
+#include <runtime/timer.h>
+}
+#include "thread.h"
+
+#include "array.hpp"
+#include "device.hpp"
+#include "device_scheduler.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr uint64_t kCacheSize = (64ULL << 20);
+constexpr uint64_t kFarMemSize = (4ULL << 30);
+constexpr uint32_t kNumGCThreads = 12;
+constexpr uint32_t kNumEntries =
+    (8ULL << 20); // So the array size is larger than the local cache size.
+constexpr uint32_t kMaxInflight = 4;
+constexpr uint64_t kHoldUs = 200;
+
+void test_priority() {
+  DeviceScheduler scheduler(1);
+  std::vector<TrafficClass> order;
+  rt::Spin order_spin;
+
+  std::optional<DeviceScheduler::Ticket> blocker(
+      scheduler.admit(TrafficClass::kCompute));
+  std::vector<rt::Thread> threads;
+  // Queue up in the reverse order of priority; all of them are admitted long
+  // before aging kicks in.
+  for (auto cls : {TrafficClass::kCompute, TrafficClass::kPrefetch,
+                   TrafficClass::kGCWrite, TrafficClass::kDemandRead}) {
+    threads.emplace_back([&, cls]() {
+      auto ticket = scheduler.admit(cls);
+      rt::ScopedLock<rt::Spin> lock(&order_spin);
+      order.push_back(cls);
+    });
+    while (!scheduler.get_queue_depth(cls)) {
+      thread_yield();
+    }
+  }
+  blocker.reset();
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  TEST_ASSERT(order.size() == 4);
+  TEST_ASSERT(order[0] == TrafficClass::kDemandRead);
+  TEST_ASSERT(order[1] == TrafficClass::kGCWrite);
+  TEST_ASSERT(order[2] == TrafficClass::kPrefetch);
+  TEST_ASSERT(order[3] == TrafficClass::kCompute);
+  TEST_ASSERT(scheduler.get_num_requests(TrafficClass::kCompute) == 2);
+  TEST_ASSERT(scheduler.get_avg_queue_delay_us(TrafficClass::kPrefetch) > 0);
+}
+
+void test_aging() {
+  DeviceScheduler scheduler(1);
+  bool compute_admitted = false;
+
+  std::optional<DeviceScheduler::Ticket> blocker(
+      scheduler.admit(TrafficClass::kDemandRead));
+  rt::Thread compute_thread([&]() {
+    auto ticket = scheduler.admit(TrafficClass::kCompute);
+    ACCESS_ONCE(compute_admitted) = true;
+  });
+  while (!scheduler.get_queue_depth(TrafficClass::kCompute)) {
+    thread_yield();
+  }
+  // Keep the device busy with demand reads; the compute request must still
+  // get through once it has aged enough.
+  std::vector<rt::Thread> threads;
+  for (uint32_t i = 0; i < 64 && !ACCESS_ONCE(compute_admitted); i++) {
+    threads.emplace_back([&]() {
+      auto ticket = scheduler.admit(TrafficClass::kDemandRead);
+      timer_sleep(kHoldUs);
+    });
+    if (i == 0) {
+      blocker.reset();
+    }
+    timer_sleep(kHoldUs / 2);
+  }
+  compute_thread.Join();
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+  TEST_ASSERT(compute_admitted);
+}
+
+void test_device(FarMemManager *manager) {
+  auto *device = manager->get_device();
+  device->enable_scheduler(kMaxInflight);
+  auto *scheduler = device->get_scheduler();
+
+  auto array = manager->allocate_array<int64_t, kNumEntries>();
+  int64_t expected_sum = 0;
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    array.write(static_cast<int64_t>(i), i);
+    expected_sum += i;
+  }
+  int64_t sum = 0;
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    sum += array.read(i);
+  }
+  TEST_ASSERT(sum == expected_sum);
+  TEST_ASSERT(array.sum() == expected_sum);
+
+  TEST_ASSERT(scheduler->get_num_requests(TrafficClass::kDemandRead));
+  TEST_ASSERT(scheduler->get_num_requests(TrafficClass::kGCWrite));
+  TEST_ASSERT(scheduler->get_num_requests(TrafficClass::kCompute));
+  for (auto cls : {TrafficClass::kDemandRead, TrafficClass::kGCWrite,
+                   TrafficClass::kPrefetch, TrafficClass::kCompute}) {
+    TEST_ASSERT(scheduler->get_queue_depth(cls) == 0);
+  }
+}
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  test_priority();
+  test_aging();
+  test_device(manager);
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+extern "C" {
+#include <runtime/runtime.h>
+#include <runtime/timer.h>
+}
+
+#include "gc_pacer.hpp"
+#include "helpers.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr double kAlmostEmptyRatio = 0.03;
+constexpr double kDefaultTriggerRatio = 0.12;
+constexpr double kMinTriggerRatio = 0.05;
+constexpr double kGoalRatio = 0.22;
+constexpr uint32_t kMaxNumGCThreads = 10;
+constexpr uint64_t kEvacBytesPerSecPerThread = (1ULL << 30);
+constexpr uint64_t kSampleUs = 10000;
+
+void alloc_at_rate(GCPacer *pacer, uint64_t bytes_per_sec) {
+  pacer->sample();
+  pacer->add_allocated_bytes(bytes_per_sec / (1000000 / kSampleUs));
+  timer_sleep(kSampleUs);
+  pacer->sample();
+}
+
+void do_work() {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  GCPacer pacer(kAlmostEmptyRatio, kDefaultTriggerRatio, kMinTriggerRatio,
+                kGoalRatio, kMaxNumGCThreads);
+  TEST_ASSERT(pacer.get_trigger_ratio() == kDefaultTriggerRatio);
+  TEST_ASSERT(pacer.get_num_gc_threads() == kMaxNumGCThreads);
+
+  // GC runs 1 GB/s per thread.
+  pacer.add_gc_round(kEvacBytesPerSecPerThread / 1000, 1000, 1);
+
+  // Light load: GC starts late and uses few threads.
+  for (uint32_t i = 0; i < 16; i++) {
+    alloc_at_rate(&pacer, 0);
+  }
+  TEST_ASSERT(pacer.get_trigger_ratio() == kMinTriggerRatio);
+  TEST_ASSERT(pacer.get_num_gc_threads() == 1);
+
+  // Heavy load: GC starts early and uses more threads.
+  for (uint32_t i = 0; i < 64; i++) {
+    alloc_at_rate(&pacer, 4 * kEvacBytesPerSecPerThread);
+  }
+  TEST_ASSERT(pacer.get_trigger_ratio() > kDefaultTriggerRatio);
+  TEST_ASSERT(pacer.get_trigger_ratio() < kGoalRatio);
+  TEST_ASSERT(pacer.get_num_gc_threads() > 4);
+  TEST_ASSERT(pacer.get_evac_bytes_per_sec() >
+              pacer.get_alloc_bytes_per_sec());
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) { do_work(); }
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
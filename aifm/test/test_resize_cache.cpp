@@ -0,0 +1,87 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "array.hpp"
+#include "device.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr uint64_t kCacheSize = (128ULL << 20);
+constexpr uint64_t kMaxCacheSize = (256ULL << 20);
+constexpr uint64_t kShrunkCacheSize = (64ULL << 20);
+constexpr uint64_t kFarMemSize = (4ULL << 30);
+constexpr uint32_t kNumGCThreads = 12;
+constexpr uint32_t kNumEntries =
+    (8ULL << 20); // So the array size is larger than the local cache size.
+
+template <typename T, uint64_t N> bool check_array(Array<T, N> *array) {
+  for (uint64_t i = 0; i < N; i++) {
+    DerefScope scope;
+    if ((*array).at(scope, i) != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  auto array = manager->allocate_array<uint64_t, kNumEntries>();
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    array.at_mut(scope, i) = i;
+  }
+  TEST_ASSERT(manager->get_cache_size() == kCacheSize);
+  TEST_ASSERT(manager->get_max_cache_size() == kMaxCacheSize);
+
+  manager->resize_cache(kShrunkCacheSize);
+  TEST_ASSERT(manager->get_cache_size() == kShrunkCacheSize);
+  TEST_ASSERT(check_array(&array));
+
+  manager->resize_cache(kMaxCacheSize);
+  TEST_ASSERT(manager->get_cache_size() == kMaxCacheSize);
+  TEST_ASSERT(check_array(&array));
+
+  // Never exceeds the reserved address space.
+  manager->resize_cache(2 * kMaxCacheSize);
+  TEST_ASSERT(manager->get_cache_size() == kMaxCacheSize);
+
+  manager->resize_cache(kCacheSize);
+  TEST_ASSERT(manager->get_cache_size() == kCacheSize);
+  TEST_ASSERT(check_array(&array));
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize),
+          kMaxCacheSize));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "helpers.hpp"
+#include "server_arena.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint64_t kArenaSize = 16 * helpers::kHugepageSize;
+constexpr static uint64_t kNumVecEntries = 1 << 24;
+
+void do_work() {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  ServerArena arena(kArenaSize, 0);
+  TEST_ASSERT(arena.get_capacity() == kArenaSize);
+
+  // Large allocations are hugepage aligned and carved out of the arena.
+  auto *a = static_cast<uint8_t *>(arena.allocate(helpers::kHugepageSize + 1));
+  auto *b = static_cast<uint8_t *>(arena.allocate(helpers::kHugepageSize));
+  TEST_ASSERT(reinterpret_cast<uint64_t>(a) % helpers::kHugepageSize == 0);
+  TEST_ASSERT(b == a + 2 * helpers::kHugepageSize);
+  memset(a, 0xff, helpers::kHugepageSize + 1);
+
+  // Freed ranges are coalesced, and come back zeroed.
+  arena.free(a, helpers::kHugepageSize + 1);
+  arena.free(b, helpers::kHugepageSize);
+  auto *c = static_cast<uint8_t *>(arena.allocate(kArenaSize));
+  TEST_ASSERT(c == a);
+  for (uint64_t i = 0; i < helpers::kHugepageSize; i++) {
+    TEST_ASSERT(c[i] == 0);
+  }
+
+  // Falls back to malloc() once exhausted.
+  auto *d = arena.allocate(helpers::kHugepageSize);
+  TEST_ASSERT(d);
+  arena.free(d, helpers::kHugepageSize);
+  arena.free(c, kArenaSize);
+
+  ArenaVector<uint64_t> vec;
+  for (uint64_t i = 0; i < kNumVecEntries; i++) {
+    vec.push_back(i);
+  }
+  vec.resize(2 * kNumVecEntries);
+  for (uint64_t i = 0; i < kNumVecEntries; i++) {
+    TEST_ASSERT(vec[i] == i);
+  }
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) { do_work(); }
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,252 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "dataframe_vector.hpp"
+#include "helpers.hpp"
+#include "internal/dataframe_types.hpp"
+#include "object.hpp"
+#include "server.hpp"
+#include "server_dataframe_vector.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sys/stat.h>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static char kSnapshotDir[] = "/tmp/aifm_server_snapshot";
+constexpr static uint64_t kFarMemSize = (1ULL << 26);
+constexpr static uint32_t kObjectSize = 256;
+constexpr static uint32_t kObjectDataSize = 64;
+constexpr static uint64_t kNumObjects = kFarMemSize / kObjectSize;
+constexpr static uint8_t kHashTableDSID = 1;
+constexpr static uint32_t kHashTableNumEntriesShift = 12;
+constexpr static uint64_t kHashTableDataSize = (1ULL << 22);
+constexpr static uint64_t kNumKVPairs = (1 << kHashTableNumEntriesShift) / 2;
+constexpr static uint8_t kDataFrameVectorDSID = 2;
+constexpr static uint64_t kDataFrameVectorSize = 1 << 20;
+// The size of the client's vector, as flush() records it.
+constexpr static uint64_t kDataFrameVectorClientSize = kDataFrameVectorSize - 5;
+
+class FarMemTest {
+public:
+  constexpr static uint8_t kOpSetSize = GenericDataFrameVector::OpCode::SetSize;
+  constexpr static uint8_t kOpGetSize = GenericDataFrameVector::OpCode::GetSize;
+};
+
+void construct_all(Server *server, uint64_t hashtable_data_size) {
+  uint64_t far_mem_size = kFarMemSize;
+  server->construct(kVanillaPtrDSType, kVanillaPtrDSID, sizeof(far_mem_size),
+                    reinterpret_cast<uint8_t *>(&far_mem_size));
+
+  uint8_t hashtable_params[sizeof(uint32_t) + sizeof(uint64_t)];
+  auto num_entries_shift = kHashTableNumEntriesShift;
+  __builtin_memcpy(&hashtable_params[0], &num_entries_shift,
+                   sizeof(num_entries_shift));
+  __builtin_memcpy(&hashtable_params[sizeof(num_entries_shift)],
+                   &hashtable_data_size, sizeof(hashtable_data_size));
+  server->construct(kHashTableDSType, kHashTableDSID, sizeof(hashtable_params),
+                    hashtable_params);
+
+  uint8_t dt_id = DataFrameTypeID::Long;
+  server->construct(kDataFrameVectorDSType, kDataFrameVectorDSID,
+                    sizeof(dt_id), &dt_id);
+}
+
+void populate(Server *server) {
+  uint8_t data[kObjectDataSize];
+  for (uint64_t i = 0; i < kNumObjects; i++) {
+    uint64_t obj_id = i * kObjectSize;
+    memset(data, static_cast<char>(i), sizeof(data));
+    server->write_object(kVanillaPtrDSID, sizeof(obj_id),
+                         reinterpret_cast<uint8_t *>(&obj_id), sizeof(data),
+                         data);
+  }
+
+  for (uint64_t i = 0; i < kNumKVPairs; i++) {
+    uint64_t val = i * i;
+    server->write_object(kHashTableDSID, sizeof(i),
+                         reinterpret_cast<uint8_t *>(&i), sizeof(val),
+                         reinterpret_cast<uint8_t *>(&val));
+  }
+
+  auto &vec = reinterpret_cast<ServerDataFrameVector<long> *>(
+                  server->get_server_ds(kDataFrameVectorDSID))
+                  ->vec_;
+  for (uint64_t i = 0; i < kDataFrameVectorSize; i++) {
+    vec.push_back(i * 3);
+  }
+  uint64_t client_size = kDataFrameVectorClientSize;
+  uint16_t output_len;
+  server->compute(kDataFrameVectorDSID, FarMemTest::kOpSetSize,
+                  sizeof(client_size),
+                  reinterpret_cast<uint8_t *>(&client_size), &output_len,
+                  nullptr);
+  TEST_ASSERT(output_len == 0);
+}
+
+void verify(Server *server) {
+  uint16_t data_len;
+  uint8_t data[Object::kMaxObjectDataSize];
+  for (uint64_t i = 0; i < kNumObjects; i++) {
+    uint64_t obj_id = i * kObjectSize;
+    server->read_object(kVanillaPtrDSID, sizeof(obj_id),
+                        reinterpret_cast<uint8_t *>(&obj_id), &data_len, data);
+    TEST_ASSERT(data_len == kObjectDataSize);
+    for (uint32_t j = 0; j < data_len; j++) {
+      TEST_ASSERT(data[j] == static_cast<uint8_t>(i));
+    }
+  }
+
+  for (uint64_t i = 0; i < kNumKVPairs; i++) {
+    server->read_object(kHashTableDSID, sizeof(i),
+                        reinterpret_cast<uint8_t *>(&i), &data_len, data);
+    TEST_ASSERT(data_len == sizeof(uint64_t));
+    TEST_ASSERT(*reinterpret_cast<uint64_t *>(data) == i * i);
+  }
+
+  auto &vec = reinterpret_cast<ServerDataFrameVector<long> *>(
+                  server->get_server_ds(kDataFrameVectorDSID))
+                  ->vec_;
+  TEST_ASSERT(vec.size() == kDataFrameVectorSize);
+  for (uint64_t i = 0; i < kDataFrameVectorSize; i++) {
+    TEST_ASSERT(vec[i] == static_cast<long>(i * 3));
+  }
+  uint64_t sizes[2];
+  uint16_t output_len;
+  server->compute(kDataFrameVectorDSID, FarMemTest::kOpGetSize, 0, nullptr,
+                  &output_len, reinterpret_cast<uint8_t *>(sizes));
+  TEST_ASSERT(output_len == sizeof(sizes));
+  TEST_ASSERT(sizes[0] == kDataFrameVectorClientSize);
+  TEST_ASSERT(sizes[1] >= kDataFrameVectorSize);
+}
+
+// Snapshots while another thread keeps overwriting all vanilla objects, one
+// round after another, with the round number. A point-in-time snapshot
+// catches a round midway: the objects before some index hold the round
+// number, and the rest hold the previous one.
+void test_concurrent_snapshot() {
+  {
+    Server server;
+    construct_all(&server, kHashTableDataSize);
+    populate(&server);
+    std::atomic<uint64_t> num_rounds{0};
+    std::atomic<bool> stop{false};
+    rt::Thread writer([&]() {
+      uint8_t data[kObjectDataSize];
+      for (uint64_t round = 1; !stop; round++) {
+        memset(data, static_cast<char>(round), sizeof(data));
+        for (uint64_t i = 0; i < kNumObjects; i++) {
+          uint64_t obj_id = i * kObjectSize;
+          server.write_object(kVanillaPtrDSID, sizeof(obj_id),
+                              reinterpret_cast<uint8_t *>(&obj_id),
+                              sizeof(data), data);
+        }
+        num_rounds = round;
+      }
+    });
+    while (num_rounds < 2) {
+      thread_yield();
+    }
+    TEST_ASSERT(server.snapshot(kSnapshotDir));
+    stop = true;
+    writer.Join();
+  }
+
+  Server server;
+  server.restore(kSnapshotDir);
+  construct_all(&server, kHashTableDataSize);
+  uint16_t data_len;
+  uint8_t data[Object::kMaxObjectDataSize];
+  uint8_t round = 0;
+  bool past_boundary = false;
+  for (uint64_t i = 0; i < kNumObjects; i++) {
+    uint64_t obj_id = i * kObjectSize;
+    server.read_object(kVanillaPtrDSID, sizeof(obj_id),
+                       reinterpret_cast<uint8_t *>(&obj_id), &data_len, data);
+    TEST_ASSERT(data_len == kObjectDataSize);
+    for (uint32_t j = 1; j < data_len; j++) {
+      TEST_ASSERT(data[j] == data[0]);
+    }
+    if (i == 0) {
+      round = data[0];
+    } else if (data[0] != round) {
+      TEST_ASSERT(!past_boundary);
+      TEST_ASSERT(data[0] == static_cast<uint8_t>(round - 1));
+      past_boundary = true;
+      round = data[0];
+    }
+  }
+}
+
+void do_work() {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  mkdir(kSnapshotDir, 0755);
+
+  {
+    Server server;
+    construct_all(&server, kHashTableDataSize);
+    populate(&server);
+    TEST_ASSERT(server.snapshot(kSnapshotDir));
+  }
+
+  // Reattach: constructing the same ds adopts the restored ones.
+  {
+    Server server;
+    server.restore(kSnapshotDir);
+    construct_all(&server, kHashTableDataSize);
+    verify(&server);
+  }
+
+  // A ds constructed with different params is rebuilt from scratch.
+  {
+    Server server;
+    server.restore(kSnapshotDir);
+    construct_all(&server, kHashTableDataSize * 2);
+    uint64_t key = 0;
+    uint16_t data_len;
+    uint8_t data[Object::kMaxObjectDataSize];
+    server.read_object(kHashTableDSID, sizeof(key),
+                       reinterpret_cast<uint8_t *>(&key), &data_len, data);
+    TEST_ASSERT(data_len == 0);
+  }
+
+  // Without reattach, the restored ds are dropped.
+  {
+    Server server;
+    server.restore(kSnapshotDir);
+    TEST_ASSERT(server.get_server_ds(kHashTableDSID));
+    server.discard_restored();
+    TEST_ASSERT(!server.get_server_ds(kHashTableDSID));
+  }
+
+  test_concurrent_snapshot();
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) { do_work(); }
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "concurrent_hopscotch.hpp"
+#include "dataframe_vector.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint32_t kNumShards = 4;
+constexpr static uint64_t kCacheSize = (128ULL << 20);
+constexpr static uint64_t kShardFarMemSize = (1ULL << 30);
+constexpr static uint64_t kWorkSetSize = (512ULL << 20);
+constexpr static uint32_t kNumGCThreads = 12;
+constexpr static uint32_t kHashTableNumEntriesShift = 16;
+constexpr static uint32_t kHashTableRemoteDataSize =
+    (Object::kHeaderSize + sizeof(uint64_t) * 2) *
+    (1 << kHashTableNumEntriesShift);
+constexpr static uint32_t kNumKVPairs = (1 << kHashTableNumEntriesShift) / 2;
+constexpr static uint64_t kNumRows = 100000;
+constexpr static uint64_t kNumKeys = 100;
+
+struct Data4096 {
+  char data[4096];
+};
+
+using Data_t = struct Data4096;
+
+constexpr static uint64_t kNumEntries = kWorkSetSize / sizeof(Data_t);
+
+void do_work(FarMemManager *manager, ShardedDevice *device) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  TEST_ASSERT(device->get_far_mem_size() == kNumShards * kShardFarMemSize);
+
+  // Vanilla objects are striped over all shards.
+  std::vector<uint32_t> stripe_cnts(kNumShards);
+  for (uint64_t addr = 0; addr < kNumShards * ShardedDevice::kStripeSize;
+       addr += ShardedDevice::kStripeSize) {
+    stripe_cnts[device->get_shard_idx(
+        kVanillaPtrDSID, sizeof(addr), reinterpret_cast<uint8_t *>(&addr))]++;
+  }
+  for (auto cnt : stripe_cnts) {
+    TEST_ASSERT(cnt == 1);
+  }
+
+  std::vector<UniquePtr<Data_t>> vec;
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+    {
+      DerefScope scope;
+      auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+      memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+    }
+    vec.emplace_back(std::move(far_mem_ptr));
+  }
+
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    const auto raw_const_ptr = vec[i].deref(scope);
+    for (uint32_t j = 0; j < sizeof(Data_t); j++) {
+      TEST_ASSERT(raw_const_ptr->data[j] == static_cast<char>(i));
+    }
+  }
+
+  // Hashtables are placed per ds_id.
+  auto hopscotch = manager->allocate_concurrent_hopscotch<uint64_t, uint64_t>(
+      kHashTableNumEntriesShift, kHashTableNumEntriesShift,
+      kHashTableRemoteDataSize);
+  for (uint64_t i = 0; i < kNumKVPairs; i++) {
+    hopscotch.insert_tp(i, i * i);
+  }
+  for (uint64_t i = 0; i < kNumKVPairs; i++) {
+    auto optional_value = hopscotch.find_tp(i);
+    TEST_ASSERT(optional_value);
+    TEST_ASSERT(*optional_value == i * i);
+  }
+
+  // DataFrameVector ops refer to other vectors (including their freshly
+  // allocated results), which must therefore live on the same shard.
+  auto key_vec = manager->allocate_dataframe_vector<int>();
+  auto val_vec = manager->allocate_dataframe_vector<long long>();
+  auto dim_vec = manager->allocate_dataframe_vector<int>();
+  for (uint64_t i = 0; i < kNumRows; i++) {
+    DerefScope scope;
+    key_vec.push_back(scope, static_cast<int>(i % kNumKeys));
+    val_vec.push_back(scope, static_cast<long long>(i));
+  }
+  for (uint64_t i = 0; i < kNumKeys; i += 2) {
+    DerefScope scope;
+    dim_vec.push_back(scope, static_cast<int>(i));
+  }
+
+  auto unique_vec = key_vec.get_col_unique_values(manager);
+  TEST_ASSERT(unique_vec.size() == kNumKeys);
+
+  auto indices = val_vec.filter(
+      manager, DataFramePredicate::cmp(key_vec, KernelCmpOp::Lt, 10));
+  TEST_ASSERT(indices.size() == kNumRows / kNumKeys * 10);
+  auto selected = val_vec.copy_data_by_idx(manager, indices);
+  TEST_ASSERT(selected.size() == indices.size());
+  for (uint64_t i = 0; i < selected.size(); i++) {
+    DerefScope scope;
+    auto val = selected.at(scope, i);
+    TEST_ASSERT(val == static_cast<long long>(indices.at(scope, i)));
+    TEST_ASSERT(val % kNumKeys < 10);
+  }
+
+  auto [lhs_indices, rhs_indices] =
+      key_vec.join(manager, dim_vec, DataFrameJoinPolicy::Inner);
+  TEST_ASSERT(lhs_indices.size() == kNumRows / 2);
+  TEST_ASSERT(rhs_indices.size() == kNumRows / 2);
+  auto joined_keys = key_vec.copy_data_by_idx(manager, lhs_indices);
+  auto joined_dims = dim_vec.copy_data_by_idx(manager, rhs_indices);
+  for (uint64_t i = 0; i < joined_keys.size(); i++) {
+    DerefScope scope;
+    TEST_ASSERT(joined_keys.at(scope, i) == joined_dims.at(scope, i));
+  }
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  std::vector<FarMemDevice *> shards;
+  for (uint32_t i = 0; i < kNumShards; i++) {
+    shards.push_back(new FakeDevice(kShardFarMemSize));
+  }
+  auto device = new ShardedDevice(shards);
+  auto manager = std::unique_ptr<FarMemManager>(
+      FarMemManagerFactory::build(kCacheSize, kNumGCThreads, device));
+  do_work(manager.get(), device);
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "concurrent_hopscotch.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+// Should be the same as SHM_SERVER_NAME in shared.sh.
+constexpr static char kShmName[] = "/aifm_shm";
+constexpr static uint64_t kCacheSize = 256 * Region::kSize;
+constexpr static uint64_t kFarMemSize = (1ULL << 32); // 4 GB.
+constexpr static uint64_t kWorkSetSize = 1 << 30;
+constexpr static uint64_t kNumGCThreads = 12;
+constexpr static uint64_t kNumChannels = 64;
+constexpr static uint32_t kHashTableNumEntriesShift = 16;
+constexpr static uint32_t kHashTableRemoteDataSize =
+    (Object::kHeaderSize + sizeof(uint64_t) * 2) *
+    (1 << kHashTableNumEntriesShift);
+constexpr static uint32_t kNumKVPairs = (1 << kHashTableNumEntriesShift) / 2;
+
+struct Data4096 {
+  char data[4096];
+};
+
+using Data_t = struct Data4096;
+
+constexpr static uint64_t kNumEntries = kWorkSetSize / sizeof(Data_t);
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  // Vanilla objects go to the shared arena directly.
+  std::vector<UniquePtr<Data_t>> vec;
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+    {
+      DerefScope scope;
+      auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+      memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+    }
+    vec.emplace_back(std::move(far_mem_ptr));
+  }
+
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    const auto raw_const_ptr = vec[i].deref(scope);
+    for (uint32_t j = 0; j < sizeof(Data_t); j++) {
+      TEST_ASSERT(raw_const_ptr->data[j] == static_cast<char>(i));
+    }
+  }
+
+  // Hashtable objects go through the rings to the server process.
+  auto hopscotch = manager->allocate_concurrent_hopscotch<uint64_t, uint64_t>(
+      kHashTableNumEntriesShift, kHashTableNumEntriesShift,
+      kHashTableRemoteDataSize);
+  for (uint64_t i = 0; i < kNumKVPairs; i++) {
+    hopscotch.insert_tp(i, i * i);
+  }
+  for (uint64_t i = 0; i < kNumKVPairs; i++) {
+    auto optional_value = hopscotch.find_tp(i);
+    TEST_ASSERT(optional_value);
+    TEST_ASSERT(*optional_value == i * i);
+  }
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads,
+      new ShmDevice(kShmName, kNumChannels, kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static char kFilePath[] = "/tmp/aifm_storage_device";
+constexpr static uint64_t kCacheSize = 256 * Region::kSize;
+constexpr static uint64_t kFarMemSize = (1ULL << 32); // 4 GB.
+constexpr static uint64_t kNumGCThreads = 12;
+constexpr static uint64_t kWorkSetSize = 1 << 30;
+
+struct Data64 {
+  char data[64];
+};
+
+struct Data4096 {
+  char data[4096];
+};
+
+// Small objects are packed into full blocks by the write-combining buffer,
+// while large ones span multiple blocks.
+template <typename Data_t> void run(FarMemManager *manager) {
+  constexpr uint64_t kNumEntries = kWorkSetSize / sizeof(Data_t);
+  std::vector<UniquePtr<Data_t>> vec;
+
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+    {
+      DerefScope scope;
+      auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+      memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+    }
+    vec.emplace_back(std::move(far_mem_ptr));
+  }
+
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    const auto raw_const_ptr = vec[i].deref(scope);
+    for (uint32_t j = 0; j < sizeof(Data_t); j++) {
+      TEST_ASSERT(raw_const_ptr->data[j] == static_cast<char>(i));
+    }
+  }
+}
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  run<Data64>(manager);
+  run<Data4096>(manager);
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads,
+      new StorageDevice(std::string(kFilePath), kFarMemSize)));
+  do_work(manager.get());
+  manager.reset();
+  unlink(kFilePath);
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
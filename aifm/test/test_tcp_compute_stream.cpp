@@ -0,0 +1,89 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "dataframe_vector.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint64_t kCacheSize = (64ULL << 20);
+constexpr static uint64_t kFarMemSize = (4ULL << 30);
+constexpr static uint32_t kNumGCThreads = 12;
+constexpr static uint32_t kNumConnections = 4;
+// The unique values make a response of 64 times the stream window, so the
+// server has to wait for credit many times over.
+constexpr static uint64_t kNumUniqueValues =
+    64 * TCPDevice::kStreamWindowSize / sizeof(long long);
+constexpr static uint64_t kNumRows = 2 * kNumUniqueValues;
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  auto vec = manager->allocate_dataframe_vector<long long>();
+  for (uint64_t i = 0; i < kNumRows; i++) {
+    DerefScope scope;
+    vec.push_back(scope, static_cast<long long>(i % kNumUniqueValues));
+  }
+
+  // Appending the streamed values to a vector that exceeds the local cache
+  // makes the consumer issue requests on the connection of the stream.
+  auto unique_vec = vec.get_col_unique_values_streamed(manager);
+  TEST_ASSERT(unique_vec.size() == kNumUniqueValues);
+  std::unordered_set<long long> seen;
+  for (uint64_t i = 0; i < unique_vec.size(); i++) {
+    DerefScope scope;
+    auto val = unique_vec.at(scope, i);
+    TEST_ASSERT(val >= 0 && static_cast<uint64_t>(val) < kNumUniqueValues);
+    TEST_ASSERT(seen.insert(val).second);
+  }
+
+  cout << "Passed" << endl;
+}
+
+int argc;
+void _main(void *arg) {
+  char **argv = static_cast<char **>(arg);
+  std::string ip_addr_port(argv[1]);
+  auto raddr = helpers::str_to_netaddr(ip_addr_port);
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads,
+          new TCPDevice(raddr, kNumConnections, kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int _argc, char *argv[]) {
+  int ret;
+
+  if (_argc < 3) {
+    std::cerr << "usage: [cfg_file] [ip_addr:port]" << std::endl;
+    return -EINVAL;
+  }
+
+  char conf_path[strlen(argv[1]) + 1];
+  strcpy(conf_path, argv[1]);
+  for (int i = 2; i < _argc; i++) {
+    argv[i - 1] = argv[i];
+  }
+  argc = _argc - 1;
+
+  ret = runtime_init(conf_path, _main, argv);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "array.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+#include "stats.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint64_t kCacheSize = (128ULL << 20);
+constexpr static uint64_t kFarMemSize = (4ULL << 30);
+constexpr static uint32_t kNumGCThreads = 12;
+constexpr static uint32_t kNumEntries =
+    (8ULL << 20); // So the array size is larger than the local cache size.
+constexpr static uint32_t kNumConnections = 300;
+// Hedge aggressively so that both the primary and the duplicate win often.
+constexpr static double kHedgePercentile = 0.5;
+
+void do_work(FarMemManager *manager) {
+  auto array = manager->allocate_array<uint64_t, kNumEntries>();
+
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    array.at_mut(scope, i) = i * i;
+  }
+  for (uint32_t round = 0; round < 2; round++) {
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      DerefScope scope;
+      TEST_ASSERT(array.at(scope, i) == i * i);
+    }
+  }
+
+  auto num_hedgeable_reads = Stats::get_num_hedgeable_reads();
+  auto num_hedged_reads = Stats::get_num_hedged_reads();
+  auto num_hedge_wins = Stats::get_num_hedge_wins();
+  TEST_ASSERT(num_hedgeable_reads > 0);
+  TEST_ASSERT(num_hedged_reads > 0);
+  TEST_ASSERT(num_hedge_wins <= num_hedged_reads);
+  cout << "hedge rate = "
+       << static_cast<double>(num_hedged_reads) / num_hedgeable_reads
+       << ", win rate = "
+       << static_cast<double>(num_hedge_wins) / num_hedged_reads << endl;
+
+  cout << "Passed" << endl;
+}
+
+int argc;
+void _main(void *arg) {
+  char **argv = static_cast<char **>(arg);
+  std::string ip_addr_port(argv[1]);
+  auto raddr = helpers::str_to_netaddr(ip_addr_port);
+  auto *device = new TCPDevice(raddr, kNumConnections, kFarMemSize);
+  device->enable_hedged_reads(kHedgePercentile);
+  std::unique_ptr<FarMemManager> manager = std::unique_ptr<FarMemManager>(
+      FarMemManagerFactory::build(kCacheSize, kNumGCThreads, device));
+  do_work(manager.get());
+}
+
+int main(int _argc, char *argv[]) {
+  int ret;
+
+  if (_argc < 3) {
+    std::cerr << "usage: [cfg_file] [ip_addr:port]" << std::endl;
+    return -EINVAL;
+  }
+
+  char conf_path[strlen(argv[1]) + 1];
+  strcpy(conf_path, argv[1]);
+  for (int i = 2; i < _argc; i++) {
+    argv[i - 1] = argv[i];
+  }
+  argc = _argc - 1;
+
+  ret = runtime_init(conf_path, _main, argv);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+extern "C" {
+#include <runtime/runtime.h>
+#include <runtime/timer.h>
+}
+
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static char kFilePath[] = "/tmp/aifm_tiered_device";
+constexpr static uint64_t kCacheSize = 256 * Region::kSize;
+constexpr static uint64_t kFarMemSize = (1ULL << 32); // 4 GB.
+constexpr static uint64_t kFastTierSize = (256ULL << 20);
+constexpr static uint64_t kFastTierHighWatermarkSize = kFastTierSize * 0.9;
+constexpr static uint64_t kNumGCThreads = 12;
+constexpr static uint64_t kWorkSetSize = 1 << 30;
+constexpr static uint32_t kDemoteWaitUs = 100 * 1000;
+
+struct Data4096 {
+  char data[4096];
+};
+
+using Data_t = struct Data4096;
+
+constexpr static uint64_t kNumEntries = kWorkSetSize / sizeof(Data_t);
+
+void do_work(FarMemManager *manager, TieredDevice *device) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  std::vector<UniquePtr<Data_t>> vec;
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+    {
+      DerefScope scope;
+      auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+      memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+    }
+    vec.emplace_back(std::move(far_mem_ptr));
+  }
+
+  // The working set is 4x the fast tier, which the slow tier extends.
+  TEST_ASSERT(device->get_far_mem_size() == kFarMemSize);
+  TEST_ASSERT(device->get_fast_tier_used_size() <= kFastTierSize);
+  // Gives the demoter time to push the cold objects to the slow tier, which
+  // frees their space in the fast tier.
+  timer_sleep(kDemoteWaitUs);
+  TEST_ASSERT(device->get_num_demotions());
+  TEST_ASSERT(device->get_fast_tier_used_size() <= kFastTierHighWatermarkSize);
+
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    const auto raw_const_ptr = vec[i].deref(scope);
+    for (uint32_t j = 0; j < sizeof(Data_t); j++) {
+      TEST_ASSERT(raw_const_ptr->data[j] == static_cast<char>(i));
+    }
+  }
+  TEST_ASSERT(device->get_num_slow_tier_hits());
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  auto device = new TieredDevice(
+      new FakeDevice(kFastTierSize),
+      new StorageDevice(std::string(kFilePath), kFarMemSize), kFastTierSize);
+  auto manager = std::unique_ptr<FarMemManager>(
+      FarMemManagerFactory::build(kCacheSize, kNumGCThreads, device));
+  do_work(manager.get(), device);
+  manager.reset();
+  unlink(kFilePath);
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}